@@ -0,0 +1,199 @@
+// client/src/batchKeyGen.cpp
+// keyGen + REkeyGen for many clients in one process: the CryptoContext is
+// loaded once, then every key pair and every re-encryption key is generated
+// and written on a pool of threads.
+//
+//   batchKeyGen <cc_path> <plan.json> [--threads N] [--timing FILE]
+//
+// plan.json:
+//   { "clients": [ {"id": "client_1", "public": <path>, "private": <path>}, ... ],
+//     "rekeys":  [ {"from": "client_1", "to": "client_2", "output": <path>}, ... ] }
+//
+// A client with "generate": false keeps the keys already at its paths (its
+// private key is needed only if it is the "from" of a rekey), so clients can
+// join a federation whose existing members keep their keys. Rekeys are
+// generated once all key pairs are. Every artifact is reported on stdout
+// with its generation and write time; --timing appends the same as CSV
+// (artifact,kind,output,start_ms,gen_ms,write_ms,bytes).
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <filesystem>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "ppfl/ppfl.h"
+#include "stage_stats.h"
+
+namespace {
+
+struct Client {
+    std::string id, pubPath, privPath;
+    bool generate = true;
+    ppfl::PublicKey pk;
+    ppfl::PrivateKey sk;
+};
+
+struct ReKey {
+    size_t from, to;
+    std::string output;
+};
+
+// One generated file set: a client's key pair or one rekey
+struct Artifact {
+    std::string name, kind, output;
+    int64_t startUs = 0, genUs = 0, writeUs = 0;
+    uintmax_t bytes = 0;
+};
+
+uintmax_t fileSize(const std::string& path) {
+    std::error_code ec;
+    uintmax_t n = std::filesystem::file_size(path, ec);
+    return ec ? 0 : n;
+}
+
+void readPlan(const std::string& path, std::vector<Client>& clients, std::vector<ReKey>& rekeys) {
+    ppfl::json plan = ppfl::ReadJsonFile(path);
+    std::map<std::string, size_t> index;
+    for (const auto& c : plan.at("clients")) {
+        Client client;
+        client.id = c.at("id").get<std::string>();
+        client.pubPath = c.at("public").get<std::string>();
+        client.privPath = c.value("private", std::string());
+        client.generate = c.value("generate", true);
+        if (client.generate && client.privPath.empty()) throw ppfl::Error(client.id + ": no private key path");
+        if (!index.emplace(client.id, clients.size()).second) throw ppfl::Error("client " + client.id + " listed twice");
+        clients.push_back(std::move(client));
+    }
+    for (const auto& r : plan.value("rekeys", ppfl::json::array())) {
+        std::string from = r.at("from").get<std::string>(), to = r.at("to").get<std::string>();
+        if (!index.count(from) || !index.count(to)) throw ppfl::Error("rekey " + from + " -> " + to + ": unknown client");
+        if (from == to) throw ppfl::Error("rekey " + from + " -> " + to + ": same client");
+        if (clients[index[from]].privPath.empty()) throw ppfl::Error(from + ": rekey source without a private key");
+        rekeys.push_back({index[from], index[to], r.at("output").get<std::string>()});
+    }
+}
+
+void appendTiming(const std::string& path, const std::vector<Artifact>& artifacts) {
+    std::ostringstream rows;
+    for (const auto& a : artifacts) {
+        rows << a.name << "," << a.kind << "," << a.output << "," << a.startUs / 1000.0 << "," << a.genUs / 1000.0
+             << "," << a.writeUs / 1000.0 << "," << a.bytes << "\n";
+    }
+    int fd = ::open(path.c_str(), O_WRONLY | O_APPEND | O_CREAT, 0644);
+    if (fd < 0) {
+        std::cerr << "[batchKeyGen] cannot write " << path << std::endl;
+        return;
+    }
+    struct stat st;
+    std::string out = rows.str();
+    if (::fstat(fd, &st) == 0 && st.st_size == 0) out = "artifact,kind,output,start_ms,gen_ms,write_ms,bytes\n" + out;
+    ssize_t n = ::write(fd, out.data(), out.size());
+    (void) n;
+    ::close(fd);
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+    std::vector<std::string> args;
+    size_t threads = 0;
+    std::string timing;
+    for (int i = 1; i < argc; i++) {
+        std::string a = argv[i];
+        if (a == "--threads" && i + 1 < argc) threads = std::stoul(argv[++i]);
+        else if (a == "--timing" && i + 1 < argc) timing = argv[++i];
+        else args.push_back(a);
+    }
+    if (args.size() != 2) {
+        std::cerr << "Usage: " << argv[0] << " <cc_path> <plan.json> [--threads N] [--timing FILE]" << std::endl;
+        return 1;
+    }
+
+    try {
+        ppfl::stats::Recorder stats("batchkeygen");
+        int64_t t0 = ppfl::trace::NowUs();
+
+        stats.begin("context");
+        auto ctx = ppfl::Context::LoadFile(args[0]);
+        std::cout << "[batchKeyGen] CryptoContext loaded from " << args[0] << std::endl;
+
+        // Existing clients' keys, loaded before anything is generated
+        stats.begin("load");
+        std::vector<Client> clients;
+        std::vector<ReKey> rekeys;
+        readPlan(args[1], clients, rekeys);
+        std::vector<bool> signs(clients.size(), false);
+        for (const auto& r : rekeys) signs[r.from] = true;
+        for (size_t i = 0; i < clients.size(); i++) {
+            Client& c = clients[i];
+            if (c.generate) continue;
+            c.pk = ppfl::LoadPublicKeyFile(c.pubPath);
+            if (signs[i]) c.sk = ppfl::LoadPrivateKeyFile(c.privPath);
+        }
+
+        std::vector<size_t> fresh;
+        for (size_t i = 0; i < clients.size(); i++) {
+            if (clients[i].generate) fresh.push_back(i);
+        }
+        std::vector<Artifact> artifacts(fresh.size() + rekeys.size());
+
+        stats.begin("keygen");
+        ppfl::ParallelFor(fresh.size(), threads, [&](size_t k) {
+            Client& c = clients[fresh[k]];
+            Artifact& a = artifacts[k];
+            a.name = c.id;
+            a.kind = "keypair";
+            a.output = c.pubPath;
+            a.startUs = ppfl::trace::NowUs();
+            ppfl::KeyPair kp = ppfl::GenerateKeyPair(*ctx);
+            int64_t t1 = ppfl::trace::NowUs();
+            ppfl::SavePrivateKeyFile(c.privPath, kp.secretKey);
+            ppfl::SavePublicKeyFile(c.pubPath, kp.publicKey);
+            a.writeUs = ppfl::trace::NowUs() - t1;
+            a.genUs = t1 - a.startUs;
+            a.startUs -= t0;
+            a.bytes = fileSize(c.privPath) + fileSize(c.pubPath);
+            c.pk = kp.publicKey;
+            c.sk = kp.secretKey;
+        });
+        for (size_t k = 0; k < fresh.size(); k++) stats.fileBytes(artifacts[k].bytes);
+
+        stats.begin("rekeygen");
+        ppfl::ParallelFor(rekeys.size(), threads, [&](size_t k) {
+            const ReKey& r = rekeys[k];
+            Artifact& a = artifacts[fresh.size() + k];
+            a.name = clients[r.from].id + "->" + clients[r.to].id;
+            a.kind = "rekey";
+            a.output = r.output;
+            a.startUs = ppfl::trace::NowUs();
+            ppfl::EvalKey rk = ppfl::GenerateReKey(*ctx, clients[r.from].sk, clients[r.to].pk);
+            int64_t t1 = ppfl::trace::NowUs();
+            ppfl::SaveEvalKeyFile(r.output, rk);
+            a.writeUs = ppfl::trace::NowUs() - t1;
+            a.genUs = t1 - a.startUs;
+            a.startUs -= t0;
+            a.bytes = fileSize(r.output);
+        });
+        for (size_t k = fresh.size(); k < artifacts.size(); k++) stats.fileBytes(artifacts[k].bytes);
+        stats.end();
+
+        for (const auto& a : artifacts) {
+            std::cout << "[batchKeyGen] " << a.kind << " " << a.name << ": gen " << a.genUs / 1000.0 << " ms, write "
+                      << a.writeUs / 1000.0 << " ms, " << a.bytes << " bytes -> " << a.output << std::endl;
+        }
+        if (!timing.empty()) appendTiming(timing, artifacts);
+        stats.finish();
+        std::cout << "[batchKeyGen] " << fresh.size() << " key pair(s), " << rekeys.size() << " rekey(s) in "
+                  << (ppfl::trace::NowUs() - t0) / 1000 << " ms" << std::endl;
+    } catch (const std::exception& e) {
+        std::cerr << "[batchKeyGen] ERROR: " << e.what() << std::endl;
+        return 1;
+    }
+    return 0;
+}
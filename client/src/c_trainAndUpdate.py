@@ -1,4 +1,4 @@
-import os, sys, json
+import os, sys, json, select
 import pandas as pd
 import numpy as np
 from datetime import datetime
@@ -12,6 +12,10 @@ from tensorflow.keras.optimizers import Adam
 from tensorflow.keras.regularizers import l2
 from tensorflow.keras import backend as K
 import matplotlib.pyplot as plt
+from tensor_io import write_tensor_file
+
+BASE_DIR = os.path.abspath(os.path.join(os.path.dirname(__file__), "../.."))
+sys.path.insert(0, os.path.join(BASE_DIR, "client/build"))  # ppfl_client extension (make pyppfl)
 
 os.environ["TF_CPP_MIN_LOG_LEVEL"] = "3"  # 0=all logs, 1=filter INFO, 2=filter WARN, 3=filter ERROR
 tf.get_logger().setLevel("ERROR") # kills the CUDA/cuDNN spam.
@@ -21,18 +25,35 @@ tf.get_logger().setLevel("ERROR") # kills the CUDA/cuDNN spam.
 # ----------------------
 
 def load_config(config_path):
-    base_dir = os.path.abspath(os.path.join(os.path.dirname(__file__), "../.."))
     with open(config_path, "r") as f:
         cfg = json.load(f)
     for key in [
+        "CC_PATH", "PUBKEY_PATH", "PRIVKEY_PATH",
         "INPUT_WEIGHTS_PATH",
+        "OUTPUT_ENCRYPTED_WEIGHTS_PATH",
+        "AGGREGATED_ENCRYPTED_WEIGHTS_PATH",
         "OUTPUT_DECRYPTED_WEIGHTS_PATH",
         "data_file", "output_file", "log_dir", "model_file"
     ]:
         if key in cfg["CLIENT"]:
-            cfg["CLIENT"][key] = os.path.join(base_dir, cfg["CLIENT"][key])
+            cfg["CLIENT"][key] = os.path.join(BASE_DIR, cfg["CLIENT"][key])
     return cfg
 
+# In-process crypto sessions (CryptoContext + keys). They outlive one round
+# only in driver mode (serve() below), where one process runs every round of
+# its client
+_CRYPTO_SESSIONS = {}
+
+def crypto_session(cfg):
+    """ppfl_client.Session for this client if INPROCESS_CRYPTO is enabled, else None."""
+    if not cfg.get("INPROCESS_CRYPTO", False):
+        return None
+    import ppfl_client
+    key = (cfg["CC_PATH"], cfg["PUBKEY_PATH"], cfg["PRIVKEY_PATH"])
+    if key not in _CRYPTO_SESSIONS:
+        _CRYPTO_SESSIONS[key] = ppfl_client.Session(*key)
+    return _CRYPTO_SESSIONS[key]
+
 def prepare_sequences(df, lookback, feature_names, target_name, fs, ts):
     features = fs.transform(df[feature_names].values)
     targets = ts.transform(df[[target_name]].values)
@@ -77,6 +98,13 @@ def reconstruct_model_from_json(json_path, lookback, n_features):
     model.set_weights(layer_weights)  # should matches array length
     return model
 
+def reconstruct_model_from_ciphertext(session, enc_path, lookback, n_features):
+    # Tensors come back already shaped; np.asarray reads them in place
+    layer_weights = [np.asarray(t, dtype=np.float32) for t in session.decrypt(enc_path)]
+    model = create_model(lookback, n_features)
+    model.set_weights(layer_weights)
+    return model
+
 # ----------------------
 # Main Training + Update
 # ----------------------
@@ -125,7 +153,11 @@ def main(config_path):
     # ----------------------------
     # Load global model if available
     # ----------------------------
-    if os.path.exists(cfg["OUTPUT_DECRYPTED_WEIGHTS_PATH"]):
+    session = crypto_session(cfg)
+    if session is not None and os.path.exists(cfg["AGGREGATED_ENCRYPTED_WEIGHTS_PATH"]):
+        print(f"[{client_id}] Decrypting global model in-process from {cfg['AGGREGATED_ENCRYPTED_WEIGHTS_PATH']}")
+        model = reconstruct_model_from_ciphertext(session, cfg["AGGREGATED_ENCRYPTED_WEIGHTS_PATH"], cfg["lookback"], cfg["n_features"]+1)
+    elif os.path.exists(cfg["OUTPUT_DECRYPTED_WEIGHTS_PATH"]):
         print(f"[{client_id}] Loading global model from {cfg['OUTPUT_DECRYPTED_WEIGHTS_PATH']}")
         model = reconstruct_model_from_json(cfg["OUTPUT_DECRYPTED_WEIGHTS_PATH"], cfg["lookback"], cfg["n_features"]+1)
     else:
@@ -170,24 +202,34 @@ def main(config_path):
     print(f"[{client_id}] Model saved -> {cfg['model_file']}")
 
     # ----------------------------
-    # Export weights to JSON for encryption
+    # Export weights for encryption
     # ----------------------------
-    weights_summary = []
     weights = model.get_weights()   # only trainable weights
-    
-    for idx, arr in enumerate(weights):
-        weights_summary.append({
-            "layer": f"param_{idx}",  # you cant recover exact layer name, but idx is fine
-            "shape": list(arr.shape),
-            "mean": float(np.mean(arr)),
-            "std_dev": float(np.std(arr)),
-            "values": arr.flatten().tolist()
-        })
-    
-    with open(cfg["INPUT_WEIGHTS_PATH"], "w") as f:
-        json.dump({"weights_summary": weights_summary}, f, indent=2)
-    
-    print(f"[{client_id}] Weights exported -> {cfg['INPUT_WEIGHTS_PATH']}")
+    names = [f"param_{idx}" for idx in range(len(weights))]  # you cant recover exact layer name, but idx is fine
+
+    if session is not None:
+        # encrypt straight from the Keras arrays, no plaintext file in between
+        session.encrypt(weights, out_path=cfg["OUTPUT_ENCRYPTED_WEIGHTS_PATH"], names=names)
+        print(f"[{client_id}] Weights encrypted in-process -> {cfg['OUTPUT_ENCRYPTED_WEIGHTS_PATH']}")
+    elif cfg["INPUT_WEIGHTS_PATH"].endswith(".bin"):
+        # raw float32 tensor file, mmap'd by encryptModelWeights (no decimal round-trip)
+        write_tensor_file(cfg["INPUT_WEIGHTS_PATH"], names, weights)
+    else:
+        weights_summary = []
+        for name, arr in zip(names, weights):
+            weights_summary.append({
+                "layer": name,
+                "shape": list(arr.shape),
+                "mean": float(np.mean(arr)),
+                "std_dev": float(np.std(arr)),
+                "values": arr.flatten().tolist()
+            })
+
+        with open(cfg["INPUT_WEIGHTS_PATH"], "w") as f:
+            json.dump({"weights_summary": weights_summary}, f, indent=2)
+
+    if session is None:
+        print(f"[{client_id}] Weights exported -> {cfg['INPUT_WEIGHTS_PATH']}")
 
     # ----------------------------
     # Evaluation
@@ -201,8 +243,52 @@ def main(config_path):
 
     K.clear_session()
 
+# ----------------------
+# Driver mode
+# ----------------------
+
+def serve(cmd_path, reply_path, parent_pid):
+    """Run main() once per request read from the FIFO cmd_path, keeping this
+    process (TensorFlow and the crypto sessions) alive across rounds.
+
+    A request is one line "<token> <round> <config.json>", answered on the FIFO
+    reply_path with "<token> OK" or "<token> ERR <message>". The driver exits
+    on "quit" or once the orchestrator (parent_pid) is gone. Both FIFOs are
+    opened read-write, so neither side blocks on open and a closing writer is
+    not an EOF.
+    """
+    cmd_fd = os.open(cmd_path, os.O_RDWR)
+    reply_fd = os.open(reply_path, os.O_RDWR)
+    buf = b""
+    while True:
+        while b"\n" not in buf:
+            ready, _, _ = select.select([cmd_fd], [], [], 5.0)
+            if os.getppid() != parent_pid:
+                return
+            if ready:
+                buf += os.read(cmd_fd, 4096)
+        line, buf = buf.split(b"\n", 1)
+        parts = line.decode().strip().split(" ", 2)
+        if parts == ["quit"]:
+            return
+        if len(parts) != 3:
+            continue
+        token, round_no, config_path = parts
+        os.environ["PPFL_TRACE_ROUND"] = round_no
+        try:
+            main(config_path)
+            status = "OK"
+        except Exception as e:
+            status = "ERR " + " ".join(f"{type(e).__name__}: {e}".split())
+        sys.stdout.flush()
+        os.write(reply_fd, f"{token} {status}\n".encode())
+
 if __name__ == "__main__":
+    if len(sys.argv) == 5 and sys.argv[1] == "--serve":
+        serve(sys.argv[2], sys.argv[3], int(sys.argv[4]))
+        sys.exit(0)
     if len(sys.argv)<2:
         print("Usage: python c_train_update.py <config.json>")
+        print("       python c_train_update.py --serve <cmd_fifo> <reply_fifo> <parent_pid>")
         sys.exit(1)
     main(sys.argv[1])
\ No newline at end of file
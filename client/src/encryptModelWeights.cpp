@@ -1,24 +1,39 @@
-#include "openfhe.h"
-
+#include <cstdio>
+#include <filesystem>
 #include <fstream>
 #include <iostream>
-#include <sstream>
+#include <memory>
 #include <string>
-#include <vector>
-#include <nlohmann/json.hpp>
-
-#include "cryptocontext-ser.h"
-#include "key/key-ser.h"
-#include "ciphertext-ser.h"
-#include "base64_utils.h"
 
-using json = nlohmann::json;
-using namespace lbcrypto;
+#include "ppfl/ppfl.h"
+#include "stage_stats.h"
+
+namespace fs = std::filesystem;
+
+// Streaming mode: each encrypted layer is published to <dir> as
+// layer_<k>_of_<n>.json (written to a temp name, then renamed, so a watcher
+// never sees a partial file); an empty "done" marker follows the last layer.
+static ppfl::LayerSink layerDirSink(const std::string& dir) {
+    return [dir](size_t idx, size_t total, const ppfl::json& layer) {
+        char name[64];
+        std::snprintf(name, sizeof(name), "layer_%05zu_of_%05zu.json", idx, total);
+        fs::path final = fs::path(dir) / name;
+        fs::path tmp = fs::path(dir) / (std::string(".") + name + ".tmp");
+        {
+            std::ofstream out(tmp);
+            if (!out) throw ppfl::Error("Cannot write " + tmp.string());
+            out << layer.dump();
+        }
+        fs::rename(tmp, final);
+        std::cout << "[encrypt] Layer " << idx + 1 << "/" << total << " published to " << final << std::endl;
+    };
+}
 
 int main(int argc, char* argv[]) {
-    if (argc != 5) {
+    if (!(argc == 5 || (argc == 7 && std::string(argv[5]) == "--layer-dir"))) {
         std::cerr << "Usage: " << argv[0] 
-                  << " <cc_path> <pubkey_path> <input_weights> <output_encfile>" 
+                  << " <cc_path> <pubkey_path> <input_weights(.json or tensor file)> <output_encfile>" 
+                  << " [--layer-dir <dir>]" 
                   << std::endl;
         return 1;
     }
@@ -27,109 +42,59 @@ int main(int argc, char* argv[]) {
     std::string pubkey_path    = argv[2];
     std::string input_weights  = argv[3];
     std::string output_encfile = argv[4];
-
-    // Step 1: Load CryptoContext
-    CryptoContext<DCRTPoly> cc;
-    if (!Serial::DeserializeFromFile(cc_path, cc, SerType::JSON)) {
-        std::cerr << "[encrypt] ERROR: Failed to deserialize crypto context from " << cc_path << std::endl;
-        return 1;
-    }
-    std::cout << "[encrypt] CryptoContext loaded from " << cc_path << std::endl;
-
-    // ? Get batch size from CryptoContext
-    size_t batchSize = cc->GetEncodingParams()->GetBatchSize();
-    std::cout << "[encrypt] Batch size from CryptoContext = " << batchSize << std::endl;
-
-    // Step 2: Load Public Key
-    PublicKey<DCRTPoly> publicKey;
-    if (!Serial::DeserializeFromFile(pubkey_path, publicKey, SerType::JSON)) {
-        std::cerr << "[encrypt] ERROR: Failed to deserialize public key from " << pubkey_path << std::endl;
-        return 1;
-    }
-    std::cout << "[encrypt] Public key loaded from " << pubkey_path << std::endl;
-
-    // Step 3: Read input JSON (weights)
-    std::ifstream inputFile(input_weights);
-    if (!inputFile.is_open()) {
-        std::cerr << "[encrypt] ERROR: Could not open input weights file: " << input_weights << std::endl;
-        return 1;
-    }
-
-    json inputJson;
-    inputFile >> inputJson;
-    inputFile.close();
-    std::cout << "[encrypt] Weights loaded from " << input_weights << std::endl;
-
-    // Step 4: Prepare output JSON structure
-    json outputJson;
-    outputJson["weights_summary"] = json::array();
-
-    for (const auto& weight : inputJson["weights_summary"]) {
-        std::string layerName = weight["layer"];
-
-        // ? Skip optimizer layers
-        if (layerName.rfind("optimizer/", 0) == 0) {
-            std::cout << "[encrypt] Skipping optimizer layer: " << layerName << std::endl;
-            continue;
+    std::string layer_dir      = argc == 7 ? argv[6] : "";
+
+    try {
+        ppfl::stats::Recorder stats("encrypt");
+
+        // Step 1: Load CryptoContext
+        stats.begin("context");
+        auto ctx = ppfl::Context::LoadFile(cc_path);
+        std::cout << "[encrypt] CryptoContext loaded from " << cc_path << std::endl;
+        std::cout << "[encrypt] Batch size from CryptoContext = " << ctx->BatchSize() << std::endl;
+
+        // Step 2: Load Public Key
+        stats.begin("key");
+        auto publicKey = ppfl::LoadPublicKeyFile(pubkey_path);
+        std::cout << "[encrypt] Public key loaded from " << pubkey_path << std::endl;
+
+        ppfl::LayerSink sink;
+        if (!layer_dir.empty()) {
+            fs::create_directories(layer_dir);
+            sink = layerDirSink(layer_dir);
         }
 
-        json encryptedWeight;
-        encryptedWeight["layer"] = layerName;
-        encryptedWeight["shape"] = weight["shape"];
-
-        // Encrypt mean
-        double mean = weight["mean"];
-        auto pt_mean = cc->MakeCKKSPackedPlaintext(std::vector<double>{mean});
-        auto ct_mean = cc->Encrypt(publicKey, pt_mean);
-        std::stringstream ss_mean;
-        Serial::Serialize(ct_mean, ss_mean, SerType::BINARY);
-        encryptedWeight["mean"] = Base64Encode(ss_mean.str());
-
-        // Encrypt std_dev
-        double stddev = weight["std_dev"];
-        auto pt_stddev = cc->MakeCKKSPackedPlaintext(std::vector<double>{stddev});
-        auto ct_stddev = cc->Encrypt(publicKey, pt_stddev);
-        std::stringstream ss_stddev;
-        Serial::Serialize(ct_stddev, ss_stddev, SerType::BINARY);
-        encryptedWeight["std_dev"] = Base64Encode(ss_stddev.str());
-
-        // Encrypt values in chunks of batchSize with padding
-        std::vector<double> samples = weight["values"];
-        std::vector<std::string> encryptedSampleBatches;
-
-        for (size_t i = 0; i < samples.size(); i += batchSize) {
-            size_t end = std::min(i + batchSize, samples.size());
-            std::vector<double> batch(samples.begin() + i, samples.begin() + end);
-
-            // Pad with zeros if smaller than batchSize
-            if (batch.size() < batchSize) {
-                batch.resize(batchSize, 0.0);
-            }
-
-            Plaintext pt_batch = cc->MakeCKKSPackedPlaintext(batch);
-            Ciphertext<DCRTPoly> ct_batch = cc->Encrypt(publicKey, pt_batch);
-
-            std::stringstream ss_batch;
-            Serial::Serialize(ct_batch, ss_batch, SerType::BINARY);
-            encryptedSampleBatches.push_back(Base64Encode(ss_batch.str()));
+        // Step 3 + 4: Read input weights (JSON or raw tensor file) and encrypt per layer
+        stats.begin("parse");
+        stats.fileBytes(fs::file_size(input_weights));
+        ppfl::json outputJson;
+        if (IsTensorFile(input_weights)) {
+            TensorFile tensors(input_weights);
+            std::cout << "[encrypt] Tensor weights mapped from " << input_weights << std::endl;
+            stats.begin("compute");
+            outputJson = ppfl::EncryptModel(*ctx, publicKey, tensors.tensors(), sink);
+        } else {
+            auto inputJson = ppfl::ReadJsonFile(input_weights);
+            std::cout << "[encrypt] Weights loaded from " << input_weights << std::endl;
+            stats.begin("compute");
+            outputJson = ppfl::EncryptModel(*ctx, publicKey, inputJson, sink);
         }
-
-        encryptedWeight["values"] = encryptedSampleBatches;
-
-        outputJson["weights_summary"].push_back(encryptedWeight);
-    }
-
-    // Step 5: Write encrypted data
-    std::ofstream outputFile(output_encfile);
-    if (!outputFile.is_open()) {
-        std::cerr << "[encrypt] ERROR: Failed to write to output file: " << output_encfile << std::endl;
+        if (!layer_dir.empty()) std::ofstream(fs::path(layer_dir) / "done");
+        auto cts = ppfl::CountCiphertexts(outputJson);
+        stats.ciphertexts(cts.count, cts.bytes);
+
+        // Step 5: Write encrypted data
+        stats.begin("serialize");
+        std::string text = ppfl::SerializeJson(outputJson);
+        stats.begin("write");
+        ppfl::WriteTextFile(output_encfile, text);
+        stats.fileBytes(text.size());
+        stats.finish();
+    } catch (const std::exception& e) {
+        std::cerr << "[encrypt] ERROR: " << e.what() << std::endl;
         return 1;
     }
 
-    outputFile << std::setw(2) << outputJson << std::endl;
-    outputFile.close();
-
     std::cout << "[encrypt] Encryption completed successfully and saved in " << output_encfile << std::endl;
     return 0;
 }
-
@@ -0,0 +1,430 @@
+// client/src/ppflClientModule.cpp
+// Python extension "ppfl_client": in-process keyGen / encryptModelWeights /
+// decryptModelWeights for c_trainAndUpdate.py, built on libppfl.
+//
+//   s = ppfl_client.Session(cc_path, pubkey_path=None, privkey_path=None)
+//   s.keygen(pubkey_out, privkey_out)        # generate, save and keep loaded
+//   s.rekeys([(peer_pubkey_path, rekey_out), ...], threads=0)  # one per peer, in parallel
+//   s.encrypt(model.get_weights(), out_path=None, names=None) -> bytes | None
+//   s.decrypt(path_or_bytes) -> [ppfl_client.Tensor, ...]
+//
+// encrypt() reads the NumPy arrays through the buffer protocol in place;
+// decrypt() returns Tensor objects that export their values through the
+// buffer protocol, so np.asarray(t) is zero-copy and already shaped.
+// The GIL is released while crypto work runs.
+
+#define PY_SSIZE_T_CLEAN
+#include <Python.h>
+
+#include <cstring>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "ppfl/ppfl.h"
+
+static PyObject* PpflError;
+
+// ==================== Tensor ====================
+
+typedef struct {
+    PyObject_HEAD
+    ppfl::PlainLayer* layer;
+    std::vector<Py_ssize_t>* shape;
+    std::vector<Py_ssize_t>* strides;
+} TensorObject;
+
+static void Tensor_dealloc(TensorObject* self) {
+    delete self->layer;
+    delete self->shape;
+    delete self->strides;
+    Py_TYPE(self)->tp_free((PyObject*)self);
+}
+
+static int Tensor_getbuffer(TensorObject* self, Py_buffer* view, int flags) {
+    if (flags & PyBUF_WRITABLE) {
+        PyErr_SetString(PyExc_BufferError, "Tensor is read-only");
+        return -1;
+    }
+    view->obj = (PyObject*)self;
+    Py_INCREF(self);
+    view->buf = self->layer->values.data();
+    view->len = (Py_ssize_t)(self->layer->values.size() * sizeof(double));
+    view->readonly = 1;
+    view->itemsize = sizeof(double);
+    view->format = (flags & PyBUF_FORMAT) ? (char*)"d" : nullptr;
+    view->ndim = (int)self->shape->size();
+    view->shape = (flags & PyBUF_ND) ? self->shape->data() : nullptr;
+    view->strides = (flags & PyBUF_STRIDES) ? self->strides->data() : nullptr;
+    view->suboffsets = nullptr;
+    view->internal = nullptr;
+    return 0;
+}
+
+static PyBufferProcs Tensor_as_buffer = {(getbufferproc)Tensor_getbuffer, nullptr};
+
+static PyObject* Tensor_get_name(TensorObject* self, void*) {
+    return PyUnicode_FromString(self->layer->name.c_str());
+}
+
+static PyObject* Tensor_get_shape(TensorObject* self, void*) {
+    PyObject* t = PyTuple_New((Py_ssize_t)self->shape->size());
+    if (!t) return nullptr;
+    for (size_t i = 0; i < self->shape->size(); i++)
+        PyTuple_SET_ITEM(t, (Py_ssize_t)i, PyLong_FromSsize_t((*self->shape)[i]));
+    return t;
+}
+
+static PyObject* Tensor_get_mean(TensorObject* self, void*) { return PyFloat_FromDouble(self->layer->mean); }
+static PyObject* Tensor_get_std(TensorObject* self, void*) { return PyFloat_FromDouble(self->layer->std_dev); }
+
+static PyGetSetDef Tensor_getset[] = {
+    {"name", (getter)Tensor_get_name, nullptr, "layer name", nullptr},
+    {"shape", (getter)Tensor_get_shape, nullptr, "layer shape", nullptr},
+    {"mean", (getter)Tensor_get_mean, nullptr, "decrypted mean", nullptr},
+    {"std_dev", (getter)Tensor_get_std, nullptr, "decrypted std_dev", nullptr},
+    {nullptr, nullptr, nullptr, nullptr, nullptr}};
+
+static PyTypeObject TensorType = {PyVarObject_HEAD_INIT(nullptr, 0)};
+
+// Takes ownership of `layer`
+static PyObject* Tensor_new(ppfl::PlainLayer* layer) {
+    TensorObject* self = PyObject_New(TensorObject, &TensorType);
+    if (!self) {
+        delete layer;
+        return nullptr;
+    }
+    self->layer = layer;
+    self->shape = new std::vector<Py_ssize_t>();
+    self->strides = new std::vector<Py_ssize_t>();
+
+    size_t count = 1;
+    for (const auto& dim : layer->shape) {
+        self->shape->push_back(dim.get<Py_ssize_t>());
+        count *= dim.get<size_t>();
+    }
+    // decryption trims padding but cannot invent missing batches
+    layer->values.resize(count, 0.0);
+
+    self->strides->resize(self->shape->size());
+    Py_ssize_t stride = sizeof(double);
+    for (size_t i = self->shape->size(); i-- > 0;) {
+        (*self->strides)[i] = stride;
+        stride *= (*self->shape)[i];
+    }
+    return (PyObject*)self;
+}
+
+// ==================== Session ====================
+
+typedef struct {
+    PyObject_HEAD
+    std::shared_ptr<const ppfl::Context>* ctx;
+    ppfl::PublicKey* pk;
+    ppfl::PrivateKey* sk;
+} SessionObject;
+
+static void Session_dealloc(SessionObject* self) {
+    delete self->ctx;
+    delete self->pk;
+    delete self->sk;
+    Py_TYPE(self)->tp_free((PyObject*)self);
+}
+
+static PyObject* Session_new(PyTypeObject* type, PyObject*, PyObject*) {
+    SessionObject* self = (SessionObject*)type->tp_alloc(type, 0);
+    if (!self) return nullptr;
+    self->ctx = new std::shared_ptr<const ppfl::Context>();
+    self->pk = new ppfl::PublicKey();
+    self->sk = new ppfl::PrivateKey();
+    return (PyObject*)self;
+}
+
+// Run `fn` without the GIL; ppfl::Error / std::exception -> PpflError
+template <typename Fn>
+static bool runUnlocked(Fn&& fn) {
+    std::string err;
+    Py_BEGIN_ALLOW_THREADS
+    try {
+        fn();
+    } catch (const std::exception& e) {
+        err = e.what();
+        if (err.empty()) err = "unknown error";
+    }
+    Py_END_ALLOW_THREADS
+    if (!err.empty()) {
+        PyErr_SetString(PpflError, err.c_str());
+        return false;
+    }
+    return true;
+}
+
+static int Session_init(SessionObject* self, PyObject* args, PyObject* kwds) {
+    static const char* kwlist[] = {"cc_path", "pubkey_path", "privkey_path", nullptr};
+    const char* cc_path = nullptr;
+    const char* pubkey_path = nullptr;
+    const char* privkey_path = nullptr;
+    if (!PyArg_ParseTupleAndKeywords(args, kwds, "s|zz", (char**)kwlist, &cc_path, &pubkey_path, &privkey_path))
+        return -1;
+
+    std::string cc(cc_path), pub(pubkey_path ? pubkey_path : ""), priv(privkey_path ? privkey_path : "");
+    bool ok = runUnlocked([&] {
+        *self->ctx = ppfl::Context::LoadFile(cc);
+        if (!pub.empty()) *self->pk = ppfl::LoadPublicKeyFile(pub);
+        if (!priv.empty()) *self->sk = ppfl::LoadPrivateKeyFile(priv);
+    });
+    return ok ? 0 : -1;
+}
+
+static PyObject* Session_keygen(SessionObject* self, PyObject* args) {
+    const char* pubkey_out;
+    const char* privkey_out;
+    if (!PyArg_ParseTuple(args, "ss", &pubkey_out, &privkey_out)) return nullptr;
+
+    std::string pubOut(pubkey_out), privOut(privkey_out);
+    ppfl::KeyPair kp;
+    const ppfl::Context& ctx = **self->ctx;
+    if (!runUnlocked([&] {
+            kp = ppfl::GenerateKeyPair(ctx);
+            ppfl::SavePrivateKeyFile(privOut, kp.secretKey);
+            ppfl::SavePublicKeyFile(pubOut, kp.publicKey);
+        }))
+        return nullptr;
+
+    *self->pk = kp.publicKey;
+    *self->sk = kp.secretKey;
+    Py_RETURN_NONE;
+}
+
+static PyObject* Session_rekeys(SessionObject* self, PyObject* args, PyObject* kwds) {
+    static const char* kwlist[] = {"peers", "threads", nullptr};
+    PyObject* peers;
+    Py_ssize_t threads = 0;
+    if (!PyArg_ParseTupleAndKeywords(args, kwds, "O|n", (char**)kwlist, &peers, &threads)) return nullptr;
+    if (!*self->sk) {
+        PyErr_SetString(PpflError, "rekeys() needs the session's private key (privkey_path or keygen())");
+        return nullptr;
+    }
+
+    std::vector<std::string> pubPaths, outPaths;
+    PyObject* seq = PySequence_Fast(peers, "peers must be a sequence of (peer_pubkey_path, rekey_out)");
+    if (!seq) return nullptr;
+    for (Py_ssize_t i = 0; i < PySequence_Fast_GET_SIZE(seq); i++) {
+        PyObject* item = PySequence_Fast_GET_ITEM(seq, i);
+        const char* pub;
+        const char* out;
+        if (!PyTuple_Check(item) || !PyArg_ParseTuple(item, "ss", &pub, &out)) {
+            if (!PyErr_Occurred()) PyErr_SetString(PyExc_TypeError, "peers items must be (peer_pubkey_path, rekey_out)");
+            Py_DECREF(seq);
+            return nullptr;
+        }
+        pubPaths.push_back(pub);
+        outPaths.push_back(out);
+    }
+    Py_DECREF(seq);
+
+    const ppfl::Context& ctx = **self->ctx;
+    const ppfl::PrivateKey& sk = *self->sk;
+    size_t n = threads > 0 ? (size_t)threads : 0;
+    if (!runUnlocked([&] {
+            std::vector<ppfl::PublicKey> pks(pubPaths.size());
+            ppfl::ParallelFor(pks.size(), n, [&](size_t i) { pks[i] = ppfl::LoadPublicKeyFile(pubPaths[i]); });
+            std::vector<ppfl::EvalKey> rks = ppfl::GenerateReKeys(ctx, sk, pks, n);
+            ppfl::ParallelFor(rks.size(), n, [&](size_t i) { ppfl::SaveEvalKeyFile(outPaths[i], rks[i]); });
+        }))
+        return nullptr;
+    Py_RETURN_NONE;
+}
+
+static bool isFormat(const char* fmt, char c) {
+    if (!fmt) return false;
+    if (fmt[0] == '<' || fmt[0] == '=' || fmt[0] == '@') fmt++;
+    return fmt[0] == c && fmt[1] == '\0';
+}
+
+static PyObject* Session_encrypt(SessionObject* self, PyObject* args, PyObject* kwds) {
+    static const char* kwlist[] = {"weights", "out_path", "names", nullptr};
+    PyObject* weights;
+    const char* out_path = nullptr;
+    PyObject* names = Py_None;
+    if (!PyArg_ParseTupleAndKeywords(args, kwds, "O|zO", (char**)kwlist, &weights, &out_path, &names))
+        return nullptr;
+    if (!*self->pk) {
+        PyErr_SetString(PpflError, "no public key loaded (pass pubkey_path or call keygen)");
+        return nullptr;
+    }
+
+    PyObject* seq = PySequence_Fast(weights, "weights must be a sequence of arrays");
+    if (!seq) return nullptr;
+    Py_ssize_t n = PySequence_Fast_GET_SIZE(seq);
+
+    // Hold every buffer for the duration of the call; views point into them
+    std::vector<Py_buffer> buffers;
+    buffers.reserve((size_t)n);
+    std::vector<TensorView> tensors((size_t)n);
+    std::vector<std::vector<double>> copies;  // misaligned buffers, re-aligned
+    auto release = [&] {
+        for (auto& b : buffers) PyBuffer_Release(&b);
+        Py_DECREF(seq);
+    };
+
+    for (Py_ssize_t i = 0; i < n; i++) {
+        Py_buffer view;
+        if (PyObject_GetBuffer(PySequence_Fast_GET_ITEM(seq, i), &view, PyBUF_C_CONTIGUOUS | PyBUF_FORMAT) != 0) {
+            release();
+            return nullptr;
+        }
+        buffers.push_back(view);
+
+        TensorView& t = tensors[(size_t)i];
+        if (isFormat(view.format, 'f')) {
+            t.dtype = TensorDType::Float32;
+        } else if (isFormat(view.format, 'd')) {
+            t.dtype = TensorDType::Float64;
+        } else {
+            PyErr_Format(PyExc_TypeError, "weights[%zd]: expected float32 or float64, got '%s'", i,
+                         view.format ? view.format : "?");
+            release();
+            return nullptr;
+        }
+        t.data = view.buf;
+        if (reinterpret_cast<uintptr_t>(view.buf) % (size_t)view.itemsize != 0) {
+            copies.emplace_back(((size_t)view.len + sizeof(double) - 1) / sizeof(double));
+            memcpy(copies.back().data(), view.buf, (size_t)view.len);
+            t.data = copies.back().data();
+        }
+        t.count = (size_t)(view.len / view.itemsize);
+        for (int d = 0; d < view.ndim; d++) t.shape.push_back((size_t)view.shape[d]);
+
+        if (names != Py_None) {
+            PyObject* name = PySequence_GetItem(names, i);
+            const char* s = name ? PyUnicode_AsUTF8(name) : nullptr;
+            if (!s) {
+                Py_XDECREF(name);
+                release();
+                return nullptr;
+            }
+            t.name = s;
+            Py_DECREF(name);
+        } else {
+            t.name = "param_" + std::to_string(i);
+        }
+    }
+
+    std::string out(out_path ? out_path : ""), blob;
+    const ppfl::Context& ctx = **self->ctx;
+    const ppfl::PublicKey& pk = *self->pk;
+    bool ok = runUnlocked([&] {
+        ppfl::json enc = ppfl::EncryptModel(ctx, pk, tensors);
+        if (out.empty()) blob = enc.dump();
+        else ppfl::WriteJsonFile(out, enc);
+    });
+    release();
+    if (!ok) return nullptr;
+
+    if (out_path) Py_RETURN_NONE;
+    return PyBytes_FromStringAndSize(blob.data(), (Py_ssize_t)blob.size());
+}
+
+static PyObject* Session_decrypt(SessionObject* self, PyObject* arg) {
+    if (!*self->sk) {
+        PyErr_SetString(PpflError, "no private key loaded (pass privkey_path or call keygen)");
+        return nullptr;
+    }
+
+    // str -> path, anything bytes-like -> serialized encrypted weights
+    std::string path, data;
+    if (PyUnicode_Check(arg)) {
+        const char* s = PyUnicode_AsUTF8(arg);
+        if (!s) return nullptr;
+        path = s;
+    } else {
+        Py_buffer view;
+        if (PyObject_GetBuffer(arg, &view, PyBUF_SIMPLE) != 0) return nullptr;
+        data.assign((const char*)view.buf, (size_t)view.len);
+        PyBuffer_Release(&view);
+    }
+
+    std::vector<std::unique_ptr<ppfl::PlainLayer>> layers;
+    const ppfl::Context& ctx = **self->ctx;
+    const ppfl::PrivateKey& sk = *self->sk;
+    bool ok = runUnlocked([&] {
+        ppfl::json enc = path.empty() ? ppfl::json::parse(data) : ppfl::ReadJsonFile(path);
+        for (const auto& encLayer : enc.at("weights_summary"))
+            layers.push_back(std::make_unique<ppfl::PlainLayer>(ppfl::DecryptLayer(ctx, sk, encLayer)));
+    });
+    if (!ok) return nullptr;
+
+    PyObject* list = PyList_New((Py_ssize_t)layers.size());
+    if (!list) return nullptr;
+    for (size_t i = 0; i < layers.size(); i++) {
+        PyObject* t = Tensor_new(layers[i].release());
+        if (!t) {
+            Py_DECREF(list);
+            return nullptr;
+        }
+        PyList_SET_ITEM(list, (Py_ssize_t)i, t);
+    }
+    return list;
+}
+
+static PyObject* Session_get_batch_size(SessionObject* self, void*) {
+    return PyLong_FromSize_t((*self->ctx)->BatchSize());
+}
+
+static PyMethodDef Session_methods[] = {
+    {"keygen", (PyCFunction)Session_keygen, METH_VARARGS,
+     "keygen(pubkey_out, privkey_out): generate a key pair, save it and keep it loaded"},
+    {"rekeys", (PyCFunction)(void (*)(void))Session_rekeys, METH_VARARGS | METH_KEYWORDS,
+     "rekeys(peers, threads=0): save a re-encryption key to each (peer_pubkey_path, rekey_out), in parallel"},
+    {"encrypt", (PyCFunction)(void (*)(void))Session_encrypt, METH_VARARGS | METH_KEYWORDS,
+     "encrypt(weights, out_path=None, names=None): encrypt float32/float64 arrays"},
+    {"decrypt", (PyCFunction)Session_decrypt, METH_O,
+     "decrypt(path_or_bytes): decrypt encrypted weights into a list of Tensor"},
+    {nullptr, nullptr, 0, nullptr}};
+
+static PyGetSetDef Session_getset[] = {
+    {"batch_size", (getter)Session_get_batch_size, nullptr, "CKKS batch size of the context", nullptr},
+    {nullptr, nullptr, nullptr, nullptr, nullptr}};
+
+static PyTypeObject SessionType = {PyVarObject_HEAD_INIT(nullptr, 0)};
+
+// ==================== Module ====================
+
+static struct PyModuleDef ppflClientModule = {
+    PyModuleDef_HEAD_INIT, "ppfl_client", "In-process PPFL client crypto (libppfl)", -1,
+    nullptr, nullptr, nullptr, nullptr, nullptr};
+
+PyMODINIT_FUNC PyInit_ppfl_client(void) {
+    TensorType.tp_name = "ppfl_client.Tensor";
+    TensorType.tp_basicsize = sizeof(TensorObject);
+    TensorType.tp_dealloc = (destructor)Tensor_dealloc;
+    TensorType.tp_flags = Py_TPFLAGS_DEFAULT;
+    TensorType.tp_doc = "Decrypted layer; exposes float64 values via the buffer protocol";
+    TensorType.tp_as_buffer = &Tensor_as_buffer;
+    TensorType.tp_getset = Tensor_getset;
+
+    SessionType.tp_name = "ppfl_client.Session";
+    SessionType.tp_basicsize = sizeof(SessionObject);
+    SessionType.tp_dealloc = (destructor)Session_dealloc;
+    SessionType.tp_flags = Py_TPFLAGS_DEFAULT;
+    SessionType.tp_doc = "CryptoContext and client keys kept loaded across rounds";
+    SessionType.tp_new = Session_new;
+    SessionType.tp_init = (initproc)Session_init;
+    SessionType.tp_methods = Session_methods;
+    SessionType.tp_getset = Session_getset;
+
+    if (PyType_Ready(&TensorType) < 0 || PyType_Ready(&SessionType) < 0) return nullptr;
+
+    PyObject* m = PyModule_Create(&ppflClientModule);
+    if (!m) return nullptr;
+
+    PpflError = PyErr_NewException("ppfl_client.Error", nullptr, nullptr);
+    Py_INCREF(PpflError);
+    PyModule_AddObject(m, "Error", PpflError);
+    Py_INCREF(&TensorType);
+    PyModule_AddObject(m, "Tensor", (PyObject*)&TensorType);
+    Py_INCREF(&SessionType);
+    PyModule_AddObject(m, "Session", (PyObject*)&SessionType);
+    return m;
+}
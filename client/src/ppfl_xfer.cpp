@@ -0,0 +1,586 @@
+// client/src/ppfl_xfer.cpp
+// Keep-alive transfer client for the orchestration layer (native backend of msend)
+//
+// Runs a batch of GET/POST transfers against runMserver, --jobs at a time.
+// Every worker keeps one persistent HttpClient per server, so a batch of
+// layer uploads or key downloads pays one TCP connect per worker instead of
+// one curl process and connection per file.
+//
+// Usage:
+//   ppfl_xfer [options] GET  <url> <output>
+//   ppfl_xfer [options] POST <url> <output> <client_id> <type> <file>
+//   ppfl_xfer [options] -            (jobs on stdin, one per line, same fields)
+//
+// Options:
+//   --jobs N            parallel transfers (default 4)
+//   --retries N         attempts per transfer (default 5)
+//   --backoff-ms MS     first retry delay; doubles per attempt with full jitter, capped at 8 s (default 200)
+//   --timeout-ms MS     socket timeout (default 60000)
+//   --compress MODE     auto | zstd | gzip | none (default auto: zstd if built in, else gzip)
+//   --level-gzip N / --level-zstd N / --min-bytes N    as WIRE_* in helper_fns.sh
+//   --cache-dir DIR     conditional-GET cache, same layout as msend's HTTP_CACHE_DIR
+//   --metrics FILE      append one row per transfer (comm_metrics.csv schema)
+//   --chunk-size N      bytes per upload chunk / download range, 0 = single requests (default 4 MiB)
+//   --chunked-min N     bodies (as sent) this large use runMserver's /upload/ protocol (default 16 MiB)
+//
+// POST bodies go out raw (application/octet-stream, client id and type in
+// X-PPFL-Client / X-PPFL-Type) instead of a multipart form; a 415 drops to
+// the next codec. Large bodies are sent in checksummed chunks through
+// /upload/ and resume where they stopped, across retries and across runs
+// (with --cache-dir). GETs fetch --chunk-size ranges into <output>.part, so
+// a rerun after a failure continues from the last complete range; replies
+// are decoded from their Content-Encoding into <output> once whole.
+// Transport errors, 408, 429 and 5xx are retried; any other status is final.
+// Metrics bytes are socket bytes, headers and retried attempts included.
+// Exit status is 1 if any transfer failed.
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <ctime>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <fcntl.h>
+#include <openssl/evp.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <nlohmann/json.hpp>
+
+#include "http_client.h"
+#include "trace.h"
+#include "wireCodec.h"
+
+using Clock = std::chrono::steady_clock;
+
+namespace {
+
+struct Options {
+    size_t jobs = 4;
+    int retries = 5;
+    long backoff_ms = 200;
+    int timeout_ms = 60000;
+    std::string compress = "auto";
+    wire::Options wire;
+    std::string cache_dir;
+    std::string metrics;
+    size_t chunk_size = 4 << 20;
+    size_t chunked_min = 16 << 20;
+};
+
+struct Job {
+    std::string method;  // GET | POST
+    std::string url, output, client_id, type, file;
+    std::string base, path;  // http://host:port, /endpoint?query
+};
+
+struct Result {
+    bool ok = false;
+    int status = 0;
+    size_t payload = 0, sent = 0, received = 0;
+    long latency_ms = 0;
+};
+
+constexpr long kBackoffCapMs = 8000;
+std::mutex g_out_m;  // stdout/stderr lines and metrics rows
+
+// ----------------------
+// Helpers
+// ----------------------
+bool splitUrl(Job& j) {
+    const std::string scheme = "http://";
+    if (j.url.compare(0, scheme.size(), scheme) != 0) return false;
+    size_t slash = j.url.find('/', scheme.size());
+    j.base = j.url.substr(0, slash);
+    j.path = slash == std::string::npos ? "/" : j.url.substr(slash);
+    return true;
+}
+
+std::string readFile(const std::string& path) {
+    std::ifstream f(path, std::ios::binary);
+    if (!f) throw std::runtime_error("cannot read " + path);
+    std::ostringstream ss;
+    ss << f.rdbuf();
+    return ss.str();
+}
+
+void writeFile(const std::string& path, const std::string& data) {
+    std::ofstream f(path, std::ios::binary | std::ios::trunc);
+    f.write(data.data(), (std::streamsize) data.size());
+    if (!f) throw std::runtime_error("cannot write " + path);
+}
+
+std::string digestHex(const char* data, size_t size, const EVP_MD* type) {
+    unsigned char md[EVP_MAX_MD_SIZE];
+    unsigned int len = 0;
+    EVP_Digest(data, size, md, &len, type, nullptr);
+    char hex[2 * EVP_MAX_MD_SIZE + 1];
+    for (unsigned int i = 0; i < len; i++) std::snprintf(hex + 2 * i, 3, "%02x", md[i]);
+    return std::string(hex, 2 * len);
+}
+
+// Same key as msend: md5 of the URL (or "url|output"), hex
+std::string md5Hex(const std::string& s) {
+    return digestHex(s.data(), s.size(), EVP_md5());
+}
+
+std::string sha256Hex(const char* data, size_t size) {
+    return digestHex(data, size, EVP_sha256());
+}
+
+size_t fileSize(const std::string& path) {
+    struct stat st;
+    return ::stat(path.c_str(), &st) == 0 ? (size_t) st.st_size : 0;
+}
+
+// `stat -c '%.9Y %s'`, what msend records in <key>.out
+std::string fileStamp(const std::string& path) {
+    struct stat st;
+    if (::stat(path.c_str(), &st) != 0) return "";
+    char buf[64];
+    std::snprintf(buf, sizeof(buf), "%ld.%09ld %lld", (long) st.st_mtim.tv_sec, (long) st.st_mtim.tv_nsec,
+                  (long long) st.st_size);
+    return buf;
+}
+
+std::string readSmall(const std::string& path) {
+    std::ifstream f(path);
+    std::string s;
+    std::getline(f, s);
+    return s;
+}
+
+void appendMetric(const Options& opt, const Job& j, const Result& r) {
+    if (opt.metrics.empty()) return;
+    std::time_t t = std::time(nullptr);
+    char ts[32];
+    std::strftime(ts, sizeof(ts), "%Y-%m-%d %H:%M:%S", std::localtime(&t));
+    std::ostringstream row;
+    row << ts << ",client," << j.method << "," << j.path << "," << j.client_id << "," << j.type << ","
+        << (j.method == "POST" ? j.file : j.output) << "," << r.payload << "," << r.sent << "," << r.received
+        << "," << r.latency_ms << "," << (r.status ? std::to_string(r.status) : "000") << "\n";
+
+    std::lock_guard<std::mutex> lk(g_out_m);
+    int fd = ::open(opt.metrics.c_str(), O_WRONLY | O_APPEND | O_CREAT, 0644);
+    if (fd < 0) return;
+    struct stat st;
+    std::string line = row.str();
+    if (::fstat(fd, &st) == 0 && st.st_size == 0) {
+        line = "timestamp,role,method,endpoint,client_id,type,file,payload_size,bytes_sent,bytes_received,"
+               "latency_ms,http_code\n" + line;
+    }
+    ssize_t n = ::write(fd, line.data(), line.size());
+    (void) n;
+    ::close(fd);
+}
+
+// Codecs to try for a body of `size` bytes, best first; "" = as-is
+std::vector<std::string> uploadCodecs(const Options& opt, size_t size) {
+    if (opt.compress == "none" || size < opt.wire.min_bytes) return {""};
+    std::vector<std::string> codecs;
+    if (opt.compress == "auto" || opt.compress == "zstd") {
+        if (wire::Supported("zstd")) codecs.push_back("zstd");
+    }
+    codecs.push_back("gzip");
+    codecs.push_back("");
+    return codecs;
+}
+
+bool retryable(int status) {
+    return status == 408 || status == 429 || status / 100 == 5;
+}
+
+// ----------------------
+// Worker: one keep-alive connection per server
+// ----------------------
+class Worker {
+public:
+    explicit Worker(const Options& opt) : opt_(opt), rng_(std::random_device{}()) {}
+
+    Result run(const Job& j) {
+        Result r;
+        auto start = Clock::now();
+        ppfl::trace::Span span(j.method + " " + j.path.substr(0, j.path.find('?')), {-1, j.client_id});
+        HttpClient& http = client(j.base);
+        size_t sent0 = http.bytesSent(), recv0 = http.bytesReceived();
+        std::string err;
+        try {
+            r.ok = j.method == "POST" ? post(http, j, r) : get(http, j, r);
+        } catch (const std::exception& e) {
+            err = e.what();
+        }
+        r.sent = http.bytesSent() - sent0;
+        r.received = http.bytesReceived() - recv0;
+        r.latency_ms = (long) std::chrono::duration_cast<std::chrono::milliseconds>(Clock::now() - start).count();
+        span.args().bytes = r.payload;
+
+        std::lock_guard<std::mutex> lk(g_out_m);
+        if (r.ok) {
+            std::cout << "[ppfl_xfer] " << j.method << " " << j.path << " -> " << r.status << " (" << r.payload
+                      << " B, " << (j.method == "POST" ? r.sent : r.received) << " B on the wire, " << r.latency_ms
+                      << " ms)" << std::endl;
+        } else {
+            std::cerr << "[ppfl_xfer] ERROR: " << j.method << " " << j.url << " failed"
+                      << (r.status ? " (HTTP " + std::to_string(r.status) + ")" : "")
+                      << (err.empty() ? "" : ": " + err) << std::endl;
+        }
+        return r;
+    }
+
+    size_t connects() const {
+        size_t n = 0;
+        for (const auto& kv : clients_) n += kv.second->connects();
+        return n;
+    }
+
+private:
+    HttpClient& client(const std::string& base) {
+        auto& c = clients_[base];
+        if (!c) c = std::make_unique<HttpClient>(base, opt_.timeout_ms);
+        return *c;
+    }
+
+    // Send with jittered exponential backoff between attempts
+    template <class F>
+    HttpResponse attempt(const Job& j, F send) {
+        for (int n = 0;; n++) {
+            std::string why;
+            try {
+                HttpResponse r = send();
+                if (!retryable(r.status)) return r;
+                if (n + 1 >= opt_.retries) return r;
+                why = "HTTP " + std::to_string(r.status);
+            } catch (const std::runtime_error& e) {
+                if (n + 1 >= opt_.retries) throw;
+                why = e.what();
+            }
+            long cap = std::min(kBackoffCapMs, opt_.backoff_ms << std::min(n, 16));
+            long delay = std::uniform_int_distribution<long>(0, cap)(rng_);
+            {
+                std::lock_guard<std::mutex> lk(g_out_m);
+                std::cerr << "[ppfl_xfer] WARN: " << j.method << " " << j.path << " attempt " << n + 1 << " failed ("
+                          << why << "), retrying in " << delay << " ms" << std::endl;
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds(delay));
+        }
+    }
+
+    bool post(HttpClient& http, const Job& j, Result& r) {
+        const std::string body = readFile(j.file);
+        r.payload = body.size();
+        HttpResponse resp;
+        for (const std::string& enc : uploadCodecs(opt_, body.size())) {
+            std::string encoded = enc.empty() ? std::string() : wire::Encode(enc, body, opt_.wire);
+            const std::string& out = enc.empty() ? body : encoded;
+            HttpHeaders h = {{"X-PPFL-Client", j.client_id}, {"X-PPFL-Type", j.type}};
+            if (!enc.empty()) h.emplace_back("Content-Encoding", enc);
+            int status = 0;
+            if (opt_.chunk_size && out.size() >= opt_.chunked_min) status = postChunked(http, j, enc, out, resp);
+            if (!status) resp = attempt(j, [&] { return http.post(j.path, out, "application/octet-stream", h); });
+            if (resp.status != 415) break;
+        }
+        r.status = resp.status;
+        if (!j.output.empty()) writeFile(j.output, resp.body);  // the server's ack, as msend keeps it
+        return resp.status / 100 == 2;
+    }
+
+    // Upload `out` (already in `enc`) through /upload/ in chunks, each retried
+    // on its own. The upload id is kept in <cache-dir>/<md5(url|file)>.upload
+    // with the file's stamp, so a rerun sends only what the server is missing.
+    // Returns the final status, or 0 if the server has no /upload/ routes.
+    int postChunked(HttpClient& http, const Job& j, const std::string& enc, const std::string& out,
+                    HttpResponse& resp) {
+        std::string state = opt_.cache_dir.empty() ? "" : opt_.cache_dir + "/" + md5Hex(j.url + "|" + j.file) + ".upload";
+        std::string stamp = fileStamp(j.file) + " " + (enc.empty() ? "identity" : enc);
+        std::string id;
+        size_t chunk = opt_.chunk_size;
+        std::vector<size_t> missing;
+
+        if (!state.empty() && ::access(state.c_str(), F_OK) == 0) {
+            std::istringstream ss(readFile(state));
+            std::string saved;
+            std::getline(ss, id);
+            std::getline(ss, saved);
+            if (saved != stamp) id.clear();
+        }
+        if (!id.empty()) {
+            resp = attempt(j, [&] { return http.get("/upload/" + id); });
+            nlohmann::json st = nlohmann::json::parse(resp.body, nullptr, false);
+            if (resp.status == 200 && st.is_object() && st.value("size", (size_t) 0) == out.size()) {
+                chunk = st.value("chunk_size", chunk);
+                missing = st.value("missing", std::vector<size_t>());
+            } else {
+                id.clear();  // expired or finished: start over
+            }
+        }
+        if (id.empty()) {
+            nlohmann::json req = {{"target", j.path}, {"size", out.size()}, {"chunk_size", chunk},
+                                  {"encoding", enc}, {"sha256", sha256Hex(out.data(), out.size())},
+                                  {"client_id", j.client_id}, {"type", j.type}};
+            resp = attempt(j, [&] { return http.post("/upload/start", req.dump(), "application/json"); });
+            if (resp.status == 404 || resp.status == 405) return 0;
+            nlohmann::json st = nlohmann::json::parse(resp.body, nullptr, false);
+            if (resp.status != 201 || !st.is_object()) return resp.status;
+            id = st.value("upload_id", std::string());
+            chunk = st.value("chunk_size", chunk);
+            for (size_t off = 0; off < out.size(); off += chunk) missing.push_back(off);
+            if (!state.empty()) {
+                ::mkdir(opt_.cache_dir.c_str(), 0755);
+                writeFile(state, id + "\n" + stamp + "\n");
+            }
+        }
+
+        for (size_t off : missing) {
+            size_t len = std::min(chunk, out.size() - off);
+            std::string body = out.substr(off, len);
+            HttpHeaders h = {{"X-Chunk-SHA256", sha256Hex(body.data(), body.size())},
+                             {"Content-Type", "application/octet-stream"}};
+            resp = attempt(j, [&] {
+                return http.request("PUT", "/upload/" + id + "?offset=" + std::to_string(off), body, h);
+            });
+            if (resp.status != 200) return resp.status;
+        }
+        resp = attempt(j, [&] { return http.post("/upload/" + id + "/finish", "", "application/json"); });
+        if (!state.empty() && resp.status != 409) std::remove(state.c_str());
+        return resp.status;
+    }
+
+    // Ranges of --chunk-size are appended to <output>.part; <output>.part.meta
+    // holds the representation's ETag and Content-Encoding. A failed run leaves
+    // both behind and the next one resumes with If-Range; a 200 in reply means
+    // the file changed (or ranges are unsupported) and replaces the part.
+    bool get(HttpClient& http, const Job& j, Result& r) {
+        std::string ckey, okey;
+        HttpHeaders h;
+        if (opt_.compress != "none") h.emplace_back("Accept-Encoding", wire::AcceptList());
+        if (!opt_.cache_dir.empty()) {
+            ::mkdir(opt_.cache_dir.c_str(), 0755);
+            ckey = opt_.cache_dir + "/" + md5Hex(j.url);
+            okey = opt_.cache_dir + "/" + md5Hex(j.url + "|" + j.output);
+        }
+
+        const std::string part = j.output + ".part", meta = part + ".meta";
+        std::string etag, encoding;
+        size_t have = 0;
+        if (opt_.chunk_size && ::access(meta.c_str(), F_OK) == 0) {
+            std::istringstream ss(readFile(meta));
+            std::getline(ss, etag);
+            std::getline(ss, encoding);
+            have = etag.empty() ? 0 : fileSize(part);
+        }
+        if (have == 0 && !ckey.empty()) {
+            std::string cached = readSmall(ckey + ".etag");
+            if (!cached.empty() && ::access((ckey + ".body").c_str(), F_OK) == 0) h.emplace_back("If-None-Match", cached);
+        }
+
+        HttpResponse resp;
+        for (bool restarted = false;;) {
+            HttpHeaders rh = h;
+            if (opt_.chunk_size) {
+                rh.emplace_back("Range", "bytes=" + std::to_string(have) + "-" + std::to_string(have + opt_.chunk_size - 1));
+                if (have) rh.emplace_back("If-Range", etag);
+            }
+            resp = attempt(j, [&] { return http.get(j.path, rh); });
+            r.status = resp.status;
+            if (resp.status == 416 && have && !restarted) {  // part is longer than the file now
+                have = 0;
+                restarted = true;
+                continue;
+            }
+            if (resp.status != 200 && resp.status != 206) break;
+
+            size_t from = 0, total = resp.body.size();
+            if (resp.status == 200) have = 0;  // whole body: changed since the part, or no ranges
+            if (resp.status == 206) {
+                unsigned long long a = 0, b = 0, t = 0;
+                if (std::sscanf(resp.header("content-range").c_str(), "bytes %llu-%llu/%llu", &a, &b, &t) != 3) {
+                    throw std::runtime_error("bad Content-Range");
+                }
+                from = (size_t) a;
+                total = (size_t) t;
+            }
+            if (from != have) throw std::runtime_error("range starts at " + std::to_string(from) + ", expected " +
+                                                       std::to_string(have));
+            if (from == 0) {
+                etag = resp.header("etag");
+                encoding = resp.header("content-encoding");
+                if (opt_.chunk_size) writeFile(meta, etag + "\n" + encoding + "\n");
+            }
+            {
+                std::ofstream f(part, std::ios::binary | (from ? std::ios::app : std::ios::trunc));
+                f.write(resp.body.data(), (std::streamsize) resp.body.size());
+                if (!f) throw std::runtime_error("cannot write " + part);
+            }
+            have = from + resp.body.size();
+            if (have >= total) break;
+        }
+
+        if (resp.status == 304 && !ckey.empty()) {
+            // Unchanged: refresh the output from the cache unless it is still what we wrote last
+            if (fileStamp(j.output) != readSmall(okey + ".out")) writeFile(j.output, readFile(ckey + ".body"));
+            r.payload = 0;
+        } else if (resp.status == 200 || resp.status == 206) {
+            std::string tmp = j.output + ".xfer." + std::to_string(::getpid());
+            {
+                const std::string body = readFile(part);
+                std::ofstream out(tmp, std::ios::binary | std::ios::trunc);
+                if (!out) throw std::runtime_error("cannot write " + tmp);
+                r.payload = wire::DecodeTo(encoding, body.data(), body.size(), out);
+                if (!out.flush()) throw std::runtime_error("cannot write " + tmp);
+            }
+            if (std::rename(tmp.c_str(), j.output.c_str()) != 0) throw std::runtime_error("cannot replace " + j.output);
+            std::remove(part.c_str());
+            std::remove(meta.c_str());
+            if (!ckey.empty()) {
+                if (!etag.empty()) {
+                    writeFile(ckey + ".body", readFile(j.output));
+                    writeFile(ckey + ".etag", etag);
+                } else {
+                    std::remove((ckey + ".etag").c_str());
+                    std::remove((ckey + ".body").c_str());
+                }
+            }
+        } else {
+            return false;
+        }
+        if (!okey.empty()) writeFile(okey + ".out", fileStamp(j.output) + "\n");
+        return true;
+    }
+
+    const Options& opt_;
+    std::mt19937_64 rng_;
+    std::map<std::string, std::unique_ptr<HttpClient>> clients_;
+};
+
+// ----------------------
+// Arguments
+// ----------------------
+bool parseJob(const std::vector<std::string>& f, Job& j) {
+    if (f.empty()) return false;
+    j.method = f[0];
+    if (j.method == "GET" && f.size() == 3) {
+        j.url = f[1];
+        j.output = f[2];
+    } else if (j.method == "POST" && f.size() == 6) {
+        j.url = f[1];
+        j.output = f[2];
+        j.client_id = f[3];
+        j.type = f[4];
+        j.file = f[5];
+    } else {
+        return false;
+    }
+    return splitUrl(j);
+}
+
+bool parseArgs(int argc, char** argv, Options& o, std::vector<Job>& jobs) {
+    std::vector<std::string> rest;
+    for (int i = 1; i < argc; i++) {
+        std::string a = argv[i];
+        auto next = [&]() -> std::string {
+            if (i + 1 >= argc) throw std::runtime_error("missing value for " + a);
+            return argv[++i];
+        };
+        if (a == "--jobs") o.jobs = std::stoul(next());
+        else if (a == "--retries") o.retries = std::stoi(next());
+        else if (a == "--backoff-ms") o.backoff_ms = std::stol(next());
+        else if (a == "--timeout-ms") o.timeout_ms = std::stoi(next());
+        else if (a == "--compress") o.compress = next();
+        else if (a == "--level-gzip") o.wire.gzip_level = std::stoi(next());
+        else if (a == "--level-zstd") o.wire.zstd_level = std::stoi(next());
+        else if (a == "--min-bytes") o.wire.min_bytes = std::stoul(next());
+        else if (a == "--cache-dir") o.cache_dir = next();
+        else if (a == "--metrics") o.metrics = next();
+        else if (a == "--chunk-size") o.chunk_size = std::stoul(next());
+        else if (a == "--chunked-min") o.chunked_min = std::stoul(next());
+        else if (a.compare(0, 2, "--") == 0) {
+            std::cerr << "[ppfl_xfer] unknown option " << a << "\n";
+            return false;
+        } else {
+            rest.assign(argv + i, argv + argc);
+            break;
+        }
+    }
+    if (o.compress != "auto" && o.compress != "zstd" && o.compress != "gzip" && o.compress != "none") {
+        std::cerr << "[ppfl_xfer] --compress must be auto, zstd, gzip or none\n";
+        return false;
+    }
+
+    if (rest.size() == 1 && rest[0] == "-") {
+        std::string line;
+        for (size_t n = 1; std::getline(std::cin, line); n++) {
+            std::istringstream ss(line);
+            std::vector<std::string> f;
+            for (std::string w; ss >> w;) f.push_back(w);
+            if (f.empty() || f[0][0] == '#') continue;
+            Job j;
+            if (!parseJob(f, j)) {
+                std::cerr << "[ppfl_xfer] stdin line " << n << ": bad job: " << line << "\n";
+                return false;
+            }
+            jobs.push_back(std::move(j));
+        }
+    } else {
+        Job j;
+        if (!parseJob(rest, j)) {
+            std::cerr << "Usage: ppfl_xfer [options] GET <url> <output>\n"
+                         "       ppfl_xfer [options] POST <url> <output> <client_id> <type> <file>\n"
+                         "       ppfl_xfer [options] -   (jobs on stdin)\n";
+            return false;
+        }
+        jobs.push_back(std::move(j));
+    }
+    return o.jobs > 0 && o.retries > 0;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    Options opt;
+    std::vector<Job> jobs;
+    try {
+        if (!parseArgs(argc, argv, opt, jobs)) return 1;
+    } catch (const std::exception& e) {
+        std::cerr << "[ppfl_xfer] " << e.what() << "\n";
+        return 1;
+    }
+    if (jobs.empty()) return 0;
+
+    // Workers pull jobs off a shared counter
+    auto start = Clock::now();
+    std::atomic<size_t> next{0};
+    std::atomic<size_t> failed{0}, sent{0}, received{0}, connects{0};
+    std::vector<std::thread> workers;
+    for (size_t w = 0; w < std::min(opt.jobs, jobs.size()); w++) {
+        workers.emplace_back([&] {
+            Worker worker(opt);
+            for (size_t i; (i = next++) < jobs.size();) {
+                Result r = worker.run(jobs[i]);
+                appendMetric(opt, jobs[i], r);
+                if (!r.ok) failed++;
+                sent += r.sent;
+                received += r.received;
+            }
+            connects += worker.connects();
+        });
+    }
+    for (auto& t : workers) t.join();
+
+    if (jobs.size() > 1) {
+        long ms = (long) std::chrono::duration_cast<std::chrono::milliseconds>(Clock::now() - start).count();
+        std::cout << "[ppfl_xfer] " << jobs.size() << " transfers (" << failed << " failed) over " << connects
+                  << " connections, " << sent << " B sent, " << received << " B received in " << ms << " ms"
+                  << std::endl;
+    }
+    return failed ? 1 : 0;
+}
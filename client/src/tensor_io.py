@@ -0,0 +1,43 @@
+"""Raw tensor weight file ("PPFLTNS1") consumed by encryptModelWeights.
+
+Layout (little-endian), see lib/tensor_utils.h:
+    magic "PPFLTNS1" | uint32 dtype (1=float32, 2=float64) | uint32 num_tensors
+    per tensor: uint32 name_len, name, uint32 ndim, uint64 dims[ndim], uint64 data_offset
+    tensor data, each block 64-byte aligned
+"""
+import struct
+import numpy as np
+
+MAGIC = b"PPFLTNS1"
+DTYPES = {np.dtype(np.float32): 1, np.dtype(np.float64): 2}
+ALIGN = 64
+
+
+def _align(n):
+    return (n + ALIGN - 1) // ALIGN * ALIGN
+
+
+def write_tensor_file(path, names, arrays, dtype=np.float32):
+    """Write `arrays` (e.g. model.get_weights()) as one tensor file, no text conversion."""
+    dtype = np.dtype(dtype)
+    arrays = [np.ascontiguousarray(a, dtype=dtype) for a in arrays]
+    encoded = [n.encode("utf-8") for n in names]
+
+    header_len = len(MAGIC) + 8
+    for name, arr in zip(encoded, arrays):
+        header_len += 4 + len(name) + 4 + 8 * arr.ndim + 8
+
+    offsets, off = [], _align(header_len)
+    for arr in arrays:
+        offsets.append(off)
+        off = _align(off + arr.nbytes)
+
+    with open(path, "wb") as f:
+        f.write(MAGIC + struct.pack("<II", DTYPES[dtype], len(arrays)))
+        for name, arr, data_off in zip(encoded, arrays, offsets):
+            f.write(struct.pack("<I", len(name)) + name)
+            f.write(struct.pack("<I", arr.ndim) + struct.pack(f"<{arr.ndim}Q", *arr.shape))
+            f.write(struct.pack("<Q", data_off))
+        for arr, data_off in zip(arrays, offsets):
+            f.write(b"\0" * (data_off - f.tell()))
+            f.write(arr.tobytes(order="C"))
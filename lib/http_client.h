@@ -0,0 +1,238 @@
+#ifndef HTTP_CLIENT_H
+#define HTTP_CLIENT_H
+
+// Minimal blocking HTTP/1.1 client for server-to-server calls (relay
+// forwarding, tooling) where the mongoose event loop is not available.
+//
+//   HttpClient up("http://10.0.0.1:8000");
+//   HttpResponse r = up.post("/uploadPartial?round=3", body, "application/json");
+//
+// One connection per client object, kept alive between requests and
+// re-opened once if the peer closed it. Responses with Content-Length,
+// chunked encoding or close-delimited bodies are supported. Not thread-safe;
+// use one HttpClient per thread. Transport errors throw std::runtime_error.
+// Socket byte counters include headers and retried attempts, for exact
+// on-the-wire accounting.
+
+#include <cctype>
+#include <cerrno>
+#include <cstring>
+#include <map>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <unistd.h>
+
+struct HttpResponse {
+    int status = 0;
+    std::map<std::string, std::string> headers;  // lower-cased names
+    std::string body;
+
+    std::string header(const std::string& name, const std::string& def = "") const {
+        auto it = headers.find(name);
+        return it == headers.end() ? def : it->second;
+    }
+};
+
+using HttpHeaders = std::vector<std::pair<std::string, std::string>>;
+
+class HttpClient {
+public:
+    // base_url: "http://host:port" (an optional path prefix is prepended to every request)
+    explicit HttpClient(const std::string& base_url, int timeout_ms = 60000) : timeout_ms_(timeout_ms) {
+        std::string rest = base_url;
+        const std::string scheme = "http://";
+        if (rest.compare(0, scheme.size(), scheme) == 0) rest = rest.substr(scheme.size());
+        size_t slash = rest.find('/');
+        if (slash != std::string::npos) {
+            prefix_ = rest.substr(slash);
+            if (!prefix_.empty() && prefix_.back() == '/') prefix_.pop_back();
+            rest = rest.substr(0, slash);
+        }
+        size_t colon = rest.rfind(':');
+        host_ = colon == std::string::npos ? rest : rest.substr(0, colon);
+        port_ = colon == std::string::npos ? "80" : rest.substr(colon + 1);
+        if (host_.empty()) throw std::runtime_error("HttpClient: bad URL " + base_url);
+    }
+
+    ~HttpClient() { disconnect(); }
+    HttpClient(const HttpClient&) = delete;
+    HttpClient& operator=(const HttpClient&) = delete;
+
+    HttpResponse request(const std::string& method, const std::string& path,
+                         const std::string& body = "", const HttpHeaders& headers = {}) {
+        std::string req = method + " " + prefix_ + path + " HTTP/1.1\r\n"
+                        + "Host: " + host_ + ":" + port_ + "\r\n"
+                        + "Content-Length: " + std::to_string(body.size()) + "\r\n";
+        for (const auto& h : headers) req += h.first + ": " + h.second + "\r\n";
+        req += "\r\n";
+
+        // A kept-alive connection may have been closed by the peer since the
+        // last request; retry exactly once on a fresh connection
+        bool reused = fd_ >= 0;
+        for (int attempt = 0;; attempt++) {
+            try {
+                if (fd_ < 0) connectSocket();
+                sendAll(req);
+                sendAll(body);
+                HttpResponse r = readResponse(method == "HEAD");
+                if (lower(r.header("connection")) == "close") disconnect();
+                return r;
+            } catch (const std::runtime_error&) {
+                disconnect();
+                if (!reused || attempt > 0) throw;
+            }
+        }
+    }
+
+    HttpResponse get(const std::string& path, const HttpHeaders& headers = {}) {
+        return request("GET", path, "", headers);
+    }
+
+    HttpResponse post(const std::string& path, const std::string& body, const std::string& content_type,
+                      HttpHeaders headers = {}) {
+        headers.emplace_back("Content-Type", content_type);
+        return request("POST", path, body, headers);
+    }
+
+    size_t bytesSent() const { return sent_; }
+    size_t bytesReceived() const { return received_; }
+    size_t connects() const { return connects_; }
+
+private:
+    static std::string lower(std::string s) {
+        for (auto& ch : s) ch = (char) tolower((unsigned char) ch);
+        return s;
+    }
+
+    void connectSocket() {
+        addrinfo hints{};
+        hints.ai_family = AF_UNSPEC;
+        hints.ai_socktype = SOCK_STREAM;
+        addrinfo* res = nullptr;
+        int rc = getaddrinfo(host_.c_str(), port_.c_str(), &hints, &res);
+        if (rc != 0) throw std::runtime_error("HttpClient: resolve " + host_ + ": " + gai_strerror(rc));
+
+        int fd = -1;
+        for (addrinfo* ai = res; ai; ai = ai->ai_next) {
+            fd = ::socket(ai->ai_family, ai->ai_socktype, ai->ai_protocol);
+            if (fd < 0) continue;
+            if (::connect(fd, ai->ai_addr, ai->ai_addrlen) == 0) break;
+            ::close(fd);
+            fd = -1;
+        }
+        freeaddrinfo(res);
+        if (fd < 0) throw std::runtime_error("HttpClient: cannot connect to " + host_ + ":" + port_);
+
+        timeval tv{timeout_ms_ / 1000, (timeout_ms_ % 1000) * 1000};
+        setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+        setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &tv, sizeof(tv));
+        int one = 1;
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+        fd_ = fd;
+        connects_++;
+        buf_.clear();
+    }
+
+    void disconnect() {
+        if (fd_ >= 0) ::close(fd_);
+        fd_ = -1;
+        buf_.clear();
+    }
+
+    void sendAll(const std::string& data) {
+        size_t off = 0;
+        while (off < data.size()) {
+            ssize_t n = ::send(fd_, data.data() + off, data.size() - off, MSG_NOSIGNAL);
+            if (n < 0 && errno == EINTR) continue;
+            if (n <= 0) throw std::runtime_error(std::string("HttpClient: send failed: ") + strerror(errno));
+            off += (size_t) n;
+            sent_ += (size_t) n;
+        }
+    }
+
+    // Read more bytes into buf_; false on orderly EOF
+    bool fill() {
+        char tmp[64 * 1024];
+        for (;;) {
+            ssize_t n = ::recv(fd_, tmp, sizeof(tmp), 0);
+            if (n < 0 && errno == EINTR) continue;
+            if (n < 0) throw std::runtime_error(std::string("HttpClient: recv failed: ") + strerror(errno));
+            if (n == 0) return false;
+            buf_.append(tmp, (size_t) n);
+            received_ += (size_t) n;
+            return true;
+        }
+    }
+
+    std::string readLine() {
+        size_t pos;
+        while ((pos = buf_.find("\r\n")) == std::string::npos) {
+            if (!fill()) throw std::runtime_error("HttpClient: connection closed mid-response");
+        }
+        std::string line = buf_.substr(0, pos);
+        buf_.erase(0, pos + 2);
+        return line;
+    }
+
+    std::string readExactly(size_t n) {
+        while (buf_.size() < n) {
+            if (!fill()) throw std::runtime_error("HttpClient: connection closed mid-body");
+        }
+        std::string out = buf_.substr(0, n);
+        buf_.erase(0, n);
+        return out;
+    }
+
+    HttpResponse readResponse(bool head) {
+        HttpResponse r;
+        std::string status = readLine();
+        if (status.compare(0, 5, "HTTP/") != 0 || status.size() < 12) {
+            throw std::runtime_error("HttpClient: bad status line: " + status);
+        }
+        r.status = std::stoi(status.substr(9, 3));
+
+        for (std::string line; !(line = readLine()).empty();) {
+            size_t colon = line.find(':');
+            if (colon == std::string::npos) continue;
+            size_t v = line.find_first_not_of(' ', colon + 1);
+            r.headers[lower(line.substr(0, colon))] = v == std::string::npos ? "" : line.substr(v);
+        }
+
+        if (head || r.status == 204 || r.status == 304 || r.status / 100 == 1) return r;
+
+        if (lower(r.header("transfer-encoding")).find("chunked") != std::string::npos) {
+            for (;;) {
+                size_t len = std::stoul(readLine(), nullptr, 16);
+                if (len == 0) {
+                    while (!readLine().empty()) {}  // trailers
+                    break;
+                }
+                r.body += readExactly(len);
+                readLine();
+            }
+        } else if (r.headers.count("content-length")) {
+            r.body = readExactly(std::stoul(r.header("content-length")));
+        } else {
+            while (fill()) {}
+            r.body.swap(buf_);
+            disconnect();
+        }
+        return r;
+    }
+
+    std::string host_, port_, prefix_;
+    int timeout_ms_;
+    int fd_ = -1;
+    std::string buf_;
+    size_t sent_ = 0, received_ = 0, connects_ = 0;
+};
+
+#endif  // HTTP_CLIENT_H
@@ -0,0 +1,652 @@
+#include "ppfl/ppfl.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <fstream>
+#include <iomanip>
+#include <mutex>
+#include <sstream>
+#include <thread>
+#include <unordered_map>
+
+#include "cryptocontext-ser.h"
+#include "key/key-ser.h"
+#include "ciphertext-ser.h"
+#include "scheme/ckksrns/ckksrns-ser.h"
+#include "base64_utils.h"
+#include "trace.h"
+
+using namespace lbcrypto;
+
+namespace ppfl {
+
+// OpenFHE resolves deserialized objects against a process-wide context
+// registry that is not synchronized; every Deserialize goes through here.
+static std::mutex g_deserializeMutex;
+
+template <typename T, typename ST>
+static void deserializeLocked(T& obj, std::istream& is, const ST& type) {
+    std::lock_guard<std::mutex> lock(g_deserializeMutex);
+    Serial::Deserialize(obj, is, type);
+}
+
+template <typename T>
+static T loadFile(const std::string& path, const char* what) {
+    std::ifstream f(path, std::ios::binary);
+    if (!f.is_open()) throw Error(std::string("Cannot open ") + what + ": " + path);
+    T obj;
+    try {
+        deserializeLocked(obj, f, SerType::JSON);
+    } catch (const std::exception& e) {
+        throw Error(std::string("Failed to deserialize ") + what + " from " + path + ": " + e.what());
+    }
+    if (!obj) throw Error(std::string("Failed to deserialize ") + what + " from " + path);
+    return obj;
+}
+
+template <typename T>
+static T loadBuffer(const std::string& serialized, const char* what) {
+    std::stringstream ss(serialized);
+    T obj;
+    try {
+        deserializeLocked(obj, ss, SerType::JSON);
+    } catch (const std::exception& e) {
+        throw Error(std::string("Failed to deserialize ") + what + ": " + e.what());
+    }
+    if (!obj) throw Error(std::string("Failed to deserialize ") + what);
+    return obj;
+}
+
+// --- Ciphertext headers ---
+json HeaderToJson(const CiphertextHeader& h) {
+    return {{"ring", h.ring},       {"towers", h.towers},         {"level", h.level},
+            {"scale_deg", h.scaleDeg}, {"scale_bits", h.scaleBits}, {"slots", h.slots},
+            {"encoding", h.encoding}, {"key_tag", h.keyTag}};
+}
+
+CiphertextHeader HeaderFromJson(const json& j) {
+    CiphertextHeader h;
+    try {
+        h.ring = j.at("ring");
+        h.towers = j.at("towers");
+        h.level = j.value("level", 0u);
+        h.scaleDeg = j.value("scale_deg", 1u);
+        h.scaleBits = j.at("scale_bits");
+        h.slots = j.at("slots");
+        h.encoding = j.at("encoding");
+        h.keyTag = j.value("key_tag", std::string());
+    } catch (const json::exception& e) {
+        throw Error(std::string("Invalid ct_header: ") + e.what());
+    }
+    return h;
+}
+
+static std::string encodingName(PlaintextEncodings e) {
+    return e == CKKS_PACKED_ENCODING ? "CKKS_PACKED" : "encoding " + std::to_string((int) e);
+}
+
+CiphertextHeader HeaderOf(const Ct& ct) {
+    const auto& elements = ct->GetElements();
+    if (elements.empty()) throw Error("Ciphertext has no elements");
+    CiphertextHeader h;
+    h.ring = elements[0].GetRingDimension();
+    h.towers = (uint32_t) elements[0].GetNumOfElements();
+    h.level = (uint32_t) ct->GetLevel();
+    h.scaleDeg = (uint32_t) std::max<size_t>(1, ct->GetNoiseScaleDeg());
+    h.scaleBits = (uint32_t) std::lround(std::log2(ct->GetScalingFactor()) / h.scaleDeg);
+    h.slots = ct->GetSlots();
+    h.encoding = encodingName(ct->GetEncodingType());
+    h.keyTag = ct->GetKeyTag();
+    return h;
+}
+
+CiphertextHeader LayerHeader(const json& encLayer) {
+    auto it = encLayer.find("ct_header");
+    if (it != encLayer.end()) return HeaderFromJson(*it);
+    return HeaderOf(DecodeCiphertext(encLayer.at("mean")));
+}
+
+void CheckHeader(const CiphertextHeader& spec, const CiphertextHeader& h) {
+    auto mismatch = [](const char* what, const std::string& got, const std::string& want) {
+        throw Error(std::string(what) + " " + got + ", expected " + want);
+    };
+    auto str = [](uint32_t v) { return std::to_string(v); };
+    if (h.encoding != spec.encoding) mismatch("encoding", h.encoding, spec.encoding);
+    if (h.ring != spec.ring) mismatch("ring dimension", str(h.ring), str(spec.ring));
+    if (h.level > spec.towers || h.towers != spec.towers - h.level) {
+        mismatch("tower count", str(h.towers) + " at level " + str(h.level),
+                 str(spec.towers - std::min(h.level, spec.towers)));
+    }
+    if (h.scaleBits != spec.scaleBits) mismatch("scaling factor", "2^" + str(h.scaleBits), "2^" + str(spec.scaleBits));
+    if (h.slots != spec.slots) mismatch("slot count", str(h.slots), str(spec.slots));
+    if (!spec.keyTag.empty() && h.keyTag != spec.keyTag) mismatch("key tag", h.keyTag, spec.keyTag);
+}
+
+// --- Context ---
+Context::Context(CC cc) : cc_(std::move(cc)), batchSize_(cc_->GetEncodingParams()->GetBatchSize()) {
+    spec_.ring = cc_->GetRingDimension();
+    spec_.towers = (uint32_t) cc_->GetElementParams()->GetParams().size();
+    auto rns = std::dynamic_pointer_cast<CryptoParametersRNS>(cc_->GetCryptoParameters());
+    if (rns) spec_.scaleBits = (uint32_t) std::lround(std::log2(rns->GetScalingFactorReal(0)));
+    spec_.slots = (uint32_t) batchSize_;
+    spec_.encoding = encodingName(CKKS_PACKED_ENCODING);
+}
+
+std::shared_ptr<const Context> Context::LoadFile(const std::string& path) {
+    return std::shared_ptr<const Context>(new Context(loadFile<CC>(path, "CryptoContext")));
+}
+
+std::shared_ptr<const Context> Context::LoadBuffer(const std::string& serialized) {
+    return std::shared_ptr<const Context>(new Context(loadBuffer<CC>(serialized, "CryptoContext")));
+}
+
+// --- Keys ---
+PublicKey  LoadPublicKeyFile(const std::string& path)  { return loadFile<PublicKey>(path, "public key"); }
+PrivateKey LoadPrivateKeyFile(const std::string& path) { return loadFile<PrivateKey>(path, "private key"); }
+EvalKey    LoadEvalKeyFile(const std::string& path)    { return loadFile<EvalKey>(path, "re-encryption key"); }
+
+PublicKey  LoadPublicKeyBuffer(const std::string& s)  { return loadBuffer<PublicKey>(s, "public key"); }
+PrivateKey LoadPrivateKeyBuffer(const std::string& s) { return loadBuffer<PrivateKey>(s, "private key"); }
+EvalKey    LoadEvalKeyBuffer(const std::string& s)    { return loadBuffer<EvalKey>(s, "re-encryption key"); }
+
+template <typename T>
+static void saveFile(const std::string& path, const T& obj, const char* what) {
+    if (!Serial::SerializeToFile(path, obj, SerType::JSON))
+        throw Error(std::string("Failed to save ") + what + " to " + path);
+}
+
+void SavePublicKeyFile(const std::string& path, const PublicKey& pk)  { saveFile(path, pk, "public key"); }
+void SavePrivateKeyFile(const std::string& path, const PrivateKey& sk) { saveFile(path, sk, "private key"); }
+void SaveEvalKeyFile(const std::string& path, const EvalKey& rk)       { saveFile(path, rk, "re-encryption key"); }
+
+KeyPair GenerateKeyPair(const Context& ctx) {
+    KeyPair kp = ctx.cc()->KeyGen();
+    if (!kp.good()) throw Error("Key generation failed");
+    return kp;
+}
+
+EvalKey GenerateReKey(const Context& ctx, const PrivateKey& sk, const PublicKey& peerPk) {
+    EvalKey rk = ctx.cc()->ReKeyGen(sk, peerPk);
+    if (!rk) throw Error("Re-encryption key generation failed");
+    return rk;
+}
+
+std::vector<KeyPair> GenerateKeyPairs(const Context& ctx, size_t n, size_t threads) {
+    std::vector<KeyPair> out(n);
+    ParallelFor(n, threads, [&](size_t i) { out[i] = GenerateKeyPair(ctx); });
+    return out;
+}
+
+std::vector<EvalKey> GenerateReKeys(const Context& ctx, const PrivateKey& sk, const std::vector<PublicKey>& peerPks,
+                                    size_t threads) {
+    std::vector<EvalKey> out(peerPks.size());
+    ParallelFor(peerPks.size(), threads, [&](size_t i) { out[i] = GenerateReKey(ctx, sk, peerPks[i]); });
+    return out;
+}
+
+void ParallelFor(size_t n, size_t threads, const std::function<void(size_t)>& fn) {
+    if (threads == 0) threads = std::max(1u, std::thread::hardware_concurrency());
+    threads = std::min(threads, n);
+
+    std::atomic<size_t> next{0};
+    std::atomic<bool> failed{false};
+    std::exception_ptr first;
+    std::mutex m;
+    auto work = [&] {
+        while (!failed.load(std::memory_order_relaxed)) {
+            size_t i = next.fetch_add(1);
+            if (i >= n) break;
+            try {
+                fn(i);
+            } catch (...) {
+                std::lock_guard<std::mutex> lock(m);
+                if (!first) first = std::current_exception();
+                failed = true;
+            }
+        }
+    };
+    std::vector<std::thread> pool;
+    for (size_t t = 1; t < threads; t++) pool.emplace_back(work);
+    work();
+    for (auto& t : pool) t.join();
+    if (first) std::rethrow_exception(first);
+}
+
+// --- Ciphertext <-> Base64 ---
+std::string EncodeCiphertext(const Ct& ct) {
+    std::stringstream ss;
+    Serial::Serialize(ct, ss, SerType::BINARY);
+    return Base64Encode(ss.str());
+}
+
+Ct DecodeCiphertext(const std::string& b64) {
+    std::string bin = Base64Decode(b64);
+    if (bin.empty()) throw Error("Invalid Base64 ciphertext");
+    std::stringstream ss(bin);
+    Ct ct;
+    deserializeLocked(ct, ss, SerType::BINARY);
+    if (!ct) throw Error("Failed to deserialize ciphertext");
+    return ct;
+}
+
+// --- Weight documents ---
+json ReadJsonFile(const std::string& path) {
+    std::ifstream f(path);
+    if (!f.is_open()) throw Error("Could not open input file: " + path);
+    json doc;
+    try {
+        f >> doc;
+    } catch (const json::exception& e) {
+        throw Error("Invalid JSON in " + path + ": " + e.what());
+    }
+    return doc;
+}
+
+void WriteJsonFile(const std::string& path, const json& doc) {
+    WriteTextFile(path, SerializeJson(doc));
+}
+
+std::string SerializeJson(const json& doc) {
+    return doc.dump(2) + "\n";
+}
+
+void WriteTextFile(const std::string& path, const std::string& text) {
+    std::ofstream f(path, std::ios::binary);
+    if (!f.is_open()) throw Error("Failed to open output file: " + path);
+    f.write(text.data(), (std::streamsize) text.size());
+    f.flush();
+    if (!f) throw Error("Failed to write output file: " + path);
+}
+
+static const json& layersOf(const json& doc) {
+    if (!doc.contains("weights_summary") || !doc["weights_summary"].is_array())
+        throw Error("Document has no 'weights_summary' array");
+    return doc["weights_summary"];
+}
+
+CiphertextCount CountCiphertexts(const json& enc) {
+    CiphertextCount n;
+    auto add = [&n](const json& v) {
+        if (!v.is_string()) return;
+        const auto& s = v.get_ref<const std::string&>();
+        n.count++;
+        n.bytes += s.size() / 4 * 3;
+    };
+    for (const auto& layer : layersOf(enc)) {
+        if (layer.contains("mean")) add(layer["mean"]);
+        if (layer.contains("std_dev")) add(layer["std_dev"]);
+        if (layer.contains("values") && layer["values"].is_array()) {
+            for (const auto& v : layer["values"]) add(v);
+        }
+    }
+    return n;
+}
+
+std::string ValidateModel(const Context& ctx, const json& enc, const std::string& keyTag, bool requireHeader) {
+    CiphertextHeader spec = ctx.Spec();
+    spec.keyTag = keyTag;
+    for (const auto& layer : layersOf(enc)) {
+        try {
+            if (requireHeader && !layer.contains("ct_header")) throw Error("no ct_header");
+            CiphertextHeader h = LayerHeader(layer);
+            CheckHeader(spec, h);
+            spec.keyTag = h.keyTag;  // every later layer must be under the same key
+
+            // Two polynomials of ring x towers 64-bit coefficients at the least
+            const size_t minBytes = 2 * sizeof(uint64_t) * (size_t) h.ring * h.towers;
+            auto checkSize = [minBytes](const json& v) {
+                if (!v.is_string()) throw Error("ciphertext is not a Base64 string");
+                size_t bytes = v.get_ref<const std::string&>().size() / 4 * 3;
+                if (bytes < minBytes) {
+                    throw Error("ciphertext of " + std::to_string(bytes) + " bytes, its header needs at least " +
+                                std::to_string(minBytes));
+                }
+            };
+            checkSize(layer.at("mean"));
+            checkSize(layer.at("std_dev"));
+            for (const auto& v : layer.at("values")) checkSize(v);
+        } catch (const std::exception& e) {
+            throw Error("Layer " + layer.value("layer", std::string("?")) + ": " + e.what());
+        }
+    }
+    return spec.keyTag;
+}
+
+static bool isOptimizerLayer(const std::string& name) {
+    return name.rfind("optimizer/", 0) == 0;
+}
+
+// --- Encrypt ---
+static Ct encryptScalar(const Context& ctx, const PublicKey& pk, double v) {
+    auto pt = ctx.cc()->MakeCKKSPackedPlaintext(std::vector<double>{v});
+    return ctx.cc()->Encrypt(pk, pt);
+}
+
+json EncryptLayer(const Context& ctx, const PublicKey& pk, const TensorView& t, double mean, double stddev) {
+    const size_t batchSize = ctx.BatchSize();
+
+    json encLayer;
+    encLayer["layer"] = t.name;
+    encLayer["shape"] = t.shape;
+    Ct meanCt = encryptScalar(ctx, pk, mean);
+    encLayer["ct_header"] = HeaderToJson(HeaderOf(meanCt));
+    encLayer["mean"] = EncodeCiphertext(meanCt);
+    encLayer["std_dev"] = EncodeCiphertext(encryptScalar(ctx, pk, stddev));
+
+    // Values packed in chunks of batchSize, last chunk zero-padded
+    std::vector<std::string> batches;
+    batches.reserve((t.count + batchSize - 1) / batchSize);
+    std::vector<double> batch(batchSize);
+
+    for (size_t i = 0; i < t.count; i += batchSize) {
+        size_t end = std::min(i + batchSize, t.count);
+        for (size_t k = i; k < end; k++) batch[k - i] = t.at(k);
+        std::fill(batch.begin() + (end - i), batch.end(), 0.0);
+
+        Plaintext pt = ctx.cc()->MakeCKKSPackedPlaintext(batch);
+        batches.push_back(EncodeCiphertext(ctx.cc()->Encrypt(pk, pt)));
+    }
+
+    encLayer["values"] = std::move(batches);
+    return encLayer;
+}
+
+json EncryptModel(const Context& ctx, const PublicKey& pk, const json& plain, const LayerSink& sink) {
+    std::vector<const json*> todo;
+    for (const auto& weight : layersOf(plain)) {
+        if (!isOptimizerLayer(weight.at("layer"))) todo.push_back(&weight);
+    }
+
+    json out;
+    out["weights_summary"] = json::array();
+
+    for (size_t idx = 0; idx < todo.size(); idx++) {
+        const json& weight = *todo[idx];
+        std::vector<double> values = weight.at("values");
+        TensorView t;
+        t.name = weight.at("layer");
+        t.shape = weight.at("shape").get<std::vector<size_t>>();
+        t.count = values.size();
+        t.dtype = TensorDType::Float64;
+        t.data = values.data();
+
+        trace::Span span("encrypt_layer", {-1, "", (long) idx});
+        out["weights_summary"].push_back(
+            EncryptLayer(ctx, pk, t, weight.at("mean").get<double>(), weight.at("std_dev").get<double>()));
+        if (sink) sink(idx, todo.size(), out["weights_summary"].back());
+    }
+    return out;
+}
+
+json EncryptModel(const Context& ctx, const PublicKey& pk, const std::vector<TensorView>& tensors,
+                  const LayerSink& sink) {
+    std::vector<const TensorView*> todo;
+    for (const auto& t : tensors) {
+        if (!isOptimizerLayer(t.name)) todo.push_back(&t);
+    }
+
+    json out;
+    out["weights_summary"] = json::array();
+
+    for (size_t idx = 0; idx < todo.size(); idx++) {
+        const TensorView& t = *todo[idx];
+        trace::Span span("encrypt_layer", {-1, "", (long) idx});
+
+        // mean / population std_dev, matching np.mean / np.std in the trainer
+        double sum = 0.0;
+        for (size_t i = 0; i < t.count; i++) sum += t.at(i);
+        double mean = t.count ? sum / t.count : 0.0;
+        double sq = 0.0;
+        for (size_t i = 0; i < t.count; i++) {
+            double d = t.at(i) - mean;
+            sq += d * d;
+        }
+        double stddev = t.count ? std::sqrt(sq / t.count) : 0.0;
+
+        out["weights_summary"].push_back(EncryptLayer(ctx, pk, t, mean, stddev));
+        if (sink) sink(idx, todo.size(), out["weights_summary"].back());
+    }
+    return out;
+}
+
+// --- Re-encrypt ---
+json ReEncryptLayer(const Context& ctx, const EvalKey& reKey, const json& encLayer) {
+    auto recrypt = [&](const std::string& b64) {
+        return EncodeCiphertext(ctx.cc()->ReEncrypt(DecodeCiphertext(b64), reKey));
+    };
+
+    json reEncLayer;
+    reEncLayer["layer"] = encLayer.at("layer");
+    reEncLayer["shape"] = encLayer.at("shape");
+    Ct meanCt = ctx.cc()->ReEncrypt(DecodeCiphertext(encLayer.at("mean")), reKey);
+    reEncLayer["ct_header"] = HeaderToJson(HeaderOf(meanCt));
+    reEncLayer["mean"] = EncodeCiphertext(meanCt);
+    reEncLayer["std_dev"] = recrypt(encLayer.at("std_dev"));
+
+    std::vector<std::string> values;
+    values.reserve(encLayer.at("values").size());
+    for (const auto& b64 : encLayer.at("values")) values.push_back(recrypt(b64));
+    reEncLayer["values"] = std::move(values);
+    return reEncLayer;
+}
+
+json ReEncryptModel(const Context& ctx, const EvalKey& reKey, const json& enc) {
+    json out;
+    out["weights_summary"] = json::array();
+    long idx = 0;
+    for (const auto& encLayer : layersOf(enc)) {
+        trace::Span span("reencrypt_layer", {-1, "", idx++});
+        out["weights_summary"].push_back(ReEncryptLayer(ctx, reKey, encLayer));
+    }
+    return out;
+}
+
+std::string ReEncryptCiphertext(const Context& ctx, const EvalKey& reKey, const std::string& b64) {
+    return EncodeCiphertext(ctx.cc()->ReEncrypt(DecodeCiphertext(b64), reKey));
+}
+
+// --- Aggregate ---
+void LayerAccumulator::Add(const Context& ctx, const json& encLayer, double weight) {
+    accumulate(ctx, encLayer, weight, weight, 1);
+}
+
+void LayerAccumulator::AddPartial(const Context& ctx, const json& partial, double scale) {
+    // The partial's ciphertexts are already weighted sums; only `scale` applies
+    accumulate(ctx, partial, scale, scale * partial.at("weight").get<double>(), partial.at("count").get<size_t>());
+}
+
+// Multiplicative levels a ciphertext has left under ctx: towers it can still
+// rescale away, less the pending rescale of a multiplied (degree 2) one
+static long levelsLeft(const Context& ctx, const CiphertextHeader& h) {
+    return (long) ctx.Spec().towers - (long) h.level - (long) h.scaleDeg;
+}
+
+void LayerAccumulator::accumulate(const Context& ctx, const json& encLayer, double ctScale, double weight,
+                                  size_t count) {
+    if (!(weight > 0.0) || !(ctScale > 0.0)) throw Error("LayerAccumulator: weight must be positive");
+    // Checked before anything is added: the scale, if any, and Finalize must both fit
+    long left = levelsLeft(ctx, LayerHeader(encLayer)) - (ctScale == 1.0 ? 0 : 1);
+    if (left < 1) {
+        throw Error("LayerAccumulator: layer " + encLayer.at("layer").get<std::string>() +
+                    (ctScale == 1.0 ? std::string(" has no multiplicative level left to average")
+                                    : " has no multiplicative level left for weight " + std::to_string(ctScale)) +
+                    " (MultiplicativeDepth of the CryptoContext too small)");
+    }
+    const CC& cc = ctx.cc();
+    // Unit scale (the common case) skips the extra plaintext multiply
+    auto load = [&](const json& b64) {
+        Ct ct = DecodeCiphertext(b64);
+        return ctScale == 1.0 ? ct : cc->EvalMult(ct, ctScale);
+    };
+
+    const auto& values = encLayer.at("values");
+    if (count_ == 0) {
+        name_ = encLayer.at("layer");
+        shape_ = encLayer.at("shape");
+        mean_ = load(encLayer.at("mean"));
+        stdDev_ = load(encLayer.at("std_dev"));
+        values_.clear();
+        values_.reserve(values.size());
+        for (const auto& b64 : values) values_.push_back(load(b64));
+        count_ = count;
+        weightSum_ = weight;
+        return;
+    }
+
+    if (encLayer.at("layer") != name_ || encLayer.at("shape") != shape_) {
+        throw Error("LayerAccumulator: layer " + encLayer.at("layer").get<std::string>() +
+                    " does not match accumulated " + name_);
+    }
+    mean_ = cc->EvalAdd(mean_, load(encLayer.at("mean")));
+    stdDev_ = cc->EvalAdd(stdDev_, load(encLayer.at("std_dev")));
+    if (values.size() < values_.size()) values_.resize(values.size());
+    for (size_t j = 0; j < values_.size(); j++) values_[j] = cc->EvalAdd(values_[j], load(values[j]));
+    count_ += count;
+    weightSum_ += weight;
+}
+
+json LayerAccumulator::Partial() const {
+    if (count_ == 0) throw Error("LayerAccumulator: nothing accumulated");
+    json partial;
+    partial["layer"] = name_;
+    partial["shape"] = shape_;
+    partial["ct_header"] = HeaderToJson(HeaderOf(mean_));
+    partial["mean"] = EncodeCiphertext(mean_);
+    partial["std_dev"] = EncodeCiphertext(stdDev_);
+
+    std::vector<std::string> values;
+    values.reserve(values_.size());
+    for (const auto& ct : values_) values.push_back(EncodeCiphertext(ct));
+    partial["values"] = std::move(values);
+    partial["weight"] = weightSum_;
+    partial["count"] = count_;
+    return partial;
+}
+
+json LayerAccumulator::Finalize(const Context& ctx) const {
+    if (count_ == 0) throw Error("LayerAccumulator: nothing accumulated");
+    if (levelsLeft(ctx, HeaderOf(mean_)) < 1) {
+        throw Error("LayerAccumulator: layer " + name_ + " has no multiplicative level left to average" +
+                    " (MultiplicativeDepth of the CryptoContext too small)");
+    }
+    const double scale = 1.0 / weightSum_;
+    auto average = [&](const Ct& sum) { return EncodeCiphertext(ctx.cc()->EvalMult(sum, scale)); };
+
+    json aggLayer;
+    aggLayer["layer"] = name_;
+    aggLayer["shape"] = shape_;
+    Ct meanCt = ctx.cc()->EvalMult(mean_, scale);
+    aggLayer["ct_header"] = HeaderToJson(HeaderOf(meanCt));
+    aggLayer["mean"] = EncodeCiphertext(meanCt);
+    aggLayer["std_dev"] = average(stdDev_);
+
+    std::vector<std::string> aggValues;
+    aggValues.reserve(values_.size());
+    for (const auto& sum : values_) aggValues.push_back(average(sum));
+    aggLayer["values"] = std::move(aggValues);
+    return aggLayer;
+}
+
+json AggregateLayers(const Context& ctx, const std::vector<const json*>& layers) {
+    if (layers.empty()) throw Error("AggregateLayers: no input layers");
+    LayerAccumulator acc;
+    for (const auto* l : layers) acc.Add(ctx, *l);
+    return acc.Finalize(ctx);
+}
+
+std::vector<std::vector<const json*>> MatchLayers(const std::vector<const json*>& encs) {
+    if (encs.empty()) throw Error("AggregateModels: no input models");
+
+    // Index the layers of every model after the first by name
+    std::vector<std::unordered_map<std::string, const json*>> index(encs.size());
+    for (size_t m = 1; m < encs.size(); m++) {
+        for (const auto& layer : layersOf(*encs[m])) index[m][layer.at("layer")] = &layer;
+    }
+
+    std::vector<std::vector<const json*>> matched;
+    for (const auto& first : layersOf(*encs[0])) {
+        const std::string name = first.at("layer");
+
+        // Aggregate only if every model has the same layer + same shape
+        std::vector<const json*> layers{&first};
+        for (size_t m = 1; m < encs.size(); m++) {
+            auto it = index[m].find(name);
+            if (it == index[m].end() || it->second->at("shape") != first.at("shape")) break;
+            layers.push_back(it->second);
+        }
+        if (layers.size() == encs.size()) matched.push_back(std::move(layers));
+    }
+    return matched;
+}
+
+json AggregateModels(const Context& ctx, const std::vector<const json*>& encs) {
+    json out;
+    out["weights_summary"] = json::array();
+    for (const auto& layers : MatchLayers(encs)) {
+        trace::Span span("aggregate_layer", {-1, "", (long) out["weights_summary"].size()});
+        out["weights_summary"].push_back(AggregateLayers(ctx, layers));
+    }
+    return out;
+}
+
+std::string AverageCiphertexts(const Context& ctx, const std::vector<const std::string*>& b64s) {
+    if (b64s.empty()) throw Error("AverageCiphertexts: no input ciphertexts");
+    const CC& cc = ctx.cc();
+    Ct sum = DecodeCiphertext(*b64s[0]);
+    for (size_t i = 1; i < b64s.size(); i++) sum = cc->EvalAdd(sum, DecodeCiphertext(*b64s[i]));
+    return EncodeCiphertext(cc->EvalMult(sum, 1.0 / (double) b64s.size()));
+}
+
+// --- Decrypt ---
+static double decryptScalar(const Context& ctx, const PrivateKey& sk, const std::string& b64) {
+    Plaintext pt;
+    ctx.cc()->Decrypt(sk, DecodeCiphertext(b64), &pt);
+    pt->SetLength(1);
+    return pt->GetRealPackedValue()[0];
+}
+
+PlainLayer DecryptLayer(const Context& ctx, const PrivateKey& sk, const json& encLayer) {
+    PlainLayer layer;
+    layer.name = encLayer.at("layer");
+    layer.shape = encLayer.at("shape");
+    layer.mean = decryptScalar(ctx, sk, encLayer.at("mean"));
+    layer.std_dev = decryptScalar(ctx, sk, encLayer.at("std_dev"));
+
+    // compute expected number of values from shape
+    size_t expected = 1;
+    for (const auto& dim : layer.shape) expected *= dim.get<size_t>();
+
+    layer.values.reserve(encLayer.at("values").size() * ctx.BatchSize());
+    for (const auto& b64 : encLayer.at("values")) {
+        Plaintext pt;
+        ctx.cc()->Decrypt(sk, DecodeCiphertext(b64), &pt);
+        auto vals = pt->GetRealPackedValue();
+        layer.values.insert(layer.values.end(), vals.begin(), vals.end());
+    }
+
+    // trim down to the real number of weights (remove padding)
+    if (layer.values.size() > expected) layer.values.resize(expected);
+    return layer;
+}
+
+json DecryptModel(const Context& ctx, const PrivateKey& sk, const json& enc) {
+    json out;
+    out["weights_summary"] = json::array();
+
+    long idx = 0;
+    for (const auto& encLayer : layersOf(enc)) {
+        trace::Span span("decrypt_layer", {-1, "", idx++});
+        PlainLayer layer = DecryptLayer(ctx, sk, encLayer);
+        json plainLayer;
+        plainLayer["layer"] = layer.name;
+        plainLayer["shape"] = layer.shape;
+        plainLayer["mean"] = layer.mean;
+        plainLayer["std_dev"] = layer.std_dev;
+        plainLayer["values"] = std::move(layer.values);
+        out["weights_summary"].push_back(std::move(plainLayer));
+    }
+    return out;
+}
+
+}  // namespace ppfl
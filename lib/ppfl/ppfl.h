@@ -0,0 +1,242 @@
+#ifndef PPFL_H
+#define PPFL_H
+
+// libppfl - in-process crypto pipeline shared by the client/server tools
+//
+// Works on the "weights_summary" documents exchanged between stages:
+//   { "weights_summary": [ { "layer", "shape", "mean", "std_dev", "values" } ] }
+// where, once encrypted, mean/std_dev are one Base64 ciphertext each and
+// values is a list of Base64 ciphertexts of batchSize packed slots.
+//
+// Thread safety: a loaded Context and keys are immutable and may be shared
+// by any number of threads. All functions below are reentrant; ciphertext
+// deserialization is internally serialized because OpenFHE's context
+// registry is global.
+//
+// Errors are reported by throwing ppfl::Error.
+
+#include "openfhe.h"
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include <nlohmann/json.hpp>
+
+#include "tensor_utils.h"
+
+namespace ppfl {
+
+using json = nlohmann::json;
+using CC         = lbcrypto::CryptoContext<lbcrypto::DCRTPoly>;
+using Ct         = lbcrypto::Ciphertext<lbcrypto::DCRTPoly>;
+using PublicKey  = lbcrypto::PublicKey<lbcrypto::DCRTPoly>;
+using PrivateKey = lbcrypto::PrivateKey<lbcrypto::DCRTPoly>;
+using EvalKey    = lbcrypto::EvalKey<lbcrypto::DCRTPoly>;
+using KeyPair    = lbcrypto::KeyPair<lbcrypto::DCRTPoly>;
+
+struct Error : std::runtime_error {
+    using std::runtime_error::runtime_error;
+};
+
+// --- Ciphertext headers ---
+// Parameters a ciphertext was made with, readable without decoding it.
+// Every encrypted layer carries the header of its ciphertexts as
+//   "ct_header": {"ring", "towers", "level", "scale_deg", "scale_bits", "slots", "encoding", "key_tag"}
+// ahead of the ciphertexts themselves, so runMserver and the server tools can
+// reject a document made under another CC.json or key before any
+// ReEncrypt/EvalAdd.
+struct CiphertextHeader {
+    uint32_t ring = 0;        // ring dimension
+    uint32_t towers = 0;      // RNS towers left (all of the context's at level 0)
+    uint32_t level = 0;       // rescalings so far
+    uint32_t scaleDeg = 1;    // scaling factor degree (grows with each multiplication)
+    uint32_t scaleBits = 0;   // log2 of the scaling factor, per degree
+    uint32_t slots = 0;
+    std::string encoding;     // "CKKS_PACKED"
+    std::string keyTag;       // key the ciphertext is encrypted under ("" = not checked)
+};
+
+json HeaderToJson(const CiphertextHeader& h);
+CiphertextHeader HeaderFromJson(const json& j);
+
+// Header of a decoded ciphertext
+CiphertextHeader HeaderOf(const Ct& ct);
+
+// "ct_header" of an encrypted layer; for a layer written before headers
+// existed, the header of its decoded mean ciphertext
+CiphertextHeader LayerHeader(const json& encLayer);
+
+// Throws Error naming the first field of `h` that does not fit `spec` (a
+// Context's Spec(), optionally with the expected keyTag)
+void CheckHeader(const CiphertextHeader& spec, const CiphertextHeader& h);
+
+// --- Context ---
+class Context {
+public:
+    static std::shared_ptr<const Context> LoadFile(const std::string& path);
+    static std::shared_ptr<const Context> LoadBuffer(const std::string& serialized);
+
+    const CC& cc() const { return cc_; }
+    size_t BatchSize() const { return batchSize_; }
+
+    // Header of a fresh ciphertext under this context, keyTag empty
+    const CiphertextHeader& Spec() const { return spec_; }
+
+private:
+    explicit Context(CC cc);
+    CC cc_;
+    size_t batchSize_;
+    CiphertextHeader spec_;
+};
+
+// --- Keys (OpenFHE JSON serialization, as written by keyGen/REkeyGen) ---
+PublicKey  LoadPublicKeyFile(const std::string& path);
+PrivateKey LoadPrivateKeyFile(const std::string& path);
+EvalKey    LoadEvalKeyFile(const std::string& path);
+PublicKey  LoadPublicKeyBuffer(const std::string& serialized);
+PrivateKey LoadPrivateKeyBuffer(const std::string& serialized);
+EvalKey    LoadEvalKeyBuffer(const std::string& serialized);
+
+void SavePublicKeyFile(const std::string& path, const PublicKey& pk);
+void SavePrivateKeyFile(const std::string& path, const PrivateKey& sk);
+void SaveEvalKeyFile(const std::string& path, const EvalKey& rk);
+
+// Fresh key pair under ctx / re-encryption key from sk's domain into pk's
+KeyPair GenerateKeyPair(const Context& ctx);
+EvalKey GenerateReKey(const Context& ctx, const PrivateKey& sk, const PublicKey& peerPk);
+
+// Batches of the above for onboarding many clients (batchKeyGen) or a client
+// with several peers: n key pairs / one re-encryption key from sk's domain
+// into each of peerPks', in input order, computed on up to `threads` threads
+// (0 = one per core)
+std::vector<KeyPair> GenerateKeyPairs(const Context& ctx, size_t n, size_t threads = 0);
+std::vector<EvalKey> GenerateReKeys(const Context& ctx, const PrivateKey& sk, const std::vector<PublicKey>& peerPks,
+                                    size_t threads = 0);
+
+// fn(0) .. fn(n - 1) on up to `threads` threads (0 = one per core), the
+// calling thread included. After a call throws no further ones start; the
+// first exception is rethrown once the running ones have returned.
+void ParallelFor(size_t n, size_t threads, const std::function<void(size_t)>& fn);
+
+// --- Ciphertext <-> Base64 (BINARY serialization) ---
+std::string EncodeCiphertext(const Ct& ct);
+Ct DecodeCiphertext(const std::string& b64);
+
+// --- Weight documents ---
+json ReadJsonFile(const std::string& path);
+void WriteJsonFile(const std::string& path, const json& doc);
+
+// WriteJsonFile in two steps, for callers that time serialization separately
+std::string SerializeJson(const json& doc);
+void WriteTextFile(const std::string& path, const std::string& text);
+
+// Number of Base64 ciphertexts in an encrypted document and their decoded size
+struct CiphertextCount {
+    size_t count = 0;
+    size_t bytes = 0;
+};
+CiphertextCount CountCiphertexts(const json& enc);
+
+// Check every layer's header against ctx (and keyTag, if not empty) and every
+// ciphertext's size against what its header implies, without decoding any
+// polynomials. A layer written before headers existed has its mean decoded
+// for the header instead, unless requireHeader (untrusted uploads) rejects
+// it. Run by the server tools before their first ReEncrypt/EvalAdd.
+// Returns the document's key tag; throws Error naming the offending layer.
+std::string ValidateModel(const Context& ctx, const json& enc, const std::string& keyTag = "",
+                          bool requireHeader = false);
+
+// Plain layer decoded by DecryptLayer
+struct PlainLayer {
+    std::string name;
+    json shape;
+    double mean = 0.0;
+    double std_dev = 0.0;
+    std::vector<double> values;  // trimmed to prod(shape)
+};
+
+// --- Pipeline stages ---
+
+// Called with (index, total, encrypted layer) as soon as each layer is done,
+// so callers can stream layers out while the rest are still encrypting
+using LayerSink = std::function<void(size_t, size_t, const json&)>;
+
+// Encrypt one layer from a tensor view (mean/std_dev supplied by the caller)
+json EncryptLayer(const Context& ctx, const PublicKey& pk, const TensorView& t, double mean, double stddev);
+
+// Encrypt a plaintext weights document; optimizer/ layers are skipped
+json EncryptModel(const Context& ctx, const PublicKey& pk, const json& plain, const LayerSink& sink = nullptr);
+
+// Encrypt tensors (e.g. a mapped TensorFile); mean/std_dev computed from the data
+json EncryptModel(const Context& ctx, const PublicKey& pk, const std::vector<TensorView>& tensors,
+                  const LayerSink& sink = nullptr);
+
+// Re-encrypt every ciphertext of one layer / a whole document into the rekey's target domain
+json ReEncryptLayer(const Context& ctx, const EvalKey& reKey, const json& encLayer);
+json ReEncryptModel(const Context& ctx, const EvalKey& reKey, const json& enc);
+
+// One base64 ciphertext of a layer re-encrypted, for callers that schedule
+// ciphertexts individually
+std::string ReEncryptCiphertext(const Context& ctx, const EvalKey& reKey, const std::string& b64);
+
+// Running encrypted sum of one layer across models sharing a key domain.
+// The first Add fixes name + shape (later ones must match); values are
+// truncated to the shortest list. Each contribution carries a weight
+// (1.0 = full, <1 e.g. for stale updates); Finalize returns
+// sum(w_i * x_i) / sum(w_i) without modifying the accumulator.
+//
+// For tree aggregation, Partial exports the unscaled sum as a layer plus
+// "weight" (sum of w_i) and "count" fields, which an upstream accumulator
+// merges with AddPartial (optionally scaled, e.g. for staleness).
+//
+// Each non-unit weight or scale and Finalize's 1/sum(w_i) costs one
+// multiplicative level, so a stale update in a relay whose partial is then
+// scaled again upstream needs MultiplicativeDepth 3. Add/AddPartial throw
+// Error, leaving the accumulator unchanged, when a contribution would not
+// leave the level Finalize needs.
+// Not thread-safe; callers lock per layer.
+class LayerAccumulator {
+public:
+    void Add(const Context& ctx, const json& encLayer, double weight = 1.0);
+    void AddPartial(const Context& ctx, const json& partial, double scale = 1.0);
+    size_t Count() const { return count_; }
+    double WeightSum() const { return weightSum_; }
+    json Finalize(const Context& ctx) const;
+    json Partial() const;
+
+private:
+    void accumulate(const Context& ctx, const json& encLayer, double ctScale, double weight, size_t count);
+
+    std::string name_;
+    json shape_;
+    Ct mean_, stdDev_;
+    std::vector<Ct> values_;
+    size_t count_ = 0;
+    double weightSum_ = 0.0;
+};
+
+// Average the same layer from several models sharing a key domain
+json AggregateLayers(const Context& ctx, const std::vector<const json*>& layers);
+
+// Average encrypted documents that share a key domain. Layers are matched by
+// name and shape, in the order of the first model.
+json AggregateModels(const Context& ctx, const std::vector<const json*>& encs);
+
+// The layers AggregateModels averages: for each layer of the first model that
+// every model has (same name and shape), that layer of each model
+std::vector<std::vector<const json*>> MatchLayers(const std::vector<const json*>& encs);
+
+// Unweighted mean of the same ciphertext of several layers, as AggregateLayers
+// computes it
+std::string AverageCiphertexts(const Context& ctx, const std::vector<const std::string*>& b64s);
+
+// Decrypt one encrypted layer / a whole encrypted document
+PlainLayer DecryptLayer(const Context& ctx, const PrivateKey& sk, const json& encLayer);
+json DecryptModel(const Context& ctx, const PrivateKey& sk, const json& enc);
+
+}  // namespace ppfl
+
+#endif  // PPFL_H
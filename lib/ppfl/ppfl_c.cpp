@@ -0,0 +1,171 @@
+#include "ppfl/ppfl_c.h"
+#include "ppfl/ppfl.h"
+
+#include <cstdlib>
+#include <cstring>
+
+struct ppfl_context {
+    std::shared_ptr<const ppfl::Context> ctx;
+};
+
+struct ppfl_key {
+    ppfl_key_type type;
+    ppfl::PublicKey pk;
+    ppfl::PrivateKey sk;
+    ppfl::EvalKey rk;
+};
+
+static thread_local std::string g_lastError;
+
+// Run `fn`, translating exceptions into status codes + ppfl_last_error()
+template <typename Fn>
+static int guarded(Fn&& fn) {
+    try {
+        fn();
+        g_lastError.clear();
+        return PPFL_OK;
+    } catch (const std::exception& e) {
+        g_lastError = e.what();
+    } catch (...) {
+        g_lastError = "unknown error";
+    }
+    return PPFL_ERR_FAILED;
+}
+
+static int badArg(const char* what) {
+    g_lastError = std::string("invalid argument: ") + what;
+    return PPFL_ERR_ARG;
+}
+
+static void emit(const std::string& s, char** out, size_t* out_len) {
+    char* buf = static_cast<char*>(std::malloc(s.size() + 1));
+    if (!buf) throw std::bad_alloc();
+    std::memcpy(buf, s.data(), s.size());
+    buf[s.size()] = '\0';
+    *out = buf;
+    *out_len = s.size();
+}
+
+static ppfl::json parseModel(const char* in, size_t in_len) {
+    try {
+        return ppfl::json::parse(in, in + in_len);
+    } catch (const ppfl::json::exception& e) {
+        throw ppfl::Error(std::string("invalid model JSON: ") + e.what());
+    }
+}
+
+extern "C" {
+
+int ppfl_context_load(const char* buf, size_t len, ppfl_context** out) {
+    if (!buf || !out) return badArg("buf/out");
+    return guarded([&] { *out = new ppfl_context{ppfl::Context::LoadBuffer(std::string(buf, len))}; });
+}
+
+int ppfl_context_load_file(const char* path, ppfl_context** out) {
+    if (!path || !out) return badArg("path/out");
+    return guarded([&] { *out = new ppfl_context{ppfl::Context::LoadFile(path)}; });
+}
+
+void ppfl_context_free(ppfl_context* ctx) { delete ctx; }
+
+size_t ppfl_context_batch_size(const ppfl_context* ctx) { return ctx ? ctx->ctx->BatchSize() : 0; }
+
+static void fillKey(ppfl_key& k, const std::string* buf, const char* path) {
+    switch (k.type) {
+        case PPFL_KEY_PUBLIC:
+            k.pk = buf ? ppfl::LoadPublicKeyBuffer(*buf) : ppfl::LoadPublicKeyFile(path);
+            break;
+        case PPFL_KEY_PRIVATE:
+            k.sk = buf ? ppfl::LoadPrivateKeyBuffer(*buf) : ppfl::LoadPrivateKeyFile(path);
+            break;
+        case PPFL_KEY_REKEY:
+            k.rk = buf ? ppfl::LoadEvalKeyBuffer(*buf) : ppfl::LoadEvalKeyFile(path);
+            break;
+        default:
+            throw ppfl::Error("unknown key type");
+    }
+}
+
+int ppfl_key_load(ppfl_key_type type, const char* buf, size_t len, ppfl_key** out) {
+    if (!buf || !out) return badArg("buf/out");
+    return guarded([&] {
+        auto k = std::make_unique<ppfl_key>();
+        k->type = type;
+        std::string s(buf, len);
+        fillKey(*k, &s, nullptr);
+        *out = k.release();
+    });
+}
+
+int ppfl_key_load_file(ppfl_key_type type, const char* path, ppfl_key** out) {
+    if (!path || !out) return badArg("path/out");
+    return guarded([&] {
+        auto k = std::make_unique<ppfl_key>();
+        k->type = type;
+        fillKey(*k, nullptr, path);
+        *out = k.release();
+    });
+}
+
+void ppfl_key_free(ppfl_key* key) { delete key; }
+
+int ppfl_encrypt_model(const ppfl_context* ctx, const ppfl_key* pubkey,
+                       const char* in, size_t in_len, char** out, size_t* out_len) {
+    if (!ctx || !pubkey || pubkey->type != PPFL_KEY_PUBLIC) return badArg("ctx/pubkey");
+    if (!in || !out || !out_len) return badArg("in/out");
+    return guarded([&] {
+        if (!IsTensorBuffer(in, in_len)) {
+            emit(ppfl::EncryptModel(*ctx->ctx, pubkey->pk, parseModel(in, in_len)).dump(), out, out_len);
+            return;
+        }
+        // Tensor data is read in place; a caller's buffer that is not aligned
+        // for double is copied into one that is
+        std::vector<double> aligned;
+        const char* image = in;
+        if (reinterpret_cast<uintptr_t>(in) % alignof(double) != 0) {
+            aligned.resize((in_len + sizeof(double) - 1) / sizeof(double));
+            memcpy(aligned.data(), in, in_len);
+            image = reinterpret_cast<const char*>(aligned.data());
+        }
+        ppfl::json enc = ppfl::EncryptModel(*ctx->ctx, pubkey->pk, ParseTensorBuffer(image, in_len, "tensor buffer"));
+        emit(enc.dump(), out, out_len);
+    });
+}
+
+int ppfl_reencrypt_model(const ppfl_context* ctx, const ppfl_key* rekey,
+                         const char* in, size_t in_len, char** out, size_t* out_len) {
+    if (!ctx || !rekey || rekey->type != PPFL_KEY_REKEY) return badArg("ctx/rekey");
+    if (!in || !out || !out_len) return badArg("in/out");
+    return guarded([&] {
+        emit(ppfl::ReEncryptModel(*ctx->ctx, rekey->rk, parseModel(in, in_len)).dump(), out, out_len);
+    });
+}
+
+int ppfl_aggregate_models(const ppfl_context* ctx, const char* const* ins, const size_t* in_lens,
+                          size_t n_models, char** out, size_t* out_len) {
+    if (!ctx || !ins || !in_lens || n_models == 0) return badArg("ctx/ins");
+    if (!out || !out_len) return badArg("out");
+    return guarded([&] {
+        std::vector<ppfl::json> models;
+        models.reserve(n_models);
+        for (size_t i = 0; i < n_models; i++) models.push_back(parseModel(ins[i], in_lens[i]));
+        std::vector<const ppfl::json*> ptrs;
+        for (const auto& m : models) ptrs.push_back(&m);
+        emit(ppfl::AggregateModels(*ctx->ctx, ptrs).dump(), out, out_len);
+    });
+}
+
+int ppfl_decrypt_model(const ppfl_context* ctx, const ppfl_key* privkey,
+                       const char* in, size_t in_len, char** out, size_t* out_len) {
+    if (!ctx || !privkey || privkey->type != PPFL_KEY_PRIVATE) return badArg("ctx/privkey");
+    if (!in || !out || !out_len) return badArg("in/out");
+    return guarded([&] {
+        emit(ppfl::DecryptModel(*ctx->ctx, privkey->sk, parseModel(in, in_len)).dump(), out, out_len);
+    });
+}
+
+void ppfl_free(void* p) { std::free(p); }
+
+const char* ppfl_last_error(void) { return g_lastError.c_str(); }
+
+}  // extern "C"
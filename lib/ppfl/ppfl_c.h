@@ -0,0 +1,66 @@
+#ifndef PPFL_C_H
+#define PPFL_C_H
+
+/*
+ * C ABI over libppfl (see ppfl.h) for callers that cannot use C++:
+ * the orchestrator tooling and language bindings.
+ *
+ * All buffers are in-memory serializations:
+ *   contexts / keys   OpenFHE JSON (CC.json, *.key)
+ *   models            "weights_summary" JSON; plaintext input to
+ *                     ppfl_encrypt_model may also be a PPFLTNS1 tensor image
+ *
+ * Functions return PPFL_OK or a negative error code; the message of the
+ * last failure on the calling thread is available from ppfl_last_error().
+ * Output buffers are allocated by the library and released with ppfl_free().
+ * Handles are immutable once loaded and may be shared between threads.
+ */
+
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define PPFL_OK            0
+#define PPFL_ERR_ARG      -1   /* NULL / malformed argument */
+#define PPFL_ERR_FAILED   -2   /* deserialization or crypto failure */
+
+typedef struct ppfl_context ppfl_context;
+typedef struct ppfl_key     ppfl_key;
+
+typedef enum {
+    PPFL_KEY_PUBLIC  = 0,
+    PPFL_KEY_PRIVATE = 1,
+    PPFL_KEY_REKEY   = 2
+} ppfl_key_type;
+
+int  ppfl_context_load(const char* buf, size_t len, ppfl_context** out);
+int  ppfl_context_load_file(const char* path, ppfl_context** out);
+void ppfl_context_free(ppfl_context* ctx);
+size_t ppfl_context_batch_size(const ppfl_context* ctx);
+
+int  ppfl_key_load(ppfl_key_type type, const char* buf, size_t len, ppfl_key** out);
+int  ppfl_key_load_file(ppfl_key_type type, const char* path, ppfl_key** out);
+void ppfl_key_free(ppfl_key* key);
+
+int ppfl_encrypt_model(const ppfl_context* ctx, const ppfl_key* pubkey,
+                       const char* in, size_t in_len, char** out, size_t* out_len);
+
+int ppfl_reencrypt_model(const ppfl_context* ctx, const ppfl_key* rekey,
+                         const char* in, size_t in_len, char** out, size_t* out_len);
+
+int ppfl_aggregate_models(const ppfl_context* ctx, const char* const* ins, const size_t* in_lens,
+                          size_t n_models, char** out, size_t* out_len);
+
+int ppfl_decrypt_model(const ppfl_context* ctx, const ppfl_key* privkey,
+                       const char* in, size_t in_len, char** out, size_t* out_len);
+
+void ppfl_free(void* p);
+const char* ppfl_last_error(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* PPFL_C_H */
@@ -0,0 +1,172 @@
+#ifndef PPFL_STAGE_STATS_H
+#define PPFL_STAGE_STATS_H
+
+// Per-phase resource accounting for the crypto CLIs.
+//
+//   ppfl::stats::Recorder stats("encrypt");
+//   stats.begin("context");  ...
+//   stats.begin("compute");  ...  stats.ciphertexts(n.count, n.bytes);
+//   stats.finish();
+//
+// Each phase records wall time, user/sys CPU (getrusage, all threads),
+// RSS at the end of the phase, the phase's peak RSS and the ciphertexts it
+// produced or consumed. The peak is per phase where the kernel allows
+// resetting the high-water mark (/proc/self/clear_refs, "peak_reset": true);
+// otherwise it is the process peak so far.
+//
+// finish() prints one "[<tool>] stats {json}" line to stdout and, when
+// PPFL_STATS_FILE is set, appends the same JSON object as one line to that
+// file, tagged with PPFL_TRACE_ROUND / PPFL_TRACE_CLIENT from the
+// orchestrator (see orchestration/metrics/analyze_stage_stats.py).
+// Every phase is also a trace span "<tool>.<phase>" (trace.h).
+
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <ctime>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <nlohmann/json.hpp>
+
+#include <fcntl.h>
+#include <sys/resource.h>
+#include <unistd.h>
+
+#include "trace.h"
+
+namespace ppfl {
+namespace stats {
+
+// VmRSS / VmHWM of this process in kB (0 if /proc is unavailable)
+inline long ProcStatusKb(const char* key) {
+    std::ifstream f("/proc/self/status");
+    std::string line;
+    size_t n = std::char_traits<char>::length(key);
+    while (std::getline(f, line)) {
+        if (line.compare(0, n, key) == 0 && line.size() > n && line[n] == ':')
+            return std::strtol(line.c_str() + n + 1, nullptr, 10);
+    }
+    return 0;
+}
+
+// Reset VmHWM to the current RSS (Linux >= 4.0)
+inline bool ResetPeakRss() {
+    std::FILE* f = std::fopen("/proc/self/clear_refs", "w");
+    if (!f) return false;
+    bool ok = std::fputs("5", f) >= 0;
+    return (std::fclose(f) == 0) && ok;
+}
+
+inline double Seconds(const timeval& tv) {
+    return tv.tv_sec + tv.tv_usec / 1e6;
+}
+
+class Recorder {
+public:
+    explicit Recorder(std::string tool) : tool_(std::move(tool)), start_us_(trace::NowUs()) {
+        getrusage(RUSAGE_SELF, &start_ru_);
+    }
+    ~Recorder() { finish(false); }
+
+    Recorder(const Recorder&) = delete;
+    Recorder& operator=(const Recorder&) = delete;
+
+    // End the current phase (if any) and start the next one
+    void begin(const std::string& phase) {
+        end();
+        cur_ = nlohmann::json{{"phase", phase}, {"ct_count", 0}, {"ct_bytes", 0}};
+        peak_reset_ = ResetPeakRss();
+        getrusage(RUSAGE_SELF, &ru_);
+        t0_us_ = trace::NowUs();
+        span_.reset(new trace::Span(tool_ + "." + phase));
+    }
+
+    // Ciphertexts read or written by the current phase
+    void ciphertexts(size_t count, size_t bytes) {
+        if (cur_.is_null()) return;
+        cur_["ct_count"] = cur_["ct_count"].get<size_t>() + count;
+        cur_["ct_bytes"] = cur_["ct_bytes"].get<size_t>() + bytes;
+        if (span_) span_->args().bytes += bytes;
+    }
+
+    // Bytes of plain file I/O of the current phase (input/output files)
+    void fileBytes(size_t bytes) {
+        if (cur_.is_null()) return;
+        cur_["file_bytes"] = cur_.value("file_bytes", (size_t) 0) + bytes;
+        if (span_) span_->args().bytes += bytes;
+    }
+
+    void end() {
+        if (cur_.is_null()) return;
+        rusage ru;
+        getrusage(RUSAGE_SELF, &ru);
+        cur_["wall_s"] = (trace::NowUs() - t0_us_) / 1e6;
+        cur_["user_s"] = Seconds(ru.ru_utime) - Seconds(ru_.ru_utime);
+        cur_["sys_s"] = Seconds(ru.ru_stime) - Seconds(ru_.ru_stime);
+        cur_["rss_kb"] = ProcStatusKb("VmRSS");
+        cur_["peak_rss_kb"] = ProcStatusKb("VmHWM");
+        cur_["peak_reset"] = peak_reset_;
+        phases_.push_back(std::move(cur_));
+        cur_ = nullptr;
+        span_.reset();
+    }
+
+    // Emit the summary once; ok=false marks an invocation that threw
+    void finish(bool ok = true) {
+        if (done_) return;
+        end();
+        done_ = true;
+
+        rusage ru;
+        getrusage(RUSAGE_SELF, &ru);
+        nlohmann::json doc = {
+            {"tool", tool_},
+            {"pid", (long) ::getpid()},
+            {"ts", (long long) std::time(nullptr)},
+            {"ok", ok},
+            {"phases", phases_},
+            {"total", {{"wall_s", (trace::NowUs() - start_us_) / 1e6},
+                       {"user_s", Seconds(ru.ru_utime) - Seconds(start_ru_.ru_utime)},
+                       {"sys_s", Seconds(ru.ru_stime) - Seconds(start_ru_.ru_stime)},
+                       {"max_rss_kb", ru.ru_maxrss}}},
+        };
+        if (const char* r = std::getenv("PPFL_TRACE_ROUND")) doc["round"] = std::strtol(r, nullptr, 10);
+        if (const char* c = std::getenv("PPFL_TRACE_CLIENT")) doc["client"] = c;
+
+        std::string line = doc.dump();
+        std::cout << "[" << tool_ << "] stats " << line << std::endl;
+
+        const char* path = std::getenv("PPFL_STATS_FILE");
+        if (path && *path) {
+            // One O_APPEND write() per line keeps concurrent appenders from interleaving
+            int fd = ::open(path, O_WRONLY | O_CREAT | O_APPEND, 0644);
+            if (fd >= 0) {
+                line += '\n';
+                ssize_t n = ::write(fd, line.data(), line.size());
+                (void) n;
+                ::close(fd);
+            } else {
+                std::cerr << "[" << tool_ << "] WARNING: cannot append stats to " << path << std::endl;
+            }
+        }
+    }
+
+private:
+    std::string tool_;
+    int64_t start_us_;
+    rusage start_ru_;
+    rusage ru_{};
+    int64_t t0_us_ = 0;
+    bool peak_reset_ = false;
+    bool done_ = false;
+    nlohmann::json cur_;
+    nlohmann::json phases_ = nlohmann::json::array();
+    std::unique_ptr<trace::Span> span_;
+};
+
+}  // namespace stats
+}  // namespace ppfl
+
+#endif  // PPFL_STAGE_STATS_H
@@ -0,0 +1,169 @@
+// lib/taskGraph.h
+// Dependency graph of tasks run on a bounded number of threads (ppfl_dag)
+//
+// A task names the tasks it depends on by the ids add() returned for them, so
+// the graph is acyclic by construction and insertion order is a topological
+// order. run() starts every task whose dependencies have all succeeded, at
+// most `jobs` at a time, and records when each one ran. After a failure
+// nothing new starts: running tasks finish and the rest are marked skipped.
+//
+//   TaskGraph g;
+//   size_t a = g.add("train_1", {}, [] { return train(1); });
+//   size_t b = g.add("encrypt_1", {a}, [] { return encrypt(1); });
+//   bool ok = g.run(4);
+//   for (size_t i : g.criticalPath()) ...
+
+#ifndef PPFL_TASK_GRAPH_H
+#define PPFL_TASK_GRAPH_H
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+class TaskGraph {
+public:
+    enum class State { Pending, Running, Done, Failed, Skipped };
+
+    struct Task {
+        std::string name;
+        std::vector<size_t> deps;
+        std::function<bool()> fn;  // false (or a throw) = failed
+        State state = State::Pending;
+        int64_t start_us = 0;      // since run() started
+        int64_t end_us = 0;
+        int64_t durationUs() const { return end_us - start_us; }
+    };
+
+    size_t add(std::string name, std::vector<size_t> deps, std::function<bool()> fn) {
+        for (size_t d : deps) {
+            if (d >= tasks_.size()) throw std::invalid_argument("TaskGraph: " + name + " depends on an unknown task");
+        }
+        tasks_.push_back({std::move(name), std::move(deps), std::move(fn)});
+        return tasks_.size() - 1;
+    }
+
+    // Run the graph with up to `jobs` tasks at once; true if every task succeeded
+    bool run(size_t jobs) {
+        std::vector<std::vector<size_t>> dependents(tasks_.size());
+        std::vector<size_t> waiting(tasks_.size());
+        std::deque<size_t> ready;
+        for (size_t i = 0; i < tasks_.size(); i++) {
+            waiting[i] = tasks_[i].deps.size();
+            for (size_t d : tasks_[i].deps) dependents[d].push_back(i);
+            if (waiting[i] == 0) ready.push_back(i);
+        }
+
+        std::mutex m;
+        std::condition_variable cv;
+        size_t running = 0;
+        bool failed = false;
+        start_ = Clock::now();
+
+        auto worker = [&] {
+            std::unique_lock<std::mutex> lk(m);
+            for (;;) {
+                // Nothing can become ready once no task is running
+                cv.wait(lk, [&] { return (!ready.empty() && !failed) || running == 0; });
+                if (ready.empty() || failed) return;
+                size_t i = ready.front();
+                ready.pop_front();
+                Task& t = tasks_[i];
+                t.state = State::Running;
+                t.start_us = elapsedUs();
+                running++;
+                lk.unlock();
+
+                bool ok = false;
+                try {
+                    ok = t.fn();
+                } catch (...) {
+                    ok = false;
+                }
+
+                lk.lock();
+                t.end_us = elapsedUs();
+                t.state = ok ? State::Done : State::Failed;
+                running--;
+                if (!ok) failed = true;
+                for (size_t d : dependents[i]) {
+                    if (ok && --waiting[d] == 0) ready.push_back(d);
+                }
+                cv.notify_all();
+            }
+        };
+
+        std::vector<std::thread> threads;
+        for (size_t n = 0; n < std::max<size_t>(1, std::min(jobs, tasks_.size())); n++) threads.emplace_back(worker);
+        for (auto& t : threads) t.join();
+        wall_us_ = elapsedUs();
+
+        for (auto& t : tasks_) {
+            if (t.state == State::Pending) t.state = State::Skipped;
+        }
+        return !failed;
+    }
+
+    const std::vector<Task>& tasks() const { return tasks_; }
+    int64_t wallUs() const { return wall_us_; }
+
+    // Sum of every task's run time: the wall time of running them one by one
+    int64_t workUs() const {
+        int64_t sum = 0;
+        for (const auto& t : tasks_) sum += t.durationUs();
+        return sum;
+    }
+
+    // Chain of dependent tasks with the largest total run time, first to last.
+    // Its length is the shortest wall time any number of jobs could reach.
+    std::vector<size_t> criticalPath() const {
+        std::vector<int64_t> finish(tasks_.size(), 0);
+        std::vector<size_t> via(tasks_.size(), SIZE_MAX);
+        size_t last = SIZE_MAX;
+        for (size_t i = 0; i < tasks_.size(); i++) {
+            for (size_t d : tasks_[i].deps) {
+                if (finish[d] > finish[i] || via[i] == SIZE_MAX) {
+                    finish[i] = finish[d];
+                    via[i] = d;
+                }
+            }
+            finish[i] += tasks_[i].durationUs();
+            if (last == SIZE_MAX || finish[i] > finish[last]) last = i;
+        }
+        std::vector<size_t> path;
+        for (size_t i = last; i != SIZE_MAX; i = via[i]) path.push_back(i);
+        std::reverse(path.begin(), path.end());
+        return path;
+    }
+
+    static const char* StateName(State s) {
+        switch (s) {
+            case State::Pending: return "pending";
+            case State::Running: return "running";
+            case State::Done: return "ok";
+            case State::Failed: return "failed";
+            case State::Skipped: return "skipped";
+        }
+        return "?";
+    }
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    int64_t elapsedUs() const {
+        return std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() - start_).count();
+    }
+
+    std::vector<Task> tasks_;
+    Clock::time_point start_;
+    int64_t wall_us_ = 0;
+};
+
+#endif  // PPFL_TASK_GRAPH_H
@@ -0,0 +1,173 @@
+#ifndef TENSOR_UTILS_H
+#define TENSOR_UTILS_H
+
+// Raw tensor weight file ("PPFLTNS1"), written by client/src/tensor_io.py
+//
+// Layout (little-endian):
+//   char     magic[8]      "PPFLTNS1"
+//   uint32   dtype         1 = float32, 2 = float64
+//   uint32   num_tensors
+//   per tensor:
+//     uint32 name_len, char name[name_len]
+//     uint32 ndim,     uint64 dims[ndim]
+//     uint64 data_offset   absolute, 64-byte aligned
+//   tensor data (row-major, dtype)
+//
+// The file is mapped read-only so the encoder can read the weights in place.
+
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+static constexpr char TENSOR_FILE_MAGIC[8] = {'P', 'P', 'F', 'L', 'T', 'N', 'S', '1'};
+
+enum class TensorDType : uint32_t { Float32 = 1, Float64 = 2 };
+
+struct TensorView {
+    std::string name;
+    std::vector<size_t> shape;
+    size_t count = 0;            // product of shape
+    TensorDType dtype = TensorDType::Float32;
+    const void* data = nullptr;  // points into the mapping
+
+    // i-th element widened to double
+    double at(size_t i) const {
+        return dtype == TensorDType::Float32
+            ? static_cast<double>(static_cast<const float*>(data)[i])
+            : static_cast<const double*>(data)[i];
+    }
+};
+
+// Returns true if the file at `path` starts with the tensor file magic
+inline bool IsTensorFile(const std::string& path) {
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) return false;
+    char magic[sizeof(TENSOR_FILE_MAGIC)];
+    ssize_t n = ::read(fd, magic, sizeof(magic));
+    ::close(fd);
+    return n == (ssize_t)sizeof(magic) && memcmp(magic, TENSOR_FILE_MAGIC, sizeof(magic)) == 0;
+}
+
+// Parse the header of a tensor image held in memory [base, base + size).
+// Views point into that memory, so each tensor's data must be aligned for its
+// dtype there; `what` names the source in error messages.
+inline std::vector<TensorView> ParseTensorBuffer(const char* base, size_t size, const std::string& what) {
+    size_t off = 0;
+    auto need = [&](size_t n) {
+        if (n > size - off) throw std::runtime_error("Truncated tensor header: " + what);
+    };
+    auto u32 = [&]() { uint32_t v; need(sizeof(v)); memcpy(&v, base + off, sizeof(v)); off += sizeof(v); return v; };
+    auto u64 = [&]() { uint64_t v; need(sizeof(v)); memcpy(&v, base + off, sizeof(v)); off += sizeof(v); return v; };
+
+    if (size < sizeof(TENSOR_FILE_MAGIC) + 8 || memcmp(base, TENSOR_FILE_MAGIC, sizeof(TENSOR_FILE_MAGIC)) != 0)
+        throw std::runtime_error("Not a tensor file (bad magic): " + what);
+    off = sizeof(TENSOR_FILE_MAGIC);
+
+    uint32_t dtype = u32();
+    if (dtype != (uint32_t)TensorDType::Float32 && dtype != (uint32_t)TensorDType::Float64)
+        throw std::runtime_error("Unsupported tensor dtype in " + what);
+    size_t elemSize = dtype == (uint32_t)TensorDType::Float32 ? sizeof(float) : sizeof(double);
+
+    uint32_t numTensors = u32();
+    std::vector<TensorView> tensors;
+    tensors.reserve(numTensors);
+
+    for (uint32_t t = 0; t < numTensors; t++) {
+        TensorView view;
+        view.dtype = static_cast<TensorDType>(dtype);
+
+        uint32_t nameLen = u32();
+        need(nameLen);
+        view.name.assign(base + off, nameLen);
+        off += nameLen;
+
+        uint32_t ndim = u32();
+        view.count = 1;
+        for (uint32_t d = 0; d < ndim; d++) {
+            uint64_t dim = u64();
+            if (dim != 0 && view.count > SIZE_MAX / dim)
+                throw std::runtime_error("Tensor shape overflows for '" + view.name + "' in " + what);
+            view.shape.push_back(static_cast<size_t>(dim));
+            view.count *= static_cast<size_t>(dim);
+        }
+
+        uint64_t dataOffset = u64();
+        if (dataOffset % elemSize != 0 || dataOffset > size || view.count > (size - dataOffset) / elemSize)
+            throw std::runtime_error("Tensor data out of bounds for '" + view.name + "' in " + what);
+        if (reinterpret_cast<uintptr_t>(base + dataOffset) % elemSize != 0)
+            throw std::runtime_error("Tensor data misaligned for '" + view.name + "' in " + what);
+        view.data = base + dataOffset;
+
+        tensors.push_back(std::move(view));
+    }
+    return tensors;
+}
+
+// True if the memory range starts with the tensor file magic
+inline bool IsTensorBuffer(const char* base, size_t size) {
+    return size >= sizeof(TENSOR_FILE_MAGIC) && memcmp(base, TENSOR_FILE_MAGIC, sizeof(TENSOR_FILE_MAGIC)) == 0;
+}
+
+// Read-only mmap of a tensor file; views stay valid while the object lives
+class TensorFile {
+public:
+    explicit TensorFile(const std::string& path) {
+        fd_ = ::open(path.c_str(), O_RDONLY);
+        if (fd_ < 0) throw std::runtime_error("Cannot open tensor file: " + path);
+
+        struct stat st;
+        if (fstat(fd_, &st) != 0) {
+            ::close(fd_);
+            throw std::runtime_error("Cannot stat tensor file: " + path);
+        }
+        size_ = static_cast<size_t>(st.st_size);
+        if (size_ < sizeof(TENSOR_FILE_MAGIC) + 8) {
+            ::close(fd_);
+            throw std::runtime_error("Tensor file too small: " + path);
+        }
+
+        void* p = mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd_, 0);
+        if (p == MAP_FAILED) {
+            ::close(fd_);
+            throw std::runtime_error("Cannot mmap tensor file: " + path);
+        }
+        base_ = static_cast<const char*>(p);
+        madvise(p, size_, MADV_SEQUENTIAL);
+
+        try {
+            tensors_ = ParseTensorBuffer(base_, size_, path);
+        } catch (...) {
+            release();
+            throw;
+        }
+    }
+
+    ~TensorFile() { release(); }
+
+    TensorFile(const TensorFile&) = delete;
+    TensorFile& operator=(const TensorFile&) = delete;
+
+    const std::vector<TensorView>& tensors() const { return tensors_; }
+
+private:
+    void release() {
+        if (base_) munmap(const_cast<char*>(base_), size_);
+        if (fd_ >= 0) ::close(fd_);
+        base_ = nullptr;
+        fd_ = -1;
+    }
+
+    int fd_ = -1;
+    size_t size_ = 0;
+    const char* base_ = nullptr;
+    std::vector<TensorView> tensors_;
+};
+
+#endif // TENSOR_UTILS_H
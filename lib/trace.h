@@ -0,0 +1,175 @@
+#ifndef PPFL_TRACE_H
+#define PPFL_TRACE_H
+
+// Span tracing shared by all PPFL binaries (and mirrored by trace_span in
+// orchestration/helper_fns.sh).
+//
+// Off unless PPFL_TRACE_DIR is set. Each process then appends Chrome trace
+// events, one JSON object per line, to
+//   $PPFL_TRACE_DIR/<process>.<pid>.trace.jsonl
+// with CLOCK_MONOTONIC microsecond timestamps. The first lines carry the
+// process name and a clock_sync anchor (monotonic + wall clock at open), so
+// orchestration/metrics/merge_traces.py can put every process of a run on
+// one timeline and emit a single Chrome/Perfetto trace.
+//
+//   {
+//       ppfl::trace::Span span("encrypt_layer", {round, client, layer});
+//       ...
+//       span.args().bytes = out.size();
+//   }   // event written here (or at span.end())
+//
+// Span args default round/client to PPFL_TRACE_ROUND / PPFL_TRACE_CLIENT,
+// which the orchestrator exports for every binary it starts. Writes are
+// serialized and flushed per event, so a killed server keeps its trace.
+
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <ctime>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <nlohmann/json.hpp>
+
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+namespace ppfl {
+namespace trace {
+
+struct Args {
+    long round = -1;       // -1: PPFL_TRACE_ROUND
+    std::string client;    // empty: PPFL_TRACE_CLIENT
+    long layer = -1;
+    size_t bytes = 0;
+};
+
+inline int64_t NowUs() {
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t) ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+class Writer {
+public:
+    static Writer& Get() {
+        static Writer w;
+        return w;
+    }
+
+    bool enabled() const { return file_ != nullptr; }
+
+    // Complete ("X") event from start_us lasting dur_us
+    void complete(const std::string& name, int64_t start_us, int64_t dur_us, const Args& a) {
+        if (!file_) return;
+        nlohmann::json args;
+        long round = a.round >= 0 ? a.round : defaultRound_;
+        const std::string& client = a.client.empty() ? defaultClient_ : a.client;
+        if (round >= 0) args["round"] = round;
+        if (!client.empty()) args["client"] = client;
+        if (a.layer >= 0) args["layer"] = a.layer;
+        if (a.bytes) args["bytes"] = a.bytes;
+
+        nlohmann::json ev = {{"name", name}, {"cat", process_}, {"ph", "X"}, {"ts", start_us},
+                             {"dur", dur_us}, {"pid", pid_}, {"tid", threadId()}, {"args", std::move(args)}};
+        write(ev.dump());
+    }
+
+    ~Writer() {
+        if (file_) std::fclose(file_);
+    }
+
+private:
+    Writer() {
+        const char* dir = std::getenv("PPFL_TRACE_DIR");
+        if (!dir || !*dir) return;
+        ::mkdir(dir, 0755);
+
+        pid_ = (long) ::getpid();
+        process_ = processName();
+        std::string path = std::string(dir) + "/" + process_ + "." + std::to_string(pid_) + ".trace.jsonl";
+        file_ = std::fopen(path.c_str(), "a");
+        if (!file_) return;
+
+        if (const char* r = std::getenv("PPFL_TRACE_ROUND")) defaultRound_ = std::strtol(r, nullptr, 10);
+        if (const char* c = std::getenv("PPFL_TRACE_CLIENT")) defaultClient_ = c;
+
+        timespec wall;
+        clock_gettime(CLOCK_REALTIME, &wall);
+        int64_t wall_us = (int64_t) wall.tv_sec * 1000000 + wall.tv_nsec / 1000;
+        std::string label = process_ + (defaultClient_.empty() ? "" : " (client " + defaultClient_ + ")");
+        write(nlohmann::json{{"name", "process_name"}, {"ph", "M"}, {"pid", pid_},
+                             {"args", {{"name", label}}}}.dump());
+        write(nlohmann::json{{"name", "clock_sync"}, {"ph", "M"}, {"pid", pid_},
+                             {"args", {{"mono_us", NowUs()}, {"wall_us", wall_us}}}}.dump());
+    }
+
+    Writer(const Writer&) = delete;
+    Writer& operator=(const Writer&) = delete;
+
+    static std::string processName() {
+        std::string name;
+        if (FILE* f = std::fopen("/proc/self/comm", "r")) {
+            char buf[64] = {0};
+            if (std::fgets(buf, sizeof(buf), f)) name = buf;
+            std::fclose(f);
+        }
+        while (!name.empty() && (name.back() == '\n' || name.back() == ' ')) name.pop_back();
+        for (auto& ch : name) {
+            if (ch == '/' || ch == '.') ch = '_';
+        }
+        return name.empty() ? "ppfl" : name;
+    }
+
+    static long threadId() {
+        static thread_local long tid = (long) ::syscall(SYS_gettid);
+        return tid;
+    }
+
+    void write(const std::string& line) {
+        std::lock_guard<std::mutex> lock(m_);
+        std::fputs(line.c_str(), file_);
+        std::fputc('\n', file_);
+        std::fflush(file_);
+    }
+
+    std::FILE* file_ = nullptr;
+    std::mutex m_;
+    long pid_ = 0;
+    std::string process_;
+    long defaultRound_ = -1;
+    std::string defaultClient_;
+};
+
+inline bool Enabled() { return Writer::Get().enabled(); }
+
+// RAII span; a single flag check when tracing is off
+class Span {
+public:
+    explicit Span(std::string name, Args args = {})
+        : on_(Enabled()), name_(std::move(name)), args_(std::move(args)), start_(on_ ? NowUs() : 0) {}
+    ~Span() { end(); }
+
+    // Emit now instead of at scope exit (for sequential steps in one scope)
+    void end() {
+        if (on_) Writer::Get().complete(name_, start_, NowUs() - start_, args_);
+        on_ = false;
+    }
+
+    Span(const Span&) = delete;
+    Span& operator=(const Span&) = delete;
+
+    Args& args() { return args_; }
+
+private:
+    bool on_;
+    std::string name_;
+    Args args_;
+    int64_t start_;
+};
+
+}  // namespace trace
+}  // namespace ppfl
+
+#endif  // PPFL_TRACE_H
@@ -0,0 +1,188 @@
+// lib/wireCodec.h
+// Content-Encoding for runMserver and ppfl_xfer transfers: gzip (zlib,
+// always built) and zstd (only with -DPPFL_WITH_ZSTD, `make ZSTD=1`)
+//
+// Bodies are decoded chunk by chunk straight into the destination stream,
+// so a compressed transfer never exists decompressed in memory. runMserver
+// encodes each cached file body once per encoding (see FileCache).
+//
+// Decoding stops with WireError once the output passes max_out, so a small
+// compressed body cannot expand without bound (a decompression bomb).
+//
+// Errors (unknown encoding, corrupt data, too large) throw WireError;
+// handlers turn them into 415 / 400 replies.
+
+#ifndef PPFL_WIRE_CODEC_H
+#define PPFL_WIRE_CODEC_H
+
+#include <cstdint>
+#include <cstdlib>
+#include <ostream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <zlib.h>
+#ifdef PPFL_WITH_ZSTD
+#include <zstd.h>
+#endif
+
+namespace wire {
+
+struct WireError : std::runtime_error {
+    using std::runtime_error::runtime_error;
+};
+
+// mSConfig.COMPRESSION
+struct Options {
+    int gzip_level = 6;        // LEVEL_GZIP, 1..9
+    int zstd_level = 3;        // LEVEL_ZSTD, 1..19
+    size_t min_bytes = 1024;   // MIN_BYTES, smaller replies go out as-is
+};
+
+inline bool Supported(const std::string &enc) {
+    if (enc.empty() || enc == "identity" || enc == "gzip") return true;
+#ifdef PPFL_WITH_ZSTD
+    if (enc == "zstd") return true;
+#endif
+    return false;
+}
+
+// Encodings this build accepts, for the Accept-Encoding response header
+inline const char *AcceptList() {
+#ifdef PPFL_WITH_ZSTD
+    return "zstd, gzip";
+#else
+    return "gzip";
+#endif
+}
+
+// Best encoding both sides support for a request's Accept-Encoding ("" = none).
+// q-values are not weighed; an explicit q=0 disables an encoding.
+inline std::string Negotiate(const std::string &accept) {
+    auto offered = [&accept](const char *enc) {
+        size_t pos = accept.find(enc);
+        if (pos == std::string::npos) return false;
+        size_t end = accept.find(',', pos);
+        std::string item = accept.substr(pos, end == std::string::npos ? std::string::npos : end - pos);
+        size_t q = item.find("q=");
+        return q == std::string::npos || std::strtod(item.c_str() + q + 2, nullptr) > 0;
+    };
+#ifdef PPFL_WITH_ZSTD
+    if (offered("zstd")) return "zstd";
+#endif
+    if (offered("gzip")) return "gzip";
+    return "";
+}
+
+// Decode `len` bytes in encoding `enc` into `out`, 256 KB at a time. Returns decoded size;
+// throws before writing past max_out bytes.
+inline size_t DecodeTo(const std::string &enc, const char *data, size_t len, std::ostream &out,
+                       size_t max_out = SIZE_MAX) {
+    auto tooLarge = [max_out] { return WireError("decoded body exceeds " + std::to_string(max_out) + " bytes"); };
+    if (enc.empty() || enc == "identity") {
+        if (len > max_out) throw tooLarge();
+        out.write(data, (std::streamsize) len);
+        return len;
+    }
+    std::vector<char> buf(256 * 1024);
+    size_t total = 0;
+
+    if (enc == "gzip") {
+        z_stream zs{};
+        if (inflateInit2(&zs, 15 + 16) != Z_OK) throw WireError("inflateInit2 failed");
+        zs.next_in = (Bytef *) data;
+        zs.avail_in = (uInt) len;
+        int rc = Z_OK;
+        while (rc != Z_STREAM_END) {
+            zs.next_out = (Bytef *) buf.data();
+            zs.avail_out = (uInt) buf.size();
+            rc = inflate(&zs, Z_NO_FLUSH);
+            if (rc != Z_OK && rc != Z_STREAM_END) {
+                inflateEnd(&zs);
+                throw WireError("corrupt gzip body");
+            }
+            size_t n = buf.size() - zs.avail_out;
+            if (n > max_out - total) {
+                inflateEnd(&zs);
+                throw tooLarge();
+            }
+            out.write(buf.data(), (std::streamsize) n);
+            total += n;
+            if (rc == Z_OK && zs.avail_in == 0 && n == 0) {
+                inflateEnd(&zs);
+                throw WireError("truncated gzip body");
+            }
+        }
+        inflateEnd(&zs);
+        return total;
+    }
+
+#ifdef PPFL_WITH_ZSTD
+    if (enc == "zstd") {
+        ZSTD_DCtx *dctx = ZSTD_createDCtx();
+        ZSTD_inBuffer in = {data, len, 0};
+        size_t rc = 1;
+        while (in.pos < in.size || rc != 0) {
+            ZSTD_outBuffer o = {buf.data(), buf.size(), 0};
+            rc = ZSTD_decompressStream(dctx, &o, &in);
+            if (ZSTD_isError(rc)) {
+                ZSTD_freeDCtx(dctx);
+                throw WireError(std::string("corrupt zstd body: ") + ZSTD_getErrorName(rc));
+            }
+            if (o.pos > max_out - total) {
+                ZSTD_freeDCtx(dctx);
+                throw tooLarge();
+            }
+            out.write(buf.data(), (std::streamsize) o.pos);
+            total += o.pos;
+            if (in.pos == in.size && o.pos == 0 && rc != 0) {
+                ZSTD_freeDCtx(dctx);
+                throw WireError("truncated zstd body");
+            }
+        }
+        ZSTD_freeDCtx(dctx);
+        return total;
+    }
+#endif
+    throw WireError("unsupported Content-Encoding: " + enc);
+}
+
+inline std::string Decode(const std::string &enc, const char *data, size_t len, size_t max_out = SIZE_MAX) {
+    std::ostringstream out;
+    DecodeTo(enc, data, len, out, max_out);
+    return out.str();
+}
+
+inline std::string Encode(const std::string &enc, const std::string &in, const Options &opt) {
+    if (enc == "gzip") {
+        z_stream zs{};
+        if (deflateInit2(&zs, opt.gzip_level, Z_DEFLATED, 15 + 16, 8, Z_DEFAULT_STRATEGY) != Z_OK)
+            throw WireError("deflateInit2 failed");
+        std::string out(deflateBound(&zs, (uLong) in.size()), '\0');
+        zs.next_in = (Bytef *) in.data();
+        zs.avail_in = (uInt) in.size();
+        zs.next_out = (Bytef *) &out[0];
+        zs.avail_out = (uInt) out.size();
+        int rc = deflate(&zs, Z_FINISH);
+        deflateEnd(&zs);
+        if (rc != Z_STREAM_END) throw WireError("gzip compression failed");
+        out.resize(zs.total_out);
+        return out;
+    }
+#ifdef PPFL_WITH_ZSTD
+    if (enc == "zstd") {
+        std::string out(ZSTD_compressBound(in.size()), '\0');
+        size_t n = ZSTD_compress(&out[0], out.size(), in.data(), in.size(), opt.zstd_level);
+        if (ZSTD_isError(n)) throw WireError(std::string("zstd compression failed: ") + ZSTD_getErrorName(n));
+        out.resize(n);
+        return out;
+    }
+#endif
+    throw WireError("unsupported Content-Encoding: " + enc);
+}
+
+}  // namespace wire
+
+#endif  // PPFL_WIRE_CODEC_H
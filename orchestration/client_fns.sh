@@ -6,6 +6,7 @@
 CLIENT_BUILD="$BASE_DIR/client/build"
 KEYGEN_BIN="$CLIENT_BUILD/keyGen"
 REKEYGEN_BIN="$CLIENT_BUILD/REkeyGen"
+BATCHKEYGEN_BIN="$CLIENT_BUILD/batchKeyGen"
 ENCRYPT_BIN="$CLIENT_BUILD/encryptModelWeights"
 DECRYPT_BIN="$CLIENT_BUILD/decryptModelWeights"
 
@@ -23,6 +24,13 @@ CLIENT_2_ENCWEIGHTS="$CLIENT_2_STORAGE/../private/encrypted_weights_c2.json"
 CLIENT_1_AGGRENCWEIGHTS="$CLIENT_1_STORAGE/../private/"
 CLIENT_2_AGGRENCWEIGHTS="$CLIENT_2_STORAGE/../private/"
 
+# c_inprocess_crypto <i>: true if client i encrypts/decrypts inside c_trainAndUpdate.py
+# (CLIENT.INPROCESS_CRYPTO, needs the ppfl_client extension from `make pyppfl`)
+c_inprocess_crypto() {
+    local cfg="$BASE_DIR/client/config/client_$1/c_config.json"
+    [ "$(jq -r '.CLIENT.INPROCESS_CRYPTO // false' "$cfg")" = "true" ]
+}
+
 o_get_cc_for_clients() {
     comm_getCC 1 "$CLIENT_1_STORAGE/CC.json"
     comm_getCC 2 "$CLIENT_2_STORAGE/CC.json"
@@ -32,48 +40,172 @@ o_get_cc_for_clients() {
 # Client compute actions, across all clients
 # ----------------------------
 
-# c_keygen: Each client generates its key pair (writes PUBKEY and PRIVKEY)
+# c_keygen [ids...]: Each client generates its key pair (writes PUBKEY and PRIVKEY)
 c_keyGen() {
-    for i in 1 2; do
+    for i in ${*:-1 2}; do
         CLIENT_CONFIG="$BASE_DIR/client/config/client_$i/c_config.json"
         cc_path=$(READJSON "$CLIENT_CONFIG" '.CLIENT.CC_PATH')
         pubkey_out=$(READJSON "$CLIENT_CONFIG" '.CLIENT.PUBKEY_PATH')
         privkey_out=$(READJSON "$CLIENT_CONFIG" '.CLIENT.PRIVKEY_PATH')
 
+        local art=("keyGen:client_$i" "$pubkey_out" "$privkey_out" -- "$cc_path" "$KEYGEN_BIN")
+        if artifact_fresh "${art[@]}"; then
+            log "client_$i" "KeyGen" "Key pair up to date for this CC.json, skipping"
+            continue
+        fi
+
         log "client_$i" "KeyGen" "Generating key pair"
         #echo "[client] keyGen for Client $i..."
         "$KEYGEN_BIN" "$cc_path" "$pubkey_out" "$privkey_out"
+        artifact_record "${art[@]}"
     done
 }
 
-# c_Rekeygen: each client generates a re-key for server domain changes
+# c_Rekeygen [ids...]: each client generates a re-key for server domain changes
 c_RekeyGen() {
-    for i in 1 2; do
+    for i in ${*:-1 2}; do
         CLIENT_CONFIG="$BASE_DIR/client/config/client_$i/c_config.json"
         cc_path=$(READJSON "$CLIENT_CONFIG" '.CLIENT.CC_PATH')
         privkey=$(READJSON "$CLIENT_CONFIG" '.CLIENT.PRIVKEY_PATH')
         peer_pubkey=$(READJSON "$CLIENT_CONFIG" '.CLIENT.PEER_PUBKEY_PATH')
         rekey_out=$(READJSON "$CLIENT_CONFIG" '.CLIENT.REKEY_PATH')
 
+        local art=("REkeyGen:client_$i" "$rekey_out" -- "$cc_path" "$privkey" "$peer_pubkey" "$REKEYGEN_BIN")
+        if artifact_fresh "${art[@]}"; then
+            log "client_$i" "ReKeyGen" "Re-key up to date for these keys, skipping"
+            continue
+        fi
+
         log "client_$i" "ReKeyGen" "Generating for domain change"
         #echo "[client] REkeyGen for Client $i..."
         "$REKEYGEN_BIN" "$cc_path" "$privkey" "$peer_pubkey" "$rekey_out"
+        artifact_record "${art[@]}"
+    done
+}
+
+# c_batchKeyGen [ids...]: c_keyGen + c_RekeyGen of all the clients in one
+# batchKeyGen process (oConfig BATCH_KEYGEN), the CryptoContext loaded once
+# and the keys generated in parallel. Each client's re-key goes into the
+# domain of the client its PEER_ID names, which must be in the same batch,
+# so the peer keys need not be distributed first.
+c_batchKeyGen() {
+    local cfgs=() i plan
+    for i in ${*:-1 2}; do cfgs+=("$BASE_DIR/client/config/client_$i/c_config.json"); done
+    plan=$(jq -s '[.[].CLIENT] as $c
+        | [$c[] | select(.PEER_ID as $p | [$c[].client_id] | index($p) | not) | .client_id] as $orphans
+        | if ($orphans | length) > 0 then error("no peer in this batch for \($orphans | join(", ")) (PEER_ID)") else . end
+        | {clients: [$c[] | {id: .client_id, public: .PUBKEY_PATH, private: .PRIVKEY_PATH}],
+           rekeys: [$c[] as $from | $c[] | select(.client_id == $from.PEER_ID)
+                    | {from: $from.client_id, to: .client_id, output: $from.REKEY_PATH}]}' "${cfgs[@]}" 2>&1) || {
+        log "client" "error" "batchKeyGen: $plan"
+        return 1
+    }
+
+    local outputs=() cc_path
+    mapfile -t outputs < <(echo "$plan" | jq -r '(.clients[] | .public, .private), .rekeys[].output')
+    cc_path=$(READJSON "${cfgs[0]}" '.CLIENT.CC_PATH')
+    local art=("batchKeyGen" "${outputs[@]}" -- "$cc_path" "${cfgs[@]}" "$BATCHKEYGEN_BIN")
+    if artifact_fresh "${art[@]}"; then
+        log "client" "batchKeyGen" "Key pairs and re-keys up to date for this CC.json, skipping"
+        return 0
+    fi
+
+    log "client" "batchKeyGen" "Generating $(echo "$plan" | jq '.clients | length') key pair(s) and $(echo "$plan" | jq '.rekeys | length') re-key(s)"
+    local plan_file="$BASE_DIR/orchestration/.artifacts/keygen_plan.json"
+    mkdir -p "$(dirname "$plan_file")"
+    echo "$plan" > "$plan_file"
+    "$BATCHKEYGEN_BIN" "$cc_path" "$plan_file" \
+        ${KEYGEN_TIMING:+--timing "$BASE_DIR/$KEYGEN_TIMING"}
+    artifact_record "${art[@]}"
+}
+
+# ----------------------------
+# Training drivers: an in-process crypto client trains every round in one
+# long-lived c_trainAndUpdate.py (--serve), so its CryptoContext and keys are
+# loaded once per run rather than once per round. Requests and replies go
+# through two FIFOs under C_DRIVER_DIR/client_<i>; the pid file lets the
+# ppfl_dag task shells find the driver too.
+# ----------------------------
+C_DRIVER_DIR="$BASE_DIR/orchestration/.artifacts/drivers"
+
+# c_start_drivers [ids...]: start a training driver for each in-process crypto client
+c_start_drivers() {
+    for i in ${*:-1 2}; do
+        c_inprocess_crypto "$i" || continue
+        local dir="$C_DRIVER_DIR/client_$i"
+        rm -rf "$dir"
+        mkdir -p "$dir"
+        mkfifo "$dir/cmd" "$dir/reply"
+        log "client_$i" "driver" "Starting training driver"
+        PPFL_TRACE_CLIENT=$i python3 "$BASE_DIR/client/src/c_trainAndUpdate.py" \
+            --serve "$dir/cmd" "$dir/reply" "$$" &
+        echo $! > "$dir/pid"
     done
 }
 
-# c_training: Run local training (calls Python training script for each client)
+# c_stop_drivers: stop every running training driver (between rounds, so none is mid-request)
+c_stop_drivers() {
+    local pidfile
+    for pidfile in "$C_DRIVER_DIR"/client_*/pid; do
+        [ -f "$pidfile" ] || continue
+        kill "$(cat "$pidfile")" 2>/dev/null || true
+        rm -f "$pidfile"
+    done
+}
+
+# c_driver_alive <i>: true if client i has a running training driver
+c_driver_alive() {
+    local pidfile="$C_DRIVER_DIR/client_$1/pid"
+    [ -f "$pidfile" ] && kill -0 "$(cat "$pidfile")" 2>/dev/null
+}
+
+# c_driver_train <i> <config>: run one training round on client i's driver and wait for it.
+# The FIFOs are opened read-write so neither open blocks, and cmd stays open until
+# the reply (a FIFO drops unread data once its last descriptor closes). The reply
+# is matched by token; a driver that dies mid-round fails the call instead of hanging it.
+c_driver_train() {
+    local i=$1 config=$2 dir="$C_DRIVER_DIR/client_$1"
+    local pid=$(cat "$dir/pid") token="$BASHPID.${EPOCHREALTIME//[.,]/}" reply=""
+    local cmd_fd reply_fd
+    exec {reply_fd}<>"$dir/reply" {cmd_fd}<>"$dir/cmd"
+    echo "$token ${PPFL_TRACE_ROUND:-0} $config" >&$cmd_fd
+    while [ "${reply%% *}" != "$token" ]; do
+        if ! read -r -t 5 -u "$reply_fd" reply; then
+            reply=""
+            kill -0 "$pid" 2>/dev/null && continue
+            exec {cmd_fd}>&- {reply_fd}<&-
+            log "client_$i" "c_training" "Training driver $pid exited"
+            return 1
+        fi
+    done
+    exec {cmd_fd}>&- {reply_fd}<&-
+    [ "${reply#* }" = "OK" ] && return 0
+    log "client_$i" "c_training" "${reply#* }"
+    return 1
+}
+
+# c_training [ids...]: Run local training (calls Python training script for each client,
+# through the client's training driver if it has one)
 c_training() {
-    for i in 1 2; do
+    for i in ${*:-1 2}; do
         CLIENT_CONFIG="$BASE_DIR/client/config/client_$i/c_config.json"
         log "client_$i" "c_training" "Local Training"
         #echo "[client $i] Local training..."
-        python3 "$BASE_DIR/client/src/c_trainAndUpdate.py" "$CLIENT_CONFIG"
+        if c_driver_alive "$i"; then
+            PPFL_TRACE_CLIENT=$i trace_span "c_training" c_driver_train "$i" "$CLIENT_CONFIG"
+        else
+            PPFL_TRACE_CLIENT=$i trace_span "c_training" python3 "$BASE_DIR/client/src/c_trainAndUpdate.py" "$CLIENT_CONFIG"
+        fi
     done
 }
 
-# c_encryptWeights: clients encrypt local weights (produces encrypted files)
+# c_encryptWeights [ids...]: clients encrypt local weights (produces encrypted files)
 c_encryptWeights() {
-    for i in 1 2; do
+    for i in ${*:-1 2}; do
+        if c_inprocess_crypto "$i"; then
+            log "client_$i" "c_encryptWeights" "Encrypted in-process during training, skipping"
+            continue
+        fi
         CLIENT_CONFIG="$BASE_DIR/client/config/client_$i/c_config.json"
         cc_path=$(READJSON "$CLIENT_CONFIG" '.CLIENT.CC_PATH')
         pubkey=$(READJSON "$CLIENT_CONFIG" '.CLIENT.PUBKEY_PATH')
@@ -82,13 +214,58 @@ c_encryptWeights() {
 
         log "client_$i" "c_encryptWeights" "Encrypting local weights"
         #echo "[client] Encrypting weights for Client $i..."
-        "$ENCRYPT_BIN" "$cc_path" "$pubkey" "$inputweights" "$outputencfile"
+        PPFL_TRACE_CLIENT=$i "$ENCRYPT_BIN" "$cc_path" "$pubkey" "$inputweights" "$outputencfile"
     done
 }
 
+# c_encryptWeights_stream <i> <round>: encrypt client i's weights layer by layer and
+# upload each layer as soon as it is ready (ROUND_MODE=STREAM)
+c_encryptWeights_stream() {
+    local i=$1
+    local round=$2
+    CLIENT_CONFIG="$BASE_DIR/client/config/client_$i/c_config.json"
+    local cc_path=$(READJSON "$CLIENT_CONFIG" '.CLIENT.CC_PATH')
+    local pubkey=$(READJSON "$CLIENT_CONFIG" '.CLIENT.PUBKEY_PATH')
+    local inputweights=$(READJSON "$CLIENT_CONFIG" '.CLIENT.INPUT_WEIGHTS_PATH')
+    local outputencfile=$(READJSON "$CLIENT_CONFIG" '.CLIENT.OUTPUT_ENCRYPTED_WEIGHTS_PATH')
+    local layer_dir="$(dirname "$outputencfile")/layer_stream"
+
+    rm -rf "$layer_dir"
+    mkdir -p "$layer_dir"
+
+    if c_inprocess_crypto "$i"; then
+        # Already encrypted during training: just split the document into layers
+        log "client_$i" "c_encryptWeights_stream" "Splitting in-process encrypted weights into layers"
+        local n=$(jq '.weights_summary | length' "$outputencfile")
+        for (( k=0; k<n; k++ )); do
+            jq -c ".weights_summary[$k]" "$outputencfile" > "$layer_dir/$(printf 'layer_%05d_of_%05d.json' "$k" "$n")"
+        done
+        touch "$layer_dir/done"
+        comm_stream_layers "$i" "$layer_dir" "$round" "$BASHPID"
+        return
+    fi
+
+    log "client_$i" "c_encryptWeights_stream" "Encrypting and streaming local weights"
+    PPFL_TRACE_CLIENT=$i "$ENCRYPT_BIN" "$cc_path" "$pubkey" "$inputweights" "$outputencfile" --layer-dir "$layer_dir" &
+    local enc_pid=$!
+    if ! comm_stream_layers "$i" "$layer_dir" "$round" "$enc_pid"; then
+        kill "$enc_pid" 2>/dev/null || true
+        return 1
+    fi
+    wait "$enc_pid"
+}
+
 #c_decryptWeights: clients decrypt the aggregated ciphertext into plaintext
+# $1 = round, then optional client ids; in-process clients decrypt at the start
+# of the next training round instead, so they only need the binary after the final round
 c_decryptWeights() {
-    for i in 1 2; do
+    local round=${1:-$ROUNDS}
+    shift || true
+    for i in ${*:-1 2}; do
+        if c_inprocess_crypto "$i" && [ "$round" -lt "$ROUNDS" ]; then
+            log "client_$i" "c_decryptWeights" "Decrypted in-process by next training round, skipping"
+            continue
+        fi
         CLIENT_CONFIG="$BASE_DIR/client/config/client_$i/c_config.json"
         cc_path=$(READJSON "$CLIENT_CONFIG" '.CLIENT.CC_PATH')
         privkey=$(READJSON "$CLIENT_CONFIG" '.CLIENT.PRIVKEY_PATH')
@@ -97,7 +274,7 @@ c_decryptWeights() {
 
         log "client_$i" "c_decryptWeights" "Decrypting Aggregated weights"
         #echo "[client] Decrypting aggregated weights for Client $i..."
-        "$DECRYPT_BIN" "$cc_path" "$privkey" "$inputweights" "$outputdecfile"
+        PPFL_TRACE_CLIENT=$i "$DECRYPT_BIN" "$cc_path" "$privkey" "$inputweights" "$outputdecfile"
     done
 }
 
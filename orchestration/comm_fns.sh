@@ -73,73 +73,199 @@ comm_getFile() {
     log "comm" "getFile" "Successfully fetched ${relpath} -> ${dest}"
 }
 
+# comm_stream_layers: upload a client's encrypted layers while they are being produced
+# $1 = client id, $2 = layer dir written by `encryptModelWeights --layer-dir`,
+# $3 = round, $4 = pid of the encryptor (to detect it dying before "done")
+comm_stream_layers() {
+    local client_id=$1
+    local layer_dir=$2
+    local round=$3
+    local enc_pid=$4
+    local acks=$(mktemp -d)
+    local -A sent=()
+    local f base k n finished jobs
+
+    while :; do
+        # Check for the marker before scanning so the last layers are never missed
+        finished=0
+        [ -f "$layer_dir/done" ] && finished=1
+
+        # Every layer found in this scan goes out in one mxfer batch (parallel, keep-alive)
+        jobs=()
+        for f in "$layer_dir"/layer_*_of_*.json; do
+            [ -e "$f" ] || continue
+            [ -n "${sent[$f]}" ] && continue
+            base=${f##*/}                       # layer_00003_of_00012.json
+            k=$((10#${base:6:5}))
+            n=$((10#${base:15:5}))
+            jobs+=("POST http://${SERVER_IP}:${SERVER_PORT}/uploadEncLayerC${client_id}?round=${round}&layer=${k}&layers=${n} $acks/$k.ack $client_id layer $f")
+        done
+        if [ ${#jobs[@]} -gt 0 ]; then
+            printf '%s\n' "${jobs[@]}" | mxfer || { rm -rf "$acks"; return 1; }
+            local job ack
+            for job in "${jobs[@]}"; do
+                read -r _ _ ack _ _ f <<< "$job"
+                if ! grep -q '"queued"' "$ack"; then
+                    log "comm" "error" "Server rejected layer $(basename "$ack" .ack) of client $client_id: $(cat "$ack")"
+                    rm -rf "$acks"
+                    return 1
+                fi
+                sent[$f]=1
+            done
+        fi
+
+        [ $finished -eq 1 ] && break
+        if ! kill -0 "$enc_pid" 2>/dev/null && [ ! -f "$layer_dir/done" ]; then
+            log "comm" "error" "Encryptor for client $client_id exited before publishing all layers"
+            rm -rf "$acks"
+            return 1
+        fi
+        sleep 0.1
+    done
+
+    rm -rf "$acks"
+    log "comm" "stream" "Client $client_id streamed ${#sent[@]} layers for round $round"
+}
+
 # ==========================
 # Orchestration Helpers
 # ==========================
 
-# o_send_cc_to_clients: send CC.json produced on server to each client
+# The helpers below take optional client ids (default: 1 2) so ppfl_dag can
+# run each client's transfer as its own step. Client i's paths are the
+# CLIENT_<i>_* variables from client_fns.sh.
+#
+# Setup transfers are recorded in the artifact manifest (helper_fns.sh) and
+# skipped while the receiving copy still hashes as the source it was sent
+# from. The server's copy is checked in SERVER_STORAGE_DIR, where the
+# runMserver started by run.sh stores uploads.
+
+# comm_fresh <key> <dest> <src>: true (and logged) if dest is still the recorded copy of src
+comm_fresh() {
+    artifact_fresh "$1" "$2" -- "$3" || return 1
+    log "comm" "skip" "$1 up to date, not transferring"
+}
+
+# o_send_cc_to_clients [ids...]: send CC.json produced on server to each client
 s_send_cc_to_c() {
-    comm_getCC 1 "$CLIENT_1_STORAGE/CC.json"
-    comm_getCC 2 "$CLIENT_2_STORAGE/CC.json"
+    local i storage
+    for i in ${*:-1 2}; do
+        storage="CLIENT_${i}_STORAGE"
+        comm_fresh "cc:client_$i" "${!storage}/CC.json" "$SERVER_STORAGE_DIR/CC.json" && continue
+        comm_getCC "$i" "${!storage}/CC.json"
+        artifact_record "cc:client_$i" "${!storage}/CC.json" -- "$SERVER_STORAGE_DIR/CC.json"
+    done
 }
 
-# --- Send client public keys to server ---
+# --- Send client public keys to server [ids...] ---
 c_send_pubkeys_to_s() {
-    if [ "$COMM_MODE" = "MONGOOSE" ]; then
-        comm_sendKey "$CLIENT_1_PUBKEY" "" "Client 1 pubkey to server" 1 "uploadPubKeyC1" "pubkey"
-        comm_sendKey "$CLIENT_2_PUBKEY" "" "Client 2 pubkey to server" 2 "uploadPubKeyC2" "pubkey"
-    else
-        comm_sendKey "$CLIENT_1_PUBKEY" "$SERVER_STORAGE_DIR/client_1/client_1-public.key" "Client 1 pubkey to server"
-        comm_sendKey "$CLIENT_2_PUBKEY" "$SERVER_STORAGE_DIR/client_2/client_2-public.key" "Client 2 pubkey to server"
-    fi
+    local i key dest
+    for i in ${*:-1 2}; do
+        key="CLIENT_${i}_PUBKEY"
+        dest="$SERVER_STORAGE_DIR/client_$i/client_$i-public.key"
+        comm_fresh "pubkey:client_$i->server" "$dest" "${!key}" && continue
+        if [ "$COMM_MODE" = "MONGOOSE" ]; then
+            comm_sendKey "${!key}" "" "Client $i pubkey to server" "$i" "uploadPubKeyC$i" "pubkey"
+        else
+            comm_sendKey "${!key}" "$dest" "Client $i pubkey to server"
+        fi
+        artifact_record "pubkey:client_$i->server" "$dest" -- "${!key}"
+    done
 }
 
-# --- Distribute pubkeys among clients ---
+# --- Distribute pubkeys among clients [ids...]: client i gets its peer's key ---
 s_send_pubkeys_to_c() {
-    if [ "$COMM_MODE" = "MONGOOSE" ]; then
-        # Client 2 should fetch Client 1's public key from server/storage/client_1/client_1-public.key
-        comm_getFile "client_1/client_1-public.key" "$CLIENT_2_STORAGE/client_1-public.key"
-
-        # Client 1 should fetch Client 2's public key from server/storage/client_2/client_2-public.key
-        comm_getFile "client_2/client_2-public.key" "$CLIENT_1_STORAGE/client_2-public.key"
-    else
-        comm_sendKey "$SERVER_STORAGE_DIR/client_1/client_1-public.key" "$CLIENT_2_STORAGE/client_1-public.key" "Client 1 pubkey to Client 2"
-        comm_sendKey "$SERVER_STORAGE_DIR/client_2/client_2-public.key" "$CLIENT_1_STORAGE/client_2-public.key" "Client 2 pubkey to Client 1"
-    fi
+    local i peer storage src
+    for i in ${*:-2 1}; do
+        peer=$((3 - i))
+        storage="CLIENT_${i}_STORAGE"
+        src="$SERVER_STORAGE_DIR/client_$peer/client_$peer-public.key"
+        comm_fresh "pubkey:client_$peer->client_$i" "${!storage}/client_$peer-public.key" "$src" && continue
+        if [ "$COMM_MODE" = "MONGOOSE" ]; then
+            # Client i fetches its peer's public key from server/storage/client_<peer>/client_<peer>-public.key
+            comm_getFile "client_$peer/client_$peer-public.key" "${!storage}/client_$peer-public.key"
+        else
+            comm_sendKey "$src" "${!storage}/client_$peer-public.key" "Client $peer pubkey to Client $i"
+        fi
+        artifact_record "pubkey:client_$peer->client_$i" "${!storage}/client_$peer-public.key" -- "$src"
+    done
 }
 
-# --- Send client Rekeys to server ---
+# --- Send client Rekeys to server [ids...] ---
 c_Rekeys_to_s() {
-    if [ "$COMM_MODE" = "MONGOOSE" ]; then
-        comm_sendKey "$CLIENT_1_REKEY" "" "Client 1 rekey to server" 1 "uploadReKeyC1" "rekey"
-        comm_sendKey "$CLIENT_2_REKEY" "" "Client 2 rekey to server" 2 "uploadReKeyC2" "rekey"
-    else
-        comm_sendKey "$CLIENT_1_REKEY" "$SERVER_STORAGE_DIR/client_1/client_1-ReKey.key" "Client 1 rekey to server"
-        comm_sendKey "$CLIENT_2_REKEY" "$SERVER_STORAGE_DIR/client_2/client_2-ReKey.key" "Client 2 rekey to server"
-    fi
+    local i key dest
+    for i in ${*:-1 2}; do
+        key="CLIENT_${i}_REKEY"
+        dest="$SERVER_STORAGE_DIR/client_$i/client_$i-ReKey.key"
+        comm_fresh "rekey:client_$i->server" "$dest" "${!key}" && continue
+        if [ "$COMM_MODE" = "MONGOOSE" ]; then
+            comm_sendKey "${!key}" "" "Client $i rekey to server" "$i" "uploadReKeyC$i" "rekey"
+        else
+            comm_sendKey "${!key}" "$dest" "Client $i rekey to server"
+        fi
+        artifact_record "rekey:client_$i->server" "$dest" -- "${!key}"
+    done
 }
 
-# Communicate encrypted weights from clients to server
+# Communicate encrypted weights from clients to server [ids...]
 c_sends_encrypted_weights_to_s() {
-    if [ "$COMM_MODE" = "MONGOOSE" ]; then
-        comm_sendKey "$CLIENT_1_ENCWEIGHTS" "" "Client 1 encrypted weights to server" 1 "uploadEncWeightsC1" "weights"
-        comm_sendKey "$CLIENT_2_ENCWEIGHTS" "" "Client 2 encrypted weights to server" 2 "uploadEncWeightsC2" "weights"
-    else
-        comm_sendKey "$CLIENT_1_ENCWEIGHTS" "$SERVER_STORAGE_DIR/client_1/encrypted_weights_c1.json" "Client 1 encrypted weights to server"
-        comm_sendKey "$CLIENT_2_ENCWEIGHTS" "$SERVER_STORAGE_DIR/client_2/encrypted_weights_c2.json" "Client 2 encrypted weights to server"
+    local i src
+    for i in ${*:-1 2}; do
+        src="CLIENT_${i}_ENCWEIGHTS"
+        if [ "$COMM_MODE" = "MONGOOSE" ]; then
+            comm_sendKey "${!src}" "" "Client $i encrypted weights to server" "$i" "uploadEncWeightsC$i" "weights"
+        else
+            comm_sendKey "${!src}" "$SERVER_STORAGE_DIR/client_$i/encrypted_weights_c$i.json" "Client $i encrypted weights to server"
+        fi
+    done
+}
+
+# Upload client i's encrypted weights tagged with the round so runMserver adds
+# the file into its running aggregate on arrival
+# $1 = client id, $2 = round
+c_send_encrypted_weights_round() {
+    local i=$1
+    local round=$2
+    local src="$CLIENT_1_ENCWEIGHTS"
+    [ "$i" = "2" ] && src="$CLIENT_2_ENCWEIGHTS"
+
+    # Tree aggregation: upload to the client's relay instead of the root
+    local upstream=""
+    [ -n "$TREE_CONFIG" ] && upstream=$(jq -r --arg i "$i" '.CLIENT_UPSTREAM[$i] // empty' "$BASE_DIR/$TREE_CONFIG")
+    if [ -n "$upstream" ] && [ "$upstream" != "http://${SERVER_IP}:${SERVER_PORT}" ]; then
+        local tmpout=$(mktemp)
+        msend POST "${upstream}/uploadEncWeights?client=${i}&round=${round}" "$tmpout" "$i" "weights" "$src"
+        local rc=$?
+        rm -f "$tmpout"
+        log "comm" "send" "Transferred Client $i encrypted weights to relay $upstream"
+        return $rc
     fi
+    comm_sendKey "$src" "" "Client $i encrypted weights to server" "$i" "uploadEncWeightsC${i}?round=${round}" "weights"
+}
+
+# Both clients upload concurrently
+c_sends_encrypted_weights_to_s_round() {
+    local round=$1
+    local pids=()
+    for i in 1 2; do
+        c_send_encrypted_weights_round "$i" "$round" &
+        pids+=($!)
+    done
+    for pid in "${pids[@]}"; do wait "$pid" || return 1; done
 }
 
-# o_send_aggregated_to_clients: server -> clients aggregated files (post-aggregation)
+# o_send_aggregated_to_clients [ids...]: server -> clients aggregated files (post-aggregation)
 s_send_aggregated_to_c() {
+  local ids=" ${*:-1 2} "
   if [ "$COMM_MODE" = "MONGOOSE" ]; then
     # Client 1 should fetch re-encrypted (c2->c1) aggregate
-    comm_getFile "client_1/c2_domainChange_c1.json" "$CLIENT_1_AGGRENCWEIGHTS/c2_domainChange_c1.json"
+    [[ $ids == *" 1 "* ]] && comm_getFile "client_1/c2_domainChange_c1.json" "$CLIENT_1_AGGRENCWEIGHTS/c2_domainChange_c1.json"
 
     # Client 2 should fetch aggregated ciphertexts
-    comm_getFile "client_2/aggregated_weights.json" "$CLIENT_2_AGGRENCWEIGHTS/aggregated_weights.json"
+    [[ $ids == *" 2 "* ]] && comm_getFile "client_2/aggregated_weights.json" "$CLIENT_2_AGGRENCWEIGHTS/aggregated_weights.json"
   else
-    cp "$reenc_c2_c1" "$CLIENT_1_AGGRENCWEIGHTS/c2_domainChange_c1.json"
-    cp "$aggrencfile" "$CLIENT_2_AGGRENCWEIGHTS/aggregated_weights.json"
+    [[ $ids == *" 1 "* ]] && cp "$reenc_c2_c1" "$CLIENT_1_AGGRENCWEIGHTS/c2_domainChange_c1.json"
+    [[ $ids == *" 2 "* ]] && cp "$aggrencfile" "$CLIENT_2_AGGRENCWEIGHTS/aggregated_weights.json"
   fi
+  return 0
 }
@@ -0,0 +1,114 @@
+#!/usr/bin/env python3
+"""
+gen_tree_configs.py
+
+Builds the configs for hierarchical (tree) aggregation: runMserver instances
+in the relay role each sum the encrypted updates of up to FANIN children and
+forward one partial aggregate upstream, so the root only ever sees FANIN
+children and its ingress grows with log_FANIN(clients).
+
+  clients -> level-1 relays -> level-2 relays -> ... -> root runMserver
+
+Relays live on one host with consecutive ports (edit the generated files to
+spread them across nodes). Each relay fetches CC.json from its parent at
+startup and reads client rekeys from --rekey-pattern, so the paths must be
+reachable on the relay's node.
+
+Usage:
+  python3 gen_tree_configs.py --clients 1 2 [... ] --fanin 16 \\
+      [--host 127.0.0.1] [--root-port 8000] [--base-port 8100] \\
+      [--rekey-pattern server/storage/client_{id}/client_{id}-ReKey.key] [--anchor 2] \\
+      [--out server/config/tree] [--root-config server/config/sConfig.json]
+
+Writes <out>/relay_<level>_<k>.json for every relay and <out>/tree.json:
+  {"RELAYS": [config paths, leaves first], "CLIENT_UPSTREAM": {"<id>": url}}
+and sets the TREE block of --root-config to the root's direct children.
+"""
+
+import argparse
+import json
+import os
+
+BASE_DIR = os.path.abspath(os.path.join(os.path.dirname(__file__), ".."))
+
+def chunks(items, n):
+    return [items[i:i + n] for i in range(0, len(items), n)]
+
+def main():
+    ap = argparse.ArgumentParser(description="Generate relay configs for tree aggregation")
+    ap.add_argument("--clients", nargs="+", required=True)
+    ap.add_argument("--fanin", type=int, default=16)
+    ap.add_argument("--host", default="127.0.0.1")
+    ap.add_argument("--root-port", type=int, default=8000)
+    ap.add_argument("--base-port", type=int, default=8100)
+    ap.add_argument("--rekey-pattern", default="server/storage/client_{id}/client_{id}-ReKey.key")
+    ap.add_argument("--anchor", default="2", help="client whose key domain is the aggregation domain")
+    ap.add_argument("--out", default="server/config/tree")
+    ap.add_argument("--root-config", default="server/config/sConfig.json")
+    args = ap.parse_args()
+    if args.fanin < 2:
+        ap.error("--fanin must be >= 2")
+
+    out_dir = os.path.join(BASE_DIR, args.out)
+    os.makedirs(out_dir, exist_ok=True)
+
+    def client_child(cid):
+        rekey = "" if cid == args.anchor else args.rekey_pattern.format(id=cid)
+        return {"ID": cid, "REKEY": rekey}
+
+    # Build bottom-up; every node is (child entry for its parent, config or None)
+    level_nodes = [(client_child(c), None) for c in args.clients]
+    relays, level, port = [], 0, args.base_port
+    client_upstream = {}
+
+    while len(level_nodes) > args.fanin:
+        level += 1
+        next_nodes = []
+        for k, group in enumerate(chunks(level_nodes, args.fanin)):
+            rid = f"relay_{level}_{k}"
+            url = f"http://{args.host}:{port}"
+            cfg = {
+                "mSConfig": {"SERVER_IP": "0.0.0.0", "SERVER_PORT": port},
+                "CC": {"path": f"server/storage/tree/{rid}/CC.json"},
+                "TREE": {"ROLE": "relay", "ID": rid, "UPSTREAM": None,
+                         "CHILDREN": [child for child, _ in group]},
+            }
+            for child, child_cfg in group:
+                if child_cfg is None:
+                    client_upstream[child["ID"]] = url
+                else:
+                    child_cfg["TREE"]["UPSTREAM"] = url
+            relays.append((rid, cfg))
+            next_nodes.append(({"ID": rid, "REKEY": ""}, cfg))
+            port += 1
+        level_nodes = next_nodes
+
+    root_url = f"http://{args.host}:{args.root_port}"
+    for child, child_cfg in level_nodes:
+        if child_cfg is None:
+            client_upstream[child["ID"]] = root_url
+        else:
+            child_cfg["TREE"]["UPSTREAM"] = root_url
+
+    paths = []
+    for rid, cfg in relays:
+        rel = os.path.join(args.out, rid + ".json")
+        with open(os.path.join(BASE_DIR, rel), "w") as f:
+            json.dump(cfg, f, indent=2)
+        paths.append(rel)
+
+    with open(os.path.join(out_dir, "tree.json"), "w") as f:
+        json.dump({"RELAYS": paths, "CLIENT_UPSTREAM": client_upstream}, f, indent=2)
+
+    root_path = os.path.join(BASE_DIR, args.root_config)
+    with open(root_path) as f:
+        root = json.load(f)
+    root["TREE"] = {"ROLE": "root", "CHILDREN": [child for child, _ in level_nodes]}
+    with open(root_path, "w") as f:
+        json.dump(root, f, indent=2)
+
+    print(f"[gen_tree_configs] {len(args.clients)} clients, fan-in {args.fanin}: "
+          f"{len(relays)} relays over {level} level(s), root has {len(level_nodes)} children")
+
+if __name__ == "__main__":
+    main()
@@ -18,6 +18,33 @@ mkdir -p "$METRICS_DIR"
 
 # header: timestamp,role,method,endpoint,client_id,type,file,payload_size,bytes_sent,bytes_received,latency_ms,http_code
 
+# Conditional GET cache for msend (set HTTP_CACHE_DIR="" to disable).
+# Per URL: <key>.etag + <key>.body, the last ETag and body the server sent.
+# Per URL+output: <key>.out, the mtime/size the output had when msend last
+# wrote it, so a 304 for an untouched output copies nothing.
+HTTP_CACHE_DIR=${HTTP_CACHE_DIR-"$BASE_DIR/orchestration/.http_cache"}
+
+# On-the-wire compression for msend (run.sh sets these from oConfig.json).
+# auto: zstd if the zstd CLI is installed, else gzip; zstd | gzip | none.
+# Uploads fall back to the next codec when the server answers 415; downloads
+# are negotiated with Accept-Encoding and decoded by curl.
+WIRE_COMPRESSION=${WIRE_COMPRESSION-auto}
+WIRE_LEVEL_GZIP=${WIRE_LEVEL_GZIP-6}
+WIRE_LEVEL_ZSTD=${WIRE_LEVEL_ZSTD-3}
+WIRE_MIN_BYTES=${WIRE_MIN_BYTES-1024}
+
+# Native transfer client (make ppfl_xfer). When it is built, msend and mxfer
+# hand transfers to it: keep-alive connections, raw bodies, jittered
+# exponential backoff and socket-exact byte counts in the same CSV.
+# XFER_BIN="" keeps the curl path below.
+XFER_BIN=${XFER_BIN-"$BASE_DIR/client/build/ppfl_xfer"}
+XFER_JOBS=${XFER_JOBS-4}
+# Uploads of XFER_CHUNKED_MIN bytes or more go through runMserver's resumable
+# /upload/ protocol in XFER_CHUNK_SIZE chunks; downloads are fetched in
+# ranges of the same size and resume from <output>.part. 0 = single requests.
+XFER_CHUNK_SIZE=${XFER_CHUNK_SIZE-4194304}
+XFER_CHUNKED_MIN=${XFER_CHUNKED_MIN-16777216}
+
 if [ ! -s "$METRICS_FILE" ]; then
   echo "timestamp,role,method,endpoint,client_id,type,file,payload_size,bytes_sent,bytes_received,latency_ms,http_code" > "$METRICS_FILE"
 fi
@@ -29,8 +56,47 @@ fi
 #   msend POST <url> <output> <client_id> <type> <file>
 # =========
 
+# wire_compress <zstd|gzip> <file>: compressed file on stdout
+wire_compress() {
+    case "$1" in
+        zstd) zstd -q -c "-$WIRE_LEVEL_ZSTD" "$2" ;;
+        gzip) gzip -c "-$WIRE_LEVEL_GZIP" "$2" ;;
+        *)    return 1 ;;
+    esac
+}
+
+# xfer_run <ppfl_xfer args...>: ppfl_xfer with msend's wire, cache and metrics settings
+xfer_run() {
+    "$XFER_BIN" --compress "$WIRE_COMPRESSION" --level-gzip "$WIRE_LEVEL_GZIP" --level-zstd "$WIRE_LEVEL_ZSTD" \
+        --min-bytes "$WIRE_MIN_BYTES" --cache-dir "$HTTP_CACHE_DIR" --metrics "$METRICS_FILE" \
+        --chunk-size "$XFER_CHUNK_SIZE" --chunked-min "$XFER_CHUNKED_MIN" "$@"
+}
+
+# mxfer: many transfers in one ppfl_xfer process, XFER_JOBS at a time.
+# Jobs on stdin, one per line with msend's arguments (no spaces in paths):
+#   GET <url> <output>  |  POST <url> <output> <client_id> <type> <file>
+# Without ppfl_xfer each line becomes one msend call.
+mxfer() {
+    if [ -n "$XFER_BIN" ] && [ -x "$XFER_BIN" ]; then
+        xfer_run --jobs "$XFER_JOBS" -
+        return
+    fi
+    local line rc=0
+    while read -r line; do
+        [ -n "$line" ] || continue
+        msend $line || rc=1
+    done
+    return $rc
+}
+
 # msend: thin wrapper around curl for GET/POST used by comm layer
 msend() {
+    if [ -n "$XFER_BIN" ] && [ -x "$XFER_BIN" ]; then
+        if [ "$1" = "POST" ]; then xfer_run "${@:1:6}"; else xfer_run "${@:1:3}"; fi || return 1
+        echo "[helper_fns.sh] SUCCESS: $1 completed"
+        return 0
+    fi
+
     local method=$1     # GET or POST
     local url=$2        # full URL (http://ip:port/endpoint)
     local output=$3     # destination file (for GET response or POST ack)
@@ -45,6 +111,7 @@ msend() {
 
     # Start timestamp
     local start_ts=$(date +%s%3N)
+    local trace_t0=${EPOCHREALTIME//[.,]/}
 
     local http_code=""
     local rc=0
@@ -53,16 +120,57 @@ msend() {
         echo "[helper_fns.sh] GET -> $url"
         mkdir -p "$(dirname "$output")" 2>/dev/null || true
 
+        # With a cached ETag for this URL, ask the server for a 304 instead of the body
+        local ckey="" okey="" cond=() body_out="$output" hdrs="" out=""
+        if [ -n "$HTTP_CACHE_DIR" ]; then
+            mkdir -p "$HTTP_CACHE_DIR"
+            ckey="$HTTP_CACHE_DIR/$(printf '%s' "$url" | md5sum | cut -c1-32)"
+            okey="$HTTP_CACHE_DIR/$(printf '%s|%s' "$url" "$output" | md5sum | cut -c1-32)"
+            if [ -s "$ckey.etag" ] && [ -f "$ckey.body" ]; then
+                cond=(-H "If-None-Match: $(cat "$ckey.etag")")
+            fi
+            body_out="$ckey.tmp.$BASHPID"
+            hdrs="$ckey.hdr.$BASHPID"
+        fi
+
+        local accept=()
+        [ "$WIRE_COMPRESSION" != "none" ] && accept=(--compressed)
+
         for i in {1..5}; do
-            http_code="$(curl -f -s -S -w "%{http_code}" -o "$output" "$url" 2>/dev/null)"
+            out="$(curl -f -s -S -w "%{http_code} %{size_download}" "${accept[@]}" "${cond[@]}" ${hdrs:+-D "$hdrs"} \
+                -o "$body_out" "$url" 2>/dev/null)"
             rc=$?
+            http_code=${out%% *}
             [ $rc -eq 0 ] && break
             echo "[helper_fns.sh] WARN: GET failed (attempt $i), retrying..."
             sleep 1
         done
 
-        local bytes_received=0
-        [ -f "$output" ] && bytes_received=$(stat -c%s "$output" 2>/dev/null || echo 0)
+        local bytes_received=${out##* }   # body bytes on the wire, before curl decodes them
+        bytes_received=${bytes_received:-0}
+
+        if [ -n "$ckey" ] && [ $rc -eq 0 ]; then
+            if [ "$http_code" = "304" ]; then
+                # Unchanged on the server: refresh the output from the cache unless it is
+                # still exactly what msend wrote last time
+                if [ "$(stat -c '%.9Y %s' "$output" 2>/dev/null)" != "$(cat "$okey.out" 2>/dev/null)" ]; then
+                    cp "$ckey.body" "$output"
+                fi
+                echo "[helper_fns.sh] $endpoint not modified (ETag $(cat "$ckey.etag"))"
+            else
+                local etag
+                etag="$(grep -i '^etag:' "$hdrs" 2>/dev/null | tail -n1 | cut -d' ' -f2- | tr -d '\r')"
+                if [ -n "$etag" ]; then
+                    cp "$body_out" "$ckey.body"
+                    printf '%s' "$etag" > "$ckey.etag"
+                else
+                    rm -f "$ckey.etag" "$ckey.body"
+                fi
+                mv -f "$body_out" "$output"
+            fi
+            stat -c '%.9Y %s' "$output" > "$okey.out" 2>/dev/null
+        fi
+        [ -n "$ckey" ] && rm -f "$body_out" "$hdrs"
 
         local end_ts=$(date +%s%3N)
         local latency_ms=$((end_ts - start_ts))
@@ -71,6 +179,7 @@ msend() {
 
         echo "$(date '+%Y-%m-%d %H:%M:%S'),client,GET,${endpoint},${client_id},${type},${output},${payload_size},${bytes_sent},${bytes_received},${latency_ms},${http_code}" \
             >> "$METRICS_FILE"
+        trace_emit "GET ${endpoint%%\?*}" "$trace_t0" "$(( ${EPOCHREALTIME//[.,]/} - trace_t0 ))" "$bytes_received"
 
         [ $rc -ne 0 ] && { echo "[helper_fns.sh] ERROR: curl GET failed ($url)"; return 1; }
 
@@ -81,22 +190,51 @@ msend() {
         fi
         echo "[helper_fns.sh] POST -> $url (client_id=$client_id, type=$type, file=$file)"
 
-        http_code="$(curl -s -S -w "%{http_code}" -o "$output" -X POST "$url" \
-            -F "file=@${file}" \
-            -F "client_id=${client_id}" \
-            -F "type=${type}" 2>/dev/null)"
-        rc=$?
+        local payload_size=$(stat -c%s "$file" 2>/dev/null || echo 0)
+
+        # Codecs to try in order; "" sends the file as-is
+        local encodings=("") enc="" zfile="" out=""
+        if [ "$payload_size" -ge "$WIRE_MIN_BYTES" ]; then
+            case "$WIRE_COMPRESSION" in
+                auto) encodings=(gzip ""); command -v zstd >/dev/null && encodings=(zstd "${encodings[@]}") ;;
+                zstd) encodings=(zstd gzip "") ;;
+                gzip) encodings=(gzip "") ;;
+            esac
+        fi
+
+        for enc in "${encodings[@]}"; do
+            local enc_field=()
+            if [ -n "$enc" ]; then
+                zfile="$(mktemp)"
+                wire_compress "$enc" "$file" > "$zfile" || { rm -f "$zfile"; zfile=""; continue; }
+                enc_field=(-F "encoding=$enc")
+            fi
+            # No "Expect: 100-continue": Mongoose never sends the 100, so curl would
+            # stall a second before every body over 1 MB
+            out="$(curl -s -S -w "%{http_code} %{size_upload}" -o "$output" -X POST "$url" -H "Expect:" \
+                "${enc_field[@]}" \
+                -F "file=@${zfile:-$file}" \
+                -F "client_id=${client_id}" \
+                -F "type=${type}" 2>/dev/null)"
+            rc=$?
+            [ -n "$zfile" ] && rm -f "$zfile"
+            zfile=""
+            http_code=${out%% *}
+            [ "$http_code" = "415" ] || break
+            echo "[helper_fns.sh] WARN: server cannot decode $enc uploads, trying next codec"
+        done
 
         local end_ts=$(date +%s%3N)
         local latency_ms=$((end_ts - start_ts))
 
-        local payload_size=$(stat -c%s "$file" 2>/dev/null || echo 0)
-        local bytes_sent=$((payload_size + 1024)) # file + overhead
+        local bytes_sent=${out##* }   # multipart body on the wire, compressed file included
+        bytes_sent=${bytes_sent:-0}
         local bytes_received=0
         [ -f "$output" ] && bytes_received=$(stat -c%s "$output" 2>/dev/null || echo 0)
 
         echo "$(date '+%Y-%m-%d %H:%M:%S'),client,POST,${endpoint},${client_id},${type},${file},${payload_size},${bytes_sent},${bytes_received},${latency_ms},${http_code}" \
             >> "$METRICS_FILE"
+        trace_emit "POST ${endpoint%%\?*}" "$trace_t0" "$(( ${EPOCHREALTIME//[.,]/} - trace_t0 ))" "$payload_size" "$client_id"
 
         [ $rc -ne 0 ] && { echo "[helper_fns.sh] ERROR: curl POST failed ($url)"; return 1; }
 
@@ -144,3 +282,145 @@ log() {
     local msg=$3    # freeform message
     echo "[$(date '+%Y-%m-%d %H:%M:%S')] [${role}] [${step}] $msg"
 }
+
+
+# =========
+# Round tracing, same event format as lib/trace.h (Chrome trace, one JSON per line)
+# On when PPFL_TRACE_DIR is set; merge with orchestration/metrics/merge_traces.py.
+# Timestamps are wall-clock microseconds, so the clock_sync anchor is the identity.
+# Parallel subshells get their own track (tid = $BASHPID).
+# =========
+
+# trace_emit <name> <start_us> <dur_us> [bytes] [client]
+trace_emit() {
+    [ -n "$PPFL_TRACE_DIR" ] || return 0
+    local file="$PPFL_TRACE_DIR/orchestrator.$$.trace.jsonl"
+    if [ ! -f "$file" ]; then
+        mkdir -p "$PPFL_TRACE_DIR"
+        local now=${EPOCHREALTIME//[.,]/}
+        {
+            echo "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":$$,\"args\":{\"name\":\"orchestrator\"}}"
+            echo "{\"name\":\"clock_sync\",\"ph\":\"M\",\"pid\":$$,\"args\":{\"mono_us\":$now,\"wall_us\":$now}}"
+        } >> "$file"
+    fi
+    local args="" client=${5:-$PPFL_TRACE_CLIENT}
+    [ -n "$PPFL_TRACE_ROUND" ] && args+="\"round\":$PPFL_TRACE_ROUND,"
+    [ -n "$client" ] && args+="\"client\":\"$client\","
+    [ -n "$4" ] && [ "$4" != "0" ] && args+="\"bytes\":$4,"
+    echo "{\"name\":\"$1\",\"cat\":\"orchestrator\",\"ph\":\"X\",\"ts\":$2,\"dur\":$3,\"pid\":$$,\"tid\":$BASHPID,\"args\":{${args%,}}}" \
+        >> "$file"
+}
+
+# trace_now: wall-clock microseconds, the timestamp trace_emit expects
+trace_now() {
+    echo "${EPOCHREALTIME//[.,]/}"
+}
+
+# trace_span <name> <command...>: run the command as one span, keeping its exit status.
+# The command is not run under `||`, so set -e still aborts inside it (the span is
+# then lost, as is the rest of the round).
+trace_span() {
+    local name=$1
+    shift
+    [ -n "$PPFL_TRACE_DIR" ] || { "$@"; return; }
+    local t0=${EPOCHREALTIME//[.,]/} rc
+    "$@"
+    rc=$?
+    local t1=${EPOCHREALTIME//[.,]/}
+    trace_emit "$name" "$t0" "$((t1 - t0))"
+    return $rc
+}
+
+
+# =========
+# Artifact manifest: the content hash of every setup artifact (CC.json, key
+# pairs, rekeys and the copies transferred to the other side) together with
+# the hashes of the inputs it was derived from. A setup step whose recorded
+# inputs still hash the same, and whose outputs are still what it wrote, is
+# skipped; with an unchanged config_cc.json and roster a warm restart
+# regenerates and retransfers nothing. ARTIFACT_MANIFEST="" disables it.
+#   { "artifacts": { <key>: {outputs: {path: sha256}, inputs: {path: sha256}, recorded} },
+#     "files":     { <path>: {stamp: "<mtime> <size>", sha256} } }
+# "files" caches hashes by mtime and size, so unchanged files are not re-read.
+# =========
+ARTIFACT_MANIFEST=${ARTIFACT_MANIFEST-"$BASE_DIR/orchestration/.artifacts/manifest.json"}
+
+# artifact_update <jq filter> [jq args...]: rewrite the manifest under its lock
+# (ppfl_dag runs setup steps concurrently)
+artifact_update() {
+    mkdir -p "$(dirname "$ARTIFACT_MANIFEST")"
+    (
+        flock 9
+        local tmp="$ARTIFACT_MANIFEST.tmp.$BASHPID"
+        { [ -s "$ARTIFACT_MANIFEST" ] && cat "$ARTIFACT_MANIFEST" || echo '{}'; } \
+            | jq "$@" > "$tmp" && mv -f "$tmp" "$ARTIFACT_MANIFEST"
+    ) 9> "$ARTIFACT_MANIFEST.lock"
+}
+
+# artifact_shas <files...>: sha256 of each file, one per line ("missing" if there
+# is none). One jq call looks up every cached hash; only changed files are read.
+artifact_shas() {
+    local f stamp pairs=() known=() new=() k=0
+    for f in "$@"; do
+        stamp=$(stat -c '%.9Y %s' "$f" 2>/dev/null) || stamp=""
+        pairs+=("$f" "$stamp")
+    done
+    mapfile -t known < <(jq -r -n --slurpfile m <(cat "$ARTIFACT_MANIFEST" 2>/dev/null) \
+        '$ARGS.positional as $p | range(0; $p | length; 2) as $i
+         | ($m[0].files[$p[$i]] // {}) as $e
+         | if $p[$i + 1] == "" then "missing" elif $e.stamp == $p[$i + 1] then $e.sha256 else "" end' \
+        --args "${pairs[@]}")
+    for f in "$@"; do
+        if [ -z "${known[k]}" ]; then
+            known[k]=$(sha256sum "$f" | cut -d' ' -f1)
+            new+=("$f" "${pairs[2 * k + 1]}" "${known[k]}")
+        fi
+        echo "${known[k]}"
+        k=$((k + 1))
+    done
+    [ ${#new[@]} -eq 0 ] || artifact_update \
+        '$ARGS.positional as $p | reduce range(0; $p | length; 3) as $i
+         (.; .files[$p[$i]] = {stamp: $p[$i + 1], sha256: $p[$i + 2]})' --args "${new[@]}"
+}
+
+# jq: {outputs: {file: sha256}, inputs: {file: sha256}} from --args <files...> <shas...>,
+# the first $n files being the outputs
+ARTIFACT_ENTRY_JQ='$ARGS.positional as $p | ($p | length / 2) as $N
+    | [range($N) as $i | {($p[$i]): $p[$i + $N]}] as $kv
+    | {outputs: ($kv[:$n] | add // {}), inputs: ($kv[$n:] | add // {})}'
+
+# artifact_args <outputs...> -- <inputs...>: "<number of outputs>", then the files, then their hashes
+artifact_args() {
+    local f files=() n=0
+    for f in "$@"; do
+        [ "$f" = "--" ] && { n=${#files[@]}; continue; }
+        files+=("$f")
+    done
+    echo "$n"
+    printf '%s\n' "${files[@]}"
+    artifact_shas "${files[@]}"
+}
+
+# artifact_fresh <key> <outputs...> -- <inputs...>: true if <key> was recorded
+# from inputs with these hashes and every output still hashes as recorded
+artifact_fresh() {
+    [ -n "$ARTIFACT_MANIFEST" ] && [ -s "$ARTIFACT_MANIFEST" ] || return 1
+    local key=$1 args=()
+    shift
+    mapfile -t args < <(artifact_args "$@")
+    jq -e -n --slurpfile m "$ARTIFACT_MANIFEST" --arg k "$key" --argjson n "${args[0]}" \
+        "($ARTIFACT_ENTRY_JQ) as \$now | (\$now.outputs | all(. != \"missing\"))
+         and \$now == (\$m[0].artifacts[\$k] // {} | {outputs, inputs})" \
+        --args "${args[@]:1}" > /dev/null
+}
+
+# artifact_record <key> <outputs...> -- <inputs...>: note that the outputs were just
+# derived from the inputs
+artifact_record() {
+    [ -n "$ARTIFACT_MANIFEST" ] || return 0
+    local key=$1 args=()
+    shift
+    mapfile -t args < <(artifact_args "$@")
+    artifact_update ".artifacts[\$k] = (($ARTIFACT_ENTRY_JQ) + {recorded: \$t})" --arg k "$key" \
+        --argjson n "${args[0]}" --arg t "$(date '+%Y-%m-%d %H:%M:%S')" --args "${args[@]:1}"
+}
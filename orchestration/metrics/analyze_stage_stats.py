@@ -0,0 +1,182 @@
+#!/usr/bin/env python3
+"""
+analyze_stage_stats.py
+
+Reads:
+  - stage_stats.jsonl (one line per crypto CLI invocation, appended by
+    lib/stage_stats.h when PPFL_STATS_FILE is set; run.sh sets it from
+    oConfig.json STATS_FILE)
+
+Produces:
+  - per tool/phase summary on stdout (median wall/CPU, max peak RSS,
+    ciphertexts), with the phase that sets each tool's peak memory marked
+  - per-round CSV ./stage_stats_by_round.csv
+  - plots in ./plots/ (if matplotlib is installed):
+      stage_peak_rss.png     peak RSS per phase, one line per tool/phase over rounds
+      stage_cpu_by_phase.png stacked user+sys CPU per tool and phase
+
+Usage:
+  python3 analyze_stage_stats.py [stage_stats.jsonl] [--tool encrypt] [--no-plots]
+"""
+
+import argparse
+import csv
+import json
+import os
+import statistics
+import sys
+from collections import defaultdict
+
+METRICS_DIR = os.path.dirname(os.path.abspath(__file__))
+STATS_FILE = os.path.join(METRICS_DIR, "stage_stats.jsonl")
+PLOTS_DIR = os.path.join(METRICS_DIR, "plots")
+OUT_CSV = "stage_stats_by_round.csv"
+PHASE_ORDER = ["context", "key", "parse", "compute", "serialize", "write"]
+
+
+def load(path, tool=None):
+    runs = []
+    with open(path) as f:
+        for n, line in enumerate(f, 1):
+            line = line.strip()
+            if not line:
+                continue
+            try:
+                run = json.loads(line)
+            except json.JSONDecodeError:
+                print(f"[stage_stats] {path}:{n}: bad line skipped", file=sys.stderr)
+                continue
+            if tool and run.get("tool") != tool:
+                continue
+            runs.append(run)
+    return runs
+
+
+def phase_key(item):
+    (tool, phase) = item[0]
+    idx = PHASE_ORDER.index(phase) if phase in PHASE_ORDER else len(PHASE_ORDER)
+    return (tool, idx, phase)
+
+
+def friendly_kb(kb):
+    mb = kb / 1024.0
+    return f"{mb / 1024.0:0.2f} GB" if mb >= 1024 else f"{mb:0.1f} MB"
+
+
+def summarize(runs):
+    by_phase = defaultdict(list)
+    for run in runs:
+        for ph in run.get("phases", []):
+            by_phase[(run["tool"], ph["phase"])].append(ph)
+
+    peak_phase = {}
+    for (tool, phase), rows in by_phase.items():
+        peak = max(r["peak_rss_kb"] for r in rows)
+        if peak > peak_phase.get(tool, ("", 0))[1]:
+            peak_phase[tool] = (phase, peak)
+
+    print(f"{'tool':<9} {'phase':<10} {'n':>4} {'wall_s':>9} {'user_s':>9} {'sys_s':>8} "
+          f"{'peak_rss':>10} {'ct_count':>9} {'ct_MB':>9}")
+    for (tool, phase), rows in sorted(by_phase.items(), key=phase_key):
+        med = lambda k: statistics.median(r[k] for r in rows)
+        mark = " <- peak" if peak_phase[tool][0] == phase else ""
+        print(f"{tool:<9} {phase:<10} {len(rows):>4} {med('wall_s'):>9.3f} {med('user_s'):>9.3f} "
+              f"{med('sys_s'):>8.3f} {friendly_kb(max(r['peak_rss_kb'] for r in rows)):>10} "
+              f"{int(med('ct_count')):>9} {med('ct_bytes') / 2**20:>9.1f}{mark}")
+
+    failed = sum(1 for r in runs if not r.get("ok", True))
+    if failed:
+        print(f"\n{failed} of {len(runs)} invocations failed (ok=false)")
+    if any(not ph.get("peak_reset", True) for r in runs for ph in r.get("phases", [])):
+        print("\nNOTE: kernel did not allow resetting VmHWM; peak_rss is cumulative per process")
+
+
+def write_csv(runs, path):
+    fields = ["round", "client", "tool", "pid", "phase", "wall_s", "user_s", "sys_s",
+              "rss_kb", "peak_rss_kb", "ct_count", "ct_bytes", "file_bytes"]
+    with open(path, "w", newline="") as f:
+        w = csv.DictWriter(f, fieldnames=fields, extrasaction="ignore")
+        w.writeheader()
+        for run in runs:
+            for ph in run.get("phases", []):
+                w.writerow({**ph, "round": run.get("round", ""), "client": run.get("client", ""),
+                            "tool": run["tool"], "pid": run.get("pid", "")})
+    print(f"\n[stage_stats] per-phase rows -> {path}")
+
+
+def plot(runs):
+    try:
+        import matplotlib
+        matplotlib.use("Agg")
+        import matplotlib.pyplot as plt
+    except ImportError:
+        print("[stage_stats] matplotlib not installed, skipping plots")
+        return
+    os.makedirs(PLOTS_DIR, exist_ok=True)
+
+    # Peak RSS per phase across rounds (max over clients)
+    series = defaultdict(dict)
+    for run in runs:
+        rnd = run.get("round")
+        if rnd is None:
+            continue
+        for ph in run.get("phases", []):
+            key = f"{run['tool']}.{ph['phase']}"
+            series[key][rnd] = max(series[key].get(rnd, 0), ph["peak_rss_kb"] / 1024.0)
+    if series:
+        plt.figure(figsize=(10, 6))
+        for key, pts in sorted(series.items()):
+            xs = sorted(pts)
+            plt.plot(xs, [pts[x] for x in xs], marker="o", label=key)
+        plt.xlabel("round")
+        plt.ylabel("peak RSS (MB)")
+        plt.title("Peak RSS per crypto phase")
+        plt.legend(fontsize="small", ncol=2)
+        plt.tight_layout()
+        plt.savefig(os.path.join(PLOTS_DIR, "stage_peak_rss.png"))
+        plt.close()
+
+    # Median CPU per tool, stacked by phase
+    cpu = defaultdict(lambda: defaultdict(list))
+    for run in runs:
+        for ph in run.get("phases", []):
+            cpu[run["tool"]][ph["phase"]].append(ph["user_s"] + ph["sys_s"])
+    tools = sorted(cpu)
+    phases = sorted({p for t in cpu.values() for p in t},
+                    key=lambda p: PHASE_ORDER.index(p) if p in PHASE_ORDER else len(PHASE_ORDER))
+    plt.figure(figsize=(8, 5))
+    bottom = [0.0] * len(tools)
+    for phase in phases:
+        vals = [statistics.median(cpu[t][phase]) if cpu[t][phase] else 0.0 for t in tools]
+        plt.bar(tools, vals, bottom=bottom, label=phase)
+        bottom = [b + v for b, v in zip(bottom, vals)]
+    plt.ylabel("CPU seconds (user + sys, median)")
+    plt.title("CPU time per tool and phase")
+    plt.legend()
+    plt.tight_layout()
+    plt.savefig(os.path.join(PLOTS_DIR, "stage_cpu_by_phase.png"))
+    plt.close()
+    print(f"[stage_stats] plots -> {PLOTS_DIR}")
+
+
+def main():
+    ap = argparse.ArgumentParser(description="Summarize per-phase stats of the PPFL crypto CLIs")
+    ap.add_argument("stats_file", nargs="?", default=STATS_FILE)
+    ap.add_argument("--tool", default=None, help="only this tool (encrypt, recrypt, agg, decrypt)")
+    ap.add_argument("--no-plots", action="store_true")
+    args = ap.parse_args()
+
+    if not os.path.exists(args.stats_file):
+        sys.exit(f"[stage_stats] {args.stats_file} not found (set STATS_FILE in oConfig.json and run a round)")
+    runs = load(args.stats_file, args.tool)
+    if not runs:
+        sys.exit("[stage_stats] no invocations recorded")
+
+    summarize(runs)
+    write_csv(runs, OUT_CSV)
+    if not args.no_plots:
+        plot(runs)
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,112 @@
+#!/usr/bin/env python3
+"""
+bench_encrypt_formats.py
+
+Times the client weight hand-off into encryptModelWeights for both input formats:
+  - json   : json.dump(indent=2) as in c_trainAndUpdate.py, parsed back with nlohmann
+  - tensor : raw float32 tensor file (client/src/tensor_io.py), mmap'd by the encryptor
+
+For every parameter count it reports export time (Python side), encrypt-stage
+wall time (encryptModelWeights process) and input file size.
+
+Usage:
+  python3 bench_encrypt_formats.py <cc_path> <pubkey_path> [--params 1000000 10000000] [--reps 1]
+
+Results are appended to ./encrypt_format_bench.csv
+"""
+
+import argparse
+import csv
+import json
+import os
+import subprocess
+import sys
+import tempfile
+import time
+
+import numpy as np
+
+BASE_DIR = os.path.abspath(os.path.join(os.path.dirname(__file__), "../.."))
+sys.path.insert(0, os.path.join(BASE_DIR, "client/src"))
+from tensor_io import write_tensor_file  # noqa: E402
+
+ENCRYPT_BIN = os.path.join(BASE_DIR, "client/build/encryptModelWeights")
+OUT_CSV = "encrypt_format_bench.csv"
+
+# ----------------------
+# Helpers
+# ----------------------
+def synthetic_weights(n_params, layer_size=1 << 18, seed=0):
+    """Split n_params into GRU-like 2D layers of at most layer_size values."""
+    rng = np.random.default_rng(seed)
+    arrays, left = [], n_params
+    while left > 0:
+        n = min(layer_size, left)
+        cols = 64 if n % 64 == 0 else 1
+        arrays.append(rng.normal(0.0, 0.05, size=(n // cols, cols)).astype(np.float32))
+        left -= n
+    return arrays
+
+def export_json(path, names, arrays):
+    weights_summary = [{
+        "layer": name,
+        "shape": list(arr.shape),
+        "mean": float(np.mean(arr)),
+        "std_dev": float(np.std(arr)),
+        "values": arr.flatten().tolist()
+    } for name, arr in zip(names, arrays)]
+    with open(path, "w") as f:
+        json.dump({"weights_summary": weights_summary}, f, indent=2)
+
+def run_encrypt(cc_path, pubkey_path, input_path, output_path):
+    start = time.perf_counter()
+    subprocess.run([ENCRYPT_BIN, cc_path, pubkey_path, input_path, output_path],
+                   check=True, stdout=subprocess.DEVNULL)
+    return time.perf_counter() - start
+
+# ----------------------
+# Main
+# ----------------------
+def main():
+    ap = argparse.ArgumentParser()
+    ap.add_argument("cc_path")
+    ap.add_argument("pubkey_path")
+    ap.add_argument("--params", type=int, nargs="+", default=[1_000_000, 10_000_000])
+    ap.add_argument("--reps", type=int, default=1)
+    args = ap.parse_args()
+
+    rows = []
+    with tempfile.TemporaryDirectory() as tmp:
+        for n_params in args.params:
+            arrays = synthetic_weights(n_params)
+            names = [f"param_{i}" for i in range(len(arrays))]
+
+            for fmt, path, exporter in (
+                ("json", os.path.join(tmp, "weights.json"), export_json),
+                ("tensor", os.path.join(tmp, "weights.bin"), write_tensor_file),
+            ):
+                for rep in range(args.reps):
+                    t0 = time.perf_counter()
+                    exporter(path, names, arrays)
+                    export_s = time.perf_counter() - t0
+                    encrypt_s = run_encrypt(args.cc_path, args.pubkey_path, path,
+                                            os.path.join(tmp, "encrypted.json"))
+                    rows.append({
+                        "params": n_params, "format": fmt, "rep": rep,
+                        "input_bytes": os.path.getsize(path),
+                        "export_s": round(export_s, 3), "encrypt_s": round(encrypt_s, 3),
+                    })
+                    print(f"[bench] params={n_params:>10} format={fmt:<6} "
+                          f"input={rows[-1]['input_bytes'] / 2**20:8.1f} MB "
+                          f"export={export_s:7.2f}s encrypt={encrypt_s:7.2f}s")
+
+    new_file = not os.path.exists(OUT_CSV)
+    with open(OUT_CSV, "a", newline="") as f:
+        w = csv.DictWriter(f, fieldnames=list(rows[0].keys()))
+        if new_file:
+            w.writeheader()
+        w.writerows(rows)
+    print(f"[bench] Results appended to {OUT_CSV}")
+
+if __name__ == "__main__":
+    main()
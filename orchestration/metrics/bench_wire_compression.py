@@ -0,0 +1,334 @@
+#!/usr/bin/env python3
+"""
+bench_wire_compression.py
+
+Bytes on the wire and end-to-end transfer time of ciphertext / key uploads
+and downloads against runMserver, per Content-Encoding (none, gzip, zstd) and
+link speed.
+
+A scratch runMserver (own config and storage in a temp dir) is started on
+--port. Every payload is POSTed the way msend does it (compressed file plus
+multipart "encoding" field) and fetched back with Accept-Encoding, through a
+token-bucket TCP proxy on loopback that caps each direction at --rates bytes/s.
+With --tc and root, a tc tbf qdisc on lo is used instead of the proxy.
+
+Upload time includes client-side compression, download time includes curl's
+decoding, so the numbers are what msend would see.
+
+Payloads (--file, repeatable) default to synthetic ones shaped like the real
+files: base64 ciphertext JSON and a decimal big-integer key JSON. zstd needs
+a runMserver built with `make runMserver ZSTD=1` and the zstd CLI or libzstd.
+
+Usage:
+  python3 bench_wire_compression.py [--bin server/build/runMserver] [--file f ...]
+         [--rates 1M 10M 100M 0] [--reps 3] [--tc]
+
+Results are written to ./wire_compression_bench.csv
+"""
+
+import argparse
+import base64
+import csv
+import ctypes
+import ctypes.util
+import gzip
+import json
+import os
+import random
+import shutil
+import socket
+import subprocess
+import sys
+import tempfile
+import threading
+import time
+import urllib.request
+
+BASE_DIR = os.path.abspath(os.path.join(os.path.dirname(__file__), "../.."))
+RUNMSERVER_BIN = os.path.join(BASE_DIR, "server/build/runMserver")
+OUT_CSV = "wire_compression_bench.csv"
+
+# ----------------------
+# Payloads
+# ----------------------
+def synthetic_ciphertext(n_bytes, seed=0):
+    """Layer list of base64 ciphertexts, like encryptModelWeights output."""
+    rng = random.Random(seed)
+    layers, left, i = [], n_bytes * 3 // 4, 0
+    while left > 0:
+        n = min(1 << 20, left)
+        layers.append({"layer": f"layer_{i}", "ciphertext": base64.b64encode(rng.randbytes(n)).decode()})
+        left -= n
+        i += 1
+    return json.dumps({"layers": layers}).encode()
+
+def synthetic_key(n_bytes, seed=1):
+    """Cereal-style JSON of 60-bit RNS limbs as decimal integers, like a public key."""
+    rng = random.Random(seed)
+    limbs = []
+    size = 0
+    while size < n_bytes:
+        v = [rng.getrandbits(60) for _ in range(4096)]
+        limbs.append({"m": "1152921504606830593", "v": v})
+        size += 20 * len(v)
+    return json.dumps({"value0": {"ptr_wrapper": {"data": {"m_vectors": limbs}}}}).encode()
+
+# ----------------------
+# Codecs
+# ----------------------
+class Zstd:
+    """zstd CLI if installed, else libzstd through ctypes, else unavailable."""
+
+    def __init__(self):
+        self.cli = shutil.which("zstd")
+        self.lib = None
+        if not self.cli:
+            name = ctypes.util.find_library("zstd")
+            if name:
+                self.lib = ctypes.CDLL(name)
+                self.lib.ZSTD_compressBound.restype = ctypes.c_size_t
+                self.lib.ZSTD_compress.restype = ctypes.c_size_t
+                self.lib.ZSTD_isError.restype = ctypes.c_uint
+
+    def available(self):
+        return bool(self.cli or self.lib)
+
+    def compress(self, data, level):
+        if self.cli:
+            return subprocess.run([self.cli, "-q", "-c", f"-{level}"], input=data, check=True,
+                                  stdout=subprocess.PIPE).stdout
+        bound = self.lib.ZSTD_compressBound(ctypes.c_size_t(len(data)))
+        buf = ctypes.create_string_buffer(bound)
+        n = self.lib.ZSTD_compress(buf, ctypes.c_size_t(bound), data, ctypes.c_size_t(len(data)), level)
+        if self.lib.ZSTD_isError(ctypes.c_size_t(n)):
+            raise RuntimeError("ZSTD_compress failed")
+        return buf.raw[:n]
+
+def encode(enc, data, args, zstd):
+    if enc == "gzip":
+        return gzip.compress(data, compresslevel=args.level_gzip)
+    if enc == "zstd":
+        return zstd.compress(data, args.level_zstd)
+    return data
+
+# ----------------------
+# Scratch server
+# ----------------------
+def start_server(args, scratch):
+    storage = os.path.join(scratch, "storage")
+    paths = {k: os.path.join(storage, v) for k, v in {
+        "CLIENT_1_PUBLIC": "client_1/client_1-public.key",
+        "CLIENT_2_PUBLIC": "client_2/client_2-public.key",
+        "CLIENT_1_REKEY": "client_1/client_1-ReKey.key",
+        "CLIENT_2_REKEY": "client_2/client_2-ReKey.key",
+        "CLIENT_1_ENCRYPTED_WEIGHTS_PATH": "client_1/encrypted_weights_c1.json",
+        "CLIENT_2_ENCRYPTED_WEIGHTS_PATH": "client_2/encrypted_weights_c2.json",
+        "OUTPUT_DOMAIN_CHANGED_PATH": "client_2/c1_domainChange_c2.json",
+        "AGGREGATED_ENCRYPTED_WEIGHTS_PATH": "client_2/aggregated_weights.json",
+        "OUTPUT_AGGREGATED_DOMAIN_CHANGED_PATH": "client_1/c2_domainChange_c1.json",
+    }.items()}
+    os.makedirs(os.path.join(storage, "client_1"))
+    os.makedirs(os.path.join(storage, "client_2"))
+    with open(os.path.join(storage, "CC.json"), "w") as f:
+        f.write("{}")
+    cfg = {
+        "mSConfig": {"SERVER_IP": "127.0.0.1", "SERVER_PORT": args.port,
+                     "COMPRESSION": {"LEVEL_GZIP": args.level_gzip, "LEVEL_ZSTD": args.level_zstd}},
+        "CC": {"path": os.path.join(storage, "CC.json")},
+        "CLIENTS": paths,
+    }
+    with open(os.path.join(scratch, "sConfig.json"), "w") as f:
+        json.dump(cfg, f)
+    log = open(os.path.join(scratch, "server.log"), "w")
+    proc = subprocess.Popen([args.bin, "sConfig.json"], cwd=scratch, stdout=log, stderr=subprocess.STDOUT)
+    for _ in range(50):
+        try:
+            urllib.request.urlopen(f"http://127.0.0.1:{args.port}/getCC", timeout=1)
+            return proc, paths
+        except OSError:
+            time.sleep(0.1)
+    proc.kill()
+    sys.exit(f"[wire_bench] runMserver did not come up, see {scratch}/server.log")
+
+def server_accepts(url):
+    """Encodings the server decodes, from the 415 reply to a bogus one."""
+    r = subprocess.run(["curl", "-s", "-D", "-", "-o", "/dev/null", "-F", "encoding=x-probe",
+                        "-F", "file=@/dev/null", url], stdout=subprocess.PIPE, text=True)
+    for line in r.stdout.splitlines():
+        if line.lower().startswith("accept-encoding:"):
+            return {e.strip() for e in line.split(":", 1)[1].split(",")}
+    return {"gzip"}
+
+# ----------------------
+# Throttling
+# ----------------------
+class ThrottleProxy:
+    """Loopback TCP proxy forwarding to `target`, each direction capped at `rate` bytes/s."""
+
+    def __init__(self, target_port):
+        self.target_port = target_port
+        self.rate = 0
+        self.sock = socket.socket()
+        self.sock.setsockopt(socket.SOL_SOCKET, socket.SO_REUSEADDR, 1)
+        self.sock.bind(("127.0.0.1", 0))
+        self.sock.listen(16)
+        self.port = self.sock.getsockname()[1]
+        threading.Thread(target=self.accept, daemon=True).start()
+
+    def accept(self):
+        while True:
+            client, _ = self.sock.accept()
+            server = socket.create_connection(("127.0.0.1", self.target_port))
+            for src, dst in ((client, server), (server, client)):
+                threading.Thread(target=self.pump, args=(src, dst, self.rate), daemon=True).start()
+
+    @staticmethod
+    def pump(src, dst, rate):
+        chunk = 64 * 1024 if not rate else max(1024, min(64 * 1024, rate // 50))
+        start, sent = time.perf_counter(), 0
+        try:
+            while True:
+                data = src.recv(chunk)
+                if not data:
+                    break
+                dst.sendall(data)
+                sent += len(data)
+                if rate:
+                    delay = start + sent / rate - time.perf_counter()
+                    if delay > 0:
+                        time.sleep(delay)
+            dst.shutdown(socket.SHUT_WR)
+        except OSError:
+            pass
+
+def tc(*cmd):
+    subprocess.run(["tc", *cmd], check=True, stdout=subprocess.DEVNULL, stderr=subprocess.DEVNULL)
+
+def tc_rate(rate):
+    """Shape lo with tbf; rate like 10M means 10 MB/s, as in curl --limit-rate."""
+    subprocess.run(["tc", "qdisc", "del", "dev", "lo", "root"], stderr=subprocess.DEVNULL)
+    if rate != "0":
+        bits = parse_size(rate) * 8
+        tc("qdisc", "add", "dev", "lo", "root", "tbf", "rate", f"{bits}bit", "burst", "256kb", "latency", "50ms")
+
+def parse_size(s):
+    mult = {"K": 1 << 10, "M": 1 << 20, "G": 1 << 30}
+    return int(float(s[:-1]) * mult[s[-1].upper()]) if s[-1].upper() in mult else int(s)
+
+# ----------------------
+# Transfers
+# ----------------------
+def curl(cmd):
+    out = subprocess.run(cmd, stdout=subprocess.PIPE, text=True, check=True).stdout.split()
+    return int(out[0]), float(out[1]), int(float(out[2]))
+
+def upload(url, payload, enc, args, zstd, tmp):
+    t0 = time.perf_counter()
+    body = encode(enc, payload, args, zstd)
+    with open(tmp, "wb") as f:
+        f.write(body)
+    cmd = ["curl", "-s", "-S", "-H", "Expect:", "-o", "/dev/null", "-w", "%{http_code} %{time_total} %{size_upload}"]
+    if enc != "none":
+        cmd += ["-F", f"encoding={enc}"]
+    cmd += ["-F", f"file=@{tmp}", "-F", "client_id=bench", "-F", "type=bench", url]
+    code, _, wire = curl(cmd)
+    return code, time.perf_counter() - t0, wire
+
+def download(url, enc, out):
+    t0 = time.perf_counter()
+    cmd = ["curl", "-s", "-S", "-o", out, "-w", "%{http_code} %{time_total} %{size_download}"]
+    if enc != "none":
+        cmd += ["--compressed", "-H", f"Accept-Encoding: {enc}"]
+    else:
+        cmd += ["-H", "Accept-Encoding: identity"]
+    code, _, wire = curl(cmd + [url])
+    return code, time.perf_counter() - t0, wire
+
+# ----------------------
+# Main
+# ----------------------
+def main():
+    ap = argparse.ArgumentParser(description="Wire compression benchmark for runMserver transfers")
+    ap.add_argument("--bin", default=RUNMSERVER_BIN)
+    ap.add_argument("--port", type=int, default=8091)
+    ap.add_argument("--file", action="append", default=[], help="payload file (default: synthetic)")
+    ap.add_argument("--size", default="16M", help="synthetic payload size")
+    ap.add_argument("--rates", nargs="+", default=["1M", "10M", "100M", "0"],
+                    help="bytes/s per direction (K/M/G suffixes); 0 = unthrottled")
+    ap.add_argument("--reps", type=int, default=3)
+    ap.add_argument("--level-gzip", type=int, default=6)
+    ap.add_argument("--level-zstd", type=int, default=3)
+    ap.add_argument("--tc", action="store_true", help="throttle with tc tbf on lo (root) instead of the proxy")
+    args = ap.parse_args()
+
+    if not os.access(args.bin, os.X_OK):
+        sys.exit(f"[wire_bench] {args.bin} missing (make runMserver [ZSTD=1])")
+    if args.tc and (os.geteuid() != 0 or not shutil.which("tc")):
+        print("[wire_bench] --tc needs root and tc, falling back to the throttling proxy")
+        args.tc = False
+
+    if args.file:
+        payloads = [(os.path.basename(p), open(p, "rb").read()) for p in args.file]
+    else:
+        n = parse_size(args.size)
+        payloads = [("ciphertext", synthetic_ciphertext(n)), ("pubkey", synthetic_key(n // 4))]
+
+    zstd = Zstd()
+    scratch = tempfile.mkdtemp(prefix="ppfl_wire.")
+    proc, paths = start_server(args, scratch)
+    rows = []
+    try:
+        accepted = server_accepts(f"http://127.0.0.1:{args.port}/uploadPubKeyC1")
+        proxy = None if args.tc else ThrottleProxy(args.port)
+        base = f"http://127.0.0.1:{args.port if args.tc else proxy.port}"
+        encodings = ["none", "gzip"] + (["zstd"] if "zstd" in accepted and zstd.available() else [])
+        if "zstd" not in encodings:
+            print("[wire_bench] zstd skipped (server built without ZSTD=1 or no zstd CLI/libzstd)")
+        tmp = os.path.join(scratch, "upload.bin")
+        out = os.path.join(scratch, "download.bin")
+
+        for name, payload in payloads:
+            for rate in args.rates:
+                if args.tc:
+                    tc_rate(rate)
+                else:
+                    proxy.rate = parse_size(rate)
+                for enc in encodings:
+                    for rep in range(args.reps):
+                        code, up_s, up_wire = upload(base + "/uploadPubKeyC1", payload, enc, args, zstd, tmp)
+                        if code != 200:
+                            sys.exit(f"[wire_bench] upload {name}/{enc} got HTTP {code}")
+                        code, down_s, down_wire = download(base + "/sendPbKeyC1", enc, out)
+                        with open(out, "rb") as f:
+                            if code != 200 or f.read() != payload:
+                                sys.exit(f"[wire_bench] download {name}/{enc} did not round-trip (HTTP {code})")
+                        rows.append({"payload": name, "payload_bytes": len(payload), "rate": rate,
+                                     "throttle": "tc" if args.tc else "proxy", "encoding": enc, "rep": rep,
+                                     "upload_wire_bytes": up_wire, "upload_s": round(up_s, 4),
+                                     "download_wire_bytes": down_wire, "download_s": round(down_s, 4)})
+    finally:
+        if args.tc:
+            subprocess.run(["tc", "qdisc", "del", "dev", "lo", "root"], stderr=subprocess.DEVNULL)
+        proc.terminate()
+        proc.wait()
+        shutil.rmtree(scratch, ignore_errors=True)
+
+    with open(OUT_CSV, "w", newline="") as f:
+        w = csv.DictWriter(f, fieldnames=list(rows[0].keys()))
+        w.writeheader()
+        w.writerows(rows)
+
+    print(f"{'payload':<12} {'rate':>6} {'enc':<5} {'up_MB':>8} {'up_s':>8} {'down_MB':>8} {'down_s':>8} {'ratio':>6}")
+    seen = {}
+    for r in rows:
+        seen.setdefault((r["payload"], r["rate"], r["encoding"]), []).append(r)
+    for (name, rate, enc), rs in seen.items():
+        med = lambda k: sorted(x[k] for x in rs)[len(rs) // 2]
+        print(f"{name:<12} {rate:>6} {enc:<5} {med('upload_wire_bytes') / 2**20:>8.2f} {med('upload_s'):>8.3f} "
+              f"{med('download_wire_bytes') / 2**20:>8.2f} {med('download_s'):>8.3f} "
+              f"{rs[0]['payload_bytes'] / max(med('download_wire_bytes'), 1):>6.2f}")
+    print(f"\n[wire_bench] {len(rows)} transfers -> {OUT_CSV}")
+
+
+if __name__ == "__main__":
+    main()
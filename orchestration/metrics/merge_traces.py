@@ -0,0 +1,122 @@
+#!/usr/bin/env python3
+"""
+merge_traces.py
+
+Merges the per-process span files written when PPFL_TRACE_DIR is set
+(lib/trace.h in the C++ binaries, trace_span/trace_emit in helper_fns.sh)
+into one Chrome trace, viewable in chrome://tracing or ui.perfetto.dev.
+
+Every *.trace.jsonl file starts with a process_name and a clock_sync
+metadata line. clock_sync pairs the file's own timestamp clock (monotonic
+for C++, wall clock for bash) with the wall clock at open. The offset
+moves all events onto wall time, then everything is shifted so that the
+earliest event starts at 0.
+
+Usage:
+  python3 merge_traces.py TRACE_DIR [-o trace.json] [--round N]
+
+Prints a per-round summary of the orchestrator stages (encrypt, upload,
+recrypt, aggregate, download, decrypt, ...) and the slowest server/CLI
+spans, so the critical path of a round is visible without the viewer.
+"""
+
+import argparse
+import glob
+import json
+import os
+import sys
+from collections import defaultdict
+
+
+def load_file(path):
+    meta, events, offset = [], [], None
+    with open(path) as f:
+        for line in f:
+            line = line.strip()
+            if not line:
+                continue
+            try:
+                ev = json.loads(line)
+            except json.JSONDecodeError:
+                continue  # partially written last line of a killed process
+            if ev.get("ph") == "M":
+                if ev.get("name") == "clock_sync":
+                    a = ev["args"]
+                    offset = a["wall_us"] - a["mono_us"]
+                else:
+                    meta.append(ev)
+            else:
+                events.append(ev)
+    if offset is None:
+        print(f"[merge_traces] {os.path.basename(path)}: no clock_sync, skipped", file=sys.stderr)
+        return [], []
+    for ev in events:
+        ev["ts"] += offset
+    return meta, events
+
+
+def summarize(events):
+    orch = defaultdict(lambda: defaultdict(float))
+    spans = defaultdict(list)
+    for ev in events:
+        rnd = ev.get("args", {}).get("round")
+        if rnd is None:
+            continue
+        if ev.get("cat") == "orchestrator":
+            orch[rnd][ev["name"]] += ev["dur"] / 1e6
+        else:
+            spans[rnd].append(ev)
+
+    for rnd in sorted(set(orch) | set(spans)):
+        print(f"--- round {rnd} ---")
+        stages = orch.get(rnd, {})
+        for name, secs in stages.items():
+            print(f"  {name:<24} {secs:9.3f} s")
+        top = sorted(spans.get(rnd, []), key=lambda e: e["dur"], reverse=True)[:5]
+        if top:
+            print("  slowest spans:")
+        for ev in top:
+            who = ev.get("cat", "")
+            client = ev.get("args", {}).get("client")
+            if client:
+                who += f" (client {client})"
+            print(f"    {ev['name']:<30} {ev['dur'] / 1e6:9.3f} s  {who}")
+
+
+def main():
+    ap = argparse.ArgumentParser(description="Merge PPFL span traces into one Chrome trace")
+    ap.add_argument("trace_dir")
+    ap.add_argument("-o", "--out", default=None, help="output file (default TRACE_DIR/trace.json)")
+    ap.add_argument("--round", type=int, default=None, help="keep only spans of this round")
+    args = ap.parse_args()
+
+    files = sorted(glob.glob(os.path.join(args.trace_dir, "*.trace.jsonl")))
+    if not files:
+        sys.exit(f"[merge_traces] no *.trace.jsonl files in {args.trace_dir}")
+
+    meta, events = [], []
+    for path in files:
+        m, e = load_file(path)
+        meta += m
+        events += e
+
+    if args.round is not None:
+        events = [e for e in events if e.get("args", {}).get("round") == args.round]
+    if not events:
+        sys.exit("[merge_traces] no events to write")
+
+    t0 = min(e["ts"] for e in events)
+    for e in events:
+        e["ts"] -= t0
+    events.sort(key=lambda e: (e["ts"], -e["dur"]))
+
+    out = args.out or os.path.join(args.trace_dir, "trace.json")
+    with open(out, "w") as f:
+        json.dump({"traceEvents": meta + events, "displayTimeUnit": "ms"}, f)
+    print(f"[merge_traces] {len(events)} spans from {len(files)} processes -> {out}")
+
+    summarize(events)
+
+
+if __name__ == "__main__":
+    main()
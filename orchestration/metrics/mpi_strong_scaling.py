@@ -0,0 +1,106 @@
+#!/usr/bin/env python3
+"""
+mpi_strong_scaling.py
+
+Strong-scaling benchmark of mpiAggregate (server-side C1->C2 re-encryption,
+aggregation and C2->C1 re-encryption distributed over MPI ranks) on one
+fixed pair of encrypted weight files, from 1 to N ranks on localhost.
+
+Inputs default to the paths in server/config/sConfig.json, so run one round
+first (or point --enc-c1/--enc-c2 at larger encrypted models). Outputs go to
+a scratch directory; server storage is not touched.
+
+Usage:
+  python3 mpi_strong_scaling.py [--ranks 1 2 4 8] [--reps 3]
+                                [--enc-c1 PATH] [--enc-c2 PATH] [--mpirun-args "--oversubscribe"]
+
+For each rank count the median of --reps runs is reported per phase
+(from mpiAggregate's "[mpiagg] timing" line), with speedup and parallel
+efficiency of total and compute time relative to the smallest rank count.
+Rows are appended to ./mpi_scaling.csv
+"""
+
+import argparse
+import csv
+import json
+import os
+import shlex
+import statistics
+import subprocess
+import tempfile
+
+BASE_DIR = os.path.abspath(os.path.join(os.path.dirname(__file__), "..", ".."))
+SERVER_CONFIG = os.path.join(BASE_DIR, "server", "config", "sConfig.json")
+MPIAGG_BIN = os.path.join(BASE_DIR, "server", "build", "mpiAggregate")
+OUT_CSV = "mpi_scaling.csv"
+PHASES = ["bcast_s", "load_s", "scatter_s", "compute_s", "gather_s", "write_s", "total_s"]
+
+def abspath(p):
+    return p if os.path.isabs(p) else os.path.join(BASE_DIR, p)
+
+def run_once(args, ranks, paths, scratch):
+    cmd = (["mpirun", "-np", str(ranks)] + shlex.split(args.mpirun_args) +
+           [MPIAGG_BIN, paths["cc"], paths["rekey_c1"], paths["rekey_c2"], paths["enc_c1"], paths["enc_c2"],
+            os.path.join(scratch, "agg.json"), os.path.join(scratch, "agg_c1.json")])
+    proc = subprocess.run(cmd, capture_output=True, text=True, cwd=BASE_DIR)
+    if proc.returncode != 0:
+        raise SystemExit(f"[mpi_scaling] {' '.join(cmd)} failed:\n{proc.stderr}")
+    for line in proc.stdout.splitlines():
+        if line.startswith("[mpiagg] timing "):
+            return json.loads(line[len("[mpiagg] timing "):])
+    raise SystemExit("[mpi_scaling] no timing line in mpiAggregate output")
+
+def main():
+    ap = argparse.ArgumentParser(description="Strong scaling of mpiAggregate over MPI ranks")
+    ap.add_argument("--ranks", type=int, nargs="+",
+                    default=[n for n in (1, 2, 4, 8, 16, 32) if n <= (os.cpu_count() or 1)])
+    ap.add_argument("--reps", type=int, default=3)
+    ap.add_argument("--enc-c1")
+    ap.add_argument("--enc-c2")
+    ap.add_argument("--mpirun-args", default="", help="extra mpirun flags, e.g. --oversubscribe or --bind-to core")
+    args = ap.parse_args()
+
+    with open(SERVER_CONFIG) as f:
+        conf = json.load(f)
+    clients = conf["CLIENTS"]
+    paths = {
+        "cc": abspath(conf["CC"]["path"]),
+        "rekey_c1": abspath(clients["CLIENT_1_REKEY"]),
+        "rekey_c2": abspath(clients["CLIENT_2_REKEY"]),
+        "enc_c1": abspath(args.enc_c1 or clients["CLIENT_1_ENCRYPTED_WEIGHTS_PATH"]),
+        "enc_c2": abspath(args.enc_c2 or clients["CLIENT_2_ENCRYPTED_WEIGHTS_PATH"]),
+    }
+
+    rows = []
+    with tempfile.TemporaryDirectory(prefix="mpi_scaling_") as scratch:
+        for ranks in sorted(args.ranks):
+            runs = [run_once(args, ranks, paths, scratch) for _ in range(args.reps)]
+            row = {"ranks": ranks, "pairs": runs[0]["pairs"]}
+            for p in PHASES:
+                row[p] = round(statistics.median(r[p] for r in runs), 4)
+            rows.append(row)
+            print(f"[mpi_scaling] {ranks:>3} ranks: total {row['total_s']:.3f}s compute {row['compute_s']:.3f}s")
+
+    base = rows[0]
+    for row in rows:
+        k = row["ranks"] / base["ranks"]
+        row["speedup"] = round(base["total_s"] / row["total_s"], 3)
+        row["efficiency"] = round(row["speedup"] / k, 3)
+        row["compute_speedup"] = round(base["compute_s"] / row["compute_s"], 3)
+        row["compute_efficiency"] = round(row["compute_speedup"] / k, 3)
+
+    print(f"{'ranks':>5} {'total_s':>9} {'compute_s':>10} {'speedup':>8} {'eff':>6} {'c_speedup':>10} {'c_eff':>6}")
+    for r in rows:
+        print(f"{r['ranks']:>5} {r['total_s']:>9} {r['compute_s']:>10} {r['speedup']:>8} "
+              f"{r['efficiency']:>6} {r['compute_speedup']:>10} {r['compute_efficiency']:>6}")
+
+    new_file = not os.path.exists(OUT_CSV)
+    with open(OUT_CSV, "a", newline="") as f:
+        w = csv.DictWriter(f, fieldnames=list(rows[0].keys()))
+        if new_file:
+            w.writeheader()
+        w.writerows(rows)
+    print(f"[mpi_scaling] {len(rows)} rows appended to {OUT_CSV}")
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,131 @@
+#!/usr/bin/env python3
+"""
+simulate_stragglers.py
+
+Monte-Carlo round latency for the round-closing policies of runMserver
+(sConfig.json AGGREGATION) under simulated straggler distributions.
+
+Each client's train + encrypt + upload time is base_ms * X, with X drawn from:
+  - lognormal : X ~ LogNormal(0, sigma)
+  - pareto    : X ~ 1 + Pareto(alpha)          (heavy tail)
+  - bimodal   : X = slow_factor with probability p_slow, else ~U(0.9, 1.1)
+
+Policies compared per round:
+  - sync          : wait for every client (QUORUM 1.0, no deadline)
+  - quorum        : close when ceil(q * n) clients are in
+  - deadline      : close at D ms if at least one client is in, else at the first arrival
+  - quorum+deadline : whichever of the two closes first
+Each is followed by a fixed finish cost (--finish-ms: last scale + re-encrypt + write).
+
+Usage:
+  python3 simulate_stragglers.py [--clients 2 10 50] [--rounds 10000] [--base-ms 1000]
+                                 [--dist lognormal pareto bimodal] [--quorum 0.8] [--deadline-ms 1500]
+
+Results (p50/p90/p99 latency, mean fraction of clients aggregated) are
+appended to ./straggler_sim.csv
+"""
+
+import argparse
+import csv
+import math
+import os
+
+import numpy as np
+
+OUT_CSV = "straggler_sim.csv"
+
+# ----------------------
+# Distributions
+# ----------------------
+def draw(dist, rng, shape, args):
+    if dist == "lognormal":
+        return rng.lognormal(0.0, args.sigma, size=shape)
+    if dist == "pareto":
+        return 1.0 + rng.pareto(args.alpha, size=shape)
+    if dist == "bimodal":
+        slow = rng.random(shape) < args.p_slow
+        return np.where(slow, args.slow_factor, rng.uniform(0.9, 1.1, size=shape))
+    raise ValueError("unknown distribution " + dist)
+
+# ----------------------
+# Policies: (close time per round, clients included per round)
+# ----------------------
+def close_sync(t, args):
+    return t[:, -1], np.full(t.shape[0], t.shape[1])
+
+def close_quorum(t, args):
+    k = min(t.shape[1], max(1, math.ceil(args.quorum * t.shape[1])))
+    return t[:, k - 1], np.full(t.shape[0], k)
+
+def close_deadline(t, args):
+    d = args.deadline_ms
+    close = np.where(t[:, -1] <= d, t[:, -1], np.maximum(d, t[:, 0]))
+    return close, (t <= close[:, None]).sum(axis=1)
+
+def close_quorum_deadline(t, args):
+    q_close, _ = close_quorum(t, args)
+    d_close, _ = close_deadline(t, args)
+    close = np.minimum(q_close, d_close)
+    return close, (t <= close[:, None]).sum(axis=1)
+
+POLICIES = [
+    ("sync", close_sync),
+    ("quorum", close_quorum),
+    ("deadline", close_deadline),
+    ("quorum+deadline", close_quorum_deadline),
+]
+
+# ----------------------
+# Main
+# ----------------------
+def main():
+    ap = argparse.ArgumentParser(description="Round latency percentiles under simulated stragglers")
+    ap.add_argument("--clients", type=int, nargs="+", default=[2, 10, 50])
+    ap.add_argument("--rounds", type=int, default=10000)
+    ap.add_argument("--base-ms", type=float, default=1000.0)
+    ap.add_argument("--finish-ms", type=float, default=50.0)
+    ap.add_argument("--dist", nargs="+", default=["lognormal", "pareto", "bimodal"])
+    ap.add_argument("--sigma", type=float, default=0.5)
+    ap.add_argument("--alpha", type=float, default=2.0)
+    ap.add_argument("--p-slow", type=float, default=0.1)
+    ap.add_argument("--slow-factor", type=float, default=5.0)
+    ap.add_argument("--quorum", type=float, default=0.8)
+    ap.add_argument("--deadline-ms", type=float, default=1500.0)
+    ap.add_argument("--seed", type=int, default=0)
+    args = ap.parse_args()
+
+    rng = np.random.default_rng(args.seed)
+    rows = []
+    for dist in args.dist:
+        for n in args.clients:
+            t = np.sort(args.base_ms * draw(dist, rng, (args.rounds, n), args), axis=1)
+            for name, policy in POLICIES:
+                close, included = policy(t, args)
+                latency = close + args.finish_ms
+                rows.append({
+                    "dist": dist,
+                    "clients": n,
+                    "policy": name,
+                    "quorum": args.quorum,
+                    "deadline_ms": args.deadline_ms,
+                    "p50_ms": round(float(np.percentile(latency, 50)), 1),
+                    "p90_ms": round(float(np.percentile(latency, 90)), 1),
+                    "p99_ms": round(float(np.percentile(latency, 99)), 1),
+                    "included_frac": round(float(np.mean(included / n)), 3),
+                })
+
+    print(f"{'dist':<10} {'n':>4} {'policy':<16} {'p50':>9} {'p90':>9} {'p99':>9} {'incl':>6}")
+    for r in rows:
+        print(f"{r['dist']:<10} {r['clients']:>4} {r['policy']:<16} "
+              f"{r['p50_ms']:>9} {r['p90_ms']:>9} {r['p99_ms']:>9} {r['included_frac']:>6}")
+
+    new_file = not os.path.exists(OUT_CSV)
+    with open(OUT_CSV, "a", newline="") as f:
+        w = csv.DictWriter(f, fieldnames=list(rows[0].keys()))
+        if new_file:
+            w.writeheader()
+        w.writerows(rows)
+    print(f"[simulate_stragglers] {len(rows)} rows appended to {OUT_CSV}")
+
+if __name__ == "__main__":
+    main()
@@ -13,6 +13,7 @@ source "$SCRIPT_DIR/helper_fns.sh" # defines READJSON, msend
 source "$SCRIPT_DIR/server_fns.sh" # defines SERVER_STORAGE_DIR and server-side bin paths
 source "$SCRIPT_DIR/client_fns.sh" # defines client storage paths and client-side macros
 source "$SCRIPT_DIR/comm_fns.sh"   # comm_fns uses both server and client path vars and provides transfer wrappers
+source "$SCRIPT_DIR/store_fns.sh"  # round-versioned copies of each round's artifacts
 
 # ---- Load Orchestration Config ----
 ORCH_CONFIG="$SCRIPT_DIR/oConfig.json"
@@ -20,6 +21,26 @@ COMM_MODE=$(jq -r '.orchestration.COMM_MODE' "$ORCH_CONFIG")
 ROUNDS=$(jq -r '.orchestration.ROUNDS' "$ORCH_CONFIG")
 SERVER_IP=$(jq -r '.orchestration.SERVER_IP' "$ORCH_CONFIG")
 SERVER_PORT=$(jq -r '.orchestration.SERVER_PORT' "$ORCH_CONFIG")
+ROUND_MODE=$(jq -r '.orchestration.ROUND_MODE // "SEQUENTIAL"' "$ORCH_CONFIG") # SEQUENTIAL | INCREMENTAL | STREAM | ASYNC
+TREE_CONFIG=$(jq -r '.orchestration.TREE_CONFIG // empty' "$ORCH_CONFIG")      # relay tree (gen_tree_configs.py), optional
+MPI_RANKS=$(jq -r '.orchestration.MPI_RANKS // 0' "$ORCH_CONFIG")              # >0: server step via mpiAggregate
+SERVER_JOBS=$(jq -r '.orchestration.SERVER_JOBS // false' "$ORCH_CONFIG")      # true: server steps as runMserver /jobs
+TRACE_DIR=$(jq -r '.orchestration.TRACE_DIR // empty' "$ORCH_CONFIG")          # span traces of every process, optional
+STATS_FILE=$(jq -r '.orchestration.STATS_FILE // empty' "$ORCH_CONFIG")        # per-phase CPU/RSS of the crypto CLIs, optional
+WIRE_COMPRESSION=$(jq -r '.orchestration.WIRE_COMPRESSION // "auto"' "$ORCH_CONFIG")  # msend codec: auto | zstd | gzip | none
+WIRE_LEVEL_GZIP=$(jq -r '.orchestration.WIRE_LEVEL_GZIP // 6' "$ORCH_CONFIG")
+WIRE_LEVEL_ZSTD=$(jq -r '.orchestration.WIRE_LEVEL_ZSTD // 3' "$ORCH_CONFIG")
+DAG_JOBS=$(jq -r '.orchestration.DAG_JOBS // 0' "$ORCH_CONFIG")                # >0: key setup and rounds as ppfl_dag graphs
+DAG_TIMING=$(jq -r '.orchestration.DAG_TIMING // empty' "$ORCH_CONFIG")        # per-step timing CSV of ppfl_dag, optional
+DAG_BIN="$BASE_DIR/orchestration/build/ppfl_dag"
+BATCH_KEYGEN=$(jq -r '.orchestration.BATCH_KEYGEN // false' "$ORCH_CONFIG")    # true: key setup via one batchKeyGen (not with DAG_JOBS)
+KEYGEN_TIMING=$(jq -r '.orchestration.KEYGEN_TIMING // empty' "$ORCH_CONFIG")  # per-key timing CSV of batchKeyGen, optional
+ROUND_STORE=$(jq -r '.orchestration.ROUND_STORE // true' "$ORCH_CONFIG")          # snapshot every round under <storage>/rounds
+ROUND_KEEP_LAST=$(jq -r '.orchestration.ROUND_KEEP_LAST // 0' "$ORCH_CONFIG")    # retention: newest N rounds (0 = all) ...
+ROUND_KEEP_EVERY=$(jq -r '.orchestration.ROUND_KEEP_EVERY // 0' "$ORCH_CONFIG")  # ... plus every Nth round
+if [ "$(jq -r '.orchestration.ARTIFACT_CACHE // true' "$ORCH_CONFIG")" != "true" ]; then
+    ARTIFACT_MANIFEST=""                                                      # regenerate every setup artifact
+fi
 
 
 # ============================================================
@@ -34,13 +55,112 @@ run_round() {
     c_training
     
     # Orchestration sequence
-    c_encryptWeights # clients encrypt local weights 
-    c_sends_encrypted_weights_to_s # orchestrator: sends encrypted weights to server
-    s_changeCipherDomain_c1_c2    # server: convert c1 -> c2 domain
-    s_aggregateEncryptedWeights
-    s_changeCipherDomain_c2_c1    # server: convert c2 -> c1 domain
-    s_send_aggregated_to_c  # orchestrator: sends aggregated weights to clients
-    c_decryptWeights              # clients decrypt final aggregated weights
+    trace_span "encrypt" c_encryptWeights # clients encrypt local weights 
+    trace_span "upload" c_sends_encrypted_weights_to_s # orchestrator: sends encrypted weights to server
+    if [ "$MPI_RANKS" -gt 0 ]; then
+        trace_span "aggregate" s_mpiAggregate "$MPI_RANKS"   # server: same three steps, distributed over MPI ranks
+    elif [ "$SERVER_JOBS" = "true" ]; then
+        trace_span "aggregate" s_jobs_round "$round"          # server: same three steps, as jobs inside runMserver
+    else
+        trace_span "recrypt_c1_c2" s_changeCipherDomain_c1_c2    # server: convert c1 -> c2 domain
+        trace_span "aggregate" s_aggregateEncryptedWeights
+        trace_span "recrypt_c2_c1" s_changeCipherDomain_c2_c1    # server: convert c2 -> c1 domain
+    fi
+    trace_span "download" s_send_aggregated_to_c  # orchestrator: sends aggregated weights to clients
+    trace_span "decrypt" c_decryptWeights "$round"     # clients decrypt final aggregated weights
+}
+
+# Incremental round: the server adds each uploaded file into a running
+# encrypted aggregate on arrival instead of running the CLIs afterwards
+run_round_incremental() {
+    local round=$1
+    log "orchestrator" "round" "Executing Round $round (incremental)"
+
+    c_training
+    trace_span "encrypt" c_encryptWeights
+    trace_span "upload" c_sends_encrypted_weights_to_s_round "$round" || { log "orchestrator" "error" "Upload failed"; exit 1; }
+    trace_span "wait_aggregate" s_wait_aggregate "$round"     # server: running sum complete, aggregate files written
+    trace_span "download" s_send_aggregated_to_c
+    trace_span "decrypt" c_decryptWeights "$round"
+}
+
+# Asynchronous round: every idle client trains, encrypts and uploads in the
+# background; the server closes the round at its quorum/deadline
+# (sConfig.json AGGREGATION). Clients still busy with an earlier round skip
+# this one and their late update is discarded or decayed by the server.
+declare -A CLIENT_JOB=()
+run_round_async() {
+    local round=$1
+    log "orchestrator" "round" "Executing Round $round (async)"
+
+    local i started=0
+    for i in 1 2; do
+        if [ -n "${CLIENT_JOB[$i]}" ] && kill -0 "${CLIENT_JOB[$i]}" 2>/dev/null; then
+            log "client_$i" "async" "Still working on an earlier round, skipping round $round"
+            continue
+        fi
+        ( c_training "$i" && c_encryptWeights "$i" && c_send_encrypted_weights_round "$i" "$round" ) &
+        CLIENT_JOB[$i]=$!
+        started=$((started + 1))
+    done
+    if [ $started -eq 0 ]; then
+        log "orchestrator" "round" "No idle client for round $round, skipping"
+        return
+    fi
+
+    trace_span "wait_aggregate" s_wait_aggregate "$round"
+
+    # Only clients that are not mid-round pick up the new aggregate
+    local idle=()
+    for i in 1 2; do
+        kill -0 "${CLIENT_JOB[$i]}" 2>/dev/null || idle+=("$i")
+    done
+    if [ ${#idle[@]} -gt 0 ]; then
+        trace_span "download" s_send_aggregated_to_c "${idle[@]}"
+        trace_span "decrypt" c_decryptWeights "$round" "${idle[@]}"
+    fi
+}
+
+# Streaming round: clients encrypt + upload layer by layer while runMserver
+# re-encrypts and aggregates each layer as soon as both contributions are in
+run_round_stream() {
+    local round=$1
+    log "orchestrator" "round" "Executing Round $round (streaming)"
+
+    c_training
+
+    local pids=()
+    for i in 1 2; do
+        c_encryptWeights_stream "$i" "$round" &
+        pids+=($!)
+    done
+    local t0=$(trace_now)
+    for pid in "${pids[@]}"; do
+        wait "$pid" || { log "orchestrator" "error" "Layer streaming failed"; exit 1; }
+    done
+    trace_emit "encrypt_stream" "$t0" $(( $(trace_now) - t0 ))
+
+    trace_span "wait_aggregate" s_wait_aggregate "$round"     # server: all layers re-encrypted + aggregated
+    trace_span "download" s_send_aggregated_to_c
+    trace_span "decrypt" c_decryptWeights "$round"
+}
+
+# DAG round (DAG_JOBS > 0, make ppfl_dag): the same steps as run_round /
+# run_round_incremental, but per client and started as soon as what they
+# need is done, DAG_JOBS at a time; a round takes its critical path
+run_round_dag() {
+    local round=$1
+    log "orchestrator" "round" "Executing Round $round (dag, $DAG_JOBS jobs)"
+    dag_run --phase round --round "$round"
+}
+
+# dag_run <ppfl_dag args...>: every step runs the function of the same name
+# through run_task.sh in a fresh shell, so the settings they read are exported
+dag_run() {
+    export COMM_MODE ROUNDS SERVER_IP SERVER_PORT TREE_CONFIG MPI_RANKS \
+           WIRE_COMPRESSION WIRE_LEVEL_GZIP WIRE_LEVEL_ZSTD ARTIFACT_MANIFEST
+    "$DAG_BIN" --jobs "$DAG_JOBS" --mode "$ROUND_MODE" --mpi-ranks "$MPI_RANKS" \
+        ${DAG_TIMING:+--timing "$BASE_DIR/$DAG_TIMING"} "$@" "$SCRIPT_DIR/run_task.sh"
 }
 
 # ============================================================
@@ -48,27 +168,89 @@ run_round() {
 # ============================================================
 main() {
     log "orchestrator" "Starting Orchestration"
+    if [ -n "$TRACE_DIR" ]; then
+        export PPFL_TRACE_DIR="$(cd "$BASE_DIR" && mkdir -p "$TRACE_DIR" && cd "$TRACE_DIR" && pwd)"
+        log "orchestrator" "trace" "Writing span traces to $PPFL_TRACE_DIR"
+    fi
+    if [ -n "$STATS_FILE" ]; then
+        case "$STATS_FILE" in /*) ;; *) STATS_FILE="$BASE_DIR/$STATS_FILE" ;; esac
+        mkdir -p "$(dirname "$STATS_FILE")"
+        export PPFL_STATS_FILE="$STATS_FILE"
+    fi
     #echo "[orchestrator] === Starting Orchestration ==="
     
+    if [ "$DAG_JOBS" -gt 0 ] && [ "$ROUND_MODE" != "SEQUENTIAL" ] && [ "$ROUND_MODE" != "INCREMENTAL" ]; then
+        log "orchestrator" "error" "DAG_JOBS requires ROUND_MODE=SEQUENTIAL or INCREMENTAL"
+        exit 1
+    fi
+
     #----Init phase----
-    
+    # Steps whose artifacts are recorded in ARTIFACT_MANIFEST from the same inputs are skipped
+
     s_genCC              # produce CC.json on server
     s_Mserver            # start Mongoose server
-    s_send_cc_to_c       # send CC.json to clients
-    c_keyGen             # clients generate key pair
-    c_send_pubkeys_to_s  # orchestrator send pubkeys to server
-    s_send_pubkeys_to_c  # orchestrator distributes pubkeys among clients
-    c_RekeyGen           # clients produce rekeys
-    c_Rekeys_to_s        # orchestrator send rekeys to server
+    if [ "$DAG_JOBS" -gt 0 ]; then
+        dag_run --phase init     # the six steps below, per client and concurrently
+    elif [ "$BATCH_KEYGEN" = "true" ]; then
+        s_send_cc_to_c
+        c_batchKeyGen        # every key pair and rekey in one process
+        c_send_pubkeys_to_s
+        s_send_pubkeys_to_c
+        c_Rekeys_to_s
+    else
+        s_send_cc_to_c       # send CC.json to clients
+        c_keyGen             # clients generate key pair
+        c_send_pubkeys_to_s  # orchestrator send pubkeys to server
+        s_send_pubkeys_to_c  # orchestrator distributes pubkeys among clients
+        c_RekeyGen           # clients produce rekeys
+        c_Rekeys_to_s        # orchestrator send rekeys to server
+    fi
+    s_start_relays       # tree aggregation relays (TREE_CONFIG only)
+    c_start_drivers      # one training process per in-process crypto client, kept across rounds
+
+    if [ "$ROUND_MODE" != "SEQUENTIAL" ] && [ "$COMM_MODE" != "MONGOOSE" ]; then
+        log "orchestrator" "error" "ROUND_MODE=$ROUND_MODE requires COMM_MODE=MONGOOSE"
+        exit 1
+    fi
+    if [ "$SERVER_JOBS" = "true" ] && [ "$COMM_MODE" != "MONGOOSE" ]; then
+        log "orchestrator" "error" "SERVER_JOBS requires COMM_MODE=MONGOOSE"
+        exit 1
+    fi
+    if [ -n "$TREE_CONFIG" ] && [ "$ROUND_MODE" != "INCREMENTAL" ] && [ "$ROUND_MODE" != "ASYNC" ]; then
+        log "orchestrator" "error" "TREE_CONFIG requires ROUND_MODE=INCREMENTAL or ASYNC"
+        exit 1
+    fi
 
     # ----- Training Rounds -----
     for (( r=1; r<=ROUNDS; r++ )); do
         log "orchestrator" "round" "===== ROUND $r / $ROUNDS ====="
-        run_round "$r"
+        export PPFL_TRACE_ROUND=$r
+        if [ "$DAG_JOBS" -gt 0 ]; then
+            trace_span "round $r" run_round_dag "$r"
+        else
+            case "$ROUND_MODE" in
+                STREAM)      trace_span "round $r" run_round_stream "$r" ;;
+                INCREMENTAL) trace_span "round $r" run_round_incremental "$r" ;;
+                ASYNC)       trace_span "round $r" run_round_async "$r" ;;
+                *)           trace_span "round $r" run_round "$r" ;;
+            esac
+        fi
+        trace_span "store" store_round "$r"   # before the next round overwrites the working files
     done
 
+    # Let stragglers of the last async round finish before stopping the server
+    for pid in "${CLIENT_JOB[@]}"; do wait "$pid" 2>/dev/null || true; done
+
+    store_wait
+    c_stop_drivers
+    s_stop_relays
     s_stop_Mserver
 
+    if [ -n "$TRACE_DIR" ]; then
+        python3 "$SCRIPT_DIR/metrics/merge_traces.py" "$PPFL_TRACE_DIR" -o "$PPFL_TRACE_DIR/trace.json" \
+            || log "orchestrator" "trace" "Trace merge failed, raw files left in $PPFL_TRACE_DIR"
+    fi
+
     log "orchestrator" "Orchestration Completed"
     #echo "[orchestrator] === Orchestration Completed ==="
 }
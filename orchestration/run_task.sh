@@ -0,0 +1,24 @@
+#!/bin/bash
+# =====================================
+# Task runner for ppfl_dag: run one orchestration function in a fresh shell
+#   run_task.sh <function> [args...]
+# run.sh exports the oConfig settings the functions read (COMM_MODE, SERVER_*,
+# ROUNDS, ...); paths come from sourcing the function libraries as run.sh does.
+# =====================================
+
+set -e
+
+SCRIPT_DIR="$(cd "$(dirname "${BASH_SOURCE[0]}")" && pwd)"
+BASE_DIR="$SCRIPT_DIR/.."
+
+source "$SCRIPT_DIR/helper_fns.sh"
+source "$SCRIPT_DIR/server_fns.sh"
+source "$SCRIPT_DIR/client_fns.sh"
+source "$SCRIPT_DIR/comm_fns.sh"
+source "$SCRIPT_DIR/store_fns.sh"
+
+if [ $# -eq 0 ] || ! declare -F "$1" > /dev/null; then
+    echo "Usage: run_task.sh <orchestration function> [args...]" >&2
+    exit 2
+fi
+"$@"
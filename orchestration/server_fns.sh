@@ -15,9 +15,12 @@ GENCC_BIN="$SERVER_BUILD/genCC"
 RUNMSERVER_BIN="$SERVER_BUILD/runMserver"
 CHANGECIPHER_BIN="$SERVER_BUILD/changeCipherDomain"
 AGGREGATE_BIN="$SERVER_BUILD/aggregateEncryptedWeights"
+MPIAGGREGATE_BIN="$SERVER_BUILD/mpiAggregate"
 
 # Load server config values used by server actions (read at source time)
 cc_path=$(READJSON "$SERVER_CONFIG" '.CC.path')
+pub_c1=$(READJSON "$SERVER_CONFIG" '.CLIENTS.CLIENT_1_PUBLIC')
+pub_c2=$(READJSON "$SERVER_CONFIG" '.CLIENTS.CLIENT_2_PUBLIC')
 enc_c1=$(READJSON "$SERVER_CONFIG" '.CLIENTS.CLIENT_1_ENCRYPTED_WEIGHTS_PATH')
 rekey_c1=$(READJSON "$SERVER_CONFIG" '.CLIENTS.CLIENT_1_REKEY')
 reenc_c1_c2=$(READJSON "$SERVER_CONFIG" '.CLIENTS.OUTPUT_DOMAIN_CHANGED_PATH')
@@ -30,8 +33,14 @@ reenc_c2_c1=$(READJSON "$SERVER_CONFIG" '.CLIENTS.OUTPUT_AGGREGATED_DOMAIN_CHANG
 # Server actions
 # ----------------------------
 
-# s_genCC: create cryptocontext (CC.json) on server storage
+# s_genCC: create cryptocontext (CC.json) on server storage, unless the one
+# there was generated from the same config_cc.json by the same genCC
 s_genCC() {
+    local art=("genCC" "$SERVER_STORAGE_DIR/CC.json" -- "$BASE_DIR/server/config/config_cc.json" "$GENCC_BIN")
+    if artifact_fresh "${art[@]}"; then
+        log "server" "genCC" "CC.json up to date, skipping"
+        return 0
+    fi
     log "server" "Running genCC"
     #echo "[server] Running genCC..."
     "$GENCC_BIN"
@@ -39,6 +48,7 @@ s_genCC() {
         echo "[server] ERROR: genCC failed"
         exit 1
     }
+    artifact_record "${art[@]}"
 }
 
 # s_Mserver: start the mongoose server
@@ -51,6 +61,28 @@ s_Mserver() {
     sleep 2
 }
 
+# s_start_relays: start one runMserver per relay of the aggregation tree
+# (oConfig TREE_CONFIG -> tree.json from gen_tree_configs.py). Parents come
+# first so every relay can fetch CC.json from its upstream at startup.
+RELAY_PIDS=()
+s_start_relays() {
+    [ -n "$TREE_CONFIG" ] || return 0
+    local relay
+    while read -r relay; do
+        log "server" "Starting relay $relay"
+        "$RUNMSERVER_BIN" "$BASE_DIR/$relay" &
+        RELAY_PIDS+=($!)
+        sleep 0.2
+    done < <(jq -r '.RELAYS | reverse | .[]' "$BASE_DIR/$TREE_CONFIG")
+    sleep 1
+}
+
+s_stop_relays() {
+    [ ${#RELAY_PIDS[@]} -gt 0 ] || return 0
+    log "server" "Stopping ${#RELAY_PIDS[@]} relays"
+    kill "${RELAY_PIDS[@]}" 2>/dev/null || true
+}
+
 # o_stop_server: stop the started server (uses SERVER_PID)
 s_stop_Mserver() {
     log "server" "Stopping Mserver"
@@ -62,7 +94,7 @@ s_stop_Mserver() {
 s_changeCipherDomain_c1_c2() {
     log "server" "changeCipherDomain (C1->C2)..."
     #echo "[server] changeCipherDomain (C1->C2)..."
-    "$CHANGECIPHER_BIN" "$cc_path" "$rekey_c1" "$enc_c1" "$reenc_c1_c2"
+    "$CHANGECIPHER_BIN" "$cc_path" "$rekey_c1" "$enc_c1" "$reenc_c1_c2" "$pub_c1"
 }
 
 # s_aggregateEncryptedWeights: aggregate ciphertexts (server-side aggregator)
@@ -76,5 +108,86 @@ s_aggregateEncryptedWeights() {
 s_changeCipherDomain_c2_c1() {
     log "server" "changeCipherDomain (C2->C1)..."
     #echo "[server] changeCipherDomain (C2->C1)..."
-    "$CHANGECIPHER_BIN" "$cc_path" "$rekey_c2" "$aggrencfile" "$reenc_c2_c1"
+    "$CHANGECIPHER_BIN" "$cc_path" "$rekey_c2" "$aggrencfile" "$reenc_c2_c1" "$pub_c2"
+}
+
+# s_submit_job <url> <job json>: POST a runMserver job, print its id
+s_submit_job() {
+    local reply
+    reply=$(curl -s -H "Expect:" -X POST --data-binary "$2" "$1") || return 1
+    echo "$reply" | jq -er '.job_id' 2>/dev/null || { log "server" "error" "Job refused: $reply"; return 1; }
+}
+
+# s_jobs_round <round>: the same three steps as runMserver jobs (oConfig
+# SERVER_JOBS), submitted up front as a chain and run on the server's
+# work-stealing pool; waits for the last one
+s_jobs_round() {
+    local round=$1
+    local url="http://${SERVER_IP}:${SERVER_PORT}/jobs"
+    local timeout=${STREAM_TIMEOUT_S:-3600}
+    local start=$(date +%s)
+    local c1_c2 agg c2_c1 status state
+
+    c1_c2=$(s_submit_job "$url" "$(jq -nc --arg i "$enc_c1" --arg k "$rekey_c1" --arg s "$pub_c1" --arg o "$reenc_c1_c2" --argjson r "$round" \
+        '{type: "reencrypt", input: $i, rekey: $k, source: $s, output: $o, round: $r}')") || exit 1
+    agg=$(s_submit_job "$url" "$(jq -nc --arg a "$enc_c2" --arg b "$reenc_c1_c2" --arg o "$aggrencfile" --arg j "$c1_c2" --argjson r "$round" \
+        '{type: "aggregate", inputs: [$a, $b], output: $o, round: $r, after: [$j]}')") || exit 1
+    c2_c1=$(s_submit_job "$url" "$(jq -nc --arg i "$aggrencfile" --arg k "$rekey_c2" --arg s "$pub_c2" --arg o "$reenc_c2_c1" --arg j "$agg" --argjson r "$round" \
+        '{type: "reencrypt", input: $i, rekey: $k, source: $s, output: $o, round: $r, after: [$j]}')") || exit 1
+    log "server" "jobs" "Round $round: jobs $c1_c2 -> $agg -> $c2_c1"
+
+    while :; do
+        status=$(curl -s "$url/$c2_c1" || echo '{}')
+        state=$(echo "$status" | jq -r '.state // empty' 2>/dev/null)
+        [ "$state" = "done" ] && break
+        if [ "$state" = "failed" ]; then
+            log "server" "error" "Round $round jobs failed: $(echo "$status" | jq -r '.error')"
+            exit 1
+        fi
+        if [ $(( $(date +%s) - start )) -ge "$timeout" ]; then
+            log "server" "error" "Timed out waiting for round $round jobs ($status)"
+            exit 1
+        fi
+        sleep 0.2
+    done
+    log "server" "jobs" "Round $round jobs done in $(( $(date +%s) - start )) s"
+}
+
+# s_mpiAggregate <ranks>: C1->C2, aggregate and C2->C1 in one MPI job
+# (make mpiAggregate). MPI_HOSTFILE, if set, spreads ranks across nodes;
+# the storage paths must then be on a shared filesystem.
+s_mpiAggregate() {
+    local ranks=$1
+    local hostfile=()
+    [ -n "$MPI_HOSTFILE" ] && hostfile=(--hostfile "$MPI_HOSTFILE")
+    log "server" "mpiAggregate on $ranks ranks..."
+    mpirun -np "$ranks" "${hostfile[@]}" "$MPIAGGREGATE_BIN" \
+        "$cc_path" "$rekey_c1" "$rekey_c2" "$enc_c1" "$enc_c2" "$aggrencfile" "$reenc_c2_c1"
+}
+
+# s_wait_aggregate <round>: wait until runMserver's running aggregate for the round
+# has every contribution and the aggregate files are written (ROUND_MODE=STREAM/INCREMENTAL)
+s_wait_aggregate() {
+    local round=$1
+    local timeout=${STREAM_TIMEOUT_S:-3600}
+    local start=$(date +%s)
+    local status
+
+    log "server" "aggregate" "Waiting for round $round aggregate..."
+    while :; do
+        status=$(curl -s "http://${SERVER_IP}:${SERVER_PORT}/aggStatus" || echo '{}')
+        if [ -n "$(echo "$status" | jq -r '.error // empty')" ]; then
+            log "server" "error" "Aggregation for round $round failed: $(echo "$status" | jq -r '.error')"
+            exit 1
+        fi
+        if [ "$(echo "$status" | jq -r --argjson r "$round" '.round == $r and .complete')" = "true" ]; then
+            break
+        fi
+        if [ $(( $(date +%s) - start )) -ge "$timeout" ]; then
+            log "server" "error" "Timed out waiting for round $round aggregate ($status)"
+            exit 1
+        fi
+        sleep 0.2
+    done
+    log "server" "aggregate" "Round $round aggregated: $(echo "$status" | jq -c '{layers, contributor_count}')"
 }
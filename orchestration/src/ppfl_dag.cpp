@@ -0,0 +1,307 @@
+// orchestration/src/ppfl_dag.cpp
+// Round orchestrator that runs independent client and server steps concurrently
+//
+// Builds the init phase or one round as a dependency graph of per-client and
+// server steps and runs it on a bounded number of jobs (lib/taskGraph.h), so
+// client 1's training no longer waits for client 2's and client 2 decrypts
+// while the server is still re-encrypting for client 1. A round then takes
+// its critical path instead of the sum of every step.
+//
+// Every step is one orchestration function run by the task runner
+// (orchestration/run_task.sh <function> <args...>), so the shell functions
+// stay the single definition of what a step does; ppfl_dag only decides
+// what may run when. PPFL_TRACE_CLIENT / PPFL_TRACE_ROUND are set per step.
+//
+// Usage:
+//   ppfl_dag [options] <runner>
+//
+// Options:
+//   --phase init|round         key setup, or one training round (default round)
+//   --mode SEQUENTIAL|INCREMENTAL   round structure, as ROUND_MODE in run.sh
+//   --round R                  round number
+//   --clients 1,2              participating client ids (default 1,2)
+//   --jobs N                   steps run at once (default: hardware threads)
+//   --mpi-ranks N              SEQUENTIAL: server steps as one mpiAggregate job
+//   --timing FILE              append one row per step (CSV)
+//   --dry-run                  print the graph and exit
+
+#include <cerrno>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <fcntl.h>
+#include <spawn.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "taskGraph.h"
+#include "trace.h"
+
+extern char** environ;
+
+namespace {
+
+struct Options {
+    std::string phase = "round";
+    std::string mode = "SEQUENTIAL";
+    long round = -1;
+    std::vector<std::string> clients = {"1", "2"};
+    size_t jobs = 0;
+    long mpi_ranks = 0;
+    std::string timing;
+    bool dry_run = false;
+    std::string runner;
+};
+
+// One orchestration function call and the steps it waits for
+struct Step {
+    std::string name;
+    std::string client;             // "" = server / orchestrator step
+    std::vector<size_t> deps;
+    std::vector<std::string> argv;  // function and its arguments
+};
+
+class Plan {
+public:
+    size_t add(std::string name, std::string client, std::vector<size_t> deps, std::vector<std::string> argv) {
+        steps_.push_back({std::move(name), std::move(client), std::move(deps), std::move(argv)});
+        return steps_.size() - 1;
+    }
+    const std::vector<Step>& steps() const { return steps_; }
+
+private:
+    std::vector<Step> steps_;
+};
+
+// Key setup after genCC and the server start (run.sh main, up to s_start_relays)
+Plan initPlan(const Options& o) {
+    Plan p;
+    std::vector<size_t> pubkeys;
+    std::map<std::string, size_t> keygen;
+    for (const auto& c : o.clients) {
+        size_t cc = p.add("get_cc_" + c, c, {}, {"s_send_cc_to_c", c});
+        keygen[c] = p.add("keygen_" + c, c, {cc}, {"c_keyGen", c});
+        pubkeys.push_back(p.add("upload_pubkey_" + c, c, {keygen[c]}, {"c_send_pubkeys_to_s", c}));
+    }
+    // Re-keys need the peer's public key, so they wait for every upload
+    for (const auto& c : o.clients) {
+        size_t peer = p.add("fetch_peer_pubkey_" + c, c, pubkeys, {"s_send_pubkeys_to_c", c});
+        size_t rekey = p.add("rekeygen_" + c, c, {peer, keygen[c]}, {"c_RekeyGen", c});
+        p.add("upload_rekey_" + c, c, {rekey}, {"c_Rekeys_to_s", c});
+    }
+    return p;
+}
+
+// One round, as run_round / run_round_incremental in run.sh
+Plan roundPlan(const Options& o) {
+    Plan p;
+    const std::string r = std::to_string(o.round);
+    const bool incremental = o.mode == "INCREMENTAL";
+    std::map<std::string, size_t> upload;
+    std::vector<size_t> uploads;
+    for (const auto& c : o.clients) {
+        size_t train = p.add("train_" + c, c, {}, {"c_training", c});
+        size_t enc = p.add("encrypt_" + c, c, {train}, {"c_encryptWeights", c});
+        upload[c] = p.add("upload_" + c, c, {enc},
+                          incremental ? std::vector<std::string>{"c_send_encrypted_weights_round", c, r}
+                                      : std::vector<std::string>{"c_sends_encrypted_weights_to_s", c});
+        uploads.push_back(upload[c]);
+    }
+
+    // Step after which client c's aggregate can be fetched
+    std::map<std::string, size_t> result;
+    if (incremental) {
+        size_t wait = p.add("wait_aggregate", "", uploads, {"s_wait_aggregate", r});
+        for (const auto& c : o.clients) result[c] = wait;
+    } else if (o.mpi_ranks > 0) {
+        size_t agg = p.add("aggregate", "", uploads, {"s_mpiAggregate", std::to_string(o.mpi_ranks)});
+        for (const auto& c : o.clients) result[c] = agg;
+    } else {
+        // C1 -> C2 only needs client 1's upload; client 2 gets the aggregate
+        // as is, so it can download and decrypt while C2 -> C1 runs
+        size_t c1c2 = p.add("recrypt_c1_c2", "", {upload.at("1")}, {"s_changeCipherDomain_c1_c2"});
+        size_t agg = p.add("aggregate", "", {c1c2, upload.at("2")}, {"s_aggregateEncryptedWeights"});
+        size_t c2c1 = p.add("recrypt_c2_c1", "", {agg}, {"s_changeCipherDomain_c2_c1"});
+        result["1"] = c2c1;
+        result["2"] = agg;
+    }
+    for (const auto& c : o.clients) {
+        size_t dl = p.add("download_" + c, c, {result.at(c)}, {"s_send_aggregated_to_c", c});
+        p.add("decrypt_" + c, c, {dl}, {"c_decryptWeights", r, c});
+    }
+    return p;
+}
+
+// Run the step through the task runner; true on exit status 0
+bool runStep(const Options& o, const Step& s) {
+    ppfl::trace::Span span(s.name, {o.round, s.client});
+
+    std::vector<std::string> env;
+    for (char** e = environ; *e; e++) {
+        std::string kv = *e;
+        if (kv.compare(0, 18, "PPFL_TRACE_CLIENT=") == 0 || kv.compare(0, 17, "PPFL_TRACE_ROUND=") == 0) continue;
+        env.push_back(kv);
+    }
+    if (!s.client.empty()) env.push_back("PPFL_TRACE_CLIENT=" + s.client);
+    if (o.round >= 0) env.push_back("PPFL_TRACE_ROUND=" + std::to_string(o.round));
+
+    std::vector<std::string> args = {o.runner};
+    args.insert(args.end(), s.argv.begin(), s.argv.end());
+    std::vector<char*> argv, envp;
+    for (auto& a : args) argv.push_back(&a[0]);
+    for (auto& e : env) envp.push_back(&e[0]);
+    argv.push_back(nullptr);
+    envp.push_back(nullptr);
+
+    pid_t pid;
+    int rc = posix_spawn(&pid, o.runner.c_str(), nullptr, nullptr, argv.data(), envp.data());
+    if (rc != 0) {
+        std::cerr << "[ppfl_dag] ERROR: cannot start " << o.runner << " for " << s.name << std::endl;
+        return false;
+    }
+    int status = 0;
+    while (waitpid(pid, &status, 0) < 0 && errno == EINTR) {
+    }
+    if (WIFEXITED(status) && WEXITSTATUS(status) == 0) return true;
+    std::cerr << "[ppfl_dag] ERROR: " << s.name << " failed ("
+              << (WIFEXITED(status) ? "exit " + std::to_string(WEXITSTATUS(status))
+                                    : "signal " + std::to_string(WTERMSIG(status)))
+              << ")" << std::endl;
+    return false;
+}
+
+std::string join(const std::vector<std::string>& v, const char* sep) {
+    std::string out;
+    for (const auto& s : v) out += (out.empty() ? "" : sep) + s;
+    return out;
+}
+
+// One row per step; header written when the file is new
+void appendTiming(const Options& o, const Plan& p, const TaskGraph& g) {
+    if (o.timing.empty()) return;
+    std::vector<bool> critical(g.tasks().size(), false);
+    for (size_t i : g.criticalPath()) critical[i] = true;
+
+    std::ostringstream rows;
+    for (size_t i = 0; i < g.tasks().size(); i++) {
+        const auto& t = g.tasks()[i];
+        std::vector<std::string> deps;
+        for (size_t d : t.deps) deps.push_back(g.tasks()[d].name);
+        rows << o.phase << "," << o.round << "," << t.name << "," << p.steps()[i].client << "," << join(deps, ";")
+             << "," << t.start_us / 1000.0 << "," << t.durationUs() / 1000.0 << "," << TaskGraph::StateName(t.state)
+             << "," << (critical[i] ? 1 : 0) << "\n";
+    }
+    int fd = ::open(o.timing.c_str(), O_WRONLY | O_APPEND | O_CREAT, 0644);
+    if (fd < 0) {
+        std::cerr << "[ppfl_dag] cannot write " << o.timing << std::endl;
+        return;
+    }
+    struct stat st;
+    std::string out = rows.str();
+    if (::fstat(fd, &st) == 0 && st.st_size == 0) {
+        out = "phase,round,task,client,deps,start_ms,duration_ms,status,critical\n" + out;
+    }
+    ssize_t n = ::write(fd, out.data(), out.size());
+    (void) n;
+    ::close(fd);
+}
+
+bool parseArgs(int argc, char** argv, Options& o) {
+    for (int i = 1; i < argc; i++) {
+        std::string a = argv[i];
+        auto next = [&]() -> std::string {
+            if (i + 1 >= argc) throw std::runtime_error("missing value for " + a);
+            return argv[++i];
+        };
+        if (a == "--phase") o.phase = next();
+        else if (a == "--mode") o.mode = next();
+        else if (a == "--round") o.round = std::stol(next());
+        else if (a == "--jobs") o.jobs = std::stoul(next());
+        else if (a == "--mpi-ranks") o.mpi_ranks = std::stol(next());
+        else if (a == "--timing") o.timing = next();
+        else if (a == "--dry-run") o.dry_run = true;
+        else if (a == "--clients") {
+            o.clients.clear();
+            std::istringstream ss(next());
+            for (std::string c; std::getline(ss, c, ',');) {
+                if (!c.empty()) o.clients.push_back(c);
+            }
+        } else if (a.compare(0, 2, "--") == 0) {
+            std::cerr << "[ppfl_dag] unknown option " << a << "\n";
+            return false;
+        } else if (o.runner.empty()) {
+            o.runner = a;
+        } else {
+            std::cerr << "[ppfl_dag] unexpected argument " << a << "\n";
+            return false;
+        }
+    }
+    if (o.runner.empty() || (o.phase != "init" && o.phase != "round") || o.clients.empty()) {
+        std::cerr << "Usage: ppfl_dag [--phase init|round] [--mode SEQUENTIAL|INCREMENTAL] [--round R]\n"
+                     "                [--clients 1,2] [--jobs N] [--mpi-ranks N] [--timing FILE] [--dry-run] <runner>\n";
+        return false;
+    }
+    if (o.mode != "SEQUENTIAL" && o.mode != "INCREMENTAL") {
+        std::cerr << "[ppfl_dag] --mode must be SEQUENTIAL or INCREMENTAL\n";
+        return false;
+    }
+    if (o.phase == "round" && o.mode == "SEQUENTIAL" && o.mpi_ranks == 0 && o.clients != std::vector<std::string>{"1", "2"}) {
+        // The proxy re-encryption chain (C1 -> C2, aggregate, C2 -> C1) is pairwise
+        std::cerr << "[ppfl_dag] SEQUENTIAL rounds pair clients 1 and 2; use INCREMENTAL for other client sets\n";
+        return false;
+    }
+    if (o.jobs == 0) o.jobs = std::max(1u, std::thread::hardware_concurrency());
+    return true;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    Options opt;
+    try {
+        if (!parseArgs(argc, argv, opt)) return 1;
+    } catch (const std::exception& e) {
+        std::cerr << "[ppfl_dag] " << e.what() << "\n";
+        return 1;
+    }
+
+    Plan plan = opt.phase == "init" ? initPlan(opt) : roundPlan(opt);
+    TaskGraph graph;
+    for (const auto& s : plan.steps()) {
+        graph.add(s.name, s.deps, [&opt, &s] { return runStep(opt, s); });
+    }
+
+    if (opt.dry_run) {
+        for (const auto& s : plan.steps()) {
+            std::vector<std::string> deps;
+            for (size_t d : s.deps) deps.push_back(plan.steps()[d].name);
+            std::cout << s.name << " <- [" << join(deps, ", ") << "]: " << join(s.argv, " ") << "\n";
+        }
+        return 0;
+    }
+
+    bool ok = graph.run(opt.jobs);
+    appendTiming(opt, plan, graph);
+
+    std::vector<std::string> path;
+    int64_t path_us = 0;
+    for (size_t i : graph.criticalPath()) {
+        path.push_back(graph.tasks()[i].name);
+        path_us += graph.tasks()[i].durationUs();
+    }
+    std::cout << "[ppfl_dag] " << opt.phase << (opt.round >= 0 ? " " + std::to_string(opt.round) : "") << ": "
+              << graph.tasks().size() << " steps on " << opt.jobs << " jobs in " << graph.wallUs() / 1e6
+              << " s (steps total " << graph.workUs() / 1e6 << " s, critical path " << path_us / 1e6
+              << " s: " << join(path, " > ") << ")" << std::endl;
+    if (!ok) {
+        size_t skipped = 0;
+        for (const auto& t : graph.tasks()) skipped += t.state == TaskGraph::State::Skipped;
+        std::cerr << "[ppfl_dag] ERROR: " << opt.phase << " failed, " << skipped << " steps not run" << std::endl;
+    }
+    return ok ? 0 : 1;
+}
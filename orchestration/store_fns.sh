@@ -0,0 +1,132 @@
+#!/bin/bash
+# ==========================
+# Round Store, round-versioned copies of each round's artifacts
+# ==========================
+# Every round overwrites the same working files (encrypted_weights_c1.json,
+# aggregated_weights.json, ...). After each round the orchestrator snapshots
+# them into a store under server storage and under each client's storage:
+#
+#   <storage>/rounds/objects/<sha256>       read-only, one per distinct content
+#   <storage>/rounds/round_<N>/<name>       hardlink to its object
+#   <storage>/rounds/latest -> round_<N>    most recently published round
+#   <storage>/rounds/index.json             {"latest": N, "seq": S,
+#                                            "rounds": {"N": {"seq": S, "files": {name: sha256}}}}
+#
+# Round directories are immutable once published (written under a temp name,
+# then renamed), and identical artifacts in different rounds share one object.
+# The working file is copied into its object (cp --reflink where the filesystem
+# allows it) rather than linked, because the binaries truncate and rewrite their
+# outputs in place. Paths under rounds/latest/ can be passed to the existing
+# binaries as they are, and runMserver serves them at /download/rounds/...
+#
+# Retention (oConfig ROUND_KEEP_LAST, ROUND_KEEP_EVERY) is applied by
+# store_compact in the background: it drops rounds that are neither among the
+# KEEP_LAST most recently published (by "seq", so a rerun starting again at
+# round 1 is not compacted away by an older run's higher rounds) nor a multiple
+# of KEEP_EVERY, then deletes objects no round links to any more.
+# KEEP_LAST=0 keeps every round.
+
+ROUND_STORE=${ROUND_STORE-true}
+ROUND_KEEP_LAST=${ROUND_KEEP_LAST-0}
+ROUND_KEEP_EVERY=${ROUND_KEEP_EVERY-0}
+STORE_COMPACT_PIDS=()
+
+# store_put <store dir> <round> <files...>: publish the files that exist as round <round>
+store_put() {
+    local store=$1 round=$2
+    shift 2
+    local dir="$store/round_$round" tmp="$store/.round_$round.$BASHPID" f sha obj
+    local pairs=()
+    mkdir -p "$store/objects"
+    (
+        flock 9
+        rm -rf "$tmp"
+        mkdir -p "$tmp"
+        for f in "$@"; do
+            [ -f "$f" ] || continue
+            sha=$(sha256sum "$f" | cut -d' ' -f1)
+            obj="$store/objects/$sha"
+            if [ ! -f "$obj" ]; then
+                cp --reflink=auto "$f" "$obj.tmp.$BASHPID" && chmod a-w "$obj.tmp.$BASHPID" \
+                    && mv -f "$obj.tmp.$BASHPID" "$obj" || return 1
+            fi
+            ln -f "$obj" "$tmp/${f##*/}"
+            pairs+=("${f##*/}" "$sha")
+        done
+
+        # Replacing a round (a rerun) swaps the whole directory
+        rm -rf "$dir"
+        mv "$tmp" "$dir"
+        { [ -s "$store/index.json" ] && cat "$store/index.json" || echo '{"seq": 0, "rounds": {}}'; } \
+            | jq --arg r "$round" '$ARGS.positional as $p
+                | .seq += 1 | .latest = ($r | tonumber)
+                | .rounds[$r] = {seq: .seq, files: ([range(0; $p | length; 2) as $i | {($p[$i]): $p[$i + 1]}] | add // {})}' \
+                --args "${pairs[@]}" > "$store/index.json.tmp" \
+            && mv -f "$store/index.json.tmp" "$store/index.json"
+        ln -sfn "round_$round" "$store/latest.tmp" && mv -T "$store/latest.tmp" "$store/latest"
+    ) 9> "$store/.lock"
+}
+
+# store_compact <store dir>: apply the retention policy and drop unreferenced objects
+store_compact() {
+    local store=$1
+    [ -s "$store/index.json" ] || return 0
+    (
+        flock 9
+        local drop r
+        drop=$(jq -r --argjson last "$ROUND_KEEP_LAST" --argjson every "$ROUND_KEEP_EVERY" '
+            [.rounds | to_entries[] | {round: (.key | tonumber), seq: .value.seq}] | sort_by(.seq) as $all
+            | if $last <= 0 then empty else
+                $all[:-$last][].round | select($every <= 0 or . % $every != 0) end' "$store/index.json")
+        [ -n "$drop" ] || return 0
+        for r in $drop; do
+            rm -rf "$store/round_$r"
+        done
+        jq '.rounds |= with_entries(select(.key as $k | $ARGS.positional | index($k) | not))' \
+            --args $drop < "$store/index.json" > "$store/index.json.tmp" && mv -f "$store/index.json.tmp" "$store/index.json"
+        # An object still in some round has a second link
+        find "$store/objects" -type f -links 1 -delete
+        log "store" "compact" "Dropped round(s) $(echo $drop) from $store"
+    ) 9> "$store/.lock"
+}
+
+# store_latest <store dir> <name>: path of <name> in the most recently published round
+store_latest() {
+    echo "$1/latest/$2"
+}
+
+# store_path <store dir> <round> <name>: path of <name> in round <round>
+store_path() {
+    echo "$1/round_$2/$3"
+}
+
+# store_round <round>: snapshot the round's server and client artifacts, then
+# compact every store in the background
+store_round() {
+    [ "$ROUND_STORE" = "true" ] || return 0
+    local round=$1 i cfg stores=("$SERVER_STORAGE_DIR/rounds")
+    store_put "$SERVER_STORAGE_DIR/rounds" "$round" \
+        "$enc_c1" "$enc_c2" "$reenc_c1_c2" "$aggrencfile" "$reenc_c2_c1"
+    for i in 1 2; do
+        cfg="$BASE_DIR/client/config/client_$i/c_config.json"
+        stores+=("$BASE_DIR/client/storage/client_$i/rounds")
+        store_put "$BASE_DIR/client/storage/client_$i/rounds" "$round" \
+            "$(READJSON "$cfg" '.CLIENT.OUTPUT_ENCRYPTED_WEIGHTS_PATH')" \
+            "$(READJSON "$cfg" '.CLIENT.AGGREGATED_ENCRYPTED_WEIGHTS_PATH')" \
+            "$(READJSON "$cfg" '.CLIENT.OUTPUT_DECRYPTED_WEIGHTS_PATH')"
+    done
+    log "store" "round" "Round $round stored"
+
+    local s
+    for s in "${stores[@]}"; do
+        store_compact "$s" &
+        STORE_COMPACT_PIDS+=($!)
+    done
+}
+
+# store_wait: let background compactions finish
+store_wait() {
+    local pid
+    for pid in "${STORE_COMPACT_PIDS[@]}"; do wait "$pid" 2>/dev/null || true; done
+    STORE_COMPACT_PIDS=()
+}
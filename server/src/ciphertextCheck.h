@@ -0,0 +1,132 @@
+// server/src/ciphertextCheck.h
+// Upload-time check of encrypted weights against CC.json and the client keys
+//
+// Every encrypted layer starts with its "ct_header" (ppfl.h), and JSON keys
+// are written sorted, so a single layer's header is within its first few
+// hundred bytes. check() looks only at that prefix of a streamed layer;
+// checkModel() runs ppfl::ValidateModel, headers required, over every layer
+// of a whole document (on the disk thread that stored it). Either way a client that
+// encrypted under a stale CC.json or another client's key is rejected before
+// its upload is aggregated, without any polynomial being decoded. A layer
+// without a header is rejected too.
+//
+// The expected parameters come from CC.json and the key tag from the public
+// key of the domain the route belongs to; both are reloaded when their file
+// changes (mtime and size), so a new CC.json or re-uploaded key takes effect
+// on the next upload.
+//
+// Thread-safe: called from the event loop and the disk threads.
+
+#ifndef PPFL_CIPHERTEXT_CHECK_H
+#define PPFL_CIPHERTEXT_CHECK_H
+
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <map>
+#include <mutex>
+#include <string>
+
+#include "ppfl/ppfl.h"
+
+class CiphertextCheck {
+public:
+    // Bytes searched for the first header
+    static constexpr size_t kPrefixBytes = 64 * 1024;
+
+    explicit CiphertextCheck(std::string cc_path) : cc_path_(std::move(cc_path)) {}
+
+    // Check the ct_header of the single layer text[0, len). key_path is the
+    // public key whose domain the ciphertexts must be in ("" = any). False
+    // with `err` set if there is no header or it does not fit.
+    bool check(const char *text, size_t len, const std::string &key_path, std::string &err) {
+        std::string header;
+        if (!findHeader(text, std::min(len, kPrefixBytes), header)) {
+            err = "no ct_header";
+            return false;
+        }
+        try {
+            ppfl::CiphertextHeader h = ppfl::HeaderFromJson(ppfl::json::parse(header));
+            ppfl::CiphertextHeader spec = context()->Spec();
+            spec.keyTag = keyTag(key_path);
+            ppfl::CheckHeader(spec, h);
+        } catch (const std::exception &e) {
+            err = e.what();
+            return false;
+        }
+        return true;
+    }
+
+    // Check every layer of a whole encrypted document, as check() does one
+    bool checkModel(const ppfl::json &doc, const std::string &key_path, std::string &err) {
+        try {
+            ppfl::ValidateModel(*context(), doc, keyTag(key_path), true);
+        } catch (const std::exception &e) {
+            err = e.what();
+            return false;
+        }
+        return true;
+    }
+
+private:
+    struct Stamp {
+        std::filesystem::file_time_type mtime;
+        uintmax_t size = 0;
+        bool operator==(const Stamp &o) const { return mtime == o.mtime && size == o.size; }
+    };
+
+    static bool stampOf(const std::string &path, Stamp &s) {
+        std::error_code ec;
+        s.mtime = std::filesystem::last_write_time(path, ec);
+        if (!ec) s.size = std::filesystem::file_size(path, ec);
+        return !ec;
+    }
+
+    // The flat object after the first "ct_header" key
+    static bool findHeader(const char *text, size_t len, std::string &out) {
+        static const char kKey[] = "\"ct_header\"";
+        const char *end = text + len;
+        const char *at = std::search(text, end, kKey, kKey + sizeof(kKey) - 1);
+        if (at == end) return false;
+        const char *open = std::find(at, end, '{');
+        const char *close = std::find(open, end, '}');
+        if (open == end || close == end) return false;
+        out.assign(open, close + 1);
+        return true;
+    }
+
+    // CC.json's context, reloaded if the file changed
+    std::shared_ptr<const ppfl::Context> context() {
+        std::lock_guard<std::mutex> lk(m_);
+        Stamp cc;
+        if (!stampOf(cc_path_, cc)) throw ppfl::Error("no CryptoContext at " + cc_path_);
+        if (!(cc == cc_stamp_) || !ctx_) {
+            ctx_ = ppfl::Context::LoadFile(cc_path_);
+            cc_stamp_ = cc;
+        }
+        return ctx_;
+    }
+
+    // Key tag of key_path, reloaded if the file changed. A key not uploaded
+    // yet ("" too) leaves the tag unchecked.
+    std::string keyTag(const std::string &key_path) {
+        std::lock_guard<std::mutex> lk(m_);
+        Stamp key;
+        if (key_path.empty() || !stampOf(key_path, key)) return "";
+
+        auto it = key_tags_.find(key_path);
+        if (it == key_tags_.end() || !(it->second.first == key)) {
+            std::string tag = ppfl::LoadPublicKeyFile(key_path)->GetKeyTag();
+            it = key_tags_.insert_or_assign(key_path, std::make_pair(key, tag)).first;
+        }
+        return it->second.second;
+    }
+
+    std::string cc_path_;
+    std::mutex m_;
+    Stamp cc_stamp_;
+    std::shared_ptr<const ppfl::Context> ctx_;
+    std::map<std::string, std::pair<Stamp, std::string>> key_tags_;  // public key path -> (stamp, key tag)
+};
+
+#endif  // PPFL_CIPHERTEXT_CHECK_H
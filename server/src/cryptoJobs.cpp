@@ -0,0 +1,369 @@
+// server/src/cryptoJobs.cpp
+#include "cryptoJobs.h"
+
+#include <algorithm>
+#include <filesystem>
+#include <iostream>
+
+#include "serverMetrics.h"
+#include "trace.h"
+
+namespace fs = std::filesystem;
+
+static const char* stateName(int s) {
+    static const char* kNames[] = {"waiting", "queued", "running", "done", "failed"};
+    return kNames[s];
+}
+
+static const char* priorityName(StealingPool::Priority p) {
+    static const char* kNames[] = {"critical", "round", "background"};
+    return kNames[p];
+}
+
+static long msBetween(std::chrono::steady_clock::time_point from, std::chrono::steady_clock::time_point to) {
+    return (long) std::chrono::duration_cast<std::chrono::milliseconds>(to - from).count();
+}
+
+JobManager::JobManager(std::string cc_path, const std::string& storage_root, StealingPool& pool)
+    : ccPath_(std::move(cc_path)), root_(fs::weakly_canonical(fs::absolute(storage_root)).string()), pool_(pool) {}
+
+std::string JobManager::resolve(const std::string& path) const {
+    if (path.empty()) return "";
+    fs::path p = fs::weakly_canonical(fs::absolute(path));
+    fs::path rel = p.lexically_relative(root_);
+    if (rel.empty() || *rel.begin() == "..") return "";
+    return p.string();
+}
+
+std::shared_ptr<JobManager::Job> JobManager::find(const std::string& id) const {
+    if (id.empty() || id.size() > 19 || !std::all_of(id.begin(), id.end(), ::isdigit)) return nullptr;
+    auto it = jobs_.find(std::stoull(id));
+    return it == jobs_.end() ? nullptr : it->second;
+}
+
+std::string JobManager::submit(const ppfl::json& spec, std::string& err) {
+    auto job = std::make_shared<Job>();
+    if (!spec.is_object()) {
+        err = "expected a JSON object";
+        return "";
+    }
+    // json::value throws on a field of the wrong type; check them all first
+    for (const char* k : {"type", "input", "rekey", "source", "output"}) {
+        if (spec.contains(k) && !spec[k].is_string()) {
+            err = std::string(k) + " must be a string";
+            return "";
+        }
+    }
+    for (const char* k : {"inputs", "after"}) {
+        if (spec.contains(k) && !spec[k].is_array()) {
+            err = std::string(k) + " must be an array";
+            return "";
+        }
+    }
+    if (spec.contains("round") && !spec["round"].is_number_integer()) {
+        err = "round must be an integer";
+        return "";
+    }
+    job->type = spec.value("type", std::string());
+    job->round = spec.value("round", -1L);
+    std::vector<std::string> inputs;
+    if (job->type == "reencrypt") {
+        inputs.push_back(spec.value("input", std::string()));
+        job->rekeyPath = resolve(spec.value("rekey", std::string()));
+        if (job->rekeyPath.empty()) {
+            err = "reencrypt needs a rekey under " + root_;
+            return "";
+        }
+        if (spec.contains("source") && (job->sourcePath = resolve(spec["source"].get<std::string>())).empty()) {
+            err = "source must be a public key under " + root_;
+            return "";
+        }
+    } else if (job->type == "aggregate") {
+        for (const auto& in : spec.value("inputs", ppfl::json::array())) {
+            if (!in.is_string()) {
+                err = "inputs must be paths";
+                return "";
+            }
+            inputs.push_back(in.get<std::string>());
+        }
+        if (inputs.empty()) {
+            err = "aggregate needs inputs";
+            return "";
+        }
+    } else {
+        err = "type must be reencrypt or aggregate";
+        return "";
+    }
+    for (const auto& in : inputs) {
+        job->inputPaths.push_back(resolve(in));
+        if (job->inputPaths.back().empty()) {
+            err = "input " + in + " is not under " + root_;
+            return "";
+        }
+    }
+    job->outputPath = resolve(spec.value("output", std::string()));
+    if (job->outputPath.empty()) {
+        err = "output must be a path under " + root_;
+        return "";
+    }
+
+    std::lock_guard<std::mutex> lk(m_);
+    std::vector<std::shared_ptr<Job>> deps;
+    for (const auto& id : spec.value("after", ppfl::json::array())) {
+        auto dep = id.is_string() ? find(id.get<std::string>()) : nullptr;
+        if (!dep) {
+            err = "unknown job in after: " + id.dump();
+            return "";
+        }
+        deps.push_back(dep);
+        job->after.push_back(dep->id);
+    }
+    job->seq = ++seq_;
+    job->id = std::to_string(job->seq);
+    job->submitted = Clock::now();
+    jobs_[job->seq] = job;
+
+    std::cout << "[SERVER] [jobs] Job " << job->id << " (" << job->type
+              << (job->round >= 0 ? ", round " + std::to_string(job->round) : std::string()) << ") -> "
+              << job->outputPath << std::endl;
+
+    std::string failedDep;
+    for (const auto& dep : deps) {
+        if (dep->state == State::kFailed) {
+            failedDep = dep->id;
+        } else if (dep->state != State::kDone) {
+            dep->dependents.push_back(job);
+            job->waitingFor++;
+        }
+    }
+    if (!failedDep.empty()) {
+        settle(job, "job " + failedDep + " failed");
+    } else if (job->waitingFor == 0) {
+        start(job);
+    }
+    return job->id;
+}
+
+StealingPool::Priority JobManager::priorityOf(const Job& job) const {
+    long current = -1;
+    for (const auto& kv : jobs_) {
+        const Job& j = *kv.second;
+        if (j.round < 0 || j.state == State::kDone || j.state == State::kFailed) continue;
+        if (current < 0 || j.round < current) current = j.round;
+    }
+    if (job.round < 0 || job.round != current) return StealingPool::kBackground;
+    return job.dependents.empty() ? StealingPool::kRound : StealingPool::kCritical;
+}
+
+void JobManager::start(const std::shared_ptr<Job>& job) {
+    job->state = State::kQueued;
+    job->priority = priorityOf(*job);
+    pool_.submit([this, job] { prepare(job); }, job->priority);
+}
+
+std::shared_ptr<const ppfl::Context> JobManager::context() {
+    std::error_code ec;
+    auto mtime = fs::last_write_time(ccPath_, ec);
+    uintmax_t size = ec ? 0 : fs::file_size(ccPath_, ec);
+    if (ec) throw ppfl::Error("no CryptoContext at " + ccPath_);
+    std::string stamp = std::to_string(mtime.time_since_epoch().count()) + ":" + std::to_string(size);
+
+    std::lock_guard<std::mutex> lk(ctxM_);
+    if (!ctx_ || stamp != ctxStamp_) {
+        ctx_ = ppfl::Context::LoadFile(ccPath_);
+        ctxStamp_ = stamp;
+    }
+    return ctx_;
+}
+
+// Load and validate the inputs, lay out the output document and fan out one
+// task per output ciphertext
+void JobManager::prepare(const std::shared_ptr<Job>& job) {
+    ppfl::trace::Span span("job.prepare", {job->round});
+    {
+        std::lock_guard<std::mutex> lk(m_);
+        job->state = State::kRunning;
+        job->started = Clock::now();
+    }
+    try {
+        job->ctx = context();
+        for (const auto& path : job->inputPaths) job->inputs.push_back(ppfl::ReadJsonFile(path));
+
+        std::vector<std::vector<const ppfl::json*>> layers;
+        if (job->type == "reencrypt") {
+            job->rekey = ppfl::LoadEvalKeyFile(job->rekeyPath);
+            std::string keyTag = ppfl::ValidateModel(*job->ctx, job->inputs[0]);
+            if (!job->sourcePath.empty()) {
+                std::string sourceTag = ppfl::LoadPublicKeyFile(job->sourcePath)->GetKeyTag();
+                if (keyTag != sourceTag) {
+                    throw ppfl::Error(job->inputPaths[0] + " is under key " + keyTag + ", the rekey re-encrypts from " +
+                                      sourceTag);
+                }
+            }
+            for (const auto& layer : job->inputs[0].at("weights_summary")) layers.push_back({&layer});
+        } else {
+            // All inputs in the first one's key domain, as aggregateEncryptedWeights checks
+            std::string keyTag;
+            for (size_t i = 0; i < job->inputs.size(); i++) {
+                try {
+                    std::string tag = ppfl::ValidateModel(*job->ctx, job->inputs[i], keyTag);
+                    if (i == 0) keyTag = tag;
+                } catch (const ppfl::Error& e) {
+                    throw ppfl::Error(job->inputPaths[i] + ": " + e.what());
+                }
+            }
+            std::vector<const ppfl::json*> docs;
+            for (const auto& doc : job->inputs) docs.push_back(&doc);
+            layers = ppfl::MatchLayers(docs);
+        }
+
+        // Output layers are laid out in full before any task runs; the tasks
+        // only assign their own ciphertext strings
+        auto& out = job->output["weights_summary"] = ppfl::json::array();
+        for (const auto& in : layers) {
+            size_t values = in[0]->at("values").size();
+            for (const auto* l : in) values = std::min(values, l->at("values").size());
+            out.push_back({{"layer", in[0]->at("layer")}, {"shape", in[0]->at("shape")}, {"mean", ""},
+                           {"std_dev", ""}, {"values", std::vector<std::string>(values)}});
+        }
+        for (size_t k = 0; k < layers.size(); k++) {
+            auto add = [&](ppfl::json& target, auto source) {
+                Slot slot{&target, {}};
+                for (const auto* l : layers[k]) slot.sources.push_back(&source(*l).template get_ref<const std::string&>());
+                job->slots.push_back(std::move(slot));
+            };
+            ppfl::json& o = out[k];
+            add(o["mean"], [](const ppfl::json& l) -> const ppfl::json& { return l.at("mean"); });
+            add(o["std_dev"], [](const ppfl::json& l) -> const ppfl::json& { return l.at("std_dev"); });
+            for (size_t j = 0; j < o["values"].size(); j++) {
+                add(o["values"][j], [j](const ppfl::json& l) -> const ppfl::json& { return l.at("values")[j]; });
+            }
+        }
+    } catch (const std::exception& e) {
+        finish(job, e.what());
+        return;
+    }
+    if (job->slots.empty()) {
+        finish(job, "");
+        return;
+    }
+
+    StealingPool::Priority priority;
+    {
+        std::lock_guard<std::mutex> lk(m_);
+        job->tasks = job->slots.size();
+        priority = job->priority = priorityOf(*job);
+    }
+    for (size_t i = 0; i < job->slots.size(); i++) pool_.submit([this, job, i] { compute(job, i); }, priority);
+}
+
+void JobManager::compute(const std::shared_ptr<Job>& job, size_t slot) {
+    if (!job->failed.load(std::memory_order_relaxed)) {
+        const Slot& s = job->slots[slot];
+        try {
+            *s.target = job->type == "reencrypt" ? ppfl::ReEncryptCiphertext(*job->ctx, job->rekey, *s.sources[0])
+                                                 : ppfl::AverageCiphertexts(*job->ctx, s.sources);
+        } catch (const std::exception& e) {
+            if (!job->failed.exchange(true)) job->taskError = e.what();
+        }
+    }
+    // The last task to finish settles the job, so none still reads the inputs
+    if (job->tasksDone.fetch_add(1, std::memory_order_acq_rel) + 1 == job->slots.size()) {
+        finish(job, job->failed.load() ? job->taskError : "");
+    }
+}
+
+// Write the output (unless `error`), then settle the job
+void JobManager::finish(const std::shared_ptr<Job>& job, const std::string& error) {
+    std::string err = error;
+    if (err.empty()) {
+        try {
+            for (auto& layer : job->output["weights_summary"]) {
+                layer["ct_header"] = ppfl::HeaderToJson(ppfl::LayerHeader(layer));
+            }
+            std::string text = ppfl::SerializeJson(job->output);
+            int64_t t0 = metrics::NowUs();
+            ppfl::WriteTextFile(job->outputPath, text);
+            metrics::AddDiskWrite(text.size(), metrics::NowUs() - t0);
+        } catch (const std::exception& e) {
+            err = e.what();
+        }
+    }
+    // The inputs and the laid-out output are no longer needed
+    job->slots.clear();
+    job->output = nullptr;
+    job->inputs.clear();
+
+    std::lock_guard<std::mutex> lk(m_);
+    settle(job, err);
+}
+
+void JobManager::settle(const std::shared_ptr<Job>& job, const std::string& error) {
+    job->state = error.empty() ? State::kDone : State::kFailed;
+    job->error = error;
+    job->finished = Clock::now();
+    if (job->started == Clock::time_point()) job->started = job->finished;
+    if (error.empty()) {
+        std::cout << "[SERVER] [jobs] Job " << job->id << " done in " << msBetween(job->started, job->finished)
+                  << " ms" << std::endl;
+    } else {
+        std::cerr << "[SERVER] [jobs] Job " << job->id << " failed: " << error << std::endl;
+    }
+
+    auto dependents = std::move(job->dependents);
+    job->dependents.clear();
+    for (const auto& dep : dependents) {
+        if (dep->state != State::kWaiting) continue;
+        if (!error.empty()) {
+            settle(dep, "job " + job->id + " failed");
+        } else if (--dep->waitingFor == 0) {
+            start(dep);
+        }
+    }
+
+    finished_.push_back(job->seq);
+    while (finished_.size() > kKeepFinished) {
+        jobs_.erase(finished_.front());
+        finished_.pop_front();
+    }
+}
+
+ppfl::json JobManager::describe(const Job& job) const {
+    size_t done = job.tasksDone.load(std::memory_order_relaxed);
+    bool finished = job.state == State::kDone || job.state == State::kFailed;
+    auto now = Clock::now();
+    bool begun = job.state != State::kWaiting && job.state != State::kQueued;
+    return {{"id", job.id},
+            {"type", job.type},
+            {"round", job.round},
+            {"after", job.after},
+            {"output", job.outputPath},
+            {"state", stateName((int) job.state)},
+            {"priority", priorityName(job.priority)},
+            {"tasks", job.tasks},
+            {"tasks_done", done},
+            {"progress", job.state == State::kDone ? 1.0 : job.tasks ? (double) done / (double) job.tasks : 0.0},
+            {"error", job.error},
+            {"wait_ms", msBetween(job.submitted, begun ? job.started : now)},
+            {"run_ms", begun ? msBetween(job.started, finished ? job.finished : now) : 0}};
+}
+
+ppfl::json JobManager::status(const std::string& id) const {
+    std::lock_guard<std::mutex> lk(m_);
+    auto job = find(id);
+    return job ? describe(*job) : ppfl::json();
+}
+
+ppfl::json JobManager::list() const {
+    std::lock_guard<std::mutex> lk(m_);
+    ppfl::json out = ppfl::json::array();
+    for (const auto& kv : jobs_) out.push_back(describe(*kv.second));
+    return out;
+}
+
+size_t JobManager::active() const {
+    std::lock_guard<std::mutex> lk(m_);
+    return std::count_if(jobs_.begin(), jobs_.end(), [](const auto& kv) {
+        return kv.second->state != State::kDone && kv.second->state != State::kFailed;
+    });
+}
@@ -0,0 +1,121 @@
+// server/src/cryptoJobs.h
+// Server-side crypto jobs submitted over HTTP (POST /jobs in runMserver)
+//
+// The steps the orchestrator otherwise runs as CLI processes each round:
+//   {"type": "reencrypt", "input": <encrypted weights>, "rekey": <rekey>, "output": <path>,
+//    "source": <public key the rekey is from, optional>}
+//   {"type": "aggregate", "inputs": [<encrypted weights>, ...], "output": <path>}
+// (changeCipherDomain, aggregateEncryptedWeights; same inputs, same output
+// files), each with an optional "round": <r> and "after": [<job id>, ...]. A
+// job starts once every job it is after is done, and fails if one of them
+// fails, so a whole round can be submitted up front. Paths are given as in
+// sConfig and must lie under the federation's storage root.
+//
+// A started job loads and validates its inputs on a worker, then fans out
+// one task per output ciphertext onto the StealingPool; the task finishing
+// the last ciphertext writes the output file. The current round (the oldest
+// with a job not finished) runs first: its jobs that others are waiting for
+// at kCritical, the rest of it at kRound, and later rounds and jobs without
+// a round at kBackground.
+
+#ifndef PPFL_CRYPTO_JOBS_H
+#define PPFL_CRYPTO_JOBS_H
+
+#include <atomic>
+#include <chrono>
+#include <deque>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "ppfl/ppfl.h"
+#include "stealingPool.h"
+
+class JobManager {
+public:
+    // Finished jobs kept for status queries
+    static constexpr size_t kKeepFinished = 1024;
+
+    JobManager(std::string cc_path, const std::string& storage_root, StealingPool& pool);
+
+    // Queue a job from its JSON description. Returns its id, or "" with
+    // `err` set if the description is invalid. Called from the event loop.
+    std::string submit(const ppfl::json& spec, std::string& err);
+
+    // {"id", "type", "round", "after", "output", "state", "priority", "tasks",
+    //  "tasks_done", "progress", "error", "wait_ms", "run_ms"}; null if unknown.
+    // state is waiting | queued | running | done | failed.
+    ppfl::json status(const std::string& id) const;
+
+    // status() of every job kept, oldest first
+    ppfl::json list() const;
+
+    // Jobs not yet done or failed (for /metrics)
+    size_t active() const;
+
+private:
+    enum class State { kWaiting, kQueued, kRunning, kDone, kFailed };
+    using Clock = std::chrono::steady_clock;
+
+    // One output ciphertext and the input ciphertexts it is computed from
+    struct Slot {
+        ppfl::json* target;
+        std::vector<const std::string*> sources;
+    };
+
+    struct Job {
+        uint64_t seq = 0;
+        std::string id, type, rekeyPath, sourcePath, outputPath;
+        std::vector<std::string> inputPaths;
+        std::vector<std::string> after;
+        long round = -1;
+
+        // Guarded by JobManager::m_
+        State state = State::kWaiting;
+        StealingPool::Priority priority = StealingPool::kBackground;
+        size_t waitingFor = 0;
+        size_t tasks = 0;  // output ciphertexts, once prepared
+        std::vector<std::shared_ptr<Job>> dependents;
+        std::string error;
+        Clock::time_point submitted, started, finished;
+
+        // Set up by prepare() before the tasks are submitted, then read-only
+        std::shared_ptr<const ppfl::Context> ctx;
+        ppfl::EvalKey rekey;
+        std::vector<ppfl::json> inputs;
+        ppfl::json output;
+        std::vector<Slot> slots;
+
+        std::atomic<size_t> tasksDone{0};
+        std::atomic<bool> failed{false};
+        std::string taskError;  // of the first task to fail
+    };
+
+    std::shared_ptr<Job> find(const std::string& id) const;  // m_ held
+    std::string resolve(const std::string& path) const;
+    std::shared_ptr<const ppfl::Context> context();
+    StealingPool::Priority priorityOf(const Job& job) const;  // m_ held
+    void start(const std::shared_ptr<Job>& job);               // m_ held
+    void prepare(const std::shared_ptr<Job>& job);
+    void compute(const std::shared_ptr<Job>& job, size_t slot);
+    void finish(const std::shared_ptr<Job>& job, const std::string& error);
+    void settle(const std::shared_ptr<Job>& job, const std::string& error);  // m_ held
+    ppfl::json describe(const Job& job) const;                              // m_ held
+
+    std::string ccPath_;
+    std::string root_;
+    StealingPool& pool_;
+
+    std::mutex ctxM_;
+    std::shared_ptr<const ppfl::Context> ctx_;
+    std::string ctxStamp_;
+
+    mutable std::mutex m_;
+    uint64_t seq_ = 0;
+    std::map<uint64_t, std::shared_ptr<Job>> jobs_;  // by seq (the id's number)
+    std::deque<uint64_t> finished_;                  // oldest first
+};
+
+#endif  // PPFL_CRYPTO_JOBS_H
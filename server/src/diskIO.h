@@ -0,0 +1,469 @@
+// server/src/diskIO.h
+// File I/O backend for runMserver's large uploads and cache fills
+//
+// Writer is a std::streambuf over a file that wire::DecodeTo (or anything
+// else taking an ostream) writes into. With the io_uring backend (built with
+// `make URING=1`, -DPPFL_WITH_URING) decoded output is collected in buffers
+// registered with the ring and written with WRITE_FIXED while the next buffer
+// fills, up to `depth` writes in flight and several submitted per syscall.
+// Large spans handed over in one piece (identity uploads) are written
+// straight from the caller's memory in buffer-sized pieces, all in flight at
+// once. The POSIX backend does the same work with one pwrite() per buffer.
+// Either way a known final size is preallocated with fallocate() and the
+// file trimmed to what was written on close().
+//
+// readFile() reads a whole file with `depth` reads in flight (io_uring) or
+// pread() (POSIX).
+//
+// One DiskIO per thread: the ring is not thread-safe, and at most one Writer
+// may be open on a DiskIO at a time. "auto" and "uring" fall back to POSIX
+// when the ring cannot be set up (no kernel support, seccomp).
+
+#ifndef PPFL_DISK_IO_H
+#define PPFL_DISK_IO_H
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <streambuf>
+#include <string>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+#ifdef PPFL_WITH_URING
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#endif
+
+namespace diskio {
+
+struct Options {
+    std::string backend = "auto";     // auto | uring | posix
+    size_t buffer_bytes = 1 << 20;    // size of each buffer and of each write
+    unsigned depth = 8;               // buffers / writes in flight (io_uring)
+};
+
+#ifdef PPFL_WITH_URING
+// Just enough of io_uring for file reads and writes, without liburing
+class Ring {
+public:
+    explicit Ring(unsigned entries) {
+        io_uring_params p{};
+        fd_ = (int) syscall(__NR_io_uring_setup, entries, &p);
+        if (fd_ < 0) return;
+        sq_bytes_ = p.sq_off.array + p.sq_entries * sizeof(uint32_t);
+        cq_bytes_ = p.cq_off.cqes + p.cq_entries * sizeof(io_uring_cqe);
+        if (p.features & IORING_FEAT_SINGLE_MMAP) sq_bytes_ = cq_bytes_ = std::max(sq_bytes_, cq_bytes_);
+        sq_ = Map(sq_bytes_, IORING_OFF_SQ_RING);
+        cq_ = (p.features & IORING_FEAT_SINGLE_MMAP) ? sq_ : Map(cq_bytes_, IORING_OFF_CQ_RING);
+        sqes_bytes_ = p.sq_entries * sizeof(io_uring_sqe);
+        sqes_ = (io_uring_sqe *) Map(sqes_bytes_, IORING_OFF_SQES);
+        if (!sq_ || !cq_ || !sqes_) {
+            close();
+            return;
+        }
+        sq_head_ = (std::atomic<uint32_t> *) (sq_ + p.sq_off.head);
+        sq_tail_ = (std::atomic<uint32_t> *) (sq_ + p.sq_off.tail);
+        sq_mask_ = *(uint32_t *) (sq_ + p.sq_off.ring_mask);
+        sq_array_ = (uint32_t *) (sq_ + p.sq_off.array);
+        cq_head_ = (std::atomic<uint32_t> *) (cq_ + p.cq_off.head);
+        cq_tail_ = (std::atomic<uint32_t> *) (cq_ + p.cq_off.tail);
+        cq_mask_ = *(uint32_t *) (cq_ + p.cq_off.ring_mask);
+        cqes_ = (io_uring_cqe *) (cq_ + p.cq_off.cqes);
+        entries_ = p.sq_entries;
+        tail_ = sq_tail_->load(std::memory_order_relaxed);
+    }
+
+    ~Ring() { close(); }
+    Ring(const Ring &) = delete;
+    Ring &operator=(const Ring &) = delete;
+
+    bool ok() const { return fd_ >= 0; }
+
+    bool registerBuffers(const std::vector<iovec> &iov) {
+        return syscall(__NR_io_uring_register, fd_, IORING_REGISTER_BUFFERS, iov.data(), (unsigned) iov.size()) == 0;
+    }
+
+    // Queue one read or write; false if the submission queue is full
+    bool prep(uint8_t op, int fd, const void *buf, size_t len, uint64_t off, uint64_t user_data, int buf_index = -1) {
+        if (tail_ - sq_head_->load(std::memory_order_acquire) >= entries_) return false;
+        uint32_t idx = tail_ & sq_mask_;
+        io_uring_sqe *sqe = &sqes_[idx];
+        std::memset(sqe, 0, sizeof(*sqe));
+        sqe->opcode = op;
+        sqe->fd = fd;
+        sqe->addr = (uint64_t) (uintptr_t) buf;
+        sqe->len = (uint32_t) len;
+        sqe->off = off;
+        sqe->user_data = user_data;
+        if (buf_index >= 0) sqe->buf_index = (uint16_t) buf_index;
+        sq_array_[idx] = idx;
+        tail_++;
+        pending_++;
+        return true;
+    }
+
+    // Submit everything queued in one syscall and wait for at least `wait_nr` completions
+    bool submit(unsigned wait_nr) {
+        sq_tail_->store(tail_, std::memory_order_release);
+        unsigned n = pending_;
+        pending_ = 0;
+        for (;;) {
+            long rc = syscall(__NR_io_uring_enter, fd_, n, wait_nr, wait_nr ? IORING_ENTER_GETEVENTS : 0, nullptr, 0);
+            if (rc >= 0) return true;
+            if (errno != EINTR) return false;
+            n = 0;
+        }
+    }
+
+    // Hand every available completion to fn(user_data, res); returns how many
+    template <typename Fn>
+    unsigned reap(Fn &&fn) {
+        uint32_t head = cq_head_->load(std::memory_order_relaxed);
+        uint32_t tail = cq_tail_->load(std::memory_order_acquire);
+        unsigned n = 0;
+        for (; head != tail; head++, n++) {
+            const io_uring_cqe &cqe = cqes_[head & cq_mask_];
+            fn(cqe.user_data, cqe.res);
+        }
+        cq_head_->store(head, std::memory_order_release);
+        return n;
+    }
+
+private:
+    char *Map(size_t bytes, off_t offset) {
+        void *p = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd_, offset);
+        return p == MAP_FAILED ? nullptr : (char *) p;
+    }
+
+    void close() {
+        if (sqes_) munmap(sqes_, sqes_bytes_);
+        if (cq_ && cq_ != sq_) munmap(cq_, cq_bytes_);
+        if (sq_) munmap(sq_, sq_bytes_);
+        if (fd_ >= 0) ::close(fd_);
+        sq_ = cq_ = nullptr;
+        sqes_ = nullptr;
+        fd_ = -1;
+    }
+
+    int fd_ = -1;
+    char *sq_ = nullptr;
+    char *cq_ = nullptr;
+    io_uring_sqe *sqes_ = nullptr;
+    size_t sq_bytes_ = 0, cq_bytes_ = 0, sqes_bytes_ = 0;
+    std::atomic<uint32_t> *sq_head_ = nullptr, *sq_tail_ = nullptr, *cq_head_ = nullptr, *cq_tail_ = nullptr;
+    uint32_t *sq_array_ = nullptr;
+    io_uring_cqe *cqes_ = nullptr;
+    uint32_t sq_mask_ = 0, cq_mask_ = 0, entries_ = 0;
+    uint32_t tail_ = 0;
+    unsigned pending_ = 0;
+};
+#endif  // PPFL_WITH_URING
+
+class DiskIO;
+
+// Output file being written through a DiskIO; check close() for the result
+class Writer : public std::streambuf {
+public:
+    ~Writer() override {
+        if (fd_ >= 0) close();
+    }
+
+    // Write out what is buffered, wait for every write and trim the file to
+    // the bytes written; false if any write failed
+    bool close();
+
+    uint64_t written() const { return off_ + (uint64_t) (pptr() - pbase()); }
+
+protected:
+    int_type overflow(int_type ch) override {
+        if (!flushBuffer()) return traits_type::eof();
+        if (!traits_type::eq_int_type(ch, traits_type::eof())) {
+            *pptr() = (char) ch;
+            pbump(1);
+        }
+        return traits_type::not_eof(ch);
+    }
+
+    std::streamsize xsputn(const char *s, std::streamsize n) override;
+
+private:
+    friend class DiskIO;
+    Writer(DiskIO &io, int fd) : io_(io), fd_(fd) {}
+
+    bool flushBuffer();
+    bool writeSpan(const char *s, size_t n);
+    bool waitOne();
+    bool pwriteAll(const char *p, size_t n, uint64_t off);
+    void useBuffer(size_t i);
+
+    DiskIO &io_;
+    int fd_;
+    uint64_t off_ = 0;            // file offset of the current buffer's first byte
+    size_t cur_ = 0;              // buffer being filled
+    std::vector<bool> busy_;      // buffers with a write in flight
+    unsigned inflight_ = 0;
+    bool failed_ = false;
+};
+
+class DiskIO {
+public:
+    explicit DiskIO(const Options &opt) : opt_(opt) {
+        opt_.buffer_bytes = std::max<size_t>(opt_.buffer_bytes, 4096);
+        opt_.depth = std::max(1u, std::min(opt_.depth, 64u));
+#ifdef PPFL_WITH_URING
+        if (opt_.backend != "posix") {
+            ring_.reset(new Ring(opt_.depth * 2));
+            if (!ring_->ok()) ring_.reset();
+        }
+#endif
+        size_t n = uring() ? opt_.depth : 1;
+        for (size_t i = 0; i < n; i++) {
+            void *p = nullptr;
+            if (posix_memalign(&p, 4096, opt_.buffer_bytes) != 0) std::abort();
+            buffers_.push_back({p, opt_.buffer_bytes});
+        }
+#ifdef PPFL_WITH_URING
+        fixed_ = ring_ && ring_->registerBuffers(buffers_);
+#endif
+    }
+
+    ~DiskIO() {
+        for (auto &b : buffers_) std::free(b.iov_base);
+    }
+
+    DiskIO(const DiskIO &) = delete;
+    DiskIO &operator=(const DiskIO &) = delete;
+
+    // "uring" or "posix": what is actually used
+    const char *backend() const { return uring() ? "uring" : "posix"; }
+
+    // Create/truncate `path` for writing; size_hint > 0 is preallocated
+    std::unique_ptr<Writer> open(const std::string &path, uint64_t size_hint, std::string &err) {
+        int fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+        if (fd < 0) {
+            err = std::string("cannot open file for writing: ") + std::strerror(errno);
+            return nullptr;
+        }
+        // Best effort: filesystems without fallocate just allocate as we go
+        if (size_hint > 0) (void) ::fallocate(fd, 0, 0, (off_t) size_hint);
+        std::unique_ptr<Writer> w(new Writer(*this, fd));
+        w->busy_.assign(buffers_.size(), false);
+        w->useBuffer(0);
+        return w;
+    }
+
+    // Whole content of `path` into `out`; false if it cannot be read
+    bool readFile(const std::string &path, std::string &out) {
+        int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+        if (fd < 0) return false;
+        struct stat st;
+        bool ok = ::fstat(fd, &st) == 0;
+        if (ok) {
+            out.resize((size_t) st.st_size);
+            ok = uring() ? ringRead(fd, &out[0], out.size()) : preadAll(fd, &out[0], out.size(), 0);
+        }
+        ::close(fd);
+        return ok;
+    }
+
+private:
+    friend class Writer;
+
+    bool uring() const {
+#ifdef PPFL_WITH_URING
+        return ring_ != nullptr;
+#else
+        return false;
+#endif
+    }
+
+    static bool preadAll(int fd, char *p, size_t n, uint64_t off) {
+        while (n > 0) {
+            ssize_t r = ::pread(fd, p, n, (off_t) off);
+            if (r < 0 && errno == EINTR) continue;
+            if (r <= 0) return false;
+            p += r;
+            n -= (size_t) r;
+            off += (uint64_t) r;
+        }
+        return true;
+    }
+
+    bool ringRead(int fd, char *p, size_t n) {
+#ifdef PPFL_WITH_URING
+        // user_data = piece offset; a short read finishes with pread
+        size_t piece = opt_.buffer_bytes, next = 0;
+        unsigned inflight = 0;
+        bool ok = true;
+        // After a failed read nothing new is queued, but every read in
+        // flight is still waited for: the kernel may be writing into p
+        while ((ok && next < n) || inflight > 0) {
+            while (ok && next < n && inflight < opt_.depth) {
+                size_t len = std::min(piece, n - next);
+                if (!ring_->prep(IORING_OP_READ, fd, p + next, len, next, next)) break;
+                next += len;
+                inflight++;
+            }
+            if (!ring_->submit(1)) return false;
+            inflight -= ring_->reap([&](uint64_t at, int res) {
+                size_t len = std::min(piece, n - (size_t) at);
+                if (res < 0) ok = false;
+                else if ((size_t) res < len) ok = ok && preadAll(fd, p + at + res, len - res, at + res);
+            });
+        }
+        return ok;
+#else
+        return preadAll(fd, p, n, 0);
+#endif
+    }
+
+    Options opt_;
+    std::vector<iovec> buffers_;
+#ifdef PPFL_WITH_URING
+    std::unique_ptr<Ring> ring_;
+    bool fixed_ = false;
+#endif
+};
+
+// user_data of a write: which buffer (kSpan for a piece of a caller's span) << 48 | length
+static constexpr uint64_t kSpan = 0xffff;
+
+inline uint64_t WriteTag(uint64_t buffer, size_t len) { return buffer << 48 | (uint64_t) len; }
+
+inline void Writer::useBuffer(size_t i) {
+    cur_ = i;
+    char *b = (char *) io_.buffers_[i].iov_base;
+    setp(b, b + io_.buffers_[i].iov_len);
+}
+
+inline bool Writer::pwriteAll(const char *p, size_t n, uint64_t off) {
+    while (n > 0) {
+        ssize_t r = ::pwrite(fd_, p, n, (off_t) off);
+        if (r < 0 && errno == EINTR) continue;
+        if (r <= 0) return false;
+        p += r;
+        n -= (size_t) r;
+        off += (uint64_t) r;
+    }
+    return true;
+}
+
+// Wait for at least one write in flight and retire every completion available.
+// A failed write sets failed_; false only if the ring itself cannot be entered.
+inline bool Writer::waitOne() {
+#ifdef PPFL_WITH_URING
+    if (!io_.ring_->submit(1)) {
+        failed_ = true;
+        return false;
+    }
+    inflight_ -= io_.ring_->reap([&](uint64_t tag, int res) {
+        uint64_t buffer = tag >> 48;
+        size_t len = (size_t) (tag & ((1ull << 48) - 1));
+        // A short write to a regular file only happens on a full disk
+        if (res < 0 || (size_t) res < len) failed_ = true;
+        if (buffer != kSpan) busy_[(size_t) buffer] = false;
+    });
+#endif
+    return true;
+}
+
+// Send the filled part of the current buffer to the file and switch to a free buffer
+inline bool Writer::flushBuffer() {
+    size_t len = (size_t) (pptr() - pbase());
+    if (failed_) return false;
+    if (len == 0) return true;
+    if (!io_.uring()) {
+        if (!pwriteAll(pbase(), len, off_)) {
+            failed_ = true;
+            return false;
+        }
+        off_ += len;
+        useBuffer(cur_);
+        return true;
+    }
+#ifdef PPFL_WITH_URING
+    uint8_t op = io_.fixed_ ? IORING_OP_WRITE_FIXED : IORING_OP_WRITE;
+    while (!io_.ring_->prep(op, fd_, pbase(), len, off_, WriteTag(cur_, len), (int) cur_)) {
+        if (!waitOne()) return false;
+    }
+    busy_[cur_] = true;
+    inflight_++;
+    off_ += len;
+    // Submitted together with later writes, at the latest when one must be waited for
+    for (;;) {
+        for (size_t i = 0; i < busy_.size(); i++) {
+            if (!busy_[i]) {
+                useBuffer(i);
+                return !failed_;
+            }
+        }
+        if (!waitOne()) return false;
+    }
+#endif
+    return true;
+}
+
+// Large spans skip the buffers: written from s itself, many pieces in flight
+// at once, and waited for before returning since s belongs to the caller
+inline std::streamsize Writer::xsputn(const char *s, std::streamsize n) {
+    if ((size_t) n < io_.opt_.buffer_bytes) return std::streambuf::xsputn(s, n);
+    if (!flushBuffer() || !writeSpan(s, (size_t) n)) return 0;
+    return n;
+}
+
+inline bool Writer::writeSpan(const char *s, size_t n) {
+    if (!io_.uring()) {
+        if (!pwriteAll(s, n, off_)) {
+            failed_ = true;
+            return false;
+        }
+        off_ += n;
+        return true;
+    }
+#ifdef PPFL_WITH_URING
+    // Even after a failed piece, s is in use until every write is retired
+    size_t piece = io_.opt_.buffer_bytes, done = 0;
+    while ((!failed_ && done < n) || inflight_ > 0) {
+        while (!failed_ && done < n && inflight_ < 2 * io_.opt_.depth) {
+            size_t len = std::min(piece, n - done);
+            if (!io_.ring_->prep(IORING_OP_WRITE, fd_, s + done, len, off_ + done, WriteTag(kSpan, len))) break;
+            done += len;
+            inflight_++;
+        }
+        if (!waitOne()) return false;
+    }
+    if (failed_) return false;
+    off_ += n;
+#endif
+    return true;
+}
+
+inline bool Writer::close() {
+    bool ok = flushBuffer();
+#ifdef PPFL_WITH_URING
+    // Drained after a failure too: nothing is left for the ring's next Writer
+    while (io_.uring() && inflight_ > 0 && waitOne()) {
+    }
+#endif
+    ok = ok && !failed_;
+    // fallocate may have made the file longer than what was written
+    if (::ftruncate(fd_, (off_t) off_) != 0) ok = false;
+    if (::close(fd_) != 0) ok = false;
+    fd_ = -1;
+    setp(nullptr, nullptr);
+    return ok;
+}
+
+}  // namespace diskio
+
+#endif  // PPFL_DISK_IO_H
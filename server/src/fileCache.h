@@ -0,0 +1,163 @@
+// server/src/fileCache.h
+// In-memory cache of the small, hot files runMserver serves (CC.json, public
+// keys, downloads) with content-hash ETags for conditional GETs
+//
+// An entry is revalidated against the file's mtime and size on every get(),
+// so a re-uploaded key or a rewritten aggregate is picked up without any
+// explicit invalidation; an unchanged file costs one stat(). The ETag is the
+// first 128 bits of the body's SHA-256, so it stays stable across server
+// restarts and copies of the same content. Least recently used entries are
+// evicted once the cache holds more than max_bytes; files larger than that
+// are hashed and served but not kept. Compressed variants of a body live
+// and die with its entry and are not counted (each is smaller than the body).
+//
+// Used from the event loop only; not thread-safe.
+
+#ifndef PPFL_FILE_CACHE_H
+#define PPFL_FILE_CACHE_H
+
+#include <algorithm>
+#include <cctype>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <list>
+#include <map>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <unordered_map>
+
+#include <openssl/evp.h>
+
+class FileCache {
+public:
+    struct Entry {
+        std::string body;
+        std::string etag;   // quoted, as sent in the ETag header
+        std::filesystem::file_time_type mtime;
+        uintmax_t size = 0;
+        mutable std::map<std::string, std::string> encoded;  // Content-Encoding -> body, filled on demand
+    };
+
+    // Reads a whole file for a miss; false if it cannot be read
+    using Reader = std::function<bool(const std::string &path, std::string &out)>;
+
+    explicit FileCache(size_t max_bytes) : max_bytes_(max_bytes) {}
+
+    // Replace the default ifstream read (runMserver plugs in its DiskIO backend)
+    void setReader(Reader reader) { reader_ = std::move(reader); }
+
+    // Current content of `path`, or nullptr if it cannot be read
+    std::shared_ptr<const Entry> get(const std::string &path) {
+        namespace fs = std::filesystem;
+        std::error_code ec;
+        auto mtime = fs::last_write_time(path, ec);
+        if (ec) return nullptr;
+        auto size = fs::file_size(path, ec);
+        if (ec) return nullptr;
+
+        auto it = index_.find(path);
+        if (it != index_.end()) {
+            const auto &e = *it->second->second;
+            if (e.mtime == mtime && e.size == size) {
+                lru_.splice(lru_.begin(), lru_, it->second);  // most recently used
+                hits_++;
+                return it->second->second;
+            }
+            drop(it);
+        }
+        misses_++;
+
+        auto e = std::make_shared<Entry>();
+        if (reader_) {
+            if (!reader_(path, e->body)) return nullptr;
+        } else {
+            std::ifstream f(path, std::ios::binary);
+            if (!f.is_open()) return nullptr;
+            std::ostringstream ss;
+            ss << f.rdbuf();
+            e->body = ss.str();
+        }
+        e->etag = ETag(e->body);
+        e->mtime = mtime;
+        e->size = size;
+        if (e->body.size() != size) return e;  // changed while reading; serve, don't keep
+
+        if (e->body.size() <= max_bytes_) {
+            lru_.emplace_front(path, e);
+            index_[path] = lru_.begin();
+            bytes_ += e->body.size();
+            while (bytes_ > max_bytes_) drop(index_.find(lru_.back().first));
+        }
+        return e;
+    }
+
+    // True if an If-None-Match value ("*" or a list of quoted ETags, weak
+    // W/ prefixes allowed as in RFC 7232 weak comparison) matches etag
+    static bool Matches(const std::string &if_none_match, const std::string &etag) {
+        return if_none_match == "*" || if_none_match.find(etag) != std::string::npos;
+    }
+
+    // Byte range of a `size`-byte body asked for by a Range header, as [from, to).
+    // 1 = satisfiable; 0 = nothing usable (not bytes=, several ranges, malformed),
+    // serve the whole body; -1 = unsatisfiable.
+    static int ParseRange(const std::string &range, size_t size, size_t &from, size_t &to) {
+        if (range.compare(0, 6, "bytes=") != 0 || range.find(',') != std::string::npos) return 0;
+        size_t dash = range.find('-', 6);
+        if (dash == std::string::npos) return 0;
+        std::string first = range.substr(6, dash - 6), last = range.substr(dash + 1);
+        auto number = [](const std::string &v, unsigned long long &out) {
+            char *end = nullptr;
+            out = strtoull(v.c_str(), &end, 10);
+            return !v.empty() && isdigit((unsigned char) v[0]) && *end == '\0';
+        };
+        unsigned long long a = 0, b = 0;
+        if (first.empty()) {  // bytes=-n: the last n bytes
+            if (!number(last, b)) return 0;
+            if (b == 0 || size == 0) return -1;
+            from = size - std::min<size_t>(b, size);
+            to = size;
+            return 1;
+        }
+        if (!number(first, a) || (!last.empty() && (!number(last, b) || b < a))) return 0;
+        if (a >= size) return -1;
+        from = a;
+        to = last.empty() ? size : std::min<size_t>(b + 1, size);
+        return 1;
+    }
+
+    static std::string ETag(const std::string &body) {
+        unsigned char md[EVP_MAX_MD_SIZE];
+        unsigned int len = 0;
+        EVP_Digest(body.data(), body.size(), md, &len, EVP_sha256(), nullptr);
+        char hex[33];
+        for (int i = 0; i < 16; i++) std::snprintf(hex + 2 * i, 3, "%02x", md[i]);
+        return "\"" + std::string(hex, 32) + "\"";
+    }
+
+    size_t hits() const { return hits_; }
+    size_t misses() const { return misses_; }
+    size_t bytes() const { return bytes_; }
+
+private:
+    using Lru = std::list<std::pair<std::string, std::shared_ptr<const Entry>>>;
+
+    void drop(std::unordered_map<std::string, Lru::iterator>::iterator it) {
+        bytes_ -= it->second->second->body.size();
+        lru_.erase(it->second);
+        index_.erase(it);
+    }
+
+    size_t max_bytes_;
+    Reader reader_;
+    size_t bytes_ = 0;
+    size_t hits_ = 0;
+    size_t misses_ = 0;
+    Lru lru_;
+    std::unordered_map<std::string, Lru::iterator> index_;
+};
+
+#endif  // PPFL_FILE_CACHE_H
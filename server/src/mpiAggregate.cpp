@@ -0,0 +1,299 @@
+// server/src/mpiAggregate.cpp
+// MPI-distributed server step of a round: the work of
+//   changeCipherDomain (C1->C2) + aggregateEncryptedWeights + changeCipherDomain (C2->C1)
+// spread across ranks.
+//
+// Rank 0 reads both encrypted weight files, matches layers (by name + shape,
+// like AggregateModels) and flattens every ciphertext pair (mean, std_dev,
+// each values batch) into one work list, which is split into equal
+// contiguous ranges, one per rank. The CryptoContext and both rekeys are
+// broadcast once. Each rank then does, per pair:
+//   agg   = (c2 + ReEncrypt(c1, rekey_c1)) * 1/2     (client 2 domain)
+//   aggC1 = ReEncrypt(agg, rekey_c2)                 (client 1 domain)
+// and rank 0 gathers the results into the same two files the sequential
+// CLIs produce. The intermediate C1->C2 file is not written.
+//
+// Usage:
+//   mpirun -np <N> mpiAggregate <cc_path> <rekey_c1> <rekey_c2> <client1_encfile>
+//          <client2_encfile> <output_aggfile> <output_agg_c1file>
+//
+// Rank 0 prints one "[mpiagg] timing {...}" JSON line with per-phase wall
+// times (compute is the slowest rank) for the strong-scaling benchmark.
+
+#include <mpi.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "ppfl/ppfl.h"
+
+namespace {
+
+using ppfl::json;
+
+constexpr int TAG_WORK = 1;
+constexpr int TAG_RESULT = 2;
+constexpr size_t MPI_CHUNK = size_t(1) << 30;  // stay below INT_MAX per MPI call
+
+// ----------------------
+// String transport (sizes may exceed the int counts of MPI calls)
+// ----------------------
+void sendString(const std::string& s, int dest, int tag) {
+    uint64_t n = s.size();
+    MPI_Send(&n, 1, MPI_UINT64_T, dest, tag, MPI_COMM_WORLD);
+    for (size_t off = 0; off < s.size(); off += MPI_CHUNK) {
+        int len = (int) std::min(MPI_CHUNK, s.size() - off);
+        MPI_Send(s.data() + off, len, MPI_CHAR, dest, tag, MPI_COMM_WORLD);
+    }
+}
+
+std::string recvString(int src, int tag) {
+    uint64_t n = 0;
+    MPI_Recv(&n, 1, MPI_UINT64_T, src, tag, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
+    std::string s(n, '\0');
+    for (size_t off = 0; off < s.size(); off += MPI_CHUNK) {
+        int len = (int) std::min(MPI_CHUNK, s.size() - off);
+        MPI_Recv(&s[off], len, MPI_CHAR, src, tag, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
+    }
+    return s;
+}
+
+void bcastString(std::string& s, int root) {
+    uint64_t n = s.size();
+    MPI_Bcast(&n, 1, MPI_UINT64_T, root, MPI_COMM_WORLD);
+    s.resize(n);
+    for (size_t off = 0; off < s.size(); off += MPI_CHUNK) {
+        int len = (int) std::min(MPI_CHUNK, s.size() - off);
+        MPI_Bcast(&s[off], len, MPI_CHAR, root, MPI_COMM_WORLD);
+    }
+}
+
+// Base64 never contains '\n', so ciphertext lists travel newline-joined
+std::string joinLines(std::vector<std::string>::const_iterator b, std::vector<std::string>::const_iterator e) {
+    std::string out;
+    for (auto it = b; it != e; ++it) {
+        out += *it;
+        out += '\n';
+    }
+    return out;
+}
+
+std::vector<std::string> splitLines(const std::string& s) {
+    std::vector<std::string> out;
+    size_t start = 0, nl;
+    while ((nl = s.find('\n', start)) != std::string::npos) {
+        out.push_back(s.substr(start, nl - start));
+        start = nl + 1;
+    }
+    return out;
+}
+
+std::string readFile(const std::string& path) {
+    std::ifstream in(path, std::ios::binary);
+    if (!in) throw ppfl::Error("cannot open " + path);
+    return std::string(std::istreambuf_iterator<char>(in), {});
+}
+
+// ----------------------
+// Work plan (rank 0)
+// ----------------------
+struct LayerPlan {
+    const json* c2;
+    size_t values;  // pairs after mean + std_dev
+};
+
+// Layers of client 2 that client 1 also has with the same shape, in client 2
+// order; values truncated to the shorter list (AggregateModels semantics)
+std::vector<LayerPlan> planLayers(const json& c1, const json& c2, std::vector<std::string>& c1Items,
+                                  std::vector<std::string>& c2Items) {
+    std::unordered_map<std::string, const json*> c1Index;
+    for (const auto& layer : c1.at("weights_summary")) c1Index[layer.at("layer")] = &layer;
+
+    std::vector<LayerPlan> plan;
+    for (const auto& layer : c2.at("weights_summary")) {
+        auto it = c1Index.find(layer.at("layer"));
+        if (it == c1Index.end() || it->second->at("shape") != layer.at("shape")) continue;
+        const json& other = *it->second;
+
+        size_t n = std::min(layer.at("values").size(), other.at("values").size());
+        plan.push_back({&layer, n});
+        for (const char* key : {"mean", "std_dev"}) {
+            c1Items.push_back(other.at(key));
+            c2Items.push_back(layer.at(key));
+        }
+        for (size_t j = 0; j < n; j++) {
+            c1Items.push_back(other.at("values")[j]);
+            c2Items.push_back(layer.at("values")[j]);
+        }
+    }
+    return plan;
+}
+
+// Every ciphertext of one output shares its parameters and key: the header
+// is taken from the first one only
+json assemble(const std::vector<LayerPlan>& plan, const std::vector<std::string>& items) {
+    json out;
+    out["weights_summary"] = json::array();
+    json header = items.empty() ? json() : ppfl::HeaderToJson(ppfl::HeaderOf(ppfl::DecodeCiphertext(items[0])));
+    size_t k = 0;
+    for (const auto& lp : plan) {
+        json layer;
+        layer["layer"] = lp.c2->at("layer");
+        layer["shape"] = lp.c2->at("shape");
+        layer["ct_header"] = header;
+        layer["mean"] = items[k++];
+        layer["std_dev"] = items[k++];
+        layer["values"] = std::vector<std::string>(items.begin() + k, items.begin() + k + lp.values);
+        k += lp.values;
+        out["weights_summary"].push_back(std::move(layer));
+    }
+    return out;
+}
+
+// [begin, end) of rank r's share of n items
+std::pair<size_t, size_t> share(size_t n, int rank, int size) {
+    size_t base = n / size, extra = n % size;
+    size_t begin = rank * base + std::min<size_t>(rank, extra);
+    return {begin, begin + base + ((size_t) rank < extra ? 1 : 0)};
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+    MPI_Init(&argc, &argv);
+    int rank = 0, size = 1;
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+    MPI_Comm_size(MPI_COMM_WORLD, &size);
+
+    if (argc != 8) {
+        if (rank == 0) {
+            std::cerr << "Usage: mpirun -np <N> " << argv[0]
+                      << " <cc_path> <rekey_c1> <rekey_c2> <client1_encfile> <client2_encfile>"
+                      << " <output_aggfile> <output_agg_c1file>" << std::endl;
+        }
+        MPI_Finalize();
+        return 1;
+    }
+
+    std::string cc_path       = argv[1];
+    std::string rekey_c1_path = argv[2];
+    std::string rekey_c2_path = argv[3];
+    std::string client1_file  = argv[4];
+    std::string client2_file  = argv[5];
+    std::string output_agg    = argv[6];
+    std::string output_agg_c1 = argv[7];
+
+    try {
+        json timing;
+        double t0 = MPI_Wtime();
+
+        // Step 1: Broadcast CryptoContext + rekeys once
+        std::string ccBuf, rk1Buf, rk2Buf;
+        if (rank == 0) {
+            ccBuf = readFile(cc_path);
+            rk1Buf = readFile(rekey_c1_path);
+            rk2Buf = readFile(rekey_c2_path);
+        }
+        bcastString(ccBuf, 0);
+        bcastString(rk1Buf, 0);
+        bcastString(rk2Buf, 0);
+        auto ctx = ppfl::Context::LoadBuffer(ccBuf);
+        auto reKey1 = ppfl::LoadEvalKeyBuffer(rk1Buf);
+        auto reKey2 = ppfl::LoadEvalKeyBuffer(rk2Buf);
+        double t1 = MPI_Wtime();
+
+        // Step 2: Rank 0 loads inputs, plans and scatters contiguous shares
+        std::vector<LayerPlan> plan;
+        std::vector<std::string> c1Items, c2Items;
+        json c1Json, c2Json;
+        if (rank == 0) {
+            c1Json = ppfl::ReadJsonFile(client1_file);
+            c2Json = ppfl::ReadJsonFile(client2_file);
+            ppfl::ValidateModel(*ctx, c1Json);
+            ppfl::ValidateModel(*ctx, c2Json);
+            plan = planLayers(c1Json, c2Json, c1Items, c2Items);
+            std::cout << "[mpiagg] " << plan.size() << " layers, " << c1Items.size()
+                      << " ciphertext pairs over " << size << " ranks\n";
+        }
+        double t2 = MPI_Wtime();
+
+        std::vector<std::string> myC1, myC2;
+        if (rank == 0) {
+            for (int r = 1; r < size; r++) {
+                auto range = share(c1Items.size(), r, size);
+                sendString(joinLines(c1Items.begin() + range.first, c1Items.begin() + range.second), r, TAG_WORK);
+                sendString(joinLines(c2Items.begin() + range.first, c2Items.begin() + range.second), r, TAG_WORK);
+            }
+            auto range = share(c1Items.size(), 0, size);
+            myC1.assign(c1Items.begin() + range.first, c1Items.begin() + range.second);
+            myC2.assign(c2Items.begin() + range.first, c2Items.begin() + range.second);
+        } else {
+            myC1 = splitLines(recvString(0, TAG_WORK));
+            myC2 = splitLines(recvString(0, TAG_WORK));
+        }
+        double t3 = MPI_Wtime();
+
+        // Step 3: ReEncrypt + EvalAdd + average + ReEncrypt back, per pair
+        const auto& cc = ctx->cc();
+        std::vector<std::string> myAgg, myAggC1;
+        myAgg.reserve(myC1.size());
+        myAggC1.reserve(myC1.size());
+        for (size_t i = 0; i < myC1.size(); i++) {
+            auto c1to2 = cc->ReEncrypt(ppfl::DecodeCiphertext(myC1[i]), reKey1);
+            auto agg = cc->EvalMult(cc->EvalAdd(ppfl::DecodeCiphertext(myC2[i]), c1to2), 0.5);
+            myAgg.push_back(ppfl::EncodeCiphertext(agg));
+            myAggC1.push_back(ppfl::EncodeCiphertext(cc->ReEncrypt(agg, reKey2)));
+        }
+        double computeLocal = MPI_Wtime() - t3, computeMax = 0.0;
+        MPI_Reduce(&computeLocal, &computeMax, 1, MPI_DOUBLE, MPI_MAX, 0, MPI_COMM_WORLD);
+        double t4 = MPI_Wtime();
+
+        // Step 4: Gather in rank order (shares are contiguous) and save
+        if (rank != 0) {
+            sendString(joinLines(myAgg.begin(), myAgg.end()), 0, TAG_RESULT);
+            sendString(joinLines(myAggC1.begin(), myAggC1.end()), 0, TAG_RESULT);
+        } else {
+            std::vector<std::string> aggItems = std::move(myAgg), aggC1Items = std::move(myAggC1);
+            for (int r = 1; r < size; r++) {
+                for (auto& s : splitLines(recvString(r, TAG_RESULT))) aggItems.push_back(std::move(s));
+                for (auto& s : splitLines(recvString(r, TAG_RESULT))) aggC1Items.push_back(std::move(s));
+            }
+            if (aggItems.size() != c1Items.size() || aggC1Items.size() != c1Items.size()) {
+                throw ppfl::Error("gathered " + std::to_string(aggItems.size()) + " results, expected " +
+                                  std::to_string(c1Items.size()));
+            }
+            double t5 = MPI_Wtime();
+
+            ppfl::WriteJsonFile(output_agg, assemble(plan, aggItems));
+            ppfl::WriteJsonFile(output_agg_c1, assemble(plan, aggC1Items));
+            double t6 = MPI_Wtime();
+
+            timing["ranks"] = size;
+            timing["pairs"] = c1Items.size();
+            timing["bcast_s"] = t1 - t0;
+            timing["load_s"] = t2 - t1;
+            timing["scatter_s"] = t3 - t2;
+            timing["compute_s"] = computeMax;
+            timing["gather_s"] = t5 - t4;
+            timing["write_s"] = t6 - t5;
+            timing["total_s"] = t6 - t0;
+            std::cout << "[mpiagg] timing " << timing.dump() << std::endl;
+        }
+    } catch (const std::exception& e) {
+        std::cerr << "[mpiagg] rank " << rank << " ERROR: " << e.what() << std::endl;
+        MPI_Abort(MPI_COMM_WORLD, 1);
+    }
+
+    if (rank == 0) {
+        std::cout << "[mpiagg] Aggregation completed successfully. Outputs: " << output_agg << ", "
+                  << output_agg_c1 << std::endl;
+    }
+    MPI_Finalize();
+    return 0;
+}
@@ -0,0 +1,372 @@
+// server/src/roundAggregator.cpp
+#include "roundAggregator.h"
+
+#include <cmath>
+#include <iostream>
+
+#include "serverMetrics.h"
+#include "trace.h"
+
+// WriteJsonFile, counted in the /metrics disk write totals
+static void writeCounted(const std::string& path, const ppfl::json& doc) {
+    std::string text = ppfl::SerializeJson(doc);
+    int64_t t0 = metrics::NowUs();
+    ppfl::WriteTextFile(path, text);
+    metrics::AddDiskWrite(text.size(), metrics::NowUs() - t0);
+}
+
+RoundAggregator::RoundAggregator(AggregatorConfig cfg, WorkerPool& pool) : cfg_(std::move(cfg)), pool_(pool) {}
+
+size_t RoundAggregator::contributorIndex(const std::string& client_id, std::string& err) const {
+    for (size_t i = 0; i < cfg_.contributors.size(); i++) {
+        if (cfg_.contributors[i].id == client_id) return i;
+    }
+    err = "unknown client " + client_id;
+    return cfg_.contributors.size();
+}
+
+bool RoundAggregator::hasContributor(const std::string& client_id) const {
+    std::string err;
+    return contributorIndex(client_id, err) < cfg_.contributors.size();
+}
+
+size_t RoundAggregator::quorumCount() const {
+    size_t n = cfg_.contributors.size();
+    size_t q = (size_t) std::ceil(cfg_.policy.quorum * n);
+    return std::min(n, std::max<size_t>(1, q));
+}
+
+size_t RoundAggregator::completeContributors(const RoundState& st) {
+    size_t fully = 0;
+    for (size_t r : st.received) fully += (r == st.layers);
+    return fully;
+}
+
+// Round state for `round`, starting a new round (and dropping the previous
+// one) on the first contribution with a higher round number. `weight` is
+// set to the contribution weight (< 1 for decayed stale updates).
+std::shared_ptr<RoundAggregator::RoundState> RoundAggregator::acquire(int round, size_t layers, double& weight,
+                                                                      std::string& err) {
+    std::lock_guard<std::mutex> lk(m_);
+    weight = 1.0;
+    if (layers == 0) {
+        err = "no layers";
+        return nullptr;
+    }
+    if (!current_ || round > current_->round) {
+        auto fresh = std::make_shared<RoundState>();
+        fresh->round = round;
+        fresh->layers = layers;
+        fresh->started = std::chrono::steady_clock::now();
+        fresh->received.assign(cfg_.contributors.size(), 0);
+        fresh->weights.assign(cfg_.contributors.size(), 0.0);
+        for (size_t l = 0; l < layers; l++) {
+            auto ls = std::make_unique<LayerState>();
+            ls->present.assign(cfg_.contributors.size(), false);
+            ls->reencrypted.resize(cfg_.contributors.size());
+            fresh->layerStates.push_back(std::move(ls));
+        }
+        current_ = std::move(fresh);
+        std::cout << "[SERVER] [agg] Round " << round << " started (" << layers << " layers)" << std::endl;
+        return current_;
+    }
+
+    if (round < current_->round) {
+        int age = current_->round - round;
+        if (!cfg_.policy.decay_stale || age > cfg_.policy.max_staleness) {
+            err = "stale round " + std::to_string(round) + " (current " + std::to_string(current_->round) + ")";
+            return nullptr;
+        }
+        weight = std::pow(cfg_.policy.stale_decay, age);
+    }
+    {
+        std::lock_guard<std::mutex> slk(current_->m);
+        if (current_->closed || current_->complete) {
+            err = "round " + std::to_string(current_->round) + " already closed";
+            return nullptr;
+        }
+    }
+    if (layers != current_->layers) {
+        err = "layer count mismatch: " + std::to_string(layers) + " vs " + std::to_string(current_->layers);
+        return nullptr;
+    }
+    if (weight != 1.0) {
+        std::cout << "[SERVER] [agg] Folding round " << round << " update into round " << current_->round
+                  << " at weight " << weight << std::endl;
+    }
+    return current_;
+}
+
+bool RoundAggregator::submitLayer(const std::string& client_id, int round, size_t layer, size_t layers,
+                                  std::string body, std::string& err, bool partial) {
+    size_t ci = contributorIndex(client_id, err);
+    if (ci == cfg_.contributors.size()) return false;
+    if (layers == 0 || layer >= layers) {
+        err = "layer index out of range";
+        return false;
+    }
+    double weight;
+    auto st = acquire(round, layers, weight, err);
+    if (!st) return false;
+
+    pool_.submit([this, st, ci, layer, weight, partial, body = std::move(body)] {
+        ppfl::json enc;
+        try {
+            enc = ppfl::json::parse(body);
+        } catch (const std::exception& e) {
+            fail(*st, "layer " + std::to_string(layer) + ": " + e.what());
+            return;
+        }
+        process(st, ci, layer, std::move(enc), weight, partial);
+    }, cfg_.lane);
+    return true;
+}
+
+bool RoundAggregator::submitModel(const std::string& client_id, int round, const std::string& path, std::string& err) {
+    size_t ci = contributorIndex(client_id, err);
+    if (ci == cfg_.contributors.size()) return false;
+
+    // Parse off the event loop, then fan the layers out to the pool. Nothing
+    // here may throw out of the task: a bad document is logged and dropped
+    // before it starts or joins a round, and fails the round after that.
+    pool_.submit([this, ci, round, path] {
+        std::shared_ptr<RoundState> st;
+        try {
+            ppfl::json doc = ppfl::ReadJsonFile(path);
+            auto& layers = doc.at("weights_summary");
+            if (!layers.is_array() || layers.empty()) throw ppfl::Error("no layers in weights_summary");
+            double weight;
+            std::string err;
+            st = acquire(round, layers.size(), weight, err);
+            if (!st) {
+                std::cerr << "[SERVER] [agg] Rejected " << path << ": " << err << std::endl;
+                return;
+            }
+            for (size_t k = 0; k < layers.size(); k++) {
+                pool_.submit([this, st, ci, k, weight, enc = std::move(layers[k])]() mutable {
+                    process(st, ci, k, std::move(enc), weight);
+                }, cfg_.lane);
+            }
+        } catch (const std::exception& e) {
+            if (st) {
+                fail(*st, path + ": " + e.what());
+            } else {
+                std::cerr << "[SERVER] [agg] Rejected " << path << ": " << e.what() << std::endl;
+            }
+        }
+    }, cfg_.lane);
+    return true;
+}
+
+void RoundAggregator::load(RoundState& st) const {
+    st.ctx = ppfl::Context::LoadFile(cfg_.cc_path);
+    for (const auto& c : cfg_.contributors) {
+        st.contribKeys.push_back(c.rekey_path.empty() ? nullptr : ppfl::LoadEvalKeyFile(c.rekey_path));
+    }
+    for (const auto& d : cfg_.deliveries) {
+        st.deliveryKeys.push_back(d.rekey_path.empty() ? nullptr : ppfl::LoadEvalKeyFile(d.rekey_path));
+    }
+}
+
+void RoundAggregator::process(const std::shared_ptr<RoundState>& st, size_t ci, size_t layer,
+                              ppfl::json enc, double weight, bool partial) {
+    ppfl::trace::Span span("agg.add_layer", {st->round, cfg_.contributors[ci].id, (long) layer});
+    try {
+        std::call_once(st->loadOnce, [&] { load(*st); });
+        const ppfl::Context& ctx = *st->ctx;
+
+        // Bring the contribution into the anchor domain (outside any lock)
+        if (st->contribKeys[ci]) {
+            ppfl::json re = ppfl::ReEncryptLayer(ctx, st->contribKeys[ci], enc);
+            if (partial) {
+                re["weight"] = enc.at("weight");
+                re["count"] = enc.at("count");
+            }
+            enc = std::move(re);
+        }
+
+        LayerState& ls = *st->layerStates[layer];
+        bool finish = false;
+        {
+            std::lock_guard<std::mutex> lk(ls.m);
+            if (ls.sealed) {
+                std::cout << "[SERVER] [agg] Layer " << layer << " from client " << cfg_.contributors[ci].id
+                          << " arrived after round " << st->round << " closed, discarded" << std::endl;
+                return;
+            }
+            if (ls.present[ci]) {
+                std::cout << "[SERVER] [agg] Duplicate layer " << layer << " from client "
+                          << cfg_.contributors[ci].id << " ignored" << std::endl;
+                return;
+            }
+            if (partial) {
+                ls.sum.AddPartial(ctx, enc, weight);
+            } else {
+                ls.sum.Add(ctx, enc, weight);
+            }
+            ls.present[ci] = true;
+            ls.contributors++;
+            if (!cfg_.contributors[ci].reenc_path.empty()) ls.reencrypted[ci] = std::move(enc);
+            if (ls.contributors == cfg_.contributors.size()) finish = ls.done = true;
+        }
+
+        bool quorum = false;
+        {
+            std::lock_guard<std::mutex> lk(st->m);
+            st->weights[ci] = weight;
+            if (++st->received[ci] == st->layers) {
+                size_t fully = completeContributors(*st);
+                quorum = fully >= quorumCount() && fully < cfg_.contributors.size();
+            }
+        }
+        if (quorum) close(st, "quorum");
+        if (finish) finishLayer(*st, layer);
+
+    } catch (const std::exception& e) {
+        fail(*st, "layer " + std::to_string(layer) + ": " + e.what());
+    }
+}
+
+// Stop accepting contributions for the round and finish every layer with
+// whatever it has accumulated
+void RoundAggregator::close(const std::shared_ptr<RoundState>& st, const std::string& reason) {
+    {
+        std::lock_guard<std::mutex> lk(st->m);
+        if (st->closed || st->complete) return;
+        st->closed = true;
+        st->closeReason = reason;
+        std::cout << "[SERVER] [agg] Closing round " << st->round << " (" << reason << ", "
+                  << completeContributors(*st) << "/" << cfg_.contributors.size() << " contributors)" << std::endl;
+    }
+    for (size_t k = 0; k < st->layers; k++) pool_.submit([this, st, k] { seal(st, k); }, cfg_.lane);
+}
+
+void RoundAggregator::seal(const std::shared_ptr<RoundState>& st, size_t layer) {
+    LayerState& ls = *st->layerStates[layer];
+    {
+        std::lock_guard<std::mutex> lk(ls.m);
+        ls.sealed = true;
+        if (ls.done) return;
+        if (ls.contributors == 0) {
+            fail(*st, "layer " + std::to_string(layer) + ": no contributions when the round closed");
+            return;
+        }
+        ls.done = true;
+    }
+    finishLayer(*st, layer);
+}
+
+// Average the layer's running sum and re-encrypt it for every delivery domain,
+// or in a relay forward the partial sum upstream. Called once per layer,
+// after which nothing else touches the accumulator.
+void RoundAggregator::finishLayer(RoundState& st, size_t layer) const {
+    ppfl::trace::Span span(cfg_.forward ? "agg.forward_layer" : "agg.finish_layer", {st.round, "", (long) layer});
+    try {
+        const ppfl::Context& ctx = *st.ctx;
+        LayerState& ls = *st.layerStates[layer];
+        if (cfg_.forward) {
+            cfg_.forward(st.round, layer, st.layers, ls.sum.Partial());
+        } else {
+            ppfl::json agg = ls.sum.Finalize(ctx);
+            for (const auto& key : st.deliveryKeys) {
+                ls.delivered.push_back(key ? ppfl::ReEncryptLayer(ctx, key, agg) : agg);
+            }
+        }
+
+        bool last;
+        {
+            std::lock_guard<std::mutex> lk(st.m);
+            last = ++st.completed == st.layers;
+        }
+        if (last) finalize(st);
+
+    } catch (const std::exception& e) {
+        fail(st, "layer " + std::to_string(layer) + ": " + e.what());
+    }
+}
+
+// Assemble per-layer results into the files the sequential pipeline produces
+void RoundAggregator::finalize(RoundState& st) const {
+    ppfl::trace::Span span("agg.write", {st.round});
+    for (size_t d = 0; d < cfg_.deliveries.size(); d++) {
+        ppfl::json doc;
+        doc["weights_summary"] = ppfl::json::array();
+        for (const auto& ls : st.layerStates) doc["weights_summary"].push_back(std::move(ls->delivered[d]));
+        writeCounted(cfg_.deliveries[d].output_path, doc);
+    }
+    for (size_t ci = 0; ci < cfg_.contributors.size(); ci++) {
+        if (cfg_.contributors[ci].reenc_path.empty()) continue;
+        // Partial if the contributor missed the close; skip rather than write holes
+        bool whole = true;
+        for (const auto& ls : st.layerStates) whole = whole && ls->present[ci];
+        if (!whole) continue;
+        ppfl::json doc;
+        doc["weights_summary"] = ppfl::json::array();
+        for (const auto& ls : st.layerStates) doc["weights_summary"].push_back(std::move(ls->reencrypted[ci]));
+        writeCounted(cfg_.contributors[ci].reenc_path, doc);
+    }
+
+    std::lock_guard<std::mutex> lk(st.m);
+    st.complete = true;
+    std::cout << "[SERVER] [agg] Round " << st.round << " complete (" << st.layers << " layers, "
+              << completeContributors(st) << "/" << cfg_.contributors.size() << " contributors)" << std::endl;
+}
+
+void RoundAggregator::fail(RoundState& st, const std::string& what) const {
+    std::cerr << "[SERVER] [agg] ERROR round " << st.round << ", " << what << std::endl;
+    std::lock_guard<std::mutex> lk(st.m);
+    if (st.error.empty()) st.error = what;
+}
+
+void RoundAggregator::tick() {
+    if (cfg_.policy.deadline_ms <= 0) return;
+    std::shared_ptr<RoundState> st;
+    {
+        std::lock_guard<std::mutex> lk(m_);
+        st = current_;
+    }
+    if (!st) return;
+
+    {
+        std::lock_guard<std::mutex> lk(st->m);
+        if (st->closed || st->complete) return;
+        auto elapsed = std::chrono::steady_clock::now() - st->started;
+        if (elapsed < std::chrono::milliseconds(cfg_.policy.deadline_ms)) return;
+        if (completeContributors(*st) == 0) return;  // keep waiting for a first complete update
+    }
+    close(st, "deadline");
+}
+
+ppfl::json RoundAggregator::status() const {
+    std::shared_ptr<RoundState> st;
+    {
+        std::lock_guard<std::mutex> lk(m_);
+        st = current_;
+    }
+
+    ppfl::json j;
+    j["expected"] = cfg_.contributors.size();
+    j["quorum"] = quorumCount();
+    j["contributors"] = ppfl::json::object();
+    j["weights"] = ppfl::json::object();
+    if (!st) {
+        j.update({{"round", 0}, {"layers", 0}, {"contributor_count", 0}, {"layers_complete", 0},
+                  {"closed", false}, {"close_reason", ""}, {"complete", false}, {"error", ""}});
+        return j;
+    }
+
+    std::lock_guard<std::mutex> lk(st->m);
+    for (size_t ci = 0; ci < cfg_.contributors.size(); ci++) {
+        j["contributors"][cfg_.contributors[ci].id] = st->received[ci];
+        j["weights"][cfg_.contributors[ci].id] = st->weights[ci];
+    }
+    j["round"] = st->round;
+    j["layers"] = st->layers;
+    j["contributor_count"] = completeContributors(*st);
+    j["layers_complete"] = st->completed;
+    j["closed"] = st->closed;
+    j["close_reason"] = st->closeReason;
+    j["complete"] = st->complete;
+    j["error"] = st->error;
+    return j;
+}
@@ -0,0 +1,147 @@
+// server/src/roundAggregator.h
+// Incremental per-layer aggregation inside runMserver
+//
+// Contributions arrive either one layer at a time (streamed rounds) or as a
+// whole encrypted weights file (/uploadEncWeights*?round=<r>). Each layer is
+// re-encrypted into the aggregation (anchor) domain on a worker thread and
+// added into a running encrypted sum as soon as it is received. When the
+// last contribution of a layer is in, the sum is averaged and re-encrypted
+// into each delivery domain; after the last layer the same files the
+// sequential CLIs produce are written out, so downloads and decryption are
+// unchanged.
+//
+// A round may also close early (Policy): once a quorum of contributors has
+// sent every layer, or at a deadline. Closing seals every layer with what it
+// has; each layer is averaged over the weights actually added to it, and
+// later uploads for the closed round are discarded. Updates tagged with an
+// older round are discarded or folded into the current round at weight
+// stale_decay^age. The first update per contributor and layer wins.
+//
+// In a relay (tree aggregation) the finished layers are not averaged but
+// handed to `forward` as partial sums (LayerAccumulator::Partial); the
+// parent merges them like any other contribution via submitLayer(partial).
+
+#ifndef PPFL_ROUND_AGGREGATOR_H
+#define PPFL_ROUND_AGGREGATOR_H
+
+#include <chrono>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "ppfl/ppfl.h"
+#include "workerPool.h"
+
+struct AggregatorConfig {
+    std::string cc_path;
+
+    struct Contributor {
+        std::string id;            // client id as used in the upload URI
+        std::string rekey_path;    // into the anchor domain; empty for the anchor itself
+        std::string reenc_path;    // re-encrypted full model (optional)
+    };
+    struct Delivery {
+        std::string rekey_path;    // out of the anchor domain; empty = anchor domain
+        std::string output_path;   // assembled aggregate for this domain
+    };
+
+    struct Policy {
+        double quorum = 1.0;        // close once ceil(quorum * contributors) sent every layer
+        long deadline_ms = 0;       // close this long after the round's first upload (0 = never),
+                                    // provided at least one contributor is complete
+        bool decay_stale = false;   // false: discard updates for older rounds
+        double stale_decay = 0.5;   // true: fold them in at weight stale_decay^age ...
+        int max_staleness = 1;      // ... up to this age in rounds
+    };
+
+    std::vector<Contributor> contributors;
+    std::vector<Delivery> deliveries;
+    Policy policy;
+    size_t lane = 0;                // WorkerPool lane the crypto work is queued in
+
+    // Relay role: called on a worker with each finished layer's partial sum
+    // (round, layer, layers, partial); must throw on failure
+    std::function<void(int, size_t, size_t, const ppfl::json&)> forward;
+};
+
+class RoundAggregator {
+public:
+    RoundAggregator(AggregatorConfig cfg, WorkerPool& pool);
+
+    // Queue one encrypted layer (JSON text) from a client, or a partial sum
+    // from a child relay. Called from the event loop; returns false with
+    // `err` set if the upload is rejected.
+    bool submitLayer(const std::string& client_id, int round, size_t layer, size_t layers,
+                     std::string body, std::string& err, bool partial = false);
+
+    bool hasContributor(const std::string& client_id) const;
+
+    // Queue a whole encrypted weights file already saved at `path`
+    bool submitModel(const std::string& client_id, int round, const std::string& path, std::string& err);
+
+    // Close the current round if its deadline has passed; called periodically
+    // from the event loop
+    void tick();
+
+    // Accumulator state of the current round:
+    // {"round", "layers", "expected", "quorum", "contributors": {"<id>": layers received},
+    //  "weights": {"<id>": weight}, "contributor_count", "layers_complete",
+    //  "closed", "close_reason", "complete", "error"}
+    ppfl::json status() const;
+
+private:
+    struct LayerState {
+        std::mutex m;
+        ppfl::LayerAccumulator sum;             // anchor domain
+        std::vector<bool> present;              // per contributor
+        size_t contributors = 0;                // present count; sum.Count() also counts relayed clients
+        std::vector<ppfl::json> reencrypted;    // per contributor, kept only if reenc_path is set
+        std::vector<ppfl::json> delivered;      // per delivery
+        bool sealed = false;                    // round closed: no further Adds
+        bool done = false;                      // finishLayer claimed
+    };
+
+    struct RoundState {
+        int round = 0;
+        size_t layers = 0;
+        std::chrono::steady_clock::time_point started;
+        std::vector<std::unique_ptr<LayerState>> layerStates;
+
+        std::once_flag loadOnce;
+        std::shared_ptr<const ppfl::Context> ctx;
+        std::vector<ppfl::EvalKey> contribKeys;  // null for the anchor
+        std::vector<ppfl::EvalKey> deliveryKeys; // null for the anchor domain
+
+        std::mutex m;  // guards everything below
+        std::vector<size_t> received;            // layers added, per contributor
+        std::vector<double> weights;             // weight used, per contributor
+        size_t completed = 0;
+        bool closed = false;
+        std::string closeReason;
+        bool complete = false;
+        std::string error;
+    };
+
+    size_t contributorIndex(const std::string& client_id, std::string& err) const;
+    std::shared_ptr<RoundState> acquire(int round, size_t layers, double& weight, std::string& err);
+    size_t quorumCount() const;
+    static size_t completeContributors(const RoundState& st);  // st.m held
+    void load(RoundState& st) const;
+    void process(const std::shared_ptr<RoundState>& st, size_t contributor, size_t layer,
+                 ppfl::json enc, double weight, bool partial = false);
+    void close(const std::shared_ptr<RoundState>& st, const std::string& reason);
+    void seal(const std::shared_ptr<RoundState>& st, size_t layer);
+    void finishLayer(RoundState& st, size_t layer) const;
+    void finalize(RoundState& st) const;
+    void fail(RoundState& st, const std::string& what) const;
+
+    AggregatorConfig cfg_;
+    WorkerPool& pool_;
+
+    mutable std::mutex m_;
+    std::shared_ptr<RoundState> current_;
+};
+
+#endif  // PPFL_ROUND_AGGREGATOR_H
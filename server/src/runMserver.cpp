@@ -16,6 +16,23 @@
 #include <chrono>    // For server-side comm metrics
 #include <iomanip>   // For server-side comm metrics
 
+#include "http_client.h"
+#include "trace.h"
+#include "fileCache.h"
+#include "roundAggregator.h"
+#include "serverMetrics.h"
+#include "wireCodec.h"
+#include "uploadSessions.h"
+#include "diskIO.h"
+#include "ciphertextCheck.h"
+#include "cryptoJobs.h"
+
+#include <atomic>
+#include <deque>
+#include <map>
+#include <mutex>
+#include <sys/mman.h>
+
 //===========Server-side metrics============
 std::string server_metrics_file = "orchestration/metrics/server_comm_metrics.csv";    // For server-side comm metrics 
 
@@ -67,246 +84,1455 @@ static bool is_uri_equal(const struct mg_str uri, const char *path) {
 struct ServerConfig {
     std::string ip;
     int port;
+    size_t file_cache_mb = 256;            // mSConfig.FILE_CACHE_MB, memory for cached GET bodies
+    wire::Options wire;                    // mSConfig.COMPRESSION, Content-Encoding of replies
+    long upload_ttl_s = 86400;             // mSConfig.UPLOAD_TTL_S, idle chunked uploads are dropped after this
+    diskio::Options disk;                  // mSConfig.DISK_IO: BACKEND, BUFFER_KB, DEPTH
+    size_t disk_threads = 2;               // mSConfig.DISK_IO.THREADS, upload writers; 0 = on the event loop
+    size_t job_threads = 0;                // mSConfig.JOBS.THREADS, workers for POST /jobs; 0 = one per core
     std::string cc_path;
-    std::string pubkey_path_client1;
-    std::string pubkey_path_client2;
-    std::string rekey_path_client1;
-    std::string rekey_path_client2;
-    
-    std::string client_1_enc_w_p;
-    std::string client_2_enc_w_p;
-    
+
+    // Client registry, from CLIENTS.CLIENT_<id>_PUBLIC / _REKEY / _ENCRYPTED_WEIGHTS_PATH;
+    // its ids name the per-client routes (/uploadPubKeyC<id>, /sendPbKeyC<id>, ...)
+    struct ClientFiles {
+        std::string public_key;
+        std::string rekey;       // into the anchor's domain; the anchor's own leads to deliver_to's
+        std::string enc_weights;
+    };
+    std::map<std::string, ClientFiles> clients;
+    std::string anchor;                    // CLIENTS.ANCHOR, aggregation domain (default "2")
+    std::string deliver_to;                // CLIENTS.DELIVER_TO, gets the re-encrypted aggregate
+                                           // (default: the first other client)
+
     std::string output_domain_chg_p;
     
     std::string agg_w_p;
         
     std::string domain_chg_agg_w_p;
     
+    AggregatorConfig::Policy agg_policy;   // optional "AGGREGATION" block
+
+    // optional "LIMITS" block: this federation's share of the server
+    size_t max_uploads = 0;                // MAX_UPLOADS, uploads received or being written at once; 0 = unlimited
+    size_t max_workers = 0;                // MAX_WORKERS, aggregation workers its rounds may occupy; 0 = all
+    uint64_t max_upload_bytes = MG_MAX_RECV_SIZE; // MAX_UPLOAD_BYTES, largest chunked upload it may start
+    uint64_t max_decoded_bytes = MG_MAX_RECV_SIZE; // MAX_DECODED_BYTES, largest upload once decoded
+                                                   // (default MAX_UPLOAD_BYTES)
+    
+    // optional "TREE" block (hierarchical aggregation)
+    std::string tree_role = "root";        // root | relay
+    std::string tree_id;                   // relay: contributor id at the parent
+    std::string tree_upstream;             // relay: parent URL, http://host:port
+    std::vector<AggregatorConfig::Contributor> tree_children;
 };
 
-// Load configuration from JSON
-static ServerConfig load_config(const std::string &config_path) {
+static json read_config(const std::string &config_path) {
     std::ifstream f(config_path);
     if (!f.is_open()) throw std::runtime_error("Cannot open config: " + config_path);
-
     json j;
     f >> j;
-    ServerConfig cfg;
+    return j;
+}
+
+// Listener settings (mSConfig), shared by every federation
+static void load_listener(json &j, ServerConfig &cfg) {
     cfg.ip = j["mSConfig"]["SERVER_IP"].get<std::string>();
     cfg.port = j["mSConfig"]["SERVER_PORT"].get<int>();
+    cfg.file_cache_mb = j["mSConfig"].value("FILE_CACHE_MB", cfg.file_cache_mb);
+    cfg.upload_ttl_s = j["mSConfig"].value("UPLOAD_TTL_S", cfg.upload_ttl_s);
+    if (j["mSConfig"].contains("DISK_IO")) {
+        const json &d = j["mSConfig"]["DISK_IO"];
+        cfg.disk.backend = d.value("BACKEND", cfg.disk.backend);
+        cfg.disk.buffer_bytes = d.value("BUFFER_KB", cfg.disk.buffer_bytes >> 10) << 10;
+        cfg.disk.depth = d.value("DEPTH", cfg.disk.depth);
+        cfg.disk_threads = d.value("THREADS", cfg.disk_threads);
+    }
+    if (j["mSConfig"].contains("JOBS")) {
+        cfg.job_threads = j["mSConfig"]["JOBS"].value("THREADS", cfg.job_threads);
+    }
+    if (j["mSConfig"].contains("COMPRESSION")) {
+        const json &z = j["mSConfig"]["COMPRESSION"];
+        cfg.wire.gzip_level = z.value("LEVEL_GZIP", cfg.wire.gzip_level);
+        cfg.wire.zstd_level = z.value("LEVEL_ZSTD", cfg.wire.zstd_level);
+        cfg.wire.min_bytes = z.value("MIN_BYTES", cfg.wire.min_bytes);
+    }
+}
+
+static bool is_safe_id(const std::string &id);
+
+// CLIENT_<id>_<FIELD> entries of a CLIENTS block, by id
+static void load_clients(const json &block, ServerConfig &cfg) {
+    static const std::pair<const char *, std::string ServerConfig::ClientFiles::*> fields[] = {
+        {"_PUBLIC", &ServerConfig::ClientFiles::public_key},
+        {"_REKEY", &ServerConfig::ClientFiles::rekey},
+        {"_ENCRYPTED_WEIGHTS_PATH", &ServerConfig::ClientFiles::enc_weights},
+    };
+    for (const auto &kv : block.items()) {
+        const std::string &key = kv.key();
+        if (key.compare(0, 7, "CLIENT_") != 0) continue;
+        for (const auto &f : fields) {
+            size_t n = strlen(f.first);
+            if (key.size() <= 7 + n || key.compare(key.size() - n, n, f.first) != 0) continue;
+            std::string id = key.substr(7, key.size() - 7 - n);
+            if (!is_safe_id(id)) throw std::runtime_error("CLIENTS." + key + ": bad client id");
+            cfg.clients[id].*f.second = kv.value().get<std::string>();
+            break;
+        }
+    }
+    for (const auto &kv : cfg.clients) {
+        if (kv.second.public_key.empty()) throw std::runtime_error("CLIENTS: client " + kv.first + " has no PUBLIC key");
+    }
+    cfg.anchor = block.value("ANCHOR", std::string("2"));
+    if (!cfg.clients.count(cfg.anchor)) throw std::runtime_error("CLIENTS: anchor " + cfg.anchor + " is not a client");
+    for (const auto &kv : cfg.clients) {
+        if (kv.first == cfg.anchor) continue;
+        if (kv.second.rekey.empty()) throw std::runtime_error("CLIENTS: client " + kv.first + " has no REKEY");
+        if (cfg.deliver_to.empty()) cfg.deliver_to = kv.first;
+    }
+    cfg.deliver_to = block.value("DELIVER_TO", cfg.deliver_to);
+    if (!cfg.deliver_to.empty() && (!cfg.clients.count(cfg.deliver_to) || cfg.deliver_to == cfg.anchor)) {
+        throw std::runtime_error("CLIENTS: DELIVER_TO must be a client other than the anchor");
+    }
+}
+
+// One federation: its CryptoContext, clients, aggregation, tree position and limits
+static void load_federation(json &j, ServerConfig &cfg) {
     cfg.cc_path = j["CC"]["path"].get<std::string>();
-    cfg.pubkey_path_client1 = j["CLIENTS"]["CLIENT_1_PUBLIC"].get<std::string>();
-    cfg.pubkey_path_client2 = j["CLIENTS"]["CLIENT_2_PUBLIC"].get<std::string>();
-    cfg.rekey_path_client1 = j["CLIENTS"]["CLIENT_1_REKEY"].get<std::string>();
-    cfg.rekey_path_client2 = j["CLIENTS"]["CLIENT_2_REKEY"].get<std::string>();
-    
-    cfg.client_1_enc_w_p = j["CLIENTS"]["CLIENT_1_ENCRYPTED_WEIGHTS_PATH"].get<std::string>();
-    cfg.client_2_enc_w_p = j["CLIENTS"]["CLIENT_2_ENCRYPTED_WEIGHTS_PATH"].get<std::string>();
     
-    cfg.output_domain_chg_p = j["CLIENTS"]["OUTPUT_DOMAIN_CHANGED_PATH"].get<std::string>();
-    
-    cfg.agg_w_p = j["CLIENTS"]["AGGREGATED_ENCRYPTED_WEIGHTS_PATH"].get<std::string>();
+    // Relays only aggregate and forward, so they carry no CLIENTS block
+    if (j.contains("CLIENTS")) {
+        load_clients(j["CLIENTS"], cfg);
+        
+        cfg.output_domain_chg_p = j["CLIENTS"]["OUTPUT_DOMAIN_CHANGED_PATH"].get<std::string>();
+        
+        cfg.agg_w_p = j["CLIENTS"]["AGGREGATED_ENCRYPTED_WEIGHTS_PATH"].get<std::string>();
+        
+        cfg.domain_chg_agg_w_p = j["CLIENTS"]["OUTPUT_AGGREGATED_DOMAIN_CHANGED_PATH"].get<std::string>();
+    }
     
-    cfg.domain_chg_agg_w_p = j["CLIENTS"]["OUTPUT_AGGREGATED_DOMAIN_CHANGED_PATH"].get<std::string>();
+    if (j.contains("AGGREGATION")) {
+        const json &a = j["AGGREGATION"];
+        cfg.agg_policy.quorum = a.value("QUORUM", cfg.agg_policy.quorum);
+        cfg.agg_policy.deadline_ms = a.value("DEADLINE_MS", cfg.agg_policy.deadline_ms);
+        cfg.agg_policy.decay_stale = a.value("STALE_POLICY", std::string("discard")) == "decay";
+        cfg.agg_policy.stale_decay = a.value("STALE_DECAY", cfg.agg_policy.stale_decay);
+        cfg.agg_policy.max_staleness = a.value("MAX_STALENESS", cfg.agg_policy.max_staleness);
+    }
+
+    if (j.contains("LIMITS")) {
+        cfg.max_uploads = j["LIMITS"].value("MAX_UPLOADS", cfg.max_uploads);
+        cfg.max_workers = j["LIMITS"].value("MAX_WORKERS", cfg.max_workers);
+        cfg.max_upload_bytes = j["LIMITS"].value("MAX_UPLOAD_BYTES", cfg.max_upload_bytes);
+        cfg.max_decoded_bytes = j["LIMITS"].value("MAX_DECODED_BYTES", cfg.max_upload_bytes);
+    }
     
+    if (j.contains("TREE")) {
+        const json &t = j["TREE"];
+        cfg.tree_role = t.value("ROLE", std::string("root"));
+        cfg.tree_id = t.value("ID", std::string());
+        cfg.tree_upstream = t.value("UPSTREAM", std::string());
+        for (const auto &child : t.value("CHILDREN", json::array())) {
+            cfg.tree_children.push_back({child.at("ID").get<std::string>(), child.value("REKEY", std::string()), ""});
+        }
+        if (cfg.tree_role == "relay" && (cfg.tree_id.empty() || cfg.tree_upstream.empty())) {
+            throw std::runtime_error("TREE relay needs ID and UPSTREAM");
+        }
+    } else if (!j.contains("CLIENTS")) {
+        throw std::runtime_error("Config needs a CLIENTS or TREE block");
+    }
+}
+
+// Load configuration from JSON. Its own federation (CC, CLIENTS, ...) is
+// "default"; "TENANTS": {"<name>": "<sConfig path>"} adds further ones on
+// the same listener, each file's federation blocks read as above (its
+// mSConfig is ignored). The default federation may be left out if there are
+// tenants.
+static ServerConfig load_config(const std::string &config_path, std::map<std::string, ServerConfig> &tenants) {
+    json j = read_config(config_path);
+    ServerConfig cfg;
+    load_listener(j, cfg);
+    json tenant_paths = j.value("TENANTS", json::object());
+    for (const auto &kv : tenant_paths.items()) {
+        json t = read_config(kv.value().get<std::string>());
+        ServerConfig &tc = tenants[kv.key()];
+        load_listener(j, tc);
+        load_federation(t, tc);
+    }
+    if (j.contains("CC") || tenants.empty()) load_federation(j, cfg);
     return cfg;
 }
 
+// Bodies of CC.json, public keys and downloads, revalidated by mtime; set up in main()
+static FileCache *g_files = nullptr;
+
+// Compression levels for replies; set up in main()
+static wire::Options g_wire;
+
+// One federation served by this process, with its own CC.json, clients and
+// storage root (CC.json's directory). "default" (the top-level sConfig's)
+// owns the unprefixed routes; every tenant's are under /t/<name>/. Its
+// crypto work and upload writes run in its own lane of the shared pools.
+struct Tenant {
+    std::string name;
+    ServerConfig cfg;
+    size_t lane = 0;       // in the aggregation pool
+    size_t disk_lane = 0;  // in the disk pool
+    std::unique_ptr<RoundAggregator> agg;      // incremental aggregation of its rounds
+    std::unique_ptr<UploadSessions> uploads;   // chunked uploads, under <storage>/.uploads
+    std::unique_ptr<CiphertextCheck> ct_check; // parameters its encrypted uploads must match
+    std::unique_ptr<JobManager> jobs;          // POST /jobs, on the shared StealingPool
+
+    // Event loop only; atomics for /metrics
+    std::atomic<size_t> uploads_in_flight{0};  // POST/PUT received or being written
+    std::atomic<uint64_t> requests{0};
+    std::atomic<uint64_t> refused{0};          // 503s over cfg.max_uploads
+    std::atomic<uint64_t> upload_bytes{0};
+};
+
+// Set up in main(); fixed once the server listens
+static std::vector<std::unique_ptr<Tenant>> g_tenants;
+static std::map<std::string, Tenant *> g_tenant_names;
+
+// File I/O backend (mSConfig.DISK_IO); each thread that writes uploads or
+// fills the file cache has its own
+static diskio::Options g_disk_opts;
+static diskio::DiskIO &thread_disk() {
+    thread_local diskio::DiskIO io(g_disk_opts);
+    return io;
+}
+
+// A whole-file upload being written, and what its reply needs once it is
+struct UploadDone {
+    unsigned long conn_id = 0;
+    std::chrono::high_resolution_clock::time_point start;
+    Tenant *tenant = nullptr;
+    std::string uri, client_id, type, encoding, dest_path, weights_client;
+    std::string upload_id;     // chunked upload session being finished ("" = whole-file upload)
+    bool ciphertexts = false;  // check the stored file's ct_header ...
+    std::string ct_key;        // ... against this public key's domain ("" = any)
+    long round = -1;
+    size_t wire_bytes = 0, total_bytes = 0;
+    int64_t write_us = 0;
+    int status = 0;  // 200, or the HTTP status to fail with
+    std::string err;
+};
+
+// Disk threads write uploads while the event loop keeps serving the network;
+// each one queues its UploadDone and wakes the loop (the listener's
+// MG_EV_WAKEUP), which replies. Set up in main(); null = write on the loop.
+static WorkerPool *g_disk_pool = nullptr;
+static unsigned long g_listener_id = 0;
+static std::mutex g_uploads_done_mu;
+static std::deque<UploadDone> g_uploads_done;
+
+// Relay role: POST each finished layer's partial sum to the parent. Runs on
+// pool workers, so every worker keeps its own keep-alive connection to each
+// federation's parent.
+static void forward_partial(const ServerConfig &cfg, int round, size_t layer, size_t layers, const json &partial) {
+    thread_local std::map<std::string, std::unique_ptr<HttpClient>> upstreams;
+    auto &upstream = upstreams[cfg.tree_upstream];
+    if (!upstream) upstream = std::make_unique<HttpClient>(cfg.tree_upstream);
+
+    std::string path = "/uploadPartial?from=" + cfg.tree_id + "&round=" + std::to_string(round) +
+                       "&layer=" + std::to_string(layer) + "&layers=" + std::to_string(layers);
+    // gzip rather than zstd: every runMserver build can decode it
+    std::string body = partial.dump();
+    HttpHeaders headers;
+    if (body.size() >= cfg.wire.min_bytes) {
+        body = wire::Encode("gzip", body, cfg.wire);
+        headers.emplace_back("Content-Encoding", "gzip");
+    }
+    HttpResponse r = upstream->post(path, body, "application/json", headers);
+    if (r.status / 100 != 2) {
+        throw std::runtime_error("upstream rejected layer " + std::to_string(layer) + " (HTTP " +
+                                 std::to_string(r.status) + "): " + r.body);
+    }
+}
+
+static AggregatorConfig make_aggregator_config(const ServerConfig &cfg) {
+    // The anchor (client 2 by default) is the aggregation domain: every other
+    // client's layers are re-encrypted into it with that client's rekey, and
+    // the aggregate is delivered as-is to the anchor and re-encrypted with the
+    // anchor's rekey for deliver_to (client 1; same files as the sequential CLIs)
+    AggregatorConfig sc;
+    sc.cc_path = cfg.cc_path;
+    for (const auto &kv : cfg.clients) {
+        bool anchor = kv.first == cfg.anchor;
+        sc.contributors.push_back({kv.first, anchor ? "" : kv.second.rekey,
+                                   kv.first == cfg.deliver_to ? cfg.output_domain_chg_p : ""});
+    }
+    if (!cfg.clients.empty()) sc.deliveries.push_back({"", cfg.agg_w_p});
+    if (!cfg.deliver_to.empty()) sc.deliveries.push_back({cfg.clients.at(cfg.anchor).rekey, cfg.domain_chg_agg_w_p});
+    sc.policy = cfg.agg_policy;
+
+    // Tree mode: direct children (clients with their rekey into the anchor's
+    // domain, or relays whose partials are already in it) replace the clients
+    if (!cfg.tree_children.empty()) sc.contributors = cfg.tree_children;
+    if (cfg.tree_role == "relay") {
+        sc.deliveries.clear();
+        sc.forward = [&cfg](int round, size_t layer, size_t layers, const json &partial) {
+            forward_partial(cfg, round, layer, layers, partial);
+        };
+    }
+    return sc;
+}
+
+// Only ids made of [A-Za-z0-9_-] may name a storage directory
+static bool is_safe_id(const std::string &id) {
+    if (id.empty() || id.size() > 64) return false;
+    for (char ch : id) {
+        if (!isalnum((unsigned char) ch) && ch != '_' && ch != '-') return false;
+    }
+    return true;
+}
+
+static std::string query_str(struct mg_http_message *hm, const char *name) {
+    char buf[128];
+    if (mg_http_get_var(&hm->query, name, buf, sizeof(buf)) <= 0) return "";
+    return buf;
+}
+
+static long query_long(struct mg_http_message *hm, const char *name, long def) {
+    char buf[32];
+    if (mg_http_get_var(&hm->query, name, buf, sizeof(buf)) <= 0) return def;
+    return strtol(buf, nullptr, 10);
+}
+
+static std::string header_str(struct mg_http_message *hm, const char *name) {
+    struct mg_str *v = mg_http_get_header(hm, name);
+    return v ? std::string(v->buf, v->len) : "";
+}
+
+// Uploads are either the multipart form msend posts with curl -F, or the
+// raw body ppfl_xfer sends with metadata in X-PPFL-Client / X-PPFL-Type
+static bool is_multipart(struct mg_http_message *hm) {
+    return header_str(hm, "Content-Type").compare(0, 10, "multipart/") == 0;
+}
+
+// 415 for a body in an encoding this build cannot decode; the client retries
+// with one listed in Accept-Encoding (gzip always is)
+static void reply_unsupported_encoding(struct mg_connection *c, const std::string &encoding) {
+    mg_http_reply(c, 415, ("Accept-Encoding: " + std::string(wire::AcceptList()) + "\r\n").c_str(),
+                  "Unsupported encoding %s\n", encoding.c_str());
+}
+
+// Reply with a cached file body, or 304 if the client's If-None-Match still
+// matches its ETag. Returns the status sent (0 if the file is unreadable and
+// nothing was sent) and the body bytes in `sent`.
+//
+// A single Range is honoured (206, or 416 past the end) on whichever
+// representation is sent, so an interrupted compressed download resumes
+// compressed. If-Range with an outdated ETag gets the whole new body.
+//
+// Bodies of at least COMPRESSION.MIN_BYTES go out compressed if the client
+// accepts zstd or gzip. Each encoding is compressed once per file version and
+// has its own ETag ("<hash>-gzip"), so a client that switches encodings never
+// gets a 304 for the other representation.
+static int serve_cached(struct mg_connection *c, struct mg_http_message *hm, const std::string &path,
+                        const char *content_type, size_t &sent) {
+    sent = 0;
+    auto entry = g_files->get(path);
+    if (!entry) return 0;
+
+    const std::string *body = &entry->body;
+    std::string etag = entry->etag;
+    std::string encoding;
+    if (entry->body.size() >= g_wire.min_bytes) encoding = wire::Negotiate(header_str(hm, "Accept-Encoding"));
+    if (!encoding.empty()) {
+        auto it = entry->encoded.find(encoding);
+        if (it == entry->encoded.end()) {
+            std::string z = wire::Encode(encoding, entry->body, g_wire);
+            if (z.size() >= entry->body.size()) z.clear();  // incompressible: remember, send as-is
+            it = entry->encoded.emplace(encoding, std::move(z)).first;
+        }
+        if (it->second.empty()) {
+            encoding.clear();
+        } else {
+            body = &it->second;
+            etag.insert(etag.size() - 1, "-" + encoding);
+        }
+    }
+    std::string extra = "Vary: Accept-Encoding\r\nAccept-Ranges: bytes\r\n";
+    if (!encoding.empty()) extra += "Content-Encoding: " + encoding + "\r\n";
+
+    struct mg_str *inm = mg_http_get_header(hm, "If-None-Match");
+    if (inm && FileCache::Matches(std::string(inm->buf, inm->len), etag)) {
+        mg_printf(c, "HTTP/1.1 304 Not Modified\r\nETag: %s\r\n%sContent-Length: 0\r\n\r\n", etag.c_str(),
+                  extra.c_str());
+        c->is_resp = 0;
+        return 304;
+    }
+
+    size_t from = 0, to = body->size();
+    int ranged = 0;
+    std::string range = header_str(hm, "Range"), if_range = header_str(hm, "If-Range");
+    if (!range.empty() && (if_range.empty() || if_range == etag)) ranged = FileCache::ParseRange(range, body->size(), from, to);
+    if (ranged < 0) {
+        mg_printf(c, "HTTP/1.1 416 Range Not Satisfiable\r\nETag: %s\r\n%sContent-Range: bytes */%lu\r\n"
+                  "Content-Length: 0\r\n\r\n", etag.c_str(), extra.c_str(), (unsigned long) body->size());
+        c->is_resp = 0;
+        return 416;
+    }
+    if (ranged) {
+        extra += "Content-Range: bytes " + std::to_string(from) + "-" + std::to_string(to - 1) + "/" +
+                 std::to_string(body->size()) + "\r\n";
+    }
+    mg_printf(c,
+              "HTTP/1.1 %s\r\nContent-Type: %s\r\nETag: %s\r\nCache-Control: no-cache\r\n%s"
+              "Content-Length: %lu\r\n\r\n",
+              ranged ? "206 Partial Content" : "200 OK", content_type, etag.c_str(), extra.c_str(),
+              (unsigned long) (to - from));
+    if (mg_vcmp(&hm->method, "HEAD") != 0) {
+        mg_send(c, body->data() + from, to - from);
+        sent = to - from;
+    }
+    c->is_resp = 0;
+    return ranged ? 206 : 200;
+}
+
 // --- Handlers ---
 static void handle_getCC(struct mg_connection *c, struct mg_http_message *hm, const std::string &cc_path) {
-    std::cout << "[SERVER] Serving " << cc_path << std::endl;
-    struct mg_http_serve_opts opts = {0};
-    mg_http_serve_file(c, hm, cc_path.c_str(), &opts);
+    ppfl::trace::Span span("GET /getCC");
+    size_t sent;
+    int status = serve_cached(c, hm, cc_path, "application/json", sent);
+    if (status == 0) {
+        mg_http_reply(c, 404, "", "Not found\n");
+        return;
+    }
+    span.args().bytes = sent;
+    std::cout << "[SERVER] Serving " << cc_path << (status == 304 ? " (not modified)" : "") << std::endl;
 }
 
 static void handle_sendPbKey(struct mg_connection *c, struct mg_http_message *hm, const std::string &pubkey_path) {
-    std::ifstream f(pubkey_path, std::ios::binary);
-    if (!f.is_open()) {
+    size_t sent;
+    int status = serve_cached(c, hm, pubkey_path, "application/octet-stream", sent);
+    if (status == 0) {
         mg_http_reply(c, 500, "", "Error: cannot open pubkey file\n");
         return;
     }
-    std::ostringstream buffer;
-    buffer << f.rdbuf();
-    f.close();
-    std::cout << "[SERVER] Serving Public Key from " << pubkey_path << std::endl;
-    mg_http_reply(c, 200, "Content-Type: application/octet-stream\r\n", "%s", buffer.str().c_str());
+    std::cout << "[SERVER] Serving Public Key from " << pubkey_path << (status == 304 ? " (not modified)" : "")
+              << std::endl;
 }
 
-// Buffered multipart upload (pre-7.x compatible)
-static void handle_upload(struct mg_connection *c, struct mg_http_message *hm, const std::string &dest_path) {
+// Decode an upload's file parts into dest_path: chunk by chunk into a temp
+// file, renamed over dest_path only once complete, so a corrupt body never
+// replaces a good file. Encrypted weights (ct_check set) must also pass its
+// check of every layer against ct_key's domain. The decoded file may not
+// exceed max_out bytes. Returns 0, or the HTTP status to fail with and why.
+static int store_upload(const std::vector<struct mg_str> &files, const std::string &encoding,
+                        const std::string &dest_path, size_t max_out, size_t &total_bytes, std::string &err,
+                        CiphertextCheck *ct_check = nullptr, const std::string &ct_key = "") {
+    fs::path p(dest_path);
+    if (p.has_parent_path()) fs::create_directories(p.parent_path());
 
-    auto start = std::chrono::high_resolution_clock::now();
+    // An identity body is exactly the file's size: preallocate it
+    std::string tmp_path = dest_path + ".part";
+    uint64_t size_hint = 0;
+    if (encoding.empty() || encoding == "identity") {
+        for (const auto &f : files) size_hint += f.len;
+    }
+    auto writer = thread_disk().open(tmp_path, size_hint, err);
+    if (!writer) return 500;
+    std::ostream out(writer.get());
+    total_bytes = 0;
+    try {
+        for (const auto &f : files) total_bytes += wire::DecodeTo(encoding, f.buf, f.len, out, max_out - total_bytes);
+    } catch (const wire::WireError &e) {
+        writer->close();
+        fs::remove(tmp_path);
+        err = e.what();
+        return 400;
+    }
+    bool written = writer->close() && out;
+    std::error_code ec;
+    if (written && ct_check) {
+        bool valid = false;
+        try {
+            valid = ct_check->checkModel(ppfl::ReadJsonFile(tmp_path), ct_key, err);
+        } catch (const std::exception &e) {
+            err = e.what();
+        }
+        if (!valid) {
+            fs::remove(tmp_path, ec);
+            err = "ciphertexts do not match the server's CryptoContext or key: " + err;
+            return 422;
+        }
+    }
+    if (written) fs::rename(tmp_path, dest_path, ec);
+    if (!written || ec) {
+        fs::remove(tmp_path, ec);
+        err = "cannot write file";
+        return 500;
+    }
+    return 0;
+}
 
-    if (mg_vcmp(&hm->method, "POST") != 0) {
-        mg_http_reply(c, 405, "", "Method not allowed\n");
+// Decode and write an upload's file parts; fills in u's result
+static void write_upload(const std::vector<struct mg_str> &files, UploadDone &u) {
+    int64_t t0 = metrics::NowUs();
+    int fail = store_upload(files, u.encoding, u.dest_path, u.tenant->cfg.max_decoded_bytes, u.total_bytes, u.err,
+                            u.ciphertexts ? u.tenant->ct_check.get() : nullptr, u.ct_key);
+    u.write_us = metrics::NowUs() - t0;
+    u.status = fail ? fail : 200;
+}
+
+// Check a completed chunked upload's data file against its SHA-256 (if the
+// client gave one), then decode it, mapped, into u.dest_path; fills in u's result
+static void write_chunked_upload(const std::string &data_path, const std::string &sha256, uint64_t size,
+                                 UploadDone &u) {
+    int64_t t0 = metrics::NowUs();
+    if (!sha256.empty() && UploadSessions::FileSha256(data_path) != sha256) {
+        u.status = 422;
+        u.err = "upload checksum mismatch";
+        return;
+    }
+    // Decoded straight from the mapped data file; nothing is buffered
+    int fd = ::open(data_path.c_str(), O_RDONLY);
+    void *data = fd >= 0 && size ? mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0) : nullptr;
+    if (fd < 0 || data == MAP_FAILED) {
+        if (fd >= 0) ::close(fd);
+        u.status = 500;
+        u.err = "cannot read upload";
         return;
     }
+    std::vector<struct mg_str> files = {{(char *) data, (size_t) size}};
+    int fail = store_upload(files, u.encoding, u.dest_path, u.tenant->cfg.max_decoded_bytes, u.total_bytes, u.err,
+                            u.ciphertexts ? u.tenant->ct_check.get() : nullptr, u.ct_key);
+    if (data) munmap(data, size);
+    ::close(fd);
+    u.write_us = metrics::NowUs() - t0;
+    u.status = fail ? fail : 200;
+}
 
-    fs::path p(dest_path);
-    if (p.has_parent_path()) fs::create_directories(p.parent_path());
+static void submit_weights(Tenant &t, const std::string &client_id, long round, const std::string &dest_path);
+
+// Reply to an upload once it is written (c is null if the client has gone
+// meanwhile) and feed encrypted weights to the aggregator. A finished chunked
+// upload's session goes with it unless it failed for want of resources.
+static void finish_upload(struct mg_connection *c, const UploadDone &u) {
+    std::shared_ptr<UploadSessions::Session> session;
+    if (!u.upload_id.empty() && (session = u.tenant->uploads->find(u.upload_id))) {
+        session->finishing = false;
+        if (u.status == 200 || u.status == 400 || u.status == 422) u.tenant->uploads->remove(u.upload_id);
+    }
+    if (u.status != 200) {
+        std::cerr << "[SERVER] Upload to " << u.dest_path << " failed: " << u.err << std::endl;
+        if (c) mg_http_reply(c, u.status, "", "Error: %s\n", u.err.c_str());
+        return;
+    }
+    metrics::AddDiskWrite(u.total_bytes, u.write_us);
+    metrics::ClientSeen(u.client_id);
+
+    auto end = std::chrono::high_resolution_clock::now();
+    long latency_ms = std::chrono::duration_cast<std::chrono::milliseconds>(end - u.start).count();
+    
+    if (!u.upload_id.empty()) {
+        std::cout << "[SERVER] Upload " << u.upload_id << " complete: " << u.total_bytes << " bytes saved to "
+                  << u.dest_path << std::endl;
+    } else {
+        std::cout << "[SERVER] Received "<<u.total_bytes<<" bytes";
+        if (!u.encoding.empty()) std::cout << " (" << u.wire_bytes << " " << u.encoding << ")";
+        std::cout << ", and saved Public Key to " << u.dest_path << std::endl;
+    }
+    if (c) mg_http_reply(c, 200, "Content-Type: application/json\r\n", "{\"status\":\"received\"}");
+    
+    // Log metric
+    log_server_metric("POST", u.uri,
+                      u.client_id, u.type, u.dest_path,
+                      u.total_bytes,
+                      0,              // bytes_sent (server doesnt send in POST)
+                      u.wire_bytes,
+                      latency_ms, 200);
+    if (!u.weights_client.empty()) submit_weights(*u.tenant, u.weights_client, u.round, u.dest_path);
+}
+
+// Buffered multipart upload (pre-7.x compatible). The file is written by a
+// disk thread when there is one and this request owns the whole receive
+// buffer (nothing pipelined behind it): the buffer is handed over as is and
+// the reply follows from finish_upload() on the event loop. ct_key is set for
+// encrypted weights (see upload_ct_key).
+static void handle_upload(struct mg_connection *c, struct mg_http_message *hm, Tenant &t, const std::string &dest_path,
+                          const std::string &weights_client, const std::string *ct_key) {
 
-    std::ofstream out(dest_path, std::ios::binary);
-    if (!out.is_open()) {
-        mg_http_reply(c, 500, "", "Error: cannot open file for writing\n");
+    auto start = std::chrono::high_resolution_clock::now();
+    ppfl::trace::Span span("POST " + std::string(hm->uri.buf, hm->uri.len), {query_long(hm, "round", -1)});
+
+    if (mg_vcmp(&hm->method, "POST") != 0) {
+        mg_http_reply(c, 405, "", "Method not allowed\n");
         return;
     }
 
+    // Parts first: the "encoding" field (gzip | zstd, set by msend when it
+    // compressed the file) decides how the file part is written
     struct mg_http_part part;
     size_t ofs = 0;
-    size_t total_bytes = 0;
+    std::vector<struct mg_str> files;
+    std::string encoding;
     std::string client_id = "-";
     std::string type = "-";
     
-    while ((ofs = mg_http_next_multipart(hm->body, ofs, &part)) > 0) {
+    bool multipart = is_multipart(hm);
+    if (!multipart) {
+        files.push_back(hm->body);
+        encoding = header_str(hm, "Content-Encoding");
+        if (mg_http_get_header(hm, "X-PPFL-Client")) client_id = header_str(hm, "X-PPFL-Client");
+        if (mg_http_get_header(hm, "X-PPFL-Type")) type = header_str(hm, "X-PPFL-Type");
+    }
+    while (multipart && (ofs = mg_http_next_multipart(hm->body, ofs, &part)) > 0) {
         std::string name(part.name.buf, part.name.len);
         if (name == "file") {
-            out.write(part.body.buf, part.body.len);
-            total_bytes += part.body.len;
+            files.push_back(part.body);
+        } else if (name == "encoding") {
+            encoding = std::string(part.body.buf, part.body.len);
         } else if (name == "client_id") {
             client_id = std::string(part.body.buf, part.body.len);
         } else if (name == "type") {
             type = std::string(part.body.buf, part.body.len);
         }
     }
-    out.close();
+    if (!wire::Supported(encoding)) {
+        reply_unsupported_encoding(c, encoding);
+        return;
+    }
+
+    UploadDone u;
+    u.tenant = &t;
+    u.conn_id = c->id;
+    u.start = start;
+    u.uri = std::string(hm->uri.buf, hm->uri.len);
+    u.client_id = client_id;
+    u.type = type;
+    u.encoding = encoding;
+    u.dest_path = dest_path;
+    u.weights_client = weights_client;
+    u.ciphertexts = ct_key != nullptr;
+    if (ct_key) u.ct_key = *ct_key;
+    u.round = query_long(hm, "round", -1);
+    for (const auto &f : files) u.wire_bytes += f.len;
+    t.upload_bytes.fetch_add(u.wire_bytes, std::memory_order_relaxed);
+    span.args().client = client_id == "-" ? "" : client_id;
+
+    if (g_disk_pool && c->recv.len == hm->message.len) {
+        // From here on hm points into `body`, which the disk thread frees
+        struct mg_iobuf body = c->recv;
+        c->recv.buf = nullptr;
+        c->recv.size = c->recv.len = 0;
+        struct mg_mgr *mgr = c->mgr;
+        g_disk_pool->submit([u, files, body, mgr]() mutable {
+            ppfl::trace::Span write_span("disk write " + u.uri, {u.round, u.client_id == "-" ? "" : u.client_id});
+            write_upload(files, u);
+            write_span.args().bytes = u.total_bytes;
+            mg_iobuf_free(&body);
+            {
+                std::lock_guard<std::mutex> lk(g_uploads_done_mu);
+                g_uploads_done.push_back(std::move(u));
+            }
+            mg_wakeup(mgr, g_listener_id, "", 0);
+        }, t.disk_lane);
+        return;
+    }
+
+    write_upload(files, u);
+    span.args().bytes = u.total_bytes;
+    finish_upload(c, u);
+}
+
+// One encrypted layer of a streamed round:
+// POST /uploadEncLayerC<i>?round=<r>&layer=<k>&layers=<n>, multipart "file" or raw body = layer JSON
+// or, from a child relay, a partial sum:
+// POST /uploadPartial?from=<relay>&round=<r>&layer=<k>&layers=<n>, raw JSON body
+// Its ct_header must match CC.json and, if ct_key is set, that public key's domain.
+static void handle_stream_layer(struct mg_connection *c, struct mg_http_message *hm, Tenant &t,
+                                const std::string &client_id, bool partial = false, const std::string &ct_key = "") {
+    auto start = std::chrono::high_resolution_clock::now();
+    ppfl::trace::Span span("POST " + std::string(hm->uri.buf, hm->uri.len), {-1, client_id});
+
+    long round = query_long(hm, "round", -1);
+    long layer = query_long(hm, "layer", -1);
+    long layers = query_long(hm, "layers", -1);
+    if (round < 0 || layer < 0 || layers <= 0) {
+        mg_http_reply(c, 400, "", "Missing round/layer/layers\n");
+        return;
+    }
+
+    // Raw bodies (partials, ppfl_xfer) carry Content-Encoding, multipart layers an "encoding" field
+    struct mg_str raw = {nullptr, 0};
+    std::string encoding;
+    if (partial || !is_multipart(hm)) {
+        raw = hm->body;
+        encoding = header_str(hm, "Content-Encoding");
+    } else {
+        struct mg_http_part part;
+        size_t ofs = 0;
+        while ((ofs = mg_http_next_multipart(hm->body, ofs, &part)) > 0) {
+            std::string name(part.name.buf, part.name.len);
+            if (name == "file") raw = part.body;
+            else if (name == "encoding") encoding.assign(part.body.buf, part.body.len);
+        }
+    }
+    if (raw.len == 0) {
+        mg_http_reply(c, 400, "", "Missing file part\n");
+        return;
+    }
+    if (!wire::Supported(encoding)) {
+        reply_unsupported_encoding(c, encoding);
+        return;
+    }
+    std::string body;
+    try {
+        body = wire::Decode(encoding, raw.buf, raw.len, t.cfg.max_decoded_bytes);
+    } catch (const wire::WireError &e) {
+        mg_http_reply(c, 400, "", "Error: %s\n", e.what());
+        return;
+    }
+    std::string err;
+    if (!t.ct_check->check(body.data(), body.size(), ct_key, err)) {
+        std::cerr << "[SERVER] Rejected layer " << layer << " from client " << client_id << ": " << err << std::endl;
+        mg_http_reply(c, 422, "Content-Type: application/json\r\n", "{\"status\":\"rejected\",\"error\":%m}",
+                      MG_ESC(err.c_str()));
+        return;
+    }
+    size_t total_bytes = body.size();
+    t.upload_bytes.fetch_add(raw.len, std::memory_order_relaxed);
+    metrics::ClientSeen(client_id);
+    span.args().round = round;
+    span.args().layer = layer;
+    span.args().bytes = total_bytes;
+
+    if (!t.agg->submitLayer(client_id, (int) round, (size_t) layer, (size_t) layers, std::move(body), err, partial)) {
+        std::cerr << "[SERVER] [agg] Rejected layer " << layer << " from client " << client_id << ": " << err << std::endl;
+        mg_http_reply(c, 409, "Content-Type: application/json\r\n", "{\"status\":\"rejected\",\"error\":%m}",
+                      MG_ESC(err.c_str()));
+        return;
+    }
+    mg_http_reply(c, 202, "Content-Type: application/json\r\n", "{\"status\":\"queued\"}");
 
     auto end = std::chrono::high_resolution_clock::now();
     long latency_ms = std::chrono::duration_cast<std::chrono::milliseconds>(end - start).count();
-    
-    std::cout << "[SERVER] Received "<<total_bytes<<" bytes, and saved Public Key to " << dest_path << std::endl;
-    mg_http_reply(c, 200, "Content-Type: application/json\r\n", "{\"status\":\"received\"}");
-    
-    // Log metric
     log_server_metric("POST", std::string(hm->uri.buf, hm->uri.len),
-                      client_id, type, dest_path,
-                      total_bytes,
-                      0,              // bytes_sent (server doesnt send in POST)
-                      total_bytes,
-                      latency_ms, 200);
+                      client_id, partial ? "partial" : "layer", "layer_" + std::to_string(layer),
+                      total_bytes, 0, raw.len, latency_ms, 202);
+}
+
+// Whole encrypted weights file from `client_id`, already saved to dest_path:
+// with ?round=<r> it is also added into the running aggregate
+static void submit_weights(Tenant &t, const std::string &client_id, long round, const std::string &dest_path) {
+    if (round < 0) return;
+    std::string err;
+    if (!t.agg->submitModel(client_id, (int) round, dest_path, err)) {
+        std::cerr << "[SERVER] [agg] Rejected weights from client " << client_id << ": " << err << std::endl;
+    }
+}
+
+// Registered client a per-client route (<prefix><id>, e.g. /uploadPubKeyC1)
+// is for; null if `route` is not <prefix> followed by a client id
+static const ServerConfig::ClientFiles *route_client(const ServerConfig &cfg, const std::string &route,
+                                                     const char *prefix, std::string *id = nullptr) {
+    size_t n = strlen(prefix);
+    if (route.size() <= n || route.compare(0, n, prefix) != 0) return nullptr;
+    auto it = cfg.clients.find(route.substr(n));
+    if (it == cfg.clients.end()) return nullptr;
+    if (id) *id = it->first;
+    return &it->second;
+}
+
+// File written by a whole-file upload route (path + query), "" if `route` is
+// not one. weights_client is set for encrypted weights, which also feed the
+// aggregator; /uploadEncWeights?client=<id> is the tree-mode route for any child.
+static std::string upload_dest(const Tenant &t, const std::string &route, struct mg_str query,
+                               std::string &weights_client) {
+    const ServerConfig &cfg = t.cfg;
+    weights_client.clear();
+    const ServerConfig::ClientFiles *client;
+    if ((client = route_client(cfg, route, "/uploadPubKeyC"))) return client->public_key;
+    if ((client = route_client(cfg, route, "/uploadReKeyC"))) return client->rekey;
+    if (route == "/uploadDomainChange") return cfg.output_domain_chg_p;
+    if (route == "/uploadAggregated") return cfg.agg_w_p;
+    if (route == "/uploadDomainChangeAgg") return cfg.domain_chg_agg_w_p;
+    if ((client = route_client(cfg, route, "/uploadEncWeightsC", &weights_client))) {
+        if (client->enc_weights.empty()) weights_client.clear();
+        return client->enc_weights;
+    }
+    if (route == "/uploadEncWeights") {
+        char id[128];
+        if (mg_http_get_var(&query, "client", id, sizeof(id)) <= 0 || !is_safe_id(id) || !t.agg->hasContributor(id)) {
+            return "";
+        }
+        weights_client = id;
+        return (fs::path(cfg.cc_path).parent_path() / ("client_" + weights_client) / "encrypted_weights.json").string();
+    }
+    return "";
+}
+
+// Public key of the domain a whole-file upload route's ciphertexts must be
+// in: each client's weights under that client's key; the re-encrypted
+// weights and the aggregate under the anchor's; the aggregate delivered
+// back under deliver_to's. "" for tree children (any domain, checked
+// against CC.json only). False if the route carries no ciphertexts (keys).
+static bool upload_ct_key(const ServerConfig &cfg, const std::string &route, std::string &ct_key) {
+    ct_key.clear();
+    const ServerConfig::ClientFiles *client = route_client(cfg, route, "/uploadEncWeightsC");
+    if (client) {
+        ct_key = client->public_key;
+    } else if (route == "/uploadDomainChangeAgg") {
+        if (!cfg.deliver_to.empty()) ct_key = cfg.clients.at(cfg.deliver_to).public_key;
+    } else if (route == "/uploadDomainChange" || route == "/uploadAggregated") {
+        if (!cfg.anchor.empty()) ct_key = cfg.clients.at(cfg.anchor).public_key;
+    } else if (route != "/uploadEncWeights") {
+        return false;
+    }
+    return true;
+}
+
+// Generic per-client streaming routes for tree mode, where children are not just clients 1/2:
+// /uploadEncLayer?client=<id>&..., /uploadPartial?from=<id>&...
+static void handle_child_upload(struct mg_connection *c, struct mg_http_message *hm, Tenant &t, const char *id_var,
+                                bool partial) {
+    std::string id = query_str(hm, id_var);
+    if (!is_safe_id(id) || !t.agg->hasContributor(id)) {
+        mg_http_reply(c, 404, "", "Unknown child %s\n", id.c_str());
+        return;
+    }
+    handle_stream_layer(c, hm, t, id, partial);
+}
+
+// Resumable uploads of whole files, for payloads too large or links too
+// flaky for a single POST to the target route:
+//   POST   /upload/start          {"target":"/uploadEncWeightsC1?round=3","size":n,"chunk_size":c,
+//                                  "encoding":"zstd","sha256":"<hex>","client_id":"1","type":"weights"}
+//                                  -> 201 {"upload_id":"<id>","chunk_size":c}
+//   PUT    /upload/<id>?offset=o   one chunk, X-Chunk-SHA256: <hex>
+//   GET    /upload/<id>            -> {"size","chunk_size","received","missing":[offsets]}
+//   POST   /upload/<id>/finish     -> what the target route replies, once every chunk is in
+//   DELETE /upload/<id>
+// size, chunks and sha256 are the bytes as sent; `encoding` is decoded at finish.
+static void handle_chunked_upload(struct mg_connection *c, struct mg_http_message *hm, Tenant &t) {
+    std::string uri(hm->uri.buf, hm->uri.len);
+    std::string id = uri.substr(strlen("/upload/"));
+    bool finish = id.size() > 7 && id.compare(id.size() - 7, 7, "/finish") == 0;
+    if (finish) id.resize(id.size() - 7);
+    const char *json_hdr = "Content-Type: application/json\r\n";
+
+    if (id == "start" && mg_vcmp(&hm->method, "POST") == 0) {
+        json req = json::parse(std::string(hm->body.buf, hm->body.len), nullptr, false);
+        if (!req.is_object() || !req.contains("target") || !req.contains("size")) {
+            mg_http_reply(c, 400, "", "Expected JSON with target and size\n");
+            return;
+        }
+        // json::value throws on a field of the wrong type; check them all first
+        for (const char *k : {"target", "encoding", "sha256", "client_id", "type"}) {
+            if (req.contains(k) && !req[k].is_string()) {
+                mg_http_reply(c, 400, "", "%s must be a string\n", k);
+                return;
+            }
+        }
+        for (const char *k : {"size", "chunk_size"}) {
+            if (req.contains(k) && !req[k].is_number_unsigned()) {
+                mg_http_reply(c, 400, "", "%s must be a non-negative integer\n", k);
+                return;
+            }
+        }
+        std::string target = req.value("target", std::string());
+        size_t q = target.find('?');
+        std::string route = target.substr(0, q);
+        struct mg_str query = mg_str(q == std::string::npos ? "" : target.c_str() + q + 1);
+        std::string weights_client;
+        if (upload_dest(t, route, query, weights_client).empty()) {
+            mg_http_reply(c, 404, "", "Not an upload route: %s\n", target.c_str());
+            return;
+        }
+        std::string encoding = req.value("encoding", std::string());
+        if (!wire::Supported(encoding)) {
+            reply_unsupported_encoding(c, encoding);
+            return;
+        }
+        std::string err;
+        std::shared_ptr<UploadSessions::Session> s;
+        try {
+            s = t.uploads->create(target, req.value("size", (uint64_t) 0), req.value("chunk_size", (uint64_t) 4 << 20),
+                                  encoding, req.value("sha256", std::string()), req.value("client_id", std::string("-")),
+                                  req.value("type", std::string("-")), err);
+        } catch (const std::exception &e) {
+            err = e.what();
+        }
+        if (!s) {
+            mg_http_reply(c, 400, "", "Error: %s\n", err.c_str());
+            return;
+        }
+        std::cout << "[SERVER] Upload " << s->id << " started for " << target << " (" << s->size << " bytes)"
+                  << std::endl;
+        mg_http_reply(c, 201, json_hdr, "{\"upload_id\":%m,\"chunk_size\":%llu}\n", MG_ESC(s->id.c_str()),
+                      (unsigned long long) s->chunk_size);
+        return;
+    }
+
+    auto s = t.uploads->find(id);
+    if (!s) {
+        mg_http_reply(c, 404, "", "Unknown upload %s\n", id.c_str());
+        return;
+    }
+
+    if (s->finishing && mg_vcmp(&hm->method, "GET") != 0) {
+        mg_http_reply(c, 409, "", "Upload %s is being stored\n", s->id.c_str());
+
+    } else if (!finish && mg_vcmp(&hm->method, "PUT") == 0) {
+        long offset = query_long(hm, "offset", -1);
+        std::string err;
+        if (offset < 0 || !t.uploads->writeChunk(*s, (uint64_t) offset, hm->body.buf, hm->body.len,
+                                                 header_str(hm, "X-Chunk-SHA256"), err)) {
+            mg_http_reply(c, offset < 0 ? 400 : 422, "", "Error: %s\n", offset < 0 ? "missing offset" : err.c_str());
+            return;
+        }
+        mg_http_reply(c, 200, json_hdr, "{\"received\":%llu}\n", (unsigned long long) s->received());
+
+    } else if (!finish && mg_vcmp(&hm->method, "GET") == 0) {
+        json st = {{"upload_id", s->id}, {"target", s->target}, {"size", s->size}, {"chunk_size", s->chunk_size},
+                   {"received", s->received()}, {"missing", UploadSessions::Missing(*s)}};
+        mg_http_reply(c, 200, json_hdr, "%s\n", st.dump().c_str());
+
+    } else if (!finish && mg_vcmp(&hm->method, "DELETE") == 0) {
+        t.uploads->remove(s->id);
+        mg_http_reply(c, 204, "", "");
+
+    } else if (finish && mg_vcmp(&hm->method, "POST") == 0) {
+        ppfl::trace::Span span("POST /upload/finish");
+        if (!s->complete()) {
+            json st = {{"status", "incomplete"}, {"missing", UploadSessions::Missing(*s)}};
+            mg_http_reply(c, 409, json_hdr, "%s\n", st.dump().c_str());
+            return;
+        }
+        size_t q = s->target.find('?');
+        std::string route = s->target.substr(0, q);
+        struct mg_str query = mg_str(q == std::string::npos ? "" : s->target.c_str() + q + 1);
+        UploadDone u;
+        u.tenant = &t;
+        u.conn_id = c->id;
+        u.start = std::chrono::high_resolution_clock::now();
+        u.uri = s->target;
+        u.upload_id = s->id;
+        u.client_id = s->client_id;
+        u.type = s->type;
+        u.encoding = s->encoding;
+        u.dest_path = upload_dest(t, route, query, u.weights_client);
+        if (u.dest_path.empty()) {
+            t.uploads->remove(s->id);
+            mg_http_reply(c, 404, "", "Not an upload route: %s\n", s->target.c_str());
+            return;
+        }
+        u.ciphertexts = upload_ct_key(t.cfg, route, u.ct_key);
+        char round[32];
+        u.round = mg_http_get_var(&query, "round", round, sizeof(round)) > 0 ? strtol(round, nullptr, 10) : -1;
+        u.wire_bytes = s->size;
+        span.args().client = s->client_id == "-" ? "" : s->client_id;
+
+        // Hashing and decoding a whole model is disk work: done on a disk
+        // thread like handle_upload's, the session held until the reply
+        std::string data_path = t.uploads->dataPath(s->id);
+        if (g_disk_pool && c->recv.len == hm->message.len) {
+            s->finishing = true;
+            struct mg_mgr *mgr = c->mgr;
+            g_disk_pool->submit([u, data_path, sha256 = s->sha256, size = s->size, mgr]() mutable {
+                ppfl::trace::Span write_span("disk write " + u.uri, {u.round, u.client_id == "-" ? "" : u.client_id});
+                write_chunked_upload(data_path, sha256, size, u);
+                write_span.args().bytes = u.total_bytes;
+                {
+                    std::lock_guard<std::mutex> lk(g_uploads_done_mu);
+                    g_uploads_done.push_back(std::move(u));
+                }
+                mg_wakeup(mgr, g_listener_id, "", 0);
+            }, t.disk_lane);
+            return;
+        }
+
+        write_chunked_upload(data_path, s->sha256, s->size, u);
+        span.args().bytes = u.total_bytes;
+        finish_upload(c, u);
+
+    } else {
+        mg_http_reply(c, 405, "", "Method not allowed\n");
+    }
+}
+
+static void agg_tick(void *arg) {
+    static_cast<RoundAggregator *>(arg)->tick();
+}
+
+static void upload_tick(void *arg) {
+    static_cast<UploadSessions *>(arg)->expire();
+}
+
+static void handle_agg_status(struct mg_connection *c, const Tenant &t) {
+    mg_http_reply(c, 200, "Content-Type: application/json\r\n", "%s\n", t.agg->status().dump().c_str());
+}
+
+// POST /jobs queues a crypto job (cryptoJobs.h); GET /jobs lists the jobs
+// kept, GET /jobs/<id> reports one
+static void handle_jobs(struct mg_connection *c, struct mg_http_message *hm, Tenant &t) {
+    std::string uri(hm->uri.buf, hm->uri.len);
+    if (mg_vcmp(&hm->method, "POST") == 0 && uri == "/jobs") {
+        json spec = json::parse(hm->body.buf, hm->body.buf + hm->body.len, nullptr, false);
+        std::string err;
+        std::string id;
+        try {
+            id = spec.is_discarded() ? "" : t.jobs->submit(spec, err);
+        } catch (const json::exception &e) {
+            err = e.what();
+        }
+        if (id.empty()) {
+            mg_http_reply(c, 400, "", "Bad job: %s\n", spec.is_discarded() ? "invalid JSON" : err.c_str());
+            return;
+        }
+        json reply = t.jobs->status(id);
+        mg_http_reply(c, 202, "Content-Type: application/json\r\n", "%s\n",
+                      json{{"job_id", id}, {"status", reply["state"]}}.dump().c_str());
+    } else if (mg_vcmp(&hm->method, "GET") == 0 && uri == "/jobs") {
+        mg_http_reply(c, 200, "Content-Type: application/json\r\n", "%s\n",
+                      t.jobs->list().dump(-1, ' ', false, json::error_handler_t::replace).c_str());
+    } else if (mg_vcmp(&hm->method, "GET") == 0) {
+        json st = t.jobs->status(uri.substr(6));
+        if (st.is_null()) {
+            mg_http_reply(c, 404, "", "No such job\n");
+            return;
+        }
+        mg_http_reply(c, 200, "Content-Type: application/json\r\n", "%s\n",
+                      st.dump(-1, ' ', false, json::error_handler_t::replace).c_str());
+    } else {
+        mg_http_reply(c, 405, "", "Method not allowed\n");
+    }
+}
+
+// Prometheus scrape target
+static void handle_metrics(struct mg_connection *c) {
+    std::string text = metrics::Registry::Get().render();
+    mg_http_reply(c, 200, "Content-Type: text/plain; version=0.0.4\r\n", "%s", text.c_str());
 }
 
 // Serve files from server/storage/<client>/<filename>
 static void handle_download(struct mg_connection *c, struct mg_http_message *hm, const ServerConfig &cfg) {
     
     auto start = std::chrono::high_resolution_clock::now();
+    ppfl::trace::Span span("GET /download");
     
     std::string uri(hm->uri.buf, hm->uri.len);
     const std::string prefix = "/download/";
     std::string rel = uri.substr(prefix.size());
 
-    fs::path base = fs::path(cfg.cc_path).parent_path(); // server/storage
-    fs::path target = (base / rel).lexically_normal();
+    // Only files under the tenant's storage root, symlinks resolved (as JobManager::resolve)
+    std::error_code ec;
+    fs::path base = fs::weakly_canonical(fs::absolute(fs::path(cfg.cc_path).parent_path()), ec); // server/storage
+    fs::path target = fs::weakly_canonical(fs::absolute(base / rel), ec);
+    fs::path inside = target.lexically_relative(base);
+    if (ec || inside.empty() || *inside.begin() == ".." || *inside.begin() == ".") {
+        mg_http_reply(c, 403, "", "Forbidden\n");
+        return;
+    }
 
     if (!fs::exists(target) || !fs::is_regular_file(target)) {
         mg_http_reply(c, 404, "", "Not found\n");
         return;
     }
 
-    std::ifstream f(target, std::ios::binary);
-    if (!f.is_open()) {
+    size_t sent;
+    int status = serve_cached(c, hm, target.string(), "application/octet-stream", sent);
+    if (status == 0) {
         mg_http_reply(c, 500, "", "Failed to open file\n");
         return;
     }
-
-    std::ostringstream ss;
-    ss << f.rdbuf();
-    std::string body = ss.str();
-
-    std::ostringstream hdr;
-    hdr << "Content-Type: application/octet-stream\r\n"
-        << "Content-Length: " << body.size() << "\r\n";
-
-    std::cout << "[SERVER] Serving file " << target << " (" << body.size() << " bytes)" << std::endl;
-    mg_http_reply(c, 200, hdr.str().c_str(), "%s", body.c_str());
+    span.args().bytes = sent;
     
     auto end = std::chrono::high_resolution_clock::now();
     long latency_ms = std::chrono::duration_cast<std::chrono::milliseconds>(end - start).count();
     
-    std::cout << "[SERVER] Sent file " << target << " (" << body.size() << " bytes)" << std::endl; 
+    if (status == 304) std::cout << "[SERVER] File " << target << " not modified" << std::endl;
+    else std::cout << "[SERVER] Sent file " << target << " (" << sent << " bytes)" << std::endl;
     
     // Log metric
     log_server_metric("GET", std::string(hm->uri.buf, hm->uri.len),
                       "-", "-", target.string(),
-                      body.size(),   // payload_size
-                      body.size(),   // bytes_sent
+                      sent,          // payload_size
+                      sent,          // bytes_sent
                       0,             // bytes_received
-                      latency_ms, 200);
+                      latency_ms, status);
 }
 
 // --- Router ---
-static void handle_request(struct mg_connection *c, int ev, void *ev_data, const ServerConfig &cfg) {
+// hm->uri is relative to the tenant's prefix (see route_tenant)
+static void handle_request(struct mg_connection *c, int ev, void *ev_data, Tenant &t) {
     if (ev != MG_EV_HTTP_MSG) return;
     struct mg_http_message *hm = (struct mg_http_message *) ev_data;
+    const ServerConfig &cfg = t.cfg;
+    std::string route(hm->uri.buf, hm->uri.len), client_id;
+    const ServerConfig::ClientFiles *client;
 
     // --- GET endpoints ---
     if (is_uri_equal(hm->uri, "/getCC") && mg_vcmp(&hm->method, "GET") == 0) {
         handle_getCC(c, hm, cfg.cc_path);
 
-    } else if (is_uri_equal(hm->uri, "/sendPbKeyC1") && mg_vcmp(&hm->method, "GET") == 0) {
-        handle_sendPbKey(c, hm, cfg.pubkey_path_client1);
-
-    } else if (is_uri_equal(hm->uri, "/sendPbKeyC2") && mg_vcmp(&hm->method, "GET") == 0) {
-        handle_sendPbKey(c, hm, cfg.pubkey_path_client2);
+    } else if ((client = route_client(cfg, route, "/sendPbKeyC")) && mg_vcmp(&hm->method, "GET") == 0) {
+        handle_sendPbKey(c, hm, client->public_key);
 
     } else if (hm->uri.len > 10 && strncmp(hm->uri.buf, "/download/", 10) == 0) {
         handle_download(c, hm, cfg);
 
-    // --- POST endpoints (uploads) ---
-    } else if (is_uri_equal(hm->uri, "/uploadPubKeyC1") && mg_vcmp(&hm->method, "POST") == 0) {
-        handle_upload(c, hm, cfg.pubkey_path_client1);
-
-    } else if (is_uri_equal(hm->uri, "/uploadPubKeyC2") && mg_vcmp(&hm->method, "POST") == 0) {
-        handle_upload(c, hm, cfg.pubkey_path_client2);
+    } else if (is_uri_equal(hm->uri, "/aggStatus") && mg_vcmp(&hm->method, "GET") == 0) {
+        handle_agg_status(c, t);
 
-    } else if (is_uri_equal(hm->uri, "/uploadReKeyC1") && mg_vcmp(&hm->method, "POST") == 0) {
-        handle_upload(c, hm, cfg.rekey_path_client1);
+    } else if (is_uri_equal(hm->uri, "/metrics") && mg_vcmp(&hm->method, "GET") == 0) {
+        handle_metrics(c);
 
-    } else if (is_uri_equal(hm->uri, "/uploadReKeyC2") && mg_vcmp(&hm->method, "POST") == 0) {
-        handle_upload(c, hm, cfg.rekey_path_client2);
+    // --- Crypto jobs ---
+    } else if (is_uri_equal(hm->uri, "/jobs") || (hm->uri.len > 6 && strncmp(hm->uri.buf, "/jobs/", 6) == 0)) {
+        handle_jobs(c, hm, t);
 
-    } else if (is_uri_equal(hm->uri, "/uploadEncWeightsC1") && mg_vcmp(&hm->method, "POST") == 0) {
-        handle_upload(c, hm, cfg.client_1_enc_w_p);
+    // --- Chunked, resumable uploads ---
+    } else if (hm->uri.len > 8 && strncmp(hm->uri.buf, "/upload/", 8) == 0) {
+        handle_chunked_upload(c, hm, t);
 
-    } else if (is_uri_equal(hm->uri, "/uploadEncWeightsC2") && mg_vcmp(&hm->method, "POST") == 0) {
-        handle_upload(c, hm, cfg.client_2_enc_w_p);
+    // --- POST endpoints (uploads) ---
+    } else if ((client = route_client(cfg, route, "/uploadEncLayerC", &client_id)) &&
+               mg_vcmp(&hm->method, "POST") == 0) {
+        handle_stream_layer(c, hm, t, client_id, false, client->public_key);
 
-    } else if (is_uri_equal(hm->uri, "/uploadDomainChange") && mg_vcmp(&hm->method, "POST") == 0) {
-        handle_upload(c, hm, cfg.output_domain_chg_p);
+    } else if (is_uri_equal(hm->uri, "/uploadEncLayer") && mg_vcmp(&hm->method, "POST") == 0) {
+        handle_child_upload(c, hm, t, "client", false);
 
-    } else if (is_uri_equal(hm->uri, "/uploadAggregated") && mg_vcmp(&hm->method, "POST") == 0) {
-        handle_upload(c, hm, cfg.agg_w_p);
+    } else if (is_uri_equal(hm->uri, "/uploadPartial") && mg_vcmp(&hm->method, "POST") == 0) {
+        handle_child_upload(c, hm, t, "from", true);
 
-    } else if (is_uri_equal(hm->uri, "/uploadDomainChangeAgg") && mg_vcmp(&hm->method, "POST") == 0) {
-        handle_upload(c, hm, cfg.domain_chg_agg_w_p);
+    } else if (mg_vcmp(&hm->method, "POST") == 0) {
+        // Whole-file uploads: keys, weights, domain-changed and aggregated files
+        std::string weights_client;
+        std::string dest = upload_dest(t, route, hm->query, weights_client);
+        if (dest.empty()) {
+            mg_http_reply(c, 404, "", "Not found\n");
+            return;
+        }
+        std::string ct_key;
+        bool ciphertexts = upload_ct_key(cfg, route, ct_key);
+        handle_upload(c, hm, t, dest, weights_client, ciphertexts ? &ct_key : nullptr);
 
     } else {
         mg_http_reply(c, 404, "", "Not found\n");
     }
 }
 
-// Adapter for Mongoose
+// Per-connection request state for /metrics, kept in c->data (zeroed by Mongoose)
+struct ConnMetrics {
+    int64_t start_us;            // first MG_EV_HTTP_HDRS of the request being received, 0 = none
+    int64_t deferred_us;         // start of a request a disk thread will answer, 0 = none
+    uint64_t deferred_body;      // ... its body bytes
+    uint16_t deferred_endpoint;  // ... and metrics::EndpointIndex
+    uint16_t tenant;             // 1 + g_tenants index of the upload counted in its uploads_in_flight, 0 = none
+    bool upload;                 // counted in uploads_in_flight
+    bool refused;                // answered 503 from its headers; the body is not handled
+};
+static_assert(sizeof(ConnMetrics) <= MG_DATA_SIZE, "ConnMetrics must fit in mg_connection::data");
+
+// Status code of the reply the handler queued at send offset `from`, 0 if none
+static int reply_status(struct mg_connection *c, size_t from) {
+    if (c->send.len < from + 12 || memcmp(c->send.buf + from, "HTTP/1.", 7) != 0) return 0;
+    return atoi((const char *) c->send.buf + from + 9);
+}
+
+// Replies for the uploads the disk threads have finished (MG_EV_WAKEUP)
+static void drain_uploads_done(struct mg_mgr *mgr) {
+    std::deque<UploadDone> done;
+    {
+        std::lock_guard<std::mutex> lk(g_uploads_done_mu);
+        done.swap(g_uploads_done);
+    }
+    for (const auto &u : done) {
+        struct mg_connection *c = mgr->conns;
+        while (c && c->id != u.conn_id) c = c->next;
+        size_t queued = c ? c->send.len : 0;
+        finish_upload(c, u);
+        u.tenant->uploads_in_flight.fetch_sub(1, std::memory_order_relaxed);
+        auto *cm = c ? reinterpret_cast<ConnMetrics *>(c->data) : nullptr;
+        if (cm && cm->deferred_us) {
+            metrics::ObserveRequest(cm->deferred_endpoint, reply_status(c, queued), metrics::NowUs() - cm->deferred_us,
+                                    cm->deferred_body);
+            cm->deferred_us = 0;
+        }
+    }
+}
+
+// Federation a request is for: /t/<name>/<route> is tenant <name>'s
+// <route>, and hm->uri is cut down to <route>; anything else is the default
+// federation's. Null if there is no such federation.
+static Tenant *route_tenant(struct mg_http_message *hm) {
+    const char *uri = hm->uri.buf;
+    if (hm->uri.len > 3 && strncmp(uri, "/t/", 3) == 0) {
+        const char *slash = (const char *) memchr(uri + 3, '/', hm->uri.len - 3);
+        if (!slash) return nullptr;
+        auto it = g_tenant_names.find(std::string(uri + 3, slash));
+        hm->uri = mg_str_n(slash, hm->uri.len - (size_t) (slash - uri));
+        return it == g_tenant_names.end() ? nullptr : it->second;
+    }
+    auto it = g_tenant_names.find("default");
+    return it == g_tenant_names.end() ? nullptr : it->second;
+}
+
+// A tenant upload's headers are in: count it against LIMITS.MAX_UPLOADS, or
+// refuse it with 503 before its body is read if the tenant is at the limit
+static void admit_upload(struct mg_connection *c, ConnMetrics *cm, Tenant &t) {
+    if (t.cfg.max_uploads && t.uploads_in_flight.load(std::memory_order_relaxed) >= t.cfg.max_uploads) {
+        t.refused.fetch_add(1, std::memory_order_relaxed);
+        cm->refused = true;
+        mg_http_reply(c, 503, "Retry-After: 1\r\n", "Too many uploads in progress for %s\n", t.name.c_str());
+        c->is_draining = 1;
+        return;
+    }
+    t.uploads_in_flight.fetch_add(1, std::memory_order_relaxed);
+    for (size_t i = 0; i < g_tenants.size(); i++) {
+        if (g_tenants[i].get() == &t) cm->tenant = (uint16_t) (i + 1);
+    }
+}
+
+// Adapter for Mongoose; also feeds the /metrics counters
 static void event_handler(struct mg_connection *c, int ev, void *ev_data) {
-    auto *cfg = static_cast<ServerConfig *>(c->fn_data);
-    handle_request(c, ev, ev_data, *cfg);
+    auto *cm = reinterpret_cast<ConnMetrics *>(c->data);
+
+    if (ev == MG_EV_READ) {
+        metrics::AddReceived((size_t) *(long *) ev_data);
+    } else if (ev == MG_EV_WRITE) {
+        metrics::AddSent((size_t) *(long *) ev_data);
+    } else if (ev == MG_EV_HTTP_HDRS) {
+        // Fired on every read until the body is complete; count the first only
+        if (cm->start_us == 0) {
+            auto *hm = (struct mg_http_message *) ev_data;
+            cm->start_us = metrics::NowUs();
+            cm->upload = mg_vcmp(&hm->method, "POST") == 0 || mg_vcmp(&hm->method, "PUT") == 0;
+            if (cm->upload) metrics::UploadStarted();
+            // On a copy: MG_EV_HTTP_MSG is passed this same message
+            struct mg_http_message route = *hm;
+            Tenant *t = cm->upload ? route_tenant(&route) : nullptr;
+            if (t && !is_uri_equal(route.uri, "/jobs")) admit_upload(c, cm, *t);
+        }
+    } else if (ev == MG_EV_HTTP_MSG) {
+        auto *hm = (struct mg_http_message *) ev_data;
+        int64_t start = cm->start_us ? cm->start_us : metrics::NowUs();
+        if (cm->upload) metrics::UploadFinished();
+        Tenant *counted = cm->tenant ? g_tenants[cm->tenant - 1].get() : nullptr;
+        bool refused = cm->refused;
+        *cm = ConnMetrics{};
+
+        // Read before the handler: a deferred upload hands hm's buffer to a disk thread
+        Tenant *t = route_tenant(hm);
+        size_t endpoint = metrics::EndpointIndex(hm->uri.buf, hm->uri.len);
+        size_t body_len = hm->body.len;
+        if (refused) {
+            metrics::ObserveRequest(endpoint, 503, metrics::NowUs() - start, body_len);
+            return;
+        }
+        size_t queued = c->send.len;
+        if (t) {
+            t->requests.fetch_add(1, std::memory_order_relaxed);
+            handle_request(c, ev, ev_data, *t);
+        } else {
+            mg_http_reply(c, 404, "", "No such federation\n");
+        }
+        int status = reply_status(c, queued);
+        if (status == 0 && c->is_resp) {
+            // Still in its tenant's uploads_in_flight until drain_uploads_done
+            cm->deferred_us = start;
+            cm->deferred_body = body_len;
+            cm->deferred_endpoint = (uint16_t) endpoint;
+            return;
+        }
+        if (counted) counted->uploads_in_flight.fetch_sub(1, std::memory_order_relaxed);
+        metrics::ObserveRequest(endpoint, status, metrics::NowUs() - start, body_len);
+        return;
+    } else if (ev == MG_EV_WAKEUP) {
+        drain_uploads_done(c->mgr);
+        return;
+    } else if (ev == MG_EV_CLOSE) {
+        if (cm->upload) metrics::UploadFinished();
+        if (cm->tenant) g_tenants[cm->tenant - 1]->uploads_in_flight.fetch_sub(1, std::memory_order_relaxed);
+        *cm = ConnMetrics{};
+    }
+}
+
+// One sample per federation, labeled tenant="<name>"
+template <class F>
+static void tenant_family(std::ostream &out, const char *name, const char *type, const char *help, F value) {
+    metrics::Registry::header(out, name, type, help);
+    for (const auto &t : g_tenants) out << name << "{tenant=\"" << t->name << "\"} " << value(*t) << "\n";
+}
+
+// Gauges owned by the worker pool, the aggregators and the file cache, read at scrape time
+static void register_metric_collectors(const WorkerPool &pool, const FileCache &files, const WorkerPool *disk_pool,
+                                       const StealingPool &job_pool) {
+    auto &reg = metrics::Registry::Get();
+    reg.addCollector([&job_pool](std::ostream &out) {
+        metrics::Registry::header(out, "ppfl_job_tasks_queued", "gauge", "Crypto job tasks waiting for a worker");
+        const char *priorities[] = {"critical", "round", "background"};
+        for (size_t p = 0; p < StealingPool::kPriorities; p++) {
+            out << "ppfl_job_tasks_queued{priority=\"" << priorities[p] << "\"} "
+                << job_pool.queued((StealingPool::Priority) p) << "\n";
+        }
+        metrics::Registry::family(out, "ppfl_job_workers_busy", "gauge", "Job workers running a task", job_pool.busy());
+        metrics::Registry::family(out, "ppfl_job_steals_total", "counter", "Job tasks taken from another worker's deque",
+                                  job_pool.steals());
+        tenant_family(out, "ppfl_tenant_jobs_active", "gauge", "Crypto jobs not yet done or failed",
+                      [](const Tenant &t) { return t.jobs->active(); });
+    });
+    if (disk_pool) {
+        reg.addCollector([disk_pool](std::ostream &out) {
+            metrics::Registry::family(out, "ppfl_disk_queue_depth", "gauge", "Uploads waiting for a disk thread",
+                                      disk_pool->queued());
+            metrics::Registry::family(out, "ppfl_disk_busy", "gauge", "Disk threads writing an upload",
+                                      disk_pool->busy());
+            tenant_family(out, "ppfl_tenant_disk_queue_depth", "gauge", "Uploads waiting for a disk thread",
+                          [disk_pool](const Tenant &t) { return disk_pool->queued(t.disk_lane); });
+        });
+    }
+    reg.addCollector([&files](std::ostream &out) {
+        metrics::Registry::family(out, "ppfl_file_cache_hits_total", "counter", "GETs served from the file cache",
+                                  files.hits());
+        metrics::Registry::family(out, "ppfl_file_cache_misses_total", "counter", "GETs that (re)read the file",
+                                  files.misses());
+        metrics::Registry::family(out, "ppfl_file_cache_bytes", "gauge", "Bytes held by the file cache", files.bytes());
+    });
+    reg.addCollector([&pool](std::ostream &out) {
+        metrics::Registry::family(out, "ppfl_upload_queue_depth", "gauge",
+                                  "Uploaded layers/models waiting for an aggregation worker", pool.queued());
+        metrics::Registry::family(out, "ppfl_workers_busy", "gauge", "Aggregation workers running a task", pool.busy());
+        tenant_family(out, "ppfl_tenant_upload_queue_depth", "gauge",
+                      "Uploaded layers/models waiting for an aggregation worker",
+                      [&pool](const Tenant &t) { return pool.queued(t.lane); });
+        tenant_family(out, "ppfl_tenant_workers_busy", "gauge", "Aggregation workers running a task",
+                      [&pool](const Tenant &t) { return pool.busy(t.lane); });
+    });
+    reg.addCollector([](std::ostream &out) {
+        tenant_family(out, "ppfl_tenant_requests_total", "counter", "HTTP requests routed to the federation",
+                      [](const Tenant &t) { return t.requests.load(); });
+        tenant_family(out, "ppfl_tenant_uploads_in_flight", "gauge", "Uploads being received or written",
+                      [](const Tenant &t) { return t.uploads_in_flight.load(); });
+        tenant_family(out, "ppfl_tenant_uploads_refused_total", "counter", "Uploads refused over LIMITS.MAX_UPLOADS",
+                      [](const Tenant &t) { return t.refused.load(); });
+        tenant_family(out, "ppfl_tenant_upload_bytes_total", "counter", "Upload body bytes as sent",
+                      [](const Tenant &t) { return t.upload_bytes.load(); });
+
+        std::vector<json> st;
+        for (const auto &t : g_tenants) st.push_back(t->agg->status());
+        auto agg_family = [&](const char *name, const char *help, const char *key) {
+            metrics::Registry::header(out, name, "gauge", help);
+            for (size_t i = 0; i < st.size(); i++) {
+                const json &v = st[i][key];
+                out << name << "{tenant=\"" << g_tenants[i]->name << "\"} "
+                    << (v.is_boolean() ? (v.get<bool>() ? 1 : 0) : v.get<long>()) << "\n";
+            }
+        };
+        agg_family("ppfl_agg_round", "Round of the current aggregation", "round");
+        agg_family("ppfl_agg_layers", "Layers in the current round", "layers");
+        agg_family("ppfl_agg_layers_complete", "Layers aggregated in the current round", "layers_complete");
+        agg_family("ppfl_agg_contributors_complete", "Contributors that sent every layer of the current round",
+                   "contributor_count");
+        agg_family("ppfl_agg_round_complete", "1 once the current round's files are written", "complete");
+    });
 }
 
 // --- Main ---
-int main() {
+// Relays start with nothing but their config: pull CC.json from the parent
+static void fetch_cc_from_upstream(const ServerConfig &cfg) {
+    if (fs::exists(cfg.cc_path)) return;
+    HttpClient upstream(cfg.tree_upstream);
+    HttpResponse r = upstream.get("/getCC");
+    if (r.status != 200) throw std::runtime_error("cannot fetch CC.json from " + cfg.tree_upstream);
+    fs::path p(cfg.cc_path);
+    if (p.has_parent_path()) fs::create_directories(p.parent_path());
+    std::ofstream(cfg.cc_path, std::ios::binary) << r.body;
+    std::cout << "[SERVER] [relay] Fetched CC.json from " << cfg.tree_upstream << std::endl;
+}
+
+// Set up federation `name`: its aggregator, upload sessions and jobs, with a
+// lane of its own in the shared aggregation and disk pools
+static void add_tenant(const std::string &name, const ServerConfig &cfg, WorkerPool &pool, WorkerPool *disk_pool,
+                       StealingPool &job_pool) {
+    if (!is_safe_id(name)) throw std::runtime_error("Invalid tenant name: " + name);
+    if (g_tenant_names.count(name)) throw std::runtime_error("Tenant " + name + " defined twice");
+    fs::path storage = fs::weakly_canonical(fs::absolute(fs::path(cfg.cc_path).parent_path()));
+    for (const auto &other : g_tenants) {
+        if (fs::weakly_canonical(fs::absolute(fs::path(other->cfg.cc_path).parent_path())) == storage) {
+            throw std::runtime_error("Tenants " + other->name + " and " + name + " share storage " + storage.string());
+        }
+    }
+
+    auto t = std::make_unique<Tenant>();
+    t->name = name;
+    t->cfg = cfg;
+    if (t->cfg.tree_role == "relay") {
+        fetch_cc_from_upstream(t->cfg);
+        std::cout << "[SERVER] [relay] " << name << ": " << t->cfg.tree_id << " forwarding "
+                  << t->cfg.tree_children.size() << " children to " << t->cfg.tree_upstream << std::endl;
+    }
+    t->lane = pool.addLane(t->cfg.max_workers);
+    if (disk_pool) t->disk_lane = disk_pool->addLane();
+    AggregatorConfig ac = make_aggregator_config(t->cfg);
+    ac.lane = t->lane;
+    t->agg = std::make_unique<RoundAggregator>(std::move(ac), pool);
+    t->uploads = std::make_unique<UploadSessions>((storage / ".uploads").string(), t->cfg.upload_ttl_s,
+                                                 t->cfg.max_upload_bytes);
+    t->ct_check = std::make_unique<CiphertextCheck>(t->cfg.cc_path);
+    t->jobs = std::make_unique<JobManager>(t->cfg.cc_path, storage.string(), job_pool);
+    g_tenant_names[name] = t.get();
+    g_tenants.push_back(std::move(t));
+}
+
+// Usage: runMserver [config_path]   (default server/config/sConfig.json)
+int main(int argc, char *argv[]) {
     try {
         init_server_metrics(); //Server-side metrics function call
-        ServerConfig cfg = load_config("server/config/sConfig.json");
+        std::map<std::string, ServerConfig> tenants;
+        ServerConfig cfg = load_config(argc > 1 ? argv[1] : "server/config/sConfig.json", tenants);
+
+        // Aggregation crypto runs on workers, never on the event loop
+        WorkerPool pool;
+        g_disk_opts = cfg.disk;
+        std::unique_ptr<WorkerPool> disk_pool;
+        if (cfg.disk_threads > 0) disk_pool = std::make_unique<WorkerPool>(cfg.disk_threads);
+        g_disk_pool = disk_pool.get();
+        StealingPool job_pool(cfg.job_threads);
+        if (!cfg.cc_path.empty()) add_tenant("default", cfg, pool, g_disk_pool, job_pool);
+        for (const auto &kv : tenants) add_tenant(kv.first, kv.second, pool, g_disk_pool, job_pool);
+        FileCache files(cfg.file_cache_mb << 20);
+        files.setReader([](const std::string &path, std::string &out) { return thread_disk().readFile(path, out); });
+        g_files = &files;
+        g_wire = cfg.wire;
+        register_metric_collectors(pool, files, g_disk_pool, job_pool);
 
         struct mg_mgr mgr;
         mg_mgr_init(&mgr);
+        if (g_disk_pool && !mg_wakeup_init(&mgr)) {
+            std::cerr << "[SERVER] mg_wakeup unavailable, writing uploads on the event loop" << std::endl;
+            g_disk_pool = nullptr;
+        }
 
         std::string url = "http://" + cfg.ip + ":" + std::to_string(cfg.port);
-        struct mg_connection *c = mg_http_listen(&mgr, url.c_str(), event_handler, &cfg);
+        struct mg_connection *c = mg_http_listen(&mgr, url.c_str(), event_handler, nullptr);
         if (!c) {
             std::cerr << "[SERVER] Failed to start server on " << url << std::endl;
             return 1;
         }
+        g_listener_id = c->id;
+
+        // Deadline checks for rounds with AGGREGATION.DEADLINE_MS set
+        for (const auto &t : g_tenants) {
+            mg_timer_add(&mgr, 100, MG_TIMER_REPEAT, agg_tick, t->agg.get());
+            mg_timer_add(&mgr, 60000, MG_TIMER_REPEAT | MG_TIMER_RUN_NOW, upload_tick, t->uploads.get());
+        }
 
         std::cout << "[SERVER] Mongoose HTTP server running on " << url << std::endl;
+        for (const auto &t : g_tenants) {
+            std::cout << "[SERVER] Federation " << t->name << " at "
+                      << (t->name == "default" ? std::string("/") : "/t/" + t->name + "/") << ", storage "
+                      << fs::path(t->cfg.cc_path).parent_path().string() << std::endl;
+        }
+        std::cout << "[SERVER] Disk I/O: " << thread_disk().backend() << ", " << cfg.disk.depth << " x "
+                  << (cfg.disk.buffer_bytes >> 10) << " KiB buffers, "
+                  << (g_disk_pool ? std::to_string(cfg.disk_threads) + " upload writer thread(s)" : "uploads on the event loop")
+                  << std::endl;
+        std::cout << "[SERVER] Crypto jobs: " << job_pool.size() << " worker thread(s)" << std::endl;
 
         for (;;) mg_mgr_poll(&mgr, 1000);
         mg_mgr_free(&mgr);
@@ -0,0 +1,272 @@
+// server/src/serverMetrics.h
+// Live counters behind runMserver's GET /metrics (Prometheus text format)
+//
+// Each recording thread (event loop, aggregation workers) gets its own Shard
+// on first use. Counters are relaxed atomics written only by their owning
+// thread, so recording is an uncontended add with no shared cache line; a
+// scrape sums every shard. Values owned by other components (worker queue
+// depth, aggregation progress) are sampled at scrape time by collectors.
+//
+// Per-client last-seen times are the one map; it is per shard as well and
+// its mutex is only ever taken by the owner and by a scrape.
+
+#ifndef PPFL_SERVER_METRICS_H
+#define PPFL_SERVER_METRICS_H
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace metrics {
+
+// Routes get their own label; anything else is "other"
+static const char *const kEndpoints[] = {
+    "/getCC", "/sendPbKeyC1", "/sendPbKeyC2", "/download", "/aggStatus", "/metrics", "/jobs",
+    "/uploadPubKeyC1", "/uploadPubKeyC2", "/uploadReKeyC1", "/uploadReKeyC2",
+    "/uploadEncWeightsC1", "/uploadEncWeightsC2", "/uploadEncLayerC1", "/uploadEncLayerC2",
+    "/uploadEncWeights", "/uploadEncLayer", "/uploadPartial",
+    "/uploadDomainChange", "/uploadAggregated", "/uploadDomainChangeAgg", "/upload", "other",
+};
+constexpr size_t kEndpointCount = sizeof(kEndpoints) / sizeof(kEndpoints[0]);
+
+// Request latency buckets, seconds (+Inf implied)
+static const double kLatencyBuckets[] = {0.001, 0.005, 0.01, 0.025, 0.05, 0.1, 0.25, 0.5, 1, 2.5, 5, 10, 30};
+constexpr size_t kBucketCount = sizeof(kLatencyBuckets) / sizeof(kLatencyBuckets[0]) + 1;
+
+// Status classes 1xx..5xx, plus 0 for "no reply seen"
+constexpr size_t kStatusClasses = 6;
+
+inline size_t EndpointIndex(const char *uri, size_t len) {
+    if (len >= 10 && std::strncmp(uri, "/download/", 10) == 0) return 3;
+    if (len >= 6 && std::strncmp(uri, "/jobs/", 6) == 0) return 6;
+    if (len >= 8 && std::strncmp(uri, "/upload/", 8) == 0) return kEndpointCount - 2;
+    for (size_t i = 0; i + 1 < kEndpointCount; i++) {
+        if (std::strlen(kEndpoints[i]) == len && std::strncmp(uri, kEndpoints[i], len) == 0) return i;
+    }
+    return kEndpointCount - 1;
+}
+
+inline int64_t NowUs() {
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+               std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+struct Shard {
+    using Counter = std::atomic<uint64_t>;
+
+    Counter requests[kEndpointCount][kStatusClasses] = {};
+    Counter latency[kEndpointCount][kBucketCount] = {};
+    Counter latency_sum_us[kEndpointCount] = {};
+    Counter body_bytes[kEndpointCount] = {};
+    Counter recv_bytes{0};
+    Counter sent_bytes{0};
+    Counter disk_write_bytes{0};
+    Counter disk_write_us{0};
+    Counter disk_writes{0};
+    std::atomic<int64_t> uploads_in_flight{0};  // per shard may go negative; the sum may not
+
+    std::mutex seen_m;
+    std::map<std::string, double> last_seen;  // client id -> unix seconds
+
+    // Owner-only read-modify-write: a plain load + store, no locked instruction
+    static void add(Counter &c, uint64_t n) { c.store(c.load(std::memory_order_relaxed) + n, std::memory_order_relaxed); }
+};
+
+class Registry {
+public:
+    static Registry &Get() {
+        static Registry r;
+        return r;
+    }
+
+    Shard *addShard() {
+        std::lock_guard<std::mutex> lk(m_);
+        shards_.emplace_back(new Shard());
+        return shards_.back().get();
+    }
+
+    // Collectors append complete metric families at scrape time
+    void addCollector(std::function<void(std::ostream &)> fn) {
+        std::lock_guard<std::mutex> lk(m_);
+        collectors_.push_back(std::move(fn));
+    }
+
+    std::string render() {
+        std::lock_guard<std::mutex> lk(m_);
+        Shard total;
+        std::map<std::string, double> seen;
+        int64_t in_flight = 0;
+        for (auto &s : shards_) {
+            for (size_t e = 0; e < kEndpointCount; e++) {
+                for (size_t k = 0; k < kStatusClasses; k++) sum(total.requests[e][k], s->requests[e][k]);
+                for (size_t b = 0; b < kBucketCount; b++) sum(total.latency[e][b], s->latency[e][b]);
+                sum(total.latency_sum_us[e], s->latency_sum_us[e]);
+                sum(total.body_bytes[e], s->body_bytes[e]);
+            }
+            sum(total.recv_bytes, s->recv_bytes);
+            sum(total.sent_bytes, s->sent_bytes);
+            sum(total.disk_write_bytes, s->disk_write_bytes);
+            sum(total.disk_write_us, s->disk_write_us);
+            sum(total.disk_writes, s->disk_writes);
+            in_flight += s->uploads_in_flight.load(std::memory_order_relaxed);
+            std::lock_guard<std::mutex> slk(s->seen_m);
+            for (const auto &kv : s->last_seen) {
+                if (kv.second > seen[kv.first]) seen[kv.first] = kv.second;
+            }
+        }
+
+        std::ostringstream out;
+        out.precision(15);  // byte counters and unix times stay exact
+        out << "# HELP ppfl_http_requests_total HTTP requests handled, by endpoint and status class\n"
+            << "# TYPE ppfl_http_requests_total counter\n";
+        for (size_t e = 0; e < kEndpointCount; e++) {
+            for (size_t k = 0; k < kStatusClasses; k++) {
+                uint64_t n = total.requests[e][k].load();
+                if (!n) continue;
+                out << "ppfl_http_requests_total{endpoint=\"" << kEndpoints[e] << "\",code=\""
+                    << (k ? std::to_string(k) + "xx" : "none") << "\"} " << n << "\n";
+            }
+        }
+
+        out << "# HELP ppfl_http_request_duration_seconds Time from request headers to reply queued\n"
+            << "# TYPE ppfl_http_request_duration_seconds histogram\n";
+        for (size_t e = 0; e < kEndpointCount; e++) {
+            uint64_t cum = 0;
+            for (size_t b = 0; b < kBucketCount; b++) cum += total.latency[e][b].load();
+            if (!cum) continue;
+            cum = 0;
+            for (size_t b = 0; b < kBucketCount; b++) {
+                cum += total.latency[e][b].load();
+                out << "ppfl_http_request_duration_seconds_bucket{endpoint=\"" << kEndpoints[e] << "\",le=\"";
+                if (b + 1 < kBucketCount) out << kLatencyBuckets[b];
+                else out << "+Inf";
+                out << "\"} " << cum << "\n";
+            }
+            out << "ppfl_http_request_duration_seconds_sum{endpoint=\"" << kEndpoints[e] << "\"} "
+                << total.latency_sum_us[e].load() / 1e6 << "\n"
+                << "ppfl_http_request_duration_seconds_count{endpoint=\"" << kEndpoints[e] << "\"} " << cum << "\n";
+        }
+
+        out << "# HELP ppfl_http_request_body_bytes_total Request body bytes, by endpoint\n"
+            << "# TYPE ppfl_http_request_body_bytes_total counter\n";
+        for (size_t e = 0; e < kEndpointCount; e++) {
+            uint64_t n = total.body_bytes[e].load();
+            if (n) out << "ppfl_http_request_body_bytes_total{endpoint=\"" << kEndpoints[e] << "\"} " << n << "\n";
+        }
+
+        family(out, "ppfl_http_received_bytes_total", "counter", "Bytes read from client sockets",
+               total.recv_bytes.load());
+        family(out, "ppfl_http_sent_bytes_total", "counter", "Bytes written to client sockets",
+               total.sent_bytes.load());
+        family(out, "ppfl_uploads_in_flight", "gauge", "POST requests with headers received but body incomplete",
+               in_flight);
+        family(out, "ppfl_disk_write_bytes_total", "counter", "Bytes written to storage (uploads, aggregates)",
+               total.disk_write_bytes.load());
+        family(out, "ppfl_disk_write_seconds_total", "counter", "Time spent writing to storage",
+               total.disk_write_us.load() / 1e6);
+        family(out, "ppfl_disk_writes_total", "counter", "Files written to storage", total.disk_writes.load());
+
+        out << "# HELP ppfl_client_last_seen_timestamp_seconds Unix time of the last upload from each client\n"
+            << "# TYPE ppfl_client_last_seen_timestamp_seconds gauge\n";
+        for (const auto &kv : seen) {
+            out << "ppfl_client_last_seen_timestamp_seconds{client=\"" << escape(kv.first) << "\"} " << kv.second << "\n";
+        }
+
+        for (auto &fn : collectors_) fn(out);
+        return out.str();
+    }
+
+    // One unlabeled sample with HELP/TYPE header (for collectors too)
+    template <class T>
+    static void family(std::ostream &out, const char *name, const char *type, const char *help, T v) {
+        header(out, name, type, help);
+        out << name << " " << v << "\n";
+    }
+
+    // HELP/TYPE header of a family whose labeled samples the collector writes
+    static void header(std::ostream &out, const char *name, const char *type, const char *help) {
+        out << "# HELP " << name << " " << help << "\n# TYPE " << name << " " << type << "\n";
+    }
+
+private:
+    Registry() = default;
+
+    // Label values are client-supplied (multipart client_id)
+    static std::string escape(const std::string &v) {
+        std::string r;
+        for (char ch : v) {
+            if (ch == '\\' || ch == '"') r += '\\';
+            if (ch == '\n') r += "\\n";
+            else r += ch;
+        }
+        return r;
+    }
+
+    static void sum(Shard::Counter &into, const Shard::Counter &from) {
+        into.store(into.load(std::memory_order_relaxed) + from.load(std::memory_order_relaxed),
+                   std::memory_order_relaxed);
+    }
+
+    std::mutex m_;  // shard list and collectors; never taken on the recording path
+    std::vector<std::unique_ptr<Shard>> shards_;
+    std::vector<std::function<void(std::ostream &)>> collectors_;
+};
+
+// This thread's shard; shards outlive their threads so totals never drop
+inline Shard &Local() {
+    thread_local Shard *shard = Registry::Get().addShard();
+    return *shard;
+}
+
+// --- Recording (hot path) ---
+
+inline void ObserveRequest(size_t endpoint, int status, int64_t latency_us, size_t body_bytes) {
+    Shard &s = Local();
+    size_t cls = status >= 100 && status < 600 ? (size_t) status / 100 : 0;
+    double secs = latency_us / 1e6;
+    size_t b = 0;
+    while (b + 1 < kBucketCount && secs > kLatencyBuckets[b]) b++;
+    Shard::add(s.requests[endpoint][cls], 1);
+    Shard::add(s.latency[endpoint][b], 1);
+    Shard::add(s.latency_sum_us[endpoint], (uint64_t) (latency_us > 0 ? latency_us : 0));
+    Shard::add(s.body_bytes[endpoint], body_bytes);
+}
+
+inline void AddReceived(size_t n) { Shard::add(Local().recv_bytes, n); }
+inline void AddSent(size_t n) { Shard::add(Local().sent_bytes, n); }
+
+inline void AddDiskWrite(size_t bytes, int64_t us) {
+    Shard &s = Local();
+    Shard::add(s.disk_write_bytes, bytes);
+    Shard::add(s.disk_write_us, (uint64_t) (us > 0 ? us : 0));
+    Shard::add(s.disk_writes, 1);
+}
+
+inline void UploadStarted() {
+    auto &g = Local().uploads_in_flight;
+    g.store(g.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+}
+inline void UploadFinished() {
+    auto &g = Local().uploads_in_flight;
+    g.store(g.load(std::memory_order_relaxed) - 1, std::memory_order_relaxed);
+}
+
+inline void ClientSeen(const std::string &client_id) {
+    if (client_id.empty() || client_id == "-") return;
+    double now = std::chrono::duration<double>(std::chrono::system_clock::now().time_since_epoch()).count();
+    Shard &s = Local();
+    std::lock_guard<std::mutex> lk(s.seen_m);
+    s.last_seen[client_id] = now;
+}
+
+}  // namespace metrics
+
+#endif  // PPFL_SERVER_METRICS_H
@@ -0,0 +1,145 @@
+// server/src/stealingPool.h
+// Work-stealing thread pool with task priorities, for runMserver's crypto jobs
+//
+// Every worker owns one deque per priority. A task submitted from a worker
+// (a job fanning out its ciphertexts) goes to that worker's own deques, one
+// submitted from outside to the workers' in turn. A worker runs the newest
+// task of its own deques and, when it has none of a priority, steals the
+// oldest of another worker's, so the fan-out of one job spreads across idle
+// workers without a shared queue. Priorities are strict: no worker starts a
+// task while a more urgent one is queued anywhere.
+
+#ifndef PPFL_STEALING_POOL_H
+#define PPFL_STEALING_POOL_H
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+class StealingPool {
+public:
+    // Lower runs first
+    enum Priority { kCritical = 0, kRound = 1, kBackground = 2 };
+    static constexpr size_t kPriorities = 3;
+
+    // n == 0 -> one worker per hardware thread
+    explicit StealingPool(size_t n = 0) {
+        if (n == 0) n = std::max(1u, std::thread::hardware_concurrency());
+        for (size_t i = 0; i < n; i++) workers_.emplace_back(new Worker());
+        for (size_t i = 0; i < n; i++) workers_[i]->thread = std::thread([this, i] { run(i); });
+    }
+
+    ~StealingPool() {
+        {
+            std::lock_guard<std::mutex> lk(m_);
+            stop_ = true;
+        }
+        cv_.notify_all();
+        for (auto& w : workers_) w->thread.join();
+    }
+
+    StealingPool(const StealingPool&) = delete;
+    StealingPool& operator=(const StealingPool&) = delete;
+
+    // Tasks must not throw; wrap them and record the error instead
+    void submit(std::function<void()> task, Priority priority = kBackground) {
+        size_t w = self_pool == this ? self_index : next_.fetch_add(1, std::memory_order_relaxed) % workers_.size();
+        // Counted first, so a count never goes below the tasks in the deques
+        {
+            std::lock_guard<std::mutex> lk(m_);
+            queued_[priority].fetch_add(1, std::memory_order_relaxed);
+        }
+        {
+            std::lock_guard<std::mutex> lk(workers_[w]->m);
+            workers_[w]->tasks[priority].push_back(std::move(task));
+        }
+        cv_.notify_one();
+    }
+
+    size_t size() const { return workers_.size(); }
+
+    // For /metrics; no lock taken
+    size_t queued() const {
+        size_t n = 0;
+        for (const auto& q : queued_) n += q.load(std::memory_order_relaxed);
+        return n;
+    }
+    size_t queued(Priority p) const { return queued_[p].load(std::memory_order_relaxed); }
+    size_t busy() const { return busy_.load(std::memory_order_relaxed); }
+    uint64_t steals() const { return steals_.load(std::memory_order_relaxed); }
+
+private:
+    struct Worker {
+        std::mutex m;
+        std::deque<std::function<void()>> tasks[kPriorities];
+        std::thread thread;
+    };
+
+    // Most urgent task for worker `self`: its own newest, else the oldest
+    // it can steal. False if every deque is empty.
+    bool take(size_t self, std::function<void()>& task) {
+        for (size_t p = 0; p < kPriorities; p++) {
+            if (queued_[p].load(std::memory_order_acquire) == 0) continue;
+            {
+                Worker& w = *workers_[self];
+                std::lock_guard<std::mutex> lk(w.m);
+                if (!w.tasks[p].empty()) {
+                    task = std::move(w.tasks[p].back());
+                    w.tasks[p].pop_back();
+                    queued_[p].fetch_sub(1, std::memory_order_relaxed);
+                    return true;
+                }
+            }
+            for (size_t i = 1; i < workers_.size(); i++) {
+                Worker& v = *workers_[(self + i) % workers_.size()];
+                std::lock_guard<std::mutex> lk(v.m);
+                if (!v.tasks[p].empty()) {
+                    task = std::move(v.tasks[p].front());
+                    v.tasks[p].pop_front();
+                    queued_[p].fetch_sub(1, std::memory_order_relaxed);
+                    steals_.fetch_add(1, std::memory_order_relaxed);
+                    return true;
+                }
+            }
+        }
+        return false;
+    }
+
+    void run(size_t self) {
+        self_pool = this;
+        self_index = self;
+        for (;;) {
+            std::function<void()> task;
+            if (!take(self, task)) {
+                std::unique_lock<std::mutex> lk(m_);
+                cv_.wait(lk, [this] { return stop_ || queued() > 0; });
+                if (stop_ && queued() == 0) return;
+                continue;
+            }
+            busy_.fetch_add(1, std::memory_order_relaxed);
+            task();
+            busy_.fetch_sub(1, std::memory_order_relaxed);
+        }
+    }
+
+    // The pool and worker the calling thread belongs to, if any
+    static inline thread_local StealingPool* self_pool = nullptr;
+    static inline thread_local size_t self_index = 0;
+
+    std::vector<std::unique_ptr<Worker>> workers_;
+    std::atomic<size_t> next_{0};
+    std::mutex m_;  // sleeping workers only
+    std::condition_variable cv_;
+    bool stop_ = false;
+    std::atomic<size_t> queued_[kPriorities] = {};
+    std::atomic<size_t> busy_{0};
+    std::atomic<uint64_t> steals_{0};
+};
+
+#endif  // PPFL_STEALING_POOL_H
@@ -0,0 +1,293 @@
+// server/src/uploadSessions.h
+// Resumable chunked uploads for runMserver (POST/GET/PUT /upload/...)
+//
+// A session is one file being uploaded in fixed-size chunks to a target
+// upload route. Its bytes go straight into <dir>/<id>.data at their offsets,
+// and <dir>/<id>.json records the target, sizes, checksum and which chunks
+// have arrived, rewritten after every chunk. Sessions therefore survive a
+// server restart as well as a dropped connection: the client asks which
+// chunks are missing and sends only those. Every chunk carries its SHA-256;
+// a mismatch rejects that chunk alone.
+//
+// A session's size is limited (LIMITS.MAX_UPLOAD_BYTES in runMserver) and
+// checked before anything is allocated for it.
+// Sessions untouched for longer than the TTL are deleted by expire().
+// Used from the event loop only; not thread-safe (FileSha256 aside, which
+// the disk threads use to check a finished upload).
+
+#ifndef PPFL_UPLOAD_SESSIONS_H
+#define PPFL_UPLOAD_SESSIONS_H
+
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <map>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+#include <nlohmann/json.hpp>
+
+#include <fcntl.h>
+#include <openssl/evp.h>
+#include <openssl/rand.h>
+#include <unistd.h>
+
+class UploadSessions {
+public:
+    struct Session {
+        std::string id;
+        std::string target;     // upload route + query, e.g. /uploadEncWeightsC1?round=3
+        std::string client_id;
+        std::string type;
+        std::string encoding;   // Content-Encoding of the assembled bytes ("" = as-is)
+        std::string sha256;     // of the assembled bytes, hex; optional
+        uint64_t size = 0;
+        uint64_t chunk_size = 0;
+        std::vector<bool> have;
+        int64_t touched = 0;    // unix seconds of the last chunk
+        bool finishing = false; // being checked and stored by a disk thread
+
+        uint64_t chunks() const { return have.size(); }
+        uint64_t chunkLen(uint64_t i) const { return std::min(chunk_size, size - i * chunk_size); }
+        bool complete() const {
+            for (bool b : have) if (!b) return false;
+            return true;
+        }
+        uint64_t received() const {
+            uint64_t n = 0;
+            for (uint64_t i = 0; i < chunks(); i++) if (have[i]) n += chunkLen(i);
+            return n;
+        }
+    };
+
+    static constexpr uint64_t kMinChunk = 64 * 1024;
+    static constexpr uint64_t kMaxChunk = 64ull << 20;
+    static constexpr uint64_t kDefaultMaxSize = 200ull << 20;
+
+    UploadSessions(std::string dir, int64_t ttl_s, uint64_t max_size = kDefaultMaxSize)
+        : dir_(std::move(dir)), ttl_s_(ttl_s), max_size_(max_size) {
+        std::filesystem::create_directories(dir_);
+    }
+
+    // New session with a preallocated data file; nullptr + err on bad parameters
+    std::shared_ptr<Session> create(const std::string &target, uint64_t size, uint64_t chunk_size,
+                                    const std::string &encoding, const std::string &sha256,
+                                    const std::string &client_id, const std::string &type, std::string &err) {
+        if (chunk_size < kMinChunk || chunk_size > kMaxChunk) {
+            err = "chunk_size must be between 64 KiB and 64 MiB";
+            return nullptr;
+        }
+        if (size == 0 || size > max_size_) {
+            err = "size must be between 1 and " + std::to_string(max_size_) + " bytes";
+            return nullptr;
+        }
+        auto s = std::make_shared<Session>();
+        s->id = NewId();
+        s->target = target;
+        s->client_id = client_id;
+        s->type = type;
+        s->encoding = encoding;
+        s->sha256 = sha256;
+        s->size = size;
+        s->chunk_size = chunk_size;
+        s->have.assign(ChunkCount(size, chunk_size), false);
+        s->touched = Now();
+
+        int fd = ::open(dataPath(s->id).c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        if (fd < 0 || ::ftruncate(fd, (off_t) size) != 0) {
+            if (fd >= 0) ::close(fd);
+            err = "cannot allocate upload file";
+            return nullptr;
+        }
+        ::close(fd);
+        if (!save(*s)) {
+            err = "cannot write upload metadata";
+            return nullptr;
+        }
+        sessions_[s->id] = s;
+        return s;
+    }
+
+    // Session by id, loaded from disk after a restart; nullptr if unknown
+    std::shared_ptr<Session> find(const std::string &id) {
+        if (!SafeId(id)) return nullptr;
+        auto it = sessions_.find(id);
+        if (it != sessions_.end()) return it->second;
+        auto s = load(id);
+        if (s) sessions_[id] = s;
+        return s;
+    }
+
+    // Store one chunk at `offset` after checking its alignment, length and SHA-256
+    bool writeChunk(Session &s, uint64_t offset, const char *data, size_t len, const std::string &sha256,
+                    std::string &err) {
+        if (offset % s.chunk_size != 0 || offset >= s.size) {
+            err = "offset is not a chunk boundary of this upload";
+            return false;
+        }
+        uint64_t i = offset / s.chunk_size;
+        if (len != s.chunkLen(i)) {
+            err = "chunk at " + std::to_string(offset) + " must be " + std::to_string(s.chunkLen(i)) + " bytes";
+            return false;
+        }
+        if (sha256.empty() || Sha256Hex(data, len) != sha256) {
+            err = "chunk checksum mismatch";
+            return false;
+        }
+        int fd = ::open(dataPath(s.id).c_str(), O_WRONLY);
+        size_t off = 0;
+        while (fd >= 0 && off < len) {
+            ssize_t n = ::pwrite(fd, data + off, len - off, (off_t) (offset + off));
+            if (n <= 0) break;
+            off += (size_t) n;
+        }
+        if (fd >= 0) ::close(fd);
+        if (off != len) {
+            err = "cannot write chunk";
+            return false;
+        }
+        s.have[i] = true;
+        s.touched = Now();
+        save(s);
+        return true;
+    }
+
+    // SHA-256 of a file (a session's assembled data file), hex
+    static std::string FileSha256(const std::string &path) {
+        EVP_MD_CTX *ctx = EVP_MD_CTX_new();
+        EVP_DigestInit_ex(ctx, EVP_sha256(), nullptr);
+        std::ifstream f(path, std::ios::binary);
+        std::vector<char> buf(1 << 20);
+        while (f.read(buf.data(), (std::streamsize) buf.size()) || f.gcount() > 0) {
+            EVP_DigestUpdate(ctx, buf.data(), (size_t) f.gcount());
+        }
+        unsigned char md[EVP_MAX_MD_SIZE];
+        unsigned int len = 0;
+        EVP_DigestFinal_ex(ctx, md, &len);
+        EVP_MD_CTX_free(ctx);
+        return Hex(md, len);
+    }
+
+    // Missing chunk offsets
+    static std::vector<uint64_t> Missing(const Session &s) {
+        std::vector<uint64_t> out;
+        for (uint64_t i = 0; i < s.chunks(); i++) if (!s.have[i]) out.push_back(i * s.chunk_size);
+        return out;
+    }
+
+    void remove(const std::string &id) {
+        std::error_code ec;
+        std::filesystem::remove(dataPath(id), ec);
+        std::filesystem::remove(metaPath(id), ec);
+        sessions_.erase(id);
+    }
+
+    // Drop sessions idle for longer than the TTL, including ones only on disk,
+    // but not one a disk thread is still finishing
+    void expire() {
+        int64_t cutoff = Now() - ttl_s_;
+        std::error_code ec;
+        for (const auto &e : std::filesystem::directory_iterator(dir_, ec)) {
+            if (e.path().extension() != ".json") continue;
+            auto s = find(e.path().stem().string());
+            if (s && !s->finishing && s->touched < cutoff) remove(s->id);
+        }
+    }
+
+    std::string dataPath(const std::string &id) const { return dir_ + "/" + id + ".data"; }
+    size_t active() const { return sessions_.size(); }
+
+    static std::string Sha256Hex(const char *data, size_t len) {
+        unsigned char md[EVP_MAX_MD_SIZE];
+        unsigned int n = 0;
+        EVP_Digest(data, len, md, &n, EVP_sha256(), nullptr);
+        return Hex(md, n);
+    }
+
+private:
+    std::string metaPath(const std::string &id) const { return dir_ + "/" + id + ".json"; }
+
+    bool save(const Session &s) const {
+        nlohmann::json have = nlohmann::json::array();
+        for (uint64_t i = 0; i < s.chunks(); i++) if (s.have[i]) have.push_back(i);
+        nlohmann::json j = {{"target", s.target}, {"client_id", s.client_id}, {"type", s.type},
+                            {"encoding", s.encoding}, {"sha256", s.sha256}, {"size", s.size},
+                            {"chunk_size", s.chunk_size}, {"have", have}, {"touched", s.touched}};
+        // Replace atomically so a crash never leaves half a metadata file
+        std::string tmp = metaPath(s.id) + ".tmp";
+        {
+            std::ofstream f(tmp, std::ios::trunc);
+            f << j.dump();
+            if (!f) return false;
+        }
+        return std::rename(tmp.c_str(), metaPath(s.id).c_str()) == 0;
+    }
+
+    std::shared_ptr<Session> load(const std::string &id) const {
+        std::ifstream f(metaPath(id));
+        if (!f) return nullptr;
+        try {
+            nlohmann::json j = nlohmann::json::parse(f);
+            auto s = std::make_shared<Session>();
+            s->id = id;
+            s->target = j.at("target").get<std::string>();
+            s->client_id = j.value("client_id", std::string());
+            s->type = j.value("type", std::string());
+            s->encoding = j.value("encoding", std::string());
+            s->sha256 = j.value("sha256", std::string());
+            s->size = j.at("size").get<uint64_t>();
+            s->chunk_size = j.at("chunk_size").get<uint64_t>();
+            s->touched = j.value("touched", (int64_t) 0);
+            if (s->chunk_size < kMinChunk || s->chunk_size > kMaxChunk || s->size > max_size_) return nullptr;
+            s->have.assign(ChunkCount(s->size, s->chunk_size), false);
+            for (uint64_t i : j.at("have")) if (i < s->chunks()) s->have[i] = true;
+            return s;
+        } catch (const std::exception &) {
+            return nullptr;
+        }
+    }
+
+    static std::string NewId() {
+        unsigned char r[16];
+        RAND_bytes(r, sizeof(r));
+        return Hex(r, sizeof(r));
+    }
+
+    // ceil(size / chunk_size) without the overflow of size + chunk_size - 1
+    static uint64_t ChunkCount(uint64_t size, uint64_t chunk_size) {
+        return size / chunk_size + (size % chunk_size != 0);
+    }
+
+    static bool SafeId(const std::string &id) {
+        if (id.size() != 32) return false;
+        for (char ch : id) if (!isxdigit((unsigned char) ch)) return false;
+        return true;
+    }
+
+    static std::string Hex(const unsigned char *p, size_t n) {
+        static const char *digits = "0123456789abcdef";
+        std::string out(2 * n, '0');
+        for (size_t i = 0; i < n; i++) {
+            out[2 * i] = digits[p[i] >> 4];
+            out[2 * i + 1] = digits[p[i] & 15];
+        }
+        return out;
+    }
+
+    static int64_t Now() {
+        return std::chrono::duration_cast<std::chrono::seconds>(
+                   std::chrono::system_clock::now().time_since_epoch()).count();
+    }
+
+    std::string dir_;
+    int64_t ttl_s_;
+    uint64_t max_size_;
+    std::map<std::string, std::shared_ptr<Session>> sessions_;
+};
+
+#endif  // PPFL_UPLOAD_SESSIONS_H
@@ -0,0 +1,135 @@
+// server/src/workerPool.h
+// Fixed-size thread pool for the crypto work runMserver runs off the event loop
+//
+// Tasks are queued in lanes (one per federation in runMserver, lane 0 by
+// default). Within a lane they run in FIFO order; workers take from the lanes
+// in turn, so one federation's burst of uploads cannot starve the others.
+
+#ifndef PPFL_WORKER_POOL_H
+#define PPFL_WORKER_POOL_H
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+class WorkerPool {
+public:
+    // n == 0 -> one worker per hardware thread
+    explicit WorkerPool(size_t n = 0) {
+        if (n == 0) n = std::max(1u, std::thread::hardware_concurrency());
+        lanes_.emplace_back(new Lane());
+        for (size_t i = 0; i < n; i++) workers_.emplace_back([this] { run(); });
+    }
+
+    ~WorkerPool() {
+        {
+            std::lock_guard<std::mutex> lk(m_);
+            stop_ = true;
+        }
+        cv_.notify_all();
+        for (auto& t : workers_) t.join();
+    }
+
+    WorkerPool(const WorkerPool&) = delete;
+    WorkerPool& operator=(const WorkerPool&) = delete;
+
+    // New lane whose tasks occupy at most max_running workers at once
+    // (0 = no cap); returns its index. Add lanes before submitting.
+    size_t addLane(size_t max_running = 0) {
+        std::lock_guard<std::mutex> lk(m_);
+        lanes_.emplace_back(new Lane());
+        lanes_.back()->max_running = max_running;
+        return lanes_.size() - 1;
+    }
+
+    // Tasks must not throw; wrap them and record the error instead
+    void submit(std::function<void()> task, size_t lane = 0) {
+        {
+            std::lock_guard<std::mutex> lk(m_);
+            Lane& l = *lanes_.at(lane);
+            l.tasks.push_back(std::move(task));
+            l.queued.fetch_add(1, std::memory_order_relaxed);
+            queued_.fetch_add(1, std::memory_order_relaxed);
+        }
+        cv_.notify_one();
+    }
+
+    size_t size() const { return workers_.size(); }
+    size_t lanes() const { return lanes_.size(); }
+
+    // Tasks waiting for a worker / running now (for /metrics; no lock taken)
+    size_t queued() const { return queued_.load(std::memory_order_relaxed); }
+    size_t busy() const { return busy_.load(std::memory_order_relaxed); }
+    size_t queued(size_t lane) const { return lanes_[lane]->queued.load(std::memory_order_relaxed); }
+    size_t busy(size_t lane) const { return lanes_[lane]->busy.load(std::memory_order_relaxed); }
+
+private:
+    struct Lane {
+        std::deque<std::function<void()>> tasks;
+        size_t max_running = 0;
+        std::atomic<size_t> queued{0};
+        std::atomic<size_t> busy{0};
+    };
+
+    // Next lane with a task it may start, round-robin; lanes_.size() if none
+    size_t next() {
+        for (size_t i = 0; i < lanes_.size(); i++) {
+            size_t k = (cursor_ + i) % lanes_.size();
+            const Lane& l = *lanes_[k];
+            if (!l.tasks.empty() && (l.max_running == 0 || l.busy.load(std::memory_order_relaxed) < l.max_running)) {
+                cursor_ = k + 1;
+                return k;
+            }
+        }
+        return lanes_.size();
+    }
+
+    void run() {
+        for (;;) {
+            std::function<void()> task;
+            Lane* lane;
+            {
+                std::unique_lock<std::mutex> lk(m_);
+                size_t k = lanes_.size();
+                cv_.wait(lk, [&] { return (k = next()) < lanes_.size() || (stop_ && queued() == 0); });
+                if (k == lanes_.size()) return;
+                lane = lanes_[k].get();
+                task = std::move(lane->tasks.front());
+                lane->tasks.pop_front();
+                lane->queued.fetch_sub(1, std::memory_order_relaxed);
+                lane->busy.fetch_add(1, std::memory_order_relaxed);
+                queued_.fetch_sub(1, std::memory_order_relaxed);
+            }
+            busy_.fetch_add(1, std::memory_order_relaxed);
+            task();
+            busy_.fetch_sub(1, std::memory_order_relaxed);
+
+            // A task held back by its lane's cap may start now, and on
+            // shutdown the last one lets the idle workers exit
+            bool wake;
+            {
+                std::lock_guard<std::mutex> lk(m_);
+                lane->busy.fetch_sub(1, std::memory_order_relaxed);
+                wake = (lane->max_running != 0 && !lane->tasks.empty()) || (stop_ && queued() == 0);
+            }
+            if (wake) cv_.notify_all();
+        }
+    }
+
+    std::vector<std::thread> workers_;
+    std::vector<std::unique_ptr<Lane>> lanes_;
+    size_t cursor_ = 0;
+    std::mutex m_;
+    std::condition_variable cv_;
+    bool stop_ = false;
+    std::atomic<size_t> queued_{0};
+    std::atomic<size_t> busy_{0};
+};
+
+#endif  // PPFL_WORKER_POOL_H
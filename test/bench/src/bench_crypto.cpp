@@ -0,0 +1,308 @@
+// test/bench/src/bench_crypto.cpp
+// google-benchmark suite for every crypto stage of a round:
+//   MakeCKKSPackedPlaintext, Encrypt, ReEncrypt, EvalAdd, EvalMult (scalar and
+//   ciphertext), Decrypt, ciphertext Serialize/Deserialize (BINARY, as used on
+//   the wire), Base64Encode/Decode, and the combined EncodeCiphertext /
+//   DecodeCiphertext of libppfl.
+//
+// Every benchmark runs once per parameter set (ring dimension, multiplicative
+// depth, batch size). By default these are config_cc.json (CONFIG_PATH) plus a
+// small sweep; override with
+//   bench_crypto --params=<ring>:<depth>:<batch>[,<ring>:<depth>:<batch>...]
+// where ring 0 lets OpenFHE pick the smallest ring for 128-bit security (as
+// genCC does); an explicit ring disables the security check so any ring
+// >= 2*batch can be measured. ScalingModSize and PREMode come from
+// config_cc.json. All standard flags apply, e.g.
+//   --benchmark_filter=ReEncrypt --benchmark_out=bench.json --benchmark_out_format=json
+// Each run carries ring/depth/batch counters (the ring is the one OpenFHE chose).
+
+#include "openfhe.h"
+#include "ciphertext-ser.h"
+#include "cryptocontext-ser.h"
+#include "key/key-ser.h"
+#include "scheme/ckksrns/ckksrns-ser.h"
+
+#include <benchmark/benchmark.h>
+
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <random>
+#include <sstream>
+#include <string>
+#include <tuple>
+#include <vector>
+#include <nlohmann/json.hpp>
+
+#include "base64_utils.h"
+#include "ppfl/ppfl.h"
+
+#ifndef CONFIG_PATH
+#define CONFIG_PATH "server/config/config_cc.json"
+#endif
+
+using namespace lbcrypto;
+using json = nlohmann::json;
+
+namespace {
+
+struct Params {
+    uint32_t ring;   // 0 = OpenFHE default for 128-bit security
+    uint32_t depth;
+    uint32_t batch;
+
+    bool operator<(const Params& o) const {
+        return std::tie(ring, depth, batch) < std::tie(o.ring, o.depth, o.batch);
+    }
+    std::string label() const {
+        return "ring:" + std::to_string(ring) + "/depth:" + std::to_string(depth) + "/batch:" + std::to_string(batch);
+    }
+};
+
+json ccConfig;  // config_cc.json
+
+// Everything the benchmarks need for one parameter set, built on first use
+struct Fixture {
+    CryptoContext<DCRTPoly> cc;
+    KeyPair<DCRTPoly> kp1, kp2;
+    EvalKey<DCRTPoly> reKey;     // kp1 -> kp2
+    std::vector<double> data;    // batch values
+    Plaintext pt;
+    Ciphertext<DCRTPoly> ct, ct2;
+    std::string bin, b64;        // serialized ct
+};
+
+std::unique_ptr<Fixture> makeFixture(const Params& p) {
+    CCParams<CryptoContextCKKSRNS> params;
+    params.SetMultiplicativeDepth(p.depth);
+    params.SetScalingModSize(ccConfig.value("ScalingModSize", 40));
+    params.SetBatchSize(p.batch);
+    if (p.ring != 0) {
+        params.SetSecurityLevel(HEStd_NotSet);
+        params.SetRingDim(p.ring);
+    }
+    if (ccConfig.value("PREMode", "INDCPA") == "INDCPA") params.SetPREMode(INDCPA);
+
+    auto f = std::make_unique<Fixture>();
+    f->cc = GenCryptoContext(params);
+    f->cc->Enable(PKE);
+    f->cc->Enable(LEVELEDSHE);
+    f->cc->Enable(KEYSWITCH);
+    f->cc->Enable(PRE);
+
+    f->kp1 = f->cc->KeyGen();
+    f->kp2 = f->cc->KeyGen();
+    f->cc->EvalMultKeyGen(f->kp1.secretKey);
+    f->reKey = f->cc->ReKeyGen(f->kp1.secretKey, f->kp2.publicKey);
+
+    std::mt19937_64 rng(42);
+    std::normal_distribution<double> dist(0.0, 0.05);  // typical weight magnitudes
+    f->data.resize(p.batch);
+    for (auto& v : f->data) v = dist(rng);
+
+    f->pt = f->cc->MakeCKKSPackedPlaintext(f->data);
+    f->ct = f->cc->Encrypt(f->kp1.publicKey, f->pt);
+    f->ct2 = f->cc->Encrypt(f->kp1.publicKey, f->pt);
+
+    std::stringstream ss;
+    Serial::Serialize(f->ct, ss, SerType::BINARY);
+    f->bin = ss.str();
+    f->b64 = Base64Encode(f->bin);
+    return f;
+}
+
+Fixture& fixture(const Params& p) {
+    static std::map<Params, std::unique_ptr<Fixture>> cache;
+    auto& f = cache[p];
+    if (!f) f = makeFixture(p);
+    return *f;
+}
+
+void setCounters(benchmark::State& state, const Params& p, const Fixture& f) {
+    state.counters["ring"] = f.cc->GetRingDimension();
+    state.counters["depth"] = p.depth;
+    state.counters["batch"] = p.batch;
+}
+
+// ----------------------
+// Benchmarks
+// ----------------------
+void BM_MakeCKKSPackedPlaintext(benchmark::State& state, Params p) {
+    auto& f = fixture(p);
+    for (auto _ : state) benchmark::DoNotOptimize(f.cc->MakeCKKSPackedPlaintext(f.data));
+    setCounters(state, p, f);
+    state.SetItemsProcessed(state.iterations() * p.batch);
+}
+
+void BM_Encrypt(benchmark::State& state, Params p) {
+    auto& f = fixture(p);
+    for (auto _ : state) benchmark::DoNotOptimize(f.cc->Encrypt(f.kp1.publicKey, f.pt));
+    setCounters(state, p, f);
+}
+
+void BM_ReEncrypt(benchmark::State& state, Params p) {
+    auto& f = fixture(p);
+    for (auto _ : state) benchmark::DoNotOptimize(f.cc->ReEncrypt(f.ct, f.reKey));
+    setCounters(state, p, f);
+}
+
+void BM_EvalAdd(benchmark::State& state, Params p) {
+    auto& f = fixture(p);
+    for (auto _ : state) benchmark::DoNotOptimize(f.cc->EvalAdd(f.ct, f.ct2));
+    setCounters(state, p, f);
+}
+
+// Scalar multiply, as used for averaging and stale-update weights
+void BM_EvalMultScalar(benchmark::State& state, Params p) {
+    auto& f = fixture(p);
+    for (auto _ : state) benchmark::DoNotOptimize(f.cc->EvalMult(f.ct, 0.5));
+    setCounters(state, p, f);
+}
+
+void BM_EvalMultCiphertext(benchmark::State& state, Params p) {
+    auto& f = fixture(p);
+    for (auto _ : state) benchmark::DoNotOptimize(f.cc->EvalMult(f.ct, f.ct2));
+    setCounters(state, p, f);
+}
+
+void BM_Decrypt(benchmark::State& state, Params p) {
+    auto& f = fixture(p);
+    for (auto _ : state) {
+        Plaintext out;
+        f.cc->Decrypt(f.kp1.secretKey, f.ct, &out);
+        benchmark::DoNotOptimize(out);
+    }
+    setCounters(state, p, f);
+}
+
+void BM_Serialize(benchmark::State& state, Params p) {
+    auto& f = fixture(p);
+    for (auto _ : state) {
+        std::stringstream ss;
+        Serial::Serialize(f.ct, ss, SerType::BINARY);
+        benchmark::DoNotOptimize(ss.str());
+    }
+    setCounters(state, p, f);
+    state.SetBytesProcessed(state.iterations() * f.bin.size());
+}
+
+void BM_Deserialize(benchmark::State& state, Params p) {
+    auto& f = fixture(p);
+    for (auto _ : state) {
+        std::stringstream ss(f.bin);
+        Ciphertext<DCRTPoly> ct;
+        Serial::Deserialize(ct, ss, SerType::BINARY);
+        benchmark::DoNotOptimize(ct);
+    }
+    setCounters(state, p, f);
+    state.SetBytesProcessed(state.iterations() * f.bin.size());
+}
+
+void BM_Base64Encode(benchmark::State& state, Params p) {
+    auto& f = fixture(p);
+    for (auto _ : state) benchmark::DoNotOptimize(Base64Encode(f.bin));
+    setCounters(state, p, f);
+    state.SetBytesProcessed(state.iterations() * f.bin.size());
+}
+
+void BM_Base64Decode(benchmark::State& state, Params p) {
+    auto& f = fixture(p);
+    for (auto _ : state) benchmark::DoNotOptimize(Base64Decode(f.b64));
+    setCounters(state, p, f);
+    state.SetBytesProcessed(state.iterations() * f.bin.size());
+}
+
+// Serialize + Base64 / Base64 + Deserialize, as every pipeline stage does per ciphertext
+void BM_EncodeCiphertext(benchmark::State& state, Params p) {
+    auto& f = fixture(p);
+    for (auto _ : state) benchmark::DoNotOptimize(ppfl::EncodeCiphertext(f.ct));
+    setCounters(state, p, f);
+    state.SetBytesProcessed(state.iterations() * f.bin.size());
+}
+
+void BM_DecodeCiphertext(benchmark::State& state, Params p) {
+    auto& f = fixture(p);
+    for (auto _ : state) benchmark::DoNotOptimize(ppfl::DecodeCiphertext(f.b64));
+    setCounters(state, p, f);
+    state.SetBytesProcessed(state.iterations() * f.bin.size());
+}
+
+const std::vector<std::pair<const char*, void (*)(benchmark::State&, Params)>> BENCHMARKS = {
+    {"MakeCKKSPackedPlaintext", BM_MakeCKKSPackedPlaintext},
+    {"Encrypt", BM_Encrypt},
+    {"ReEncrypt", BM_ReEncrypt},
+    {"EvalAdd", BM_EvalAdd},
+    {"EvalMultScalar", BM_EvalMultScalar},
+    {"EvalMultCiphertext", BM_EvalMultCiphertext},
+    {"Decrypt", BM_Decrypt},
+    {"Serialize", BM_Serialize},
+    {"Deserialize", BM_Deserialize},
+    {"Base64Encode", BM_Base64Encode},
+    {"Base64Decode", BM_Base64Decode},
+    {"EncodeCiphertext", BM_EncodeCiphertext},
+    {"DecodeCiphertext", BM_DecodeCiphertext},
+};
+
+// ----------------------
+// Parameter sets
+// ----------------------
+std::vector<Params> defaultParams() {
+    Params cfg{0, ccConfig.value("MultiplicativeDepth", 2u), ccConfig.value("BatchSize", 8192u)};
+    std::vector<Params> out{cfg};
+    for (uint32_t depth : {1u, 2u, 3u}) out.push_back({16384, depth, 8192});
+    out.push_back({32768, 2, 16384});
+    return out;
+}
+
+// "--params=R:D:B,R:D:B"; removed from argv so benchmark::Initialize does not reject it
+bool parseParams(int& argc, char** argv, std::vector<Params>& out) {
+    const std::string flag = "--params=";
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg.compare(0, flag.size(), flag) != 0) continue;
+
+        std::stringstream list(arg.substr(flag.size()));
+        for (std::string item; std::getline(list, item, ',');) {
+            Params p{};
+            char c1 = 0, c2 = 0;
+            std::stringstream is(item);
+            if (!(is >> p.ring >> c1 >> p.depth >> c2 >> p.batch) || c1 != ':' || c2 != ':' || p.depth == 0 ||
+                p.batch == 0 || (p.ring != 0 && p.ring < 2 * p.batch)) {
+                std::cerr << "[bench] bad --params entry '" << item << "' (want ring:depth:batch, ring >= 2*batch)\n";
+                return false;
+            }
+            out.push_back(p);
+        }
+        for (int j = i; j + 1 < argc; j++) argv[j] = argv[j + 1];
+        argc--;
+        i--;
+    }
+    return true;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    std::ifstream cfg(CONFIG_PATH);
+    if (cfg.good()) cfg >> ccConfig;
+    else std::cerr << "[bench] " << CONFIG_PATH << " not found, using built-in defaults\n";
+    ccConfig = ccConfig.is_object() ? ccConfig : json::object();
+
+    std::vector<Params> sets;
+    if (!parseParams(argc, argv, sets)) return 1;
+    if (sets.empty()) sets = defaultParams();
+
+    for (const auto& p : sets) {
+        for (const auto& b : BENCHMARKS) {
+            std::string name = std::string(b.first) + "/" + p.label();
+            benchmark::RegisterBenchmark(name.c_str(), b.second, p)->Unit(benchmark::kMicrosecond);
+        }
+    }
+
+    benchmark::Initialize(&argc, argv);
+    if (benchmark::ReportUnrecognizedArguments(argc, argv)) return 1;
+    benchmark::RunSpecifiedBenchmarks();
+    benchmark::Shutdown();
+    return 0;
+}
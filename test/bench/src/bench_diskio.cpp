@@ -0,0 +1,191 @@
+// test/bench/src/bench_diskio.cpp
+// google-benchmark suite for runMserver's disk I/O backends (server/src/diskIO.h):
+//   WriteStream  many small writes through the Writer streambuf, as
+//                wire::DecodeTo produces when decoding a compressed upload
+//   WriteSpan    one large write, as an identity upload is stored
+//   ReadFile     a whole-file read, as a FileCache miss is filled
+//
+// Each runs once per backend (posix, and uring when built with -DPPFL_WITH_URING)
+// and per file size. Files go to $PPFL_BENCH_DIR (default /tmp); put that on the
+// disk runMserver's storage lives on for meaningful numbers. Writes end with
+// fdatasync() unless --no-sync is given, so the page cache does not hide the
+// device; rates are per wall-clock second. Extra flags:
+//   bench_diskio --sizes=<MiB>[,<MiB>...] --depth=<n> --buffer-kb=<n> --no-sync
+// plus all standard flags, e.g. --benchmark_out=diskio.json --benchmark_out_format=json
+
+#include <benchmark/benchmark.h>
+
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "../../../server/src/diskIO.h"
+
+namespace {
+
+std::vector<size_t> sizesMiB = {4, 64, 256};
+diskio::Options baseOpts;
+bool doSync = true;
+
+std::string benchPath(const char* tag) {
+    const char* dir = std::getenv("PPFL_BENCH_DIR");
+    return std::string(dir ? dir : "/tmp") + "/bench_diskio_" + tag + "_" + std::to_string(getpid()) + ".bin";
+}
+
+std::string payload(size_t bytes) {
+    std::string s(bytes, '\0');
+    uint64_t x = 0x9e3779b97f4a7c15ull;
+    for (size_t i = 0; i < bytes; i++) {
+        x ^= x << 13; x ^= x >> 7; x ^= x << 17;
+        s[i] = (char) x;
+    }
+    return s;
+}
+
+void syncFile(const std::string& path) {
+    if (!doSync) return;
+    int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd >= 0) {
+        ::fdatasync(fd);
+        ::close(fd);
+    }
+}
+
+// Fails the benchmark if `backend` fell back to another one
+bool setup(benchmark::State& state, diskio::DiskIO& io, const std::string& backend) {
+    if (backend != io.backend()) {
+        state.SkipWithError(("backend " + backend + " unavailable, got " + io.backend()).c_str());
+        return false;
+    }
+    return true;
+}
+
+void WriteStream(benchmark::State& state, std::string backend, size_t bytes) {
+    diskio::Options opt = baseOpts;
+    opt.backend = backend;
+    diskio::DiskIO io(opt);
+    if (!setup(state, io, backend)) return;
+    const std::string data = payload(bytes), path = benchPath("stream");
+    const size_t chunk = 16 * 1024;  // zlib/zstd output granularity
+
+    for (auto _ : state) {
+        std::string err;
+        auto w = io.open(path, bytes, err);
+        if (!w) { state.SkipWithError(err.c_str()); break; }
+        for (size_t off = 0; off < bytes; off += chunk) {
+            w->sputn(data.data() + off, (std::streamsize) std::min(chunk, bytes - off));
+        }
+        if (!w->close()) { state.SkipWithError("write failed"); break; }
+        syncFile(path);
+    }
+    ::unlink(path.c_str());
+    state.SetBytesProcessed((int64_t) (state.iterations() * bytes));
+}
+
+void WriteSpan(benchmark::State& state, std::string backend, size_t bytes) {
+    diskio::Options opt = baseOpts;
+    opt.backend = backend;
+    diskio::DiskIO io(opt);
+    if (!setup(state, io, backend)) return;
+    const std::string data = payload(bytes), path = benchPath("span");
+
+    for (auto _ : state) {
+        std::string err;
+        auto w = io.open(path, bytes, err);
+        if (!w) { state.SkipWithError(err.c_str()); break; }
+        w->sputn(data.data(), (std::streamsize) bytes);
+        if (!w->close()) { state.SkipWithError("write failed"); break; }
+        syncFile(path);
+    }
+    ::unlink(path.c_str());
+    state.SetBytesProcessed((int64_t) (state.iterations() * bytes));
+}
+
+void ReadFile(benchmark::State& state, std::string backend, size_t bytes) {
+    diskio::Options opt = baseOpts;
+    opt.backend = backend;
+    diskio::DiskIO io(opt);
+    if (!setup(state, io, backend)) return;
+    const std::string path = benchPath("read");
+    {
+        std::string err;
+        const std::string data = payload(bytes);
+        auto w = io.open(path, bytes, err);
+        if (!w || (w->sputn(data.data(), (std::streamsize) bytes), !w->close())) {
+            state.SkipWithError("could not create the input file");
+            return;
+        }
+    }
+
+    std::string out;
+    for (auto _ : state) {
+        if (!io.readFile(path, out) || out.size() != bytes) { state.SkipWithError("read failed"); break; }
+        benchmark::DoNotOptimize(out.data());
+    }
+    ::unlink(path.c_str());
+    state.SetBytesProcessed((int64_t) (state.iterations() * bytes));
+}
+
+bool parseArgs(int& argc, char** argv) {
+    int out = 1;
+    for (int i = 1; i < argc; i++) {
+        std::string a = argv[i];
+        try {
+            if (a.rfind("--sizes=", 0) == 0) {
+                sizesMiB.clear();
+                std::string list = a.substr(8);
+                for (size_t pos = 0; pos <= list.size();) {
+                    size_t comma = list.find(',', pos);
+                    if (comma == std::string::npos) comma = list.size();
+                    sizesMiB.push_back(std::stoul(list.substr(pos, comma - pos)));
+                    pos = comma + 1;
+                }
+            } else if (a.rfind("--depth=", 0) == 0) {
+                baseOpts.depth = std::stoul(a.substr(8));
+            } else if (a.rfind("--buffer-kb=", 0) == 0) {
+                baseOpts.buffer_bytes = std::stoul(a.substr(12)) * 1024;
+            } else if (a == "--no-sync") {
+                doSync = false;
+            } else {
+                argv[out++] = argv[i];
+            }
+        } catch (const std::exception&) {
+            std::cerr << "[bench] bad value in " << a << "\n";
+            return false;
+        }
+    }
+    argc = out;
+    return true;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    if (!parseArgs(argc, argv)) return 1;
+
+    std::vector<std::string> backends = {"posix"};
+#ifdef PPFL_WITH_URING
+    backends.push_back("uring");
+#endif
+
+    for (size_t mib : sizesMiB) {
+        size_t bytes = mib << 20;
+        for (const auto& be : backends) {
+            std::string label = "/" + be + "/MiB:" + std::to_string(mib);
+            benchmark::RegisterBenchmark(("WriteStream" + label).c_str(), WriteStream, be, bytes)->Unit(benchmark::kMillisecond)->UseRealTime();
+            benchmark::RegisterBenchmark(("WriteSpan" + label).c_str(), WriteSpan, be, bytes)->Unit(benchmark::kMillisecond)->UseRealTime();
+            benchmark::RegisterBenchmark(("ReadFile" + label).c_str(), ReadFile, be, bytes)->Unit(benchmark::kMillisecond)->UseRealTime();
+        }
+    }
+
+    benchmark::Initialize(&argc, argv);
+    if (benchmark::ReportUnrecognizedArguments(argc, argv)) return 1;
+    benchmark::RunSpecifiedBenchmarks();
+    benchmark::Shutdown();
+    return 0;
+}
@@ -0,0 +1,128 @@
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+#include "taskGraph.h"
+
+// Dependency graph behind ppfl_dag (TaskGraph): ordering, failure handling,
+// the job bound and the critical path; tasks are plain lambdas.
+class TaskGraphTest : public ::testing::Test {
+protected:
+    std::mutex m;
+    std::vector<size_t> finished;
+
+    std::function<bool()> record(size_t id, int sleepMs = 0, bool ok = true) {
+        return [this, id, sleepMs, ok] {
+            if (sleepMs) std::this_thread::sleep_for(std::chrono::milliseconds(sleepMs));
+            std::lock_guard<std::mutex> lk(m);
+            finished.push_back(id);
+            return ok;
+        };
+    }
+
+    size_t position(size_t id) const {
+        return std::find(finished.begin(), finished.end(), id) - finished.begin();
+    }
+};
+
+// --- Every task runs after all of its dependencies ---
+TEST_F(TaskGraphTest, DependenciesRunFirst) {
+    TaskGraph g;
+    size_t train1 = g.add("train_1", {}, record(0, 5));
+    size_t train2 = g.add("train_2", {}, record(1));
+    size_t enc1 = g.add("encrypt_1", {train1}, record(2));
+    size_t enc2 = g.add("encrypt_2", {train2}, record(3, 5));
+    size_t agg = g.add("aggregate", {enc1, enc2}, record(4));
+    g.add("decrypt", {agg}, record(5));
+
+    ASSERT_TRUE(g.run(4));
+    ASSERT_EQ(finished.size(), 6u);
+    for (size_t i = 0; i < g.tasks().size(); i++) {
+        const auto& t = g.tasks()[i];
+        EXPECT_EQ(t.state, TaskGraph::State::Done) << t.name;
+        for (size_t d : t.deps) {
+            EXPECT_LT(position(d), position(i)) << t.name;
+            EXPECT_LE(g.tasks()[d].end_us, t.start_us) << t.name;
+        }
+    }
+}
+
+// --- After a failure nothing new starts; the rest is skipped ---
+TEST_F(TaskGraphTest, FailureSkipsTheRest) {
+    TaskGraph g;
+    size_t a = g.add("train_1", {}, record(0, 0, false));
+    g.add("encrypt_1", {a}, record(1));
+    g.add("train_2", {}, record(2));
+
+    EXPECT_FALSE(g.run(1));
+    EXPECT_EQ(finished, (std::vector<size_t>{0}));
+    EXPECT_EQ(g.tasks()[0].state, TaskGraph::State::Failed);
+    EXPECT_EQ(g.tasks()[1].state, TaskGraph::State::Skipped);
+    EXPECT_EQ(g.tasks()[2].state, TaskGraph::State::Skipped);
+}
+
+TEST_F(TaskGraphTest, ThrowCountsAsFailure) {
+    TaskGraph g;
+    size_t a = g.add("keygen", {}, []() -> bool { throw std::runtime_error("no CC.json"); });
+    g.add("upload", {a}, record(1));
+    EXPECT_FALSE(g.run(2));
+    EXPECT_EQ(g.tasks()[0].state, TaskGraph::State::Failed);
+    EXPECT_EQ(g.tasks()[1].state, TaskGraph::State::Skipped);
+    EXPECT_TRUE(finished.empty());
+}
+
+TEST_F(TaskGraphTest, UnknownDependencyRejected) {
+    TaskGraph g;
+    size_t a = g.add("train_1", {}, record(0));
+    EXPECT_THROW(g.add("encrypt_1", {a + 1}, record(1)), std::invalid_argument);
+    EXPECT_EQ(g.tasks().size(), 1u);
+}
+
+// --- At most `jobs` tasks at once ---
+TEST_F(TaskGraphTest, JobsBoundConcurrency) {
+    TaskGraph g;
+    std::atomic<int> running{0}, peak{0};
+    for (int i = 0; i < 9; i++) {
+        g.add("t" + std::to_string(i), {}, [&] {
+            int now = ++running;
+            int prev = peak.load();
+            while (now > prev && !peak.compare_exchange_weak(prev, now)) {
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds(20));
+            running--;
+            return true;
+        });
+    }
+    ASSERT_TRUE(g.run(3));
+    EXPECT_LE(peak.load(), 3);
+    EXPECT_GT(peak.load(), 1);
+    EXPECT_LT(g.wallUs(), g.workUs());
+}
+
+// --- The critical path is the slowest dependency chain ---
+TEST_F(TaskGraphTest, CriticalPathFollowsSlowestChain) {
+    TaskGraph g;
+    size_t slow = g.add("train_1", {}, record(0, 40));
+    size_t fast = g.add("train_2", {}, record(1));
+    size_t agg = g.add("aggregate", {fast, slow}, record(2, 10));
+    g.add("report", {}, record(3, 5));
+
+    ASSERT_TRUE(g.run(4));
+    EXPECT_EQ(g.criticalPath(), (std::vector<size_t>{slow, agg}));
+    int64_t path = g.tasks()[slow].durationUs() + g.tasks()[agg].durationUs();
+    EXPECT_GE(g.workUs(), path);
+    EXPECT_GE(g.wallUs(), path);
+}
+
+TEST_F(TaskGraphTest, EmptyGraphSucceeds) {
+    TaskGraph g;
+    EXPECT_TRUE(g.run(4));
+    EXPECT_TRUE(g.criticalPath().empty());
+    EXPECT_STREQ(TaskGraph::StateName(TaskGraph::State::Skipped), "skipped");
+}
@@ -0,0 +1,78 @@
+#!/bin/bash
+# =====================================
+# PPFL Load Test: runMserver on scratch storage + loadgen
+# =====================================
+#
+# Usage: test/load/run_load.sh [loadgen options...]
+#   e.g. test/load/run_load.sh --clients 64 --concurrency 32 --rounds 3 --weights-bytes 32M
+#
+# Starts runMserver on LOAD_PORT (default 8090) with a generated config whose
+# storage lives in a temp dir seeded with synthetic CC/key/weights files, runs
+# loadgen against it with --server-pid for RSS sampling, then stops the
+# server. The JSON report goes to test/load/build/loadgen_report.json unless
+# --out is given.
+
+set -e
+
+SCRIPT_DIR="$(cd "$(dirname "${BASH_SOURCE[0]}")" && pwd)"
+BASE_DIR="$SCRIPT_DIR/../.."
+cd "$BASE_DIR"
+
+RUNMSERVER_BIN="server/build/runMserver"
+LOADGEN_BIN="test/load/build/loadgen"
+LOAD_PORT=${LOAD_PORT:-8090}
+SEED_BYTES=${SEED_BYTES:-65536}
+
+for bin in "$RUNMSERVER_BIN" "$LOADGEN_BIN"; do
+    [ -x "$bin" ] || { echo "[load] ERROR: $bin missing (make runMserver loadgen)"; exit 1; }
+done
+
+SCRATCH=$(mktemp -d /tmp/ppfl_load.XXXXXX)
+STORAGE="$SCRATCH/storage"
+SERVER_PID=""
+cleanup() {
+    [ -n "$SERVER_PID" ] && kill "$SERVER_PID" 2>/dev/null || true
+    rm -rf "$SCRATCH"
+}
+trap cleanup EXIT
+
+# --- Scratch config, same layout as server/config/sConfig.json ---
+cat > "$SCRATCH/sConfig.json" <<EOF
+{
+  "mSConfig": { "SERVER_IP": "127.0.0.1", "SERVER_PORT": $LOAD_PORT },
+  "CC": { "path": "$STORAGE/CC.json" },
+  "CLIENTS": {
+    "CLIENT_1_PUBLIC": "$STORAGE/client_1/client_1-public.key",
+    "CLIENT_2_PUBLIC": "$STORAGE/client_2/client_2-public.key",
+    "CLIENT_1_REKEY": "$STORAGE/client_1/client_1-ReKey.key",
+    "CLIENT_2_REKEY": "$STORAGE/client_2/client_2-ReKey.key",
+    "CLIENT_1_ENCRYPTED_WEIGHTS_PATH": "$STORAGE/client_1/encrypted_weights_c1.json",
+    "CLIENT_2_ENCRYPTED_WEIGHTS_PATH": "$STORAGE/client_2/encrypted_weights_c2.json",
+    "OUTPUT_DOMAIN_CHANGED_PATH": "$STORAGE/client_2/c1_domainChange_c2.json",
+    "AGGREGATED_ENCRYPTED_WEIGHTS_PATH": "$STORAGE/client_2/aggregated_weights.json",
+    "OUTPUT_AGGREGATED_DOMAIN_CHANGED_PATH": "$STORAGE/client_1/c2_domainChange_c1.json"
+  }
+}
+EOF
+
+# --- Seed every file a GET may ask for before the first upload lands ---
+mkdir -p "$STORAGE/client_1" "$STORAGE/client_2"
+for f in CC.json client_1/client_1-public.key client_2/client_2-public.key \
+         client_1/encrypted_weights_c1.json client_2/encrypted_weights_c2.json; do
+    head -c "$SEED_BYTES" /dev/urandom | base64 -w0 > "$STORAGE/$f"
+done
+
+# --- Run ---
+# From the scratch dir, so the server's metrics CSV stays out of the repo
+(cd "$SCRATCH" && exec "$BASE_DIR/$RUNMSERVER_BIN" sConfig.json > server.log 2>&1) &
+SERVER_PID=$!
+for _ in $(seq 50); do
+    curl -s -o /dev/null "http://127.0.0.1:$LOAD_PORT/getCC" && break
+    sleep 0.1
+done
+
+mkdir -p test/load/build
+OUT_ARGS=(--out test/load/build/loadgen_report.json)
+for a in "$@"; do [ "$a" = "--out" ] && OUT_ARGS=(); done
+
+"$LOADGEN_BIN" --url "http://127.0.0.1:$LOAD_PORT" --server-pid "$SERVER_PID" "${OUT_ARGS[@]}" "$@"
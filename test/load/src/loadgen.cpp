@@ -0,0 +1,345 @@
+// test/load/src/loadgen.cpp
+// Synthetic N-client load generator for runMserver
+//
+// Simulates N clients doing the real endpoint sequence of a federated round
+// against one runMserver, --concurrency of them at a time:
+//   once:      GET /getCC, POST /uploadPubKeyC<k>, GET /sendPbKeyC<peer>, POST /uploadReKeyC<k>
+//   per round: POST /uploadEncWeightsC<k>, GET /download/<path>
+// Client i uses slot k = 1 + i % 2 (the server's hard-wired clients 1/2).
+// Payloads are synthetic Base64 text of the configured sizes sent as the
+// same multipart form msend posts, so run it against a scratch server
+// (test/load/run_load.sh), never against real key storage.
+//
+// Usage:
+//   loadgen [--url http://127.0.0.1:8000] [--clients 16] [--concurrency 16] [--rounds 1]
+//           [--key-bytes 4M] [--weights-bytes 8M] [--download-path client_{k}/encrypted_weights_c{k}.json]
+//           [--server-pid PID] [--sample-ms 250] [--no-keepalive] [--timeout-ms 60000]
+//           [--out loadgen_report.json]
+//
+// Reports throughput, per-endpoint latency percentiles and errors on stdout;
+// the JSON report adds a timeline of completed requests, bytes and server
+// RSS (VmRSS of --server-pid) every --sample-ms.
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include <nlohmann/json.hpp>
+
+#include "http_client.h"
+
+using json = nlohmann::json;
+using Clock = std::chrono::steady_clock;
+
+namespace {
+
+struct Options {
+    std::string url = "http://127.0.0.1:8000";
+    size_t clients = 16;
+    size_t concurrency = 0;  // 0 = clients
+    int rounds = 1;
+    size_t key_bytes = 4u << 20;
+    size_t weights_bytes = 8u << 20;
+    std::string download_path = "client_{k}/encrypted_weights_c{k}.json";
+    long server_pid = 0;
+    int sample_ms = 250;
+    bool keepalive = true;
+    int timeout_ms = 60000;
+    std::string out = "loadgen_report.json";
+};
+
+// Latency samples of one endpoint, microseconds
+struct EndpointStats {
+    std::vector<double> latency_us;
+    size_t errors = 0;
+    size_t bytes_sent = 0;
+    size_t bytes_received = 0;
+};
+
+// ----------------------
+// Shared progress (read by the sampler)
+// ----------------------
+std::atomic<size_t> g_requests{0};
+std::atomic<size_t> g_errors{0};
+std::atomic<size_t> g_bytes{0};
+
+size_t parseSize(const std::string& s) {
+    char* end = nullptr;
+    double v = strtod(s.c_str(), &end);
+    switch (end && *end ? toupper((unsigned char) *end) : 0) {
+        case 'K': v *= 1024; break;
+        case 'M': v *= 1024 * 1024; break;
+        case 'G': v *= 1024.0 * 1024 * 1024; break;
+        default: break;
+    }
+    return (size_t) v;
+}
+
+std::string replaceAll(std::string s, const std::string& from, const std::string& to) {
+    for (size_t pos = 0; (pos = s.find(from, pos)) != std::string::npos; pos += to.size()) s.replace(pos, from.size(), to);
+    return s;
+}
+
+// Synthetic Base64-alphabet payload, like a serialized key or encrypted weights file
+std::string makePayload(size_t n) {
+    static const char alphabet[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+    std::string s(n, 'A');
+    uint64_t x = 0x9E3779B97F4A7C15ull;
+    for (auto& ch : s) {
+        x ^= x << 13; x ^= x >> 7; x ^= x << 17;
+        ch = alphabet[x & 63];
+    }
+    return s;
+}
+
+// The multipart form msend/curl -F sends: file, client_id, type
+std::string multipart(const std::string& boundary, const std::string& payload, const std::string& client_id,
+                      const std::string& type) {
+    std::string b = "--" + boundary + "\r\n"
+                    "Content-Disposition: form-data; name=\"file\"; filename=\"" + type + ".json\"\r\n"
+                    "Content-Type: application/octet-stream\r\n\r\n";
+    b.reserve(b.size() + payload.size() + 256);
+    b += payload;
+    b += "\r\n--" + boundary + "\r\nContent-Disposition: form-data; name=\"client_id\"\r\n\r\n" + client_id;
+    b += "\r\n--" + boundary + "\r\nContent-Disposition: form-data; name=\"type\"\r\n\r\n" + type;
+    b += "\r\n--" + boundary + "--\r\n";
+    return b;
+}
+
+long readRssKb(long pid) {
+    std::ifstream f("/proc/" + std::to_string(pid) + "/status");
+    for (std::string line; std::getline(f, line);) {
+        if (line.compare(0, 6, "VmRSS:") == 0) return strtol(line.c_str() + 6, nullptr, 10);
+    }
+    return -1;
+}
+
+double percentile(std::vector<double>& v, double p) {
+    if (v.empty()) return 0.0;
+    size_t k = std::min(v.size() - 1, (size_t) (p / 100.0 * (v.size() - 1) + 0.5));
+    std::nth_element(v.begin(), v.begin() + k, v.end());
+    return v[k];
+}
+
+// ----------------------
+// One simulated client
+// ----------------------
+class SimClient {
+public:
+    SimClient(const Options& opt, size_t index, const std::string& keyPayload, const std::string& weightsPayload,
+              std::map<std::string, EndpointStats>& stats)
+        : opt_(opt), slot_(1 + index % 2), keyPayload_(keyPayload), weightsPayload_(weightsPayload), stats_(stats) {}
+
+    void run() {
+        const std::string k = std::to_string(slot_), peer = std::to_string(3 - slot_);
+        const std::string boundary = "----ppflload" + k;
+        const std::string form = "multipart/form-data; boundary=" + boundary;
+
+        call("GET /getCC", "GET", "/getCC");
+        call("POST /uploadPubKeyC", "POST", "/uploadPubKeyC" + k, multipart(boundary, keyPayload_, k, "pubkey"), form);
+        call("GET /sendPbKeyC", "GET", "/sendPbKeyC" + peer);
+        call("POST /uploadReKeyC", "POST", "/uploadReKeyC" + k, multipart(boundary, keyPayload_, k, "rekey"), form);
+
+        const std::string weightsForm = multipart(boundary, weightsPayload_, k, "weights");
+        const std::string download = "/download/" + replaceAll(opt_.download_path, "{k}", k);
+        for (int r = 0; r < opt_.rounds; r++) {
+            call("POST /uploadEncWeightsC", "POST", "/uploadEncWeightsC" + k, weightsForm, form);
+            call("GET /download", "GET", download);
+        }
+    }
+
+private:
+    void call(const std::string& label, const std::string& method, const std::string& path,
+              const std::string& body = "", const std::string& contentType = "") {
+        HttpHeaders headers;
+        if (!contentType.empty()) headers.emplace_back("Content-Type", contentType);
+        if (!opt_.keepalive) headers.emplace_back("Connection", "close");
+
+        auto& st = stats_[label];
+        auto t0 = Clock::now();
+        bool ok = false;
+        size_t received = 0;
+        try {
+            if (!http_ || !opt_.keepalive) http_ = std::make_unique<HttpClient>(opt_.url, opt_.timeout_ms);
+            HttpResponse r = http_->request(method, path, body, headers);
+            ok = r.status / 100 == 2;
+            received = r.body.size();
+        } catch (const std::exception&) {
+            http_.reset();
+        }
+        double us = std::chrono::duration<double, std::micro>(Clock::now() - t0).count();
+
+        st.latency_us.push_back(us);
+        st.bytes_sent += body.size();
+        st.bytes_received += received;
+        if (!ok) {
+            st.errors++;
+            g_errors++;
+        }
+        g_requests++;
+        g_bytes += body.size() + received;
+    }
+
+    const Options& opt_;
+    int slot_;
+    const std::string& keyPayload_;
+    const std::string& weightsPayload_;
+    std::map<std::string, EndpointStats>& stats_;  // this worker's shard
+    std::unique_ptr<HttpClient> http_;
+};
+
+bool parseArgs(int argc, char** argv, Options& o) {
+    for (int i = 1; i < argc; i++) {
+        std::string a = argv[i];
+        auto next = [&]() -> std::string {
+            if (i + 1 >= argc) throw std::runtime_error("missing value for " + a);
+            return argv[++i];
+        };
+        if (a == "--url") o.url = next();
+        else if (a == "--clients") o.clients = std::stoul(next());
+        else if (a == "--concurrency") o.concurrency = std::stoul(next());
+        else if (a == "--rounds") o.rounds = std::stoi(next());
+        else if (a == "--key-bytes") o.key_bytes = parseSize(next());
+        else if (a == "--weights-bytes") o.weights_bytes = parseSize(next());
+        else if (a == "--download-path") o.download_path = next();
+        else if (a == "--server-pid") o.server_pid = std::stol(next());
+        else if (a == "--sample-ms") o.sample_ms = std::stoi(next());
+        else if (a == "--no-keepalive") o.keepalive = false;
+        else if (a == "--timeout-ms") o.timeout_ms = std::stoi(next());
+        else if (a == "--out") o.out = next();
+        else {
+            std::cerr << "[loadgen] unknown option " << a << "\n";
+            return false;
+        }
+    }
+    if (o.concurrency == 0 || o.concurrency > o.clients) o.concurrency = o.clients;
+    return o.clients > 0 && o.rounds > 0 && o.sample_ms > 0;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    Options opt;
+    try {
+        if (!parseArgs(argc, argv, opt)) return 1;
+    } catch (const std::exception& e) {
+        std::cerr << "[loadgen] " << e.what() << "\n";
+        return 1;
+    }
+
+    const std::string keyPayload = makePayload(opt.key_bytes);
+    const std::string weightsPayload = makePayload(opt.weights_bytes);
+    std::cout << "[loadgen] " << opt.clients << " clients x " << opt.rounds << " rounds, concurrency "
+              << opt.concurrency << ", keys " << opt.key_bytes << " B, weights " << opt.weights_bytes << " B -> "
+              << opt.url << std::endl;
+
+    // Sampler: progress + server RSS over time
+    json timeline = json::array();
+    std::atomic<bool> done{false};
+    auto start = Clock::now();
+    auto sample = [&] {
+        json s;
+        s["t_ms"] = std::chrono::duration_cast<std::chrono::milliseconds>(Clock::now() - start).count();
+        s["requests"] = g_requests.load();
+        s["errors"] = g_errors.load();
+        s["bytes"] = g_bytes.load();
+        if (opt.server_pid > 0) s["server_rss_kb"] = readRssKb(opt.server_pid);
+        timeline.push_back(std::move(s));
+    };
+    std::thread sampler([&] {
+        while (!done) {
+            sample();
+            std::this_thread::sleep_for(std::chrono::milliseconds(opt.sample_ms));
+        }
+    });
+
+    // Workers pull clients off a shared counter; stats are sharded per worker
+    std::atomic<size_t> nextClient{0};
+    std::vector<std::map<std::string, EndpointStats>> shards(opt.concurrency);
+    std::vector<std::thread> workers;
+    for (size_t w = 0; w < opt.concurrency; w++) {
+        workers.emplace_back([&, w] {
+            for (size_t i; (i = nextClient++) < opt.clients;) {
+                SimClient(opt, i, keyPayload, weightsPayload, shards[w]).run();
+            }
+        });
+    }
+    for (auto& t : workers) t.join();
+    double elapsed_s = std::chrono::duration<double>(Clock::now() - start).count();
+    done = true;
+    sampler.join();
+    sample();
+
+    // Merge shards
+    std::map<std::string, EndpointStats> merged;
+    EndpointStats total;
+    for (auto& shard : shards) {
+        for (auto& kv : shard) {
+            auto& m = merged[kv.first];
+            for (auto* dst : {&m, &total}) {
+                dst->latency_us.insert(dst->latency_us.end(), kv.second.latency_us.begin(), kv.second.latency_us.end());
+                dst->errors += kv.second.errors;
+                dst->bytes_sent += kv.second.bytes_sent;
+                dst->bytes_received += kv.second.bytes_received;
+            }
+        }
+    }
+
+    json report;
+    report["options"] = {{"url", opt.url}, {"clients", opt.clients}, {"concurrency", opt.concurrency},
+                         {"rounds", opt.rounds}, {"key_bytes", opt.key_bytes}, {"weights_bytes", opt.weights_bytes},
+                         {"keepalive", opt.keepalive}};
+    report["elapsed_s"] = elapsed_s;
+
+    auto summarize = [&](EndpointStats& s) {
+        size_t n = s.latency_us.size();
+        return json{{"requests", n},
+                    {"errors", s.errors},
+                    {"req_per_s", n / elapsed_s},
+                    {"mb_per_s", (s.bytes_sent + s.bytes_received) / elapsed_s / (1024.0 * 1024.0)},
+                    {"p50_ms", percentile(s.latency_us, 50) / 1000.0},
+                    {"p90_ms", percentile(s.latency_us, 90) / 1000.0},
+                    {"p99_ms", percentile(s.latency_us, 99) / 1000.0},
+                    {"max_ms", s.latency_us.empty() ? 0.0
+                                                    : *std::max_element(s.latency_us.begin(), s.latency_us.end()) / 1000.0}};
+    };
+
+    std::cout << std::left << std::setw(26) << "endpoint" << std::right << std::setw(8) << "reqs" << std::setw(7)
+              << "errs" << std::setw(10) << "req/s" << std::setw(10) << "MB/s" << std::setw(10) << "p50 ms"
+              << std::setw(10) << "p90 ms" << std::setw(10) << "p99 ms" << std::setw(10) << "max ms" << "\n";
+    auto print = [](const std::string& name, const json& s) {
+        std::cout << std::left << std::setw(26) << name << std::right << std::fixed << std::setprecision(1)
+                  << std::setw(8) << s["requests"].get<size_t>() << std::setw(7) << s["errors"].get<size_t>()
+                  << std::setw(10) << s["req_per_s"].get<double>() << std::setw(10) << s["mb_per_s"].get<double>()
+                  << std::setw(10) << s["p50_ms"].get<double>() << std::setw(10) << s["p90_ms"].get<double>()
+                  << std::setw(10) << s["p99_ms"].get<double>() << std::setw(10) << s["max_ms"].get<double>() << "\n";
+    };
+    for (auto& kv : merged) {
+        report["endpoints"][kv.first] = summarize(kv.second);
+        print(kv.first, report["endpoints"][kv.first]);
+    }
+    report["total"] = summarize(total);
+    print("total", report["total"]);
+
+    if (opt.server_pid > 0) {
+        long peak = 0;
+        for (const auto& s : timeline) peak = std::max(peak, s.value("server_rss_kb", 0L));
+        report["server_peak_rss_kb"] = peak;
+        std::cout << "[loadgen] server peak RSS " << peak / 1024 << " MB\n";
+    }
+    report["timeline"] = std::move(timeline);
+
+    std::ofstream(opt.out) << report.dump(2) << "\n";
+    std::cout << "[loadgen] " << std::setprecision(2) << elapsed_s << " s, report written to " << opt.out << std::endl;
+    return total.errors == 0 ? 0 : 2;
+}
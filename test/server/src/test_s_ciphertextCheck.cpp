@@ -0,0 +1,180 @@
+#include <gtest/gtest.h>
+#include <nlohmann/json.hpp>
+#include <filesystem>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+#include <unistd.h>
+#include "ppfl/ppfl.h"
+#include "test_helper_fns.hpp"
+#include "../../../server/src/ciphertextCheck.h"
+
+using json = nlohmann::json;
+namespace fs = std::filesystem;
+
+// Upload-time ciphertext checks: ppfl::CheckHeader on each header field and
+// runMserver's CiphertextCheck on streamed layers and whole documents.
+static ppfl::CiphertextHeader specHeader() {
+    ppfl::CiphertextHeader spec;
+    spec.ring = 16384;
+    spec.towers = 3;
+    spec.scaleBits = 50;
+    spec.slots = 8192;
+    spec.encoding = "CKKS_PACKED";
+    return spec;
+}
+
+static void expectMismatch(const ppfl::CiphertextHeader& spec, const ppfl::CiphertextHeader& h,
+                           const std::string& field) {
+    try {
+        ppfl::CheckHeader(spec, h);
+        ADD_FAILURE() << field << " mismatch accepted";
+    } catch (const ppfl::Error& e) {
+        EXPECT_NE(std::string(e.what()).find(field), std::string::npos) << e.what();
+    }
+}
+
+// --- CheckHeader: each field that does not fit is named ---
+TEST(CheckHeaderTest, MatchingHeaderAccepted) {
+    ppfl::CiphertextHeader spec = specHeader(), h = specHeader();
+    EXPECT_NO_THROW(ppfl::CheckHeader(spec, h));
+    h.level = 1;
+    h.towers = 2;
+    EXPECT_NO_THROW(ppfl::CheckHeader(spec, h));
+    h.keyTag = "any";  // spec without a key tag
+    EXPECT_NO_THROW(ppfl::CheckHeader(spec, h));
+}
+
+TEST(CheckHeaderTest, EachFieldChecked) {
+    ppfl::CiphertextHeader spec = specHeader();
+    auto with = [](const std::function<void(ppfl::CiphertextHeader&)>& change) {
+        ppfl::CiphertextHeader h = specHeader();
+        change(h);
+        return h;
+    };
+    expectMismatch(spec, with([](auto& h) { h.encoding = "CKKS_COEF"; }), "encoding");
+    expectMismatch(spec, with([](auto& h) { h.ring = 8192; }), "ring dimension");
+    expectMismatch(spec, with([](auto& h) { h.towers = 2; }), "tower count");
+    expectMismatch(spec, with([](auto& h) { h.level = 4; h.towers = 0; }), "tower count");
+    expectMismatch(spec, with([](auto& h) { h.scaleBits = 40; }), "scaling factor");
+    expectMismatch(spec, with([](auto& h) { h.slots = 4096; }), "slot count");
+
+    spec.keyTag = "client_1";
+    expectMismatch(spec, with([](auto& h) { h.keyTag = "client_2"; }), "key tag");
+    expectMismatch(spec, specHeader(), "key tag");
+}
+
+TEST(CheckHeaderTest, JsonRoundTrip) {
+    ppfl::CiphertextHeader h = specHeader();
+    h.level = 1;
+    h.towers = 2;
+    h.keyTag = "tag";
+    ppfl::CiphertextHeader back = ppfl::HeaderFromJson(ppfl::HeaderToJson(h));
+    EXPECT_EQ(back.ring, h.ring);
+    EXPECT_EQ(back.towers, h.towers);
+    EXPECT_EQ(back.level, h.level);
+    EXPECT_EQ(back.keyTag, h.keyTag);
+    EXPECT_THROW(ppfl::HeaderFromJson(json{{"ring", 16384}}), ppfl::Error);
+}
+
+// --- CiphertextCheck under the federation's CC.json and two clients' keys ---
+class CiphertextCheckTest : public ::testing::Test {
+protected:
+    static std::shared_ptr<const ppfl::Context> ctx;
+    static ppfl::KeyPair owner, other;
+    static std::string ccFile, dir, ownerKey, otherKey;
+
+    static void SetUpTestSuite() {
+        json config = loadJson("test/server/config/test_s_config.json")["test_s_ciphertextCheck"];
+        ccFile = config["CCFile"];
+        ctx = ppfl::Context::LoadFile(ccFile);
+        owner = ppfl::GenerateKeyPair(*ctx);
+        other = ppfl::GenerateKeyPair(*ctx);
+        dir = (fs::temp_directory_path() / ("ppfl_test_ctcheck_" + std::to_string(getpid()))).string();
+        fs::create_directories(dir);
+        ownerKey = dir + "/owner_public.txt";
+        otherKey = dir + "/other_public.txt";
+        ppfl::SavePublicKeyFile(ownerKey, owner.publicKey);
+        ppfl::SavePublicKeyFile(otherKey, other.publicKey);
+    }
+
+    static void TearDownTestSuite() {
+        fs::remove_all(dir);
+        owner = other = ppfl::KeyPair();
+        ctx.reset();
+    }
+
+    static json layer(const std::string& name) {
+        std::vector<double> values = {0.5, -1.0, 2.0};
+        TensorView t;
+        t.name = name;
+        t.shape = {values.size()};
+        t.count = values.size();
+        t.dtype = TensorDType::Float64;
+        t.data = values.data();
+        return ppfl::EncryptLayer(*ctx, owner.publicKey, t, 0.5, 1.0);
+    }
+
+    static bool check(CiphertextCheck& c, const json& encLayer, const std::string& key, std::string& err) {
+        std::string text = encLayer.dump();
+        return c.check(text.data(), text.size(), key, err);
+    }
+};
+
+std::shared_ptr<const ppfl::Context> CiphertextCheckTest::ctx;
+ppfl::KeyPair CiphertextCheckTest::owner, CiphertextCheckTest::other;
+std::string CiphertextCheckTest::ccFile, CiphertextCheckTest::dir, CiphertextCheckTest::ownerKey,
+    CiphertextCheckTest::otherKey;
+
+TEST_F(CiphertextCheckTest, StreamedLayer) {
+    CiphertextCheck c(ccFile);
+    std::string err;
+    json l = layer("dense");
+    EXPECT_TRUE(check(c, l, ownerKey, err)) << err;
+    EXPECT_TRUE(check(c, l, "", err)) << err;
+    EXPECT_TRUE(check(c, l, dir + "/not_uploaded_yet.txt", err)) << err;
+
+    EXPECT_FALSE(check(c, l, otherKey, err));
+    EXPECT_NE(err.find("key tag"), std::string::npos) << err;
+
+    l.erase("ct_header");
+    EXPECT_FALSE(check(c, l, ownerKey, err));
+    EXPECT_EQ(err, "no ct_header");
+    EXPECT_FALSE(c.check("", 0, ownerKey, err));
+}
+
+TEST_F(CiphertextCheckTest, WholeModel) {
+    CiphertextCheck c(ccFile);
+    std::string err;
+    json doc = {{"weights_summary", json::array({layer("dense"), layer("dense_1")})}};
+    EXPECT_TRUE(c.checkModel(doc, ownerKey, err)) << err;
+    EXPECT_FALSE(c.checkModel(doc, otherKey, err));
+    EXPECT_NE(err.find("dense"), std::string::npos) << err;
+
+    // A truncated ciphertext in the second layer
+    json cut = doc;
+    std::string& v = cut["weights_summary"][1]["values"][0].get_ref<std::string&>();
+    v.resize(v.size() / 8);
+    EXPECT_FALSE(c.checkModel(cut, ownerKey, err));
+    EXPECT_NE(err.find("dense_1"), std::string::npos) << err;
+
+    // A headerless layer is not decoded for its header, unlike the CLIs' legacy path
+    json bare = doc;
+    bare["weights_summary"][1].erase("ct_header");
+    EXPECT_FALSE(c.checkModel(bare, ownerKey, err));
+    EXPECT_NE(err.find("dense_1: no ct_header"), std::string::npos) << err;
+    EXPECT_EQ(ppfl::ValidateModel(*ctx, bare), owner.publicKey->GetKeyTag());
+    bare["weights_summary"][1]["mean"] = "bm90IGEgY2lwaGVydGV4dA==";
+    EXPECT_FALSE(c.checkModel(bare, ownerKey, err));
+    EXPECT_NE(err.find("no ct_header"), std::string::npos) << err;
+
+    EXPECT_FALSE(c.checkModel(json{{"layers", json::array()}}, ownerKey, err));
+}
+
+TEST_F(CiphertextCheckTest, MissingContext) {
+    CiphertextCheck c(dir + "/no_CC.json");
+    std::string err;
+    EXPECT_FALSE(check(c, layer("dense"), ownerKey, err));
+    EXPECT_NE(err.find("no CryptoContext"), std::string::npos) << err;
+}
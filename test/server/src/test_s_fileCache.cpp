@@ -0,0 +1,117 @@
+#include <gtest/gtest.h>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <unistd.h>
+#include "../../../server/src/fileCache.h"
+
+namespace fs = std::filesystem;
+
+// FileCache: content-hash ETags, revalidation on change and LRU eviction
+class FileCacheTest : public ::testing::Test {
+protected:
+    std::string dir;
+
+    void SetUp() override {
+        dir = (fs::temp_directory_path() / ("ppfl_test_filecache_" + std::to_string(getpid()))).string();
+        fs::remove_all(dir);
+        fs::create_directories(dir);
+    }
+
+    void TearDown() override { fs::remove_all(dir); }
+
+    std::string write(const std::string& name, const std::string& body) {
+        std::string path = dir + "/" + name;
+        std::ofstream(path, std::ios::binary | std::ios::trunc) << body;
+        return path;
+    }
+};
+
+// --- ETag: quoted, from the content only ---
+TEST_F(FileCacheTest, ETagFollowsContent) {
+    FileCache cache(1 << 20);
+    auto a = cache.get(write("a.key", "public key A"));
+    auto b = cache.get(write("b.key", "public key A"));
+    auto c = cache.get(write("c.key", "public key C"));
+    ASSERT_TRUE(a && b && c);
+    EXPECT_EQ(a->etag.size(), 34u);
+    EXPECT_EQ(a->etag.front(), '"');
+    EXPECT_EQ(a->etag, b->etag);
+    EXPECT_NE(a->etag, c->etag);
+    EXPECT_EQ(a->etag, FileCache::ETag("public key A"));
+}
+
+TEST_F(FileCacheTest, IfNoneMatch) {
+    std::string etag = FileCache::ETag("x");
+    EXPECT_TRUE(FileCache::Matches(etag, etag));
+    EXPECT_TRUE(FileCache::Matches("*", etag));
+    EXPECT_TRUE(FileCache::Matches("\"other\", W/" + etag, etag));
+    EXPECT_FALSE(FileCache::Matches(FileCache::ETag("y"), etag));
+    EXPECT_FALSE(FileCache::Matches("", etag));
+}
+
+// --- Hits while unchanged, a new body (and ETag) once rewritten ---
+TEST_F(FileCacheTest, RevalidatesOnChange) {
+    FileCache cache(1 << 20);
+    std::string path = write("CC.json", "{\"v\":1}");
+    auto first = cache.get(path);
+    auto again = cache.get(path);
+    EXPECT_EQ(first, again);
+    EXPECT_EQ(cache.hits(), 1u);
+    EXPECT_EQ(cache.misses(), 1u);
+
+    write("CC.json", "{\"v\":22}");
+    auto changed = cache.get(path);
+    ASSERT_TRUE(changed);
+    EXPECT_EQ(changed->body, "{\"v\":22}");
+    EXPECT_NE(changed->etag, first->etag);
+    EXPECT_EQ(cache.misses(), 2u);
+    EXPECT_EQ(cache.bytes(), changed->body.size());
+
+    // Same size: caught by the mtime
+    write("CC.json", "{\"v\":33}");
+    fs::last_write_time(path, fs::last_write_time(path) + std::chrono::seconds(2));
+    EXPECT_EQ(cache.get(path)->body, "{\"v\":33}");
+}
+
+// --- Least recently used bodies go first; oversized ones are never kept ---
+TEST_F(FileCacheTest, EvictsLeastRecentlyUsed) {
+    FileCache cache(10);
+    std::string a = write("a", "aaaa"), b = write("b", "bbbb"), c = write("c", "cccc");
+    cache.get(a);
+    cache.get(b);
+    cache.get(a);  // b is now the oldest
+    cache.get(c);
+    EXPECT_EQ(cache.bytes(), 8u);
+    size_t misses = cache.misses();
+    cache.get(a);
+    EXPECT_EQ(cache.misses(), misses);
+    cache.get(b);
+    EXPECT_EQ(cache.misses(), misses + 1);
+
+    auto big = cache.get(write("big", std::string(64, 'x')));
+    ASSERT_TRUE(big);
+    EXPECT_EQ(big->body.size(), 64u);
+    EXPECT_LE(cache.bytes(), 10u);
+}
+
+TEST_F(FileCacheTest, MissingFileAndReader) {
+    FileCache cache(1 << 20);
+    EXPECT_FALSE(cache.get(dir + "/nope"));
+
+    std::string path = write("k", "on disk");
+    size_t reads = 0;
+    cache.setReader([&reads](const std::string&, std::string& out) {
+        reads++;
+        out = "via reader";
+        return true;
+    });
+    auto e = cache.get(path);
+    ASSERT_TRUE(e);
+    EXPECT_EQ(e->body, "via reader");
+    EXPECT_EQ(reads, 1u);
+
+    cache.setReader([](const std::string&, std::string&) { return false; });
+    EXPECT_FALSE(cache.get(write("unreadable", "x")));
+}
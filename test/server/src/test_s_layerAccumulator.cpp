@@ -0,0 +1,154 @@
+#include <gtest/gtest.h>
+#include <nlohmann/json.hpp>
+#include <cmath>
+#include <memory>
+#include <vector>
+#include "ppfl/ppfl.h"
+#include "test_helper_fns.hpp"
+
+using json = nlohmann::json;
+
+// Encrypted-domain weighted averaging (ppfl::LayerAccumulator) under the
+// federation's CC.json: contributions re-encrypted into one domain, weighted,
+// merged as relay partials and decrypted again.
+class LayerAccumulatorTest : public ::testing::Test {
+protected:
+    static std::shared_ptr<const ppfl::Context> ctx;
+    static ppfl::KeyPair anchor, other;
+    static ppfl::EvalKey toAnchor;
+    static int depth;
+
+    static void SetUpTestSuite() {
+        json config = loadJson("test/server/config/test_s_config.json")["test_s_layerAccumulator"];
+        depth = loadJson(config["ConfigFile"])["MultiplicativeDepth"];
+        ctx = ppfl::Context::LoadFile(config["CCFile"]);
+        anchor = ppfl::GenerateKeyPair(*ctx);
+        other = ppfl::GenerateKeyPair(*ctx);
+        toAnchor = ppfl::GenerateReKey(*ctx, other.secretKey, anchor.publicKey);
+    }
+
+    static void TearDownTestSuite() {
+        toAnchor = nullptr;
+        anchor = other = ppfl::KeyPair();
+        ctx.reset();
+    }
+
+    // Layer "dense" holding `values`, encrypted in the anchor domain (directly,
+    // or under the other key and re-encrypted, as runMserver does)
+    static json layer(const std::vector<double>& values, double mean, bool viaRekey = false) {
+        TensorView t;
+        t.name = "dense";
+        t.shape = {values.size()};
+        t.count = values.size();
+        t.dtype = TensorDType::Float64;
+        t.data = values.data();
+        if (!viaRekey) return ppfl::EncryptLayer(*ctx, anchor.publicKey, t, mean, 0.0);
+        return ppfl::ReEncryptLayer(*ctx, toAnchor, ppfl::EncryptLayer(*ctx, other.publicKey, t, mean, 0.0));
+    }
+
+    static void expectDecrypts(const json& encLayer, const std::vector<double>& values, double mean) {
+        ppfl::PlainLayer plain = ppfl::DecryptLayer(*ctx, anchor.secretKey, encLayer);
+        ASSERT_EQ(plain.values.size(), values.size());
+        for (size_t i = 0; i < values.size(); i++) EXPECT_NEAR(plain.values[i], values[i], 1e-3) << "value " << i;
+        EXPECT_NEAR(plain.mean, mean, 1e-3);
+    }
+};
+
+std::shared_ptr<const ppfl::Context> LayerAccumulatorTest::ctx;
+ppfl::KeyPair LayerAccumulatorTest::anchor, LayerAccumulatorTest::other;
+ppfl::EvalKey LayerAccumulatorTest::toAnchor;
+int LayerAccumulatorTest::depth = 0;
+
+// --- Unit weights: plain mean of re-encrypted and anchor contributions ---
+TEST_F(LayerAccumulatorTest, UnitWeightsAverage) {
+    ppfl::LayerAccumulator acc;
+    acc.Add(*ctx, layer({1.0, 2.0, 3.0}, 1.0));
+    acc.Add(*ctx, layer({3.0, 4.0, 5.0}, 3.0, true));
+    EXPECT_EQ(acc.Count(), 2u);
+    EXPECT_DOUBLE_EQ(acc.WeightSum(), 2.0);
+    expectDecrypts(acc.Finalize(*ctx), {2.0, 3.0, 4.0}, 2.0);
+}
+
+// --- A stale (down-weighted) update counts for its weight only ---
+TEST_F(LayerAccumulatorTest, StaleWeightAverage) {
+    ppfl::LayerAccumulator acc;
+    acc.Add(*ctx, layer({1.0, 1.0}, 1.0));
+    acc.Add(*ctx, layer({4.0, 7.0}, 4.0, true), 0.5);
+    EXPECT_DOUBLE_EQ(acc.WeightSum(), 1.5);
+    expectDecrypts(acc.Finalize(*ctx), {2.0, 3.0}, 2.0);
+}
+
+// --- Partials merged upstream give the same average as one flat accumulator ---
+TEST_F(LayerAccumulatorTest, PartialMergeMatchesFlat) {
+    ppfl::LayerAccumulator left, right, root;
+    left.Add(*ctx, layer({1.0, 2.0}, 1.0));
+    left.Add(*ctx, layer({3.0, 4.0}, 3.0, true));
+    right.Add(*ctx, layer({5.0, 6.0}, 5.0, true));
+
+    json p = left.Partial();
+    EXPECT_DOUBLE_EQ(p["weight"].get<double>(), 2.0);
+    EXPECT_EQ(p["count"].get<size_t>(), 2u);
+
+    root.AddPartial(*ctx, p);
+    root.AddPartial(*ctx, right.Partial());
+    EXPECT_EQ(root.Count(), 3u);
+    EXPECT_DOUBLE_EQ(root.WeightSum(), 3.0);
+    expectDecrypts(root.Finalize(*ctx), {3.0, 4.0}, 3.0);
+}
+
+// --- Tree aggregate with a stale update folded in at a relay ---
+TEST_F(LayerAccumulatorTest, StaleWeightedTreeAggregateDecrypts) {
+    ppfl::LayerAccumulator relay, root;
+    relay.Add(*ctx, layer({2.0, 2.0}, 2.0));
+    relay.Add(*ctx, layer({8.0, 4.0}, 8.0, true), 0.5);
+    root.AddPartial(*ctx, relay.Partial());
+    root.Add(*ctx, layer({0.0, 2.0}, 0.0, true));
+
+    // (2 + 0.5 * 8 + 0) / 2.5 and (2 + 0.5 * 4 + 2) / 2.5
+    EXPECT_DOUBLE_EQ(root.WeightSum(), 2.5);
+    json agg = root.Finalize(*ctx);
+    expectDecrypts(agg, {2.4, 2.4}, 2.4);
+
+    // Still decryptable in the delivery domain after the final re-encryption
+    ppfl::EvalKey back = ppfl::GenerateReKey(*ctx, anchor.secretKey, other.publicKey);
+    ppfl::PlainLayer delivered = ppfl::DecryptLayer(*ctx, other.secretKey, ppfl::ReEncryptLayer(*ctx, back, agg));
+    EXPECT_NEAR(delivered.values[0], 2.4, 1e-3);
+}
+
+// --- A scaled stale partial needs a third level: refused, accumulator untouched ---
+TEST_F(LayerAccumulatorTest, ScaledStalePartialChecksDepth) {
+    ppfl::LayerAccumulator relay, root;
+    relay.Add(*ctx, layer({4.0}, 4.0), 0.5);
+    root.Add(*ctx, layer({1.0}, 1.0));
+
+    if (depth < 3) {
+        EXPECT_THROW(root.AddPartial(*ctx, relay.Partial(), 0.5), ppfl::Error);
+        EXPECT_EQ(root.Count(), 1u);
+        expectDecrypts(root.Finalize(*ctx), {1.0}, 1.0);
+    } else {
+        root.AddPartial(*ctx, relay.Partial(), 0.5);
+        expectDecrypts(root.Finalize(*ctx), {(1.0 + 0.25 * 4.0) / 1.25}, (1.0 + 0.25 * 4.0) / 1.25);
+    }
+}
+
+// --- Layers are matched by name and shape; weights must be positive ---
+TEST_F(LayerAccumulatorTest, MismatchedLayerRejected) {
+    ppfl::LayerAccumulator acc;
+    acc.Add(*ctx, layer({1.0, 2.0}, 1.0));
+    json renamed = layer({1.0, 2.0}, 1.0);
+    renamed["layer"] = "other";
+    EXPECT_THROW(acc.Add(*ctx, renamed), ppfl::Error);
+    EXPECT_THROW(acc.Add(*ctx, layer({1.0, 2.0}, 1.0), 0.0), ppfl::Error);
+    EXPECT_EQ(acc.Count(), 1u);
+}
+
+TEST_F(LayerAccumulatorTest, EmptyAccumulatorRefusesOutput) {
+    ppfl::LayerAccumulator acc;
+    EXPECT_THROW(acc.Finalize(*ctx), ppfl::Error);
+    EXPECT_THROW(acc.Partial(), ppfl::Error);
+}
+
+int main(int argc, char **argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,287 @@
+#include <gtest/gtest.h>
+#include <nlohmann/json.hpp>
+#include <chrono>
+#include <filesystem>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include <unistd.h>
+#include "ppfl/ppfl.h"
+#include "test_helper_fns.hpp"
+#include "../../../server/src/roundAggregator.h"
+
+using json = nlohmann::json;
+namespace fs = std::filesystem;
+
+// runMserver's in-process aggregation (RoundAggregator): full rounds, early
+// close by quorum or deadline, stale updates and relay partial sums. Clients
+// "1" and "3" upload under their own keys; "2" is the anchor.
+class RoundAggregatorTest : public ::testing::Test {
+protected:
+    static std::shared_ptr<const ppfl::Context> ctx;
+    static ppfl::KeyPair anchor, c1, c3;
+    static std::string ccFile, dir;
+
+    static void SetUpTestSuite() {
+        json config = loadJson("test/server/config/test_s_config.json")["test_s_roundAggregator"];
+        ccFile = config["CCFile"];
+        ctx = ppfl::Context::LoadFile(ccFile);
+        anchor = ppfl::GenerateKeyPair(*ctx);
+        c1 = ppfl::GenerateKeyPair(*ctx);
+        c3 = ppfl::GenerateKeyPair(*ctx);
+        dir = (fs::temp_directory_path() / ("ppfl_test_roundagg_" + std::to_string(getpid()))).string();
+        fs::create_directories(dir);
+        ppfl::SaveEvalKeyFile(dir + "/rk_1.txt", ppfl::GenerateReKey(*ctx, c1.secretKey, anchor.publicKey));
+        ppfl::SaveEvalKeyFile(dir + "/rk_3.txt", ppfl::GenerateReKey(*ctx, c3.secretKey, anchor.publicKey));
+    }
+
+    static void TearDownTestSuite() {
+        fs::remove_all(dir);
+        anchor = c1 = c3 = ppfl::KeyPair();
+        ctx.reset();
+    }
+
+    WorkerPool pool{1};  // one worker: layers are added in submission order
+
+    AggregatorConfig config(const std::string& output) const {
+        AggregatorConfig cfg;
+        cfg.cc_path = ccFile;
+        cfg.contributors = {{"1", dir + "/rk_1.txt", ""}, {"2", "", ""}, {"3", dir + "/rk_3.txt", ""}};
+        cfg.deliveries = {{"", dir + "/" + output}};
+        return cfg;
+    }
+
+    // Encrypted layer k of a client's model: every value and the mean are v
+    static std::string layer(const std::string& client, size_t k, double v) {
+        const ppfl::KeyPair& kp = client == "1" ? c1 : client == "3" ? c3 : anchor;
+        std::vector<double> values = {v, v};
+        TensorView t;
+        t.name = "dense_" + std::to_string(k);
+        t.shape = {values.size()};
+        t.count = values.size();
+        t.dtype = TensorDType::Float64;
+        t.data = values.data();
+        return ppfl::EncryptLayer(*ctx, kp.publicKey, t, v, 0.0).dump();
+    }
+
+    static void submit(RoundAggregator& agg, const std::string& client, int round, size_t k, double v,
+                       size_t layers = 2) {
+        std::string err;
+        ASSERT_TRUE(agg.submitLayer(client, round, k, layers, layer(client, k, v), err)) << err;
+    }
+
+    static json waitFor(const RoundAggregator& agg, const std::function<bool(const json&)>& done) {
+        for (int i = 0; i < 3000; i++) {
+            json s = agg.status();
+            if (done(s) || !s["error"].get<std::string>().empty()) return s;
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        }
+        return agg.status();
+    }
+
+    static json waitComplete(const RoundAggregator& agg) {
+        return waitFor(agg, [](const json& s) { return s["complete"].get<bool>(); });
+    }
+
+    // Per-layer partial sums of a relay whose clients upload `updates`
+    std::vector<json> relayPartials(const std::vector<std::pair<std::string, double>>& updates) {
+        std::mutex m;
+        std::vector<json> partials(2);
+        AggregatorConfig cfg = config("");
+        cfg.contributors.clear();
+        cfg.deliveries.clear();
+        for (const auto& u : updates) cfg.contributors.push_back({u.first, dir + "/rk_" + u.first + ".txt", ""});
+        cfg.forward = [&](int, size_t k, size_t, const json& partial) {
+            std::lock_guard<std::mutex> lk(m);
+            partials[k] = partial;
+        };
+        RoundAggregator relay(cfg, pool);
+        for (size_t k = 0; k < 2; k++) {
+            for (const auto& u : updates) submit(relay, u.first, 1, k, u.second);
+        }
+        json s = waitComplete(relay);
+        EXPECT_TRUE(s["complete"].get<bool>()) << s.dump();
+        return partials;
+    }
+
+    static void submitPartial(RoundAggregator& agg, const std::string& child, size_t k, const json& partial) {
+        std::string err;
+        ASSERT_TRUE(agg.submitLayer(child, 1, k, 2, partial.dump(), err, true)) << err;
+    }
+
+    // Decrypted mean of each layer of an aggregate written in the anchor domain
+    static std::vector<double> means(const std::string& output) {
+        std::vector<double> out;
+        json doc = ppfl::ReadJsonFile(dir + "/" + output);
+        for (const auto& l : doc["weights_summary"]) {
+            ppfl::PlainLayer p = ppfl::DecryptLayer(*ctx, anchor.secretKey, l);
+            EXPECT_NEAR(p.values[0], p.mean, 1e-3);
+            out.push_back(p.mean);
+        }
+        return out;
+    }
+
+    static void expectMeans(const std::vector<double>& got, const std::vector<double>& want) {
+        ASSERT_EQ(got.size(), want.size());
+        for (size_t i = 0; i < want.size(); i++) EXPECT_NEAR(got[i], want[i], 1e-3) << "layer " << i;
+    }
+};
+
+std::shared_ptr<const ppfl::Context> RoundAggregatorTest::ctx;
+ppfl::KeyPair RoundAggregatorTest::anchor, RoundAggregatorTest::c1, RoundAggregatorTest::c3;
+std::string RoundAggregatorTest::ccFile, RoundAggregatorTest::dir;
+
+// --- Every contributor: the plain mean; the first update per layer wins ---
+TEST_F(RoundAggregatorTest, FullRoundAverages) {
+    RoundAggregator agg(config("full.json"), pool);
+    submit(agg, "1", 1, 0, 1.0);
+    submit(agg, "1", 1, 0, 100.0);  // duplicate, ignored
+    submit(agg, "2", 1, 0, 2.0);
+    submit(agg, "3", 1, 0, 6.0);
+    for (const char* c : {"1", "2", "3"}) submit(agg, c, 1, 1, 3.0);
+
+    json s = waitComplete(agg);
+    ASSERT_TRUE(s["complete"].get<bool>()) << s.dump();
+    EXPECT_FALSE(s["closed"].get<bool>());
+    EXPECT_EQ(s["contributor_count"], 3);
+    expectMeans(means("full.json"), {3.0, 3.0});
+}
+
+// --- A quorum of complete contributors closes the round; later uploads are refused ---
+TEST_F(RoundAggregatorTest, QuorumClosesRound) {
+    AggregatorConfig cfg = config("quorum.json");
+    cfg.policy.quorum = 0.5;  // ceil(1.5) = 2 of 3
+    RoundAggregator agg(cfg, pool);
+    EXPECT_EQ(agg.status()["quorum"], 2);
+    submit(agg, "3", 1, 0, 8.0);  // never completes
+    for (size_t k = 0; k < 2; k++) {
+        submit(agg, "1", 1, k, 1.0);
+        submit(agg, "2", 1, k, 3.0);
+    }
+
+    json s = waitComplete(agg);
+    ASSERT_TRUE(s["complete"].get<bool>()) << s.dump();
+    EXPECT_EQ(s["close_reason"], "quorum");
+    EXPECT_EQ(s["contributor_count"], 2);
+    // Layer 0 keeps client 3's update: (1 + 3 + 8) / 3 and (1 + 3) / 2
+    expectMeans(means("quorum.json"), {4.0, 2.0});
+
+    std::string err;
+    EXPECT_FALSE(agg.submitLayer("3", 1, 1, 2, layer("3", 1, 8.0), err));
+    EXPECT_NE(err.find("already closed"), std::string::npos) << err;
+}
+
+// --- The deadline waits for one complete contributor, then seals what each layer has ---
+TEST_F(RoundAggregatorTest, DeadlineSealsPartialLayers) {
+    AggregatorConfig cfg = config("deadline.json");
+    cfg.policy.deadline_ms = 50;
+    RoundAggregator agg(cfg, pool);
+    submit(agg, "3", 1, 0, 5.0);
+    waitFor(agg, [](const json& s) { return s["contributors"]["3"] == 1; });
+    std::this_thread::sleep_for(std::chrono::milliseconds(80));
+    agg.tick();
+    EXPECT_FALSE(agg.status()["closed"].get<bool>());
+
+    submit(agg, "2", 1, 0, 1.0);
+    submit(agg, "2", 1, 1, 1.0);
+    waitFor(agg, [](const json& s) { return s["contributor_count"] == 1; });
+    agg.tick();
+
+    json s = waitComplete(agg);
+    ASSERT_TRUE(s["complete"].get<bool>()) << s.dump();
+    EXPECT_EQ(s["close_reason"], "deadline");
+    // (5 + 1) / 2, and client 2's alone
+    expectMeans(means("deadline.json"), {3.0, 1.0});
+}
+
+// --- Older rounds: refused by default, or folded in at stale_decay^age ---
+TEST_F(RoundAggregatorTest, StaleUpdatesDecayed) {
+    AggregatorConfig cfg = config("stale.json");
+    cfg.policy.decay_stale = true;
+    RoundAggregator agg(cfg, pool);
+    for (size_t k = 0; k < 2; k++) {
+        submit(agg, "1", 5, k, 1.0);
+        submit(agg, "2", 5, k, 1.0);
+        submit(agg, "3", 4, k, 4.0);  // weight 0.5
+    }
+    std::string err;
+    EXPECT_FALSE(agg.submitLayer("3", 3, 0, 2, layer("3", 0, 4.0), err));  // beyond max_staleness
+    EXPECT_NE(err.find("stale round"), std::string::npos) << err;
+
+    json s = waitComplete(agg);
+    ASSERT_TRUE(s["complete"].get<bool>()) << s.dump();
+    EXPECT_DOUBLE_EQ(s["weights"]["3"].get<double>(), 0.5);
+    // (1 + 1 + 0.5 * 4) / 2.5
+    expectMeans(means("stale.json"), {1.6, 1.6});
+}
+
+// --- A relay forwards partial sums; the parent merges them like contributions ---
+TEST_F(RoundAggregatorTest, RelayPartialsMergeUpstream) {
+    AggregatorConfig rootCfg = config("root.json");
+    rootCfg.contributors = {{"relay", "", ""}, {"2", "", ""}};
+    RoundAggregator root(rootCfg, pool);
+    for (size_t k = 0; k < 2; k++) submit(root, "2", 1, k, 6.0);
+    std::vector<json> partials = relayPartials({{"1", 2.0}, {"3", 4.0}});
+    for (size_t k = 0; k < 2; k++) submitPartial(root, "relay", k, partials[k]);
+
+    json s = waitComplete(root);
+    ASSERT_TRUE(s["complete"].get<bool>()) << s.dump();
+    // (2 + 4 + 6) / 3, not the mean of the relay's and the anchor's means
+    expectMeans(means("root.json"), {4.0, 4.0});
+}
+
+// --- Children of different sizes: a layer waits for every contributor, not for a client count ---
+TEST_F(RoundAggregatorTest, RelayChildrenOfDifferentSizes) {
+    AggregatorConfig rootCfg = config("mixed.json");
+    rootCfg.contributors = {{"big", "", ""}, {"small", "", ""}, {"2", "", ""}};
+    RoundAggregator root(rootCfg, pool);
+    std::vector<json> big = relayPartials({{"1", 1.0}, {"3", 3.0}});
+    std::vector<json> small = relayPartials({{"1", 5.0}});
+    for (size_t k = 0; k < 2; k++) {
+        submitPartial(root, "big", k, big[k]);
+        submitPartial(root, "small", k, small[k]);
+    }
+
+    // Three clients are in, but the anchor is not
+    json s = waitFor(root, [](const json& s) { return s["contributors"]["small"] == 2; });
+    EXPECT_EQ(s["layers_complete"], 0) << s.dump();
+    EXPECT_FALSE(s["complete"].get<bool>());
+
+    for (size_t k = 0; k < 2; k++) submit(root, "2", 1, k, 7.0);
+    s = waitComplete(root);
+    ASSERT_TRUE(s["complete"].get<bool>()) << s.dump();
+    // (1 + 3 + 5 + 7) / 4
+    expectMeans(means("mixed.json"), {4.0, 4.0});
+}
+
+// --- Rejected before any crypto work is queued ---
+TEST(RoundAggregatorRejectTest, BadSubmissions) {
+    WorkerPool pool(1);
+    AggregatorConfig cfg;
+    cfg.contributors = {{"1", "", ""}, {"2", "", ""}};
+    RoundAggregator agg(cfg, pool);
+    std::string err;
+    EXPECT_FALSE(agg.hasContributor("7"));
+    EXPECT_FALSE(agg.submitLayer("7", 1, 0, 2, "{}", err));
+    EXPECT_NE(err.find("unknown client"), std::string::npos) << err;
+    EXPECT_FALSE(agg.submitLayer("1", 1, 2, 2, "{}", err));
+    EXPECT_FALSE(agg.submitLayer("1", 1, 0, 0, "{}", err));
+
+    // Starts round 2; the body itself fails on the worker
+    ASSERT_TRUE(agg.submitLayer("1", 2, 0, 2, "not json", err)) << err;
+    EXPECT_FALSE(agg.submitLayer("2", 1, 0, 2, "{}", err));
+    EXPECT_EQ(err, "stale round 1 (current 2)");
+    EXPECT_FALSE(agg.submitLayer("2", 2, 0, 3, "{}", err));
+    EXPECT_NE(err.find("layer count mismatch"), std::string::npos) << err;
+
+    json s;
+    for (int i = 0; i < 300 && (s = agg.status())["error"].get<std::string>().empty(); i++) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    EXPECT_EQ(s["round"], 2);
+    EXPECT_NE(s["error"].get<std::string>().find("layer 0"), std::string::npos) << s.dump();
+    EXPECT_EQ(s["expected"], 2);
+}
@@ -0,0 +1,113 @@
+#include <gtest/gtest.h>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <set>
+#include <thread>
+#include <vector>
+#include "../../../server/src/stealingPool.h"
+
+// runMserver's crypto-job pool (StealingPool): every task runs, priorities
+// are strict, and a job's fan-out is stolen by idle workers.
+class StealingPoolTest : public ::testing::Test {
+protected:
+    std::mutex m;
+    std::condition_variable cv;
+    size_t done = 0;
+    bool open = false;
+
+    void finish() {
+        std::lock_guard<std::mutex> lk(m);
+        done++;
+        cv.notify_all();
+    }
+
+    bool waitDone(size_t n) {
+        std::unique_lock<std::mutex> lk(m);
+        return cv.wait_for(lk, std::chrono::seconds(10), [&] { return done >= n; });
+    }
+
+    // Holds a worker until release()
+    std::function<void()> gate() {
+        return [this] {
+            std::unique_lock<std::mutex> lk(m);
+            cv.wait(lk, [&] { return open; });
+        };
+    }
+
+    void release() {
+        std::lock_guard<std::mutex> lk(m);
+        open = true;
+        cv.notify_all();
+    }
+};
+
+TEST_F(StealingPoolTest, EveryTaskRuns) {
+    std::atomic<int> sum{0};
+    {
+        StealingPool pool(4);
+        EXPECT_EQ(pool.size(), 4u);
+        for (int i = 1; i <= 1000; i++) pool.submit([&sum, i] { sum += i; }, StealingPool::Priority(i % 3));
+    }  // the destructor drains the deques
+    EXPECT_EQ(sum.load(), 500500);
+}
+
+// --- One worker: queued tasks start most urgent first ---
+TEST_F(StealingPoolTest, StrictPriorities) {
+    StealingPool pool(1);
+    std::vector<int> order;
+    pool.submit(gate(), StealingPool::kCritical);
+    while (pool.busy() == 0) std::this_thread::yield();
+
+    auto note = [&](int p) {
+        return [this, &order, p] {
+            {
+                std::lock_guard<std::mutex> lk(m);
+                order.push_back(p);
+            }
+            finish();
+        };
+    };
+    pool.submit(note(2), StealingPool::kBackground);
+    pool.submit(note(1), StealingPool::kRound);
+    pool.submit(note(2), StealingPool::kBackground);
+    pool.submit(note(0), StealingPool::kCritical);
+    EXPECT_EQ(pool.queued(), 4u);
+    EXPECT_EQ(pool.queued(StealingPool::kBackground), 2u);
+    EXPECT_EQ(pool.queued(StealingPool::kCritical), 1u);
+
+    release();
+    ASSERT_TRUE(waitDone(4));
+    EXPECT_EQ(order, (std::vector<int>{0, 1, 2, 2}));
+    EXPECT_EQ(pool.queued(), 0u);
+    EXPECT_EQ(pool.steals(), 0u);
+}
+
+// --- Tasks a job submits from its worker are spread by stealing ---
+TEST_F(StealingPoolTest, NestedFanOutIsStolen) {
+    constexpr size_t kParts = 64;
+    std::set<std::thread::id> ran;
+    StealingPool pool(4);
+    pool.submit(
+        [&] {
+            for (size_t i = 0; i < kParts; i++) {
+                pool.submit(
+                    [&] {
+                        std::this_thread::sleep_for(std::chrono::milliseconds(2));
+                        {
+                            std::lock_guard<std::mutex> lk(m);
+                            ran.insert(std::this_thread::get_id());
+                        }
+                        finish();
+                    },
+                    StealingPool::kRound);
+            }
+        },
+        StealingPool::kRound);
+
+    ASSERT_TRUE(waitDone(kParts));
+    EXPECT_GT(pool.steals(), 0u);
+    EXPECT_GT(ran.size(), 1u);
+}
@@ -0,0 +1,164 @@
+#include <gtest/gtest.h>
+#include <filesystem>
+#include <string>
+#include <unistd.h>
+#include "../../../server/src/fileCache.h"
+#include "../../../server/src/uploadSessions.h"
+
+namespace fs = std::filesystem;
+
+// Resumable chunked uploads (UploadSessions) and the Range parsing behind
+// resumed downloads (FileCache::ParseRange); no server or crypto needed.
+class UploadSessionsTest : public ::testing::Test {
+protected:
+    static constexpr uint64_t kChunk = UploadSessions::kMinChunk;
+    std::string dir;
+    std::string data;  // 2.5 chunks
+
+    void SetUp() override {
+        dir = (fs::temp_directory_path() / ("ppfl_test_uploads_" + std::to_string(getpid()))).string();
+        fs::remove_all(dir);
+        data.resize(kChunk * 5 / 2);
+        for (size_t i = 0; i < data.size(); i++) data[i] = (char) (i * 31 % 251);
+    }
+
+    void TearDown() override { fs::remove_all(dir); }
+
+    std::shared_ptr<UploadSessions::Session> start(UploadSessions& u) {
+        std::string err;
+        auto s = u.create("/uploadEncWeightsC1?round=3", data.size(), kChunk, "",
+                          UploadSessions::Sha256Hex(data.data(), data.size()), "client_1", "weights", err);
+        EXPECT_TRUE(s) << err;
+        return s;
+    }
+
+    bool put(UploadSessions& u, UploadSessions::Session& s, uint64_t offset, std::string& err) {
+        size_t len = std::min<size_t>(kChunk, data.size() - offset);
+        return u.writeChunk(s, offset, data.data() + offset, len, UploadSessions::Sha256Hex(data.data() + offset, len),
+                            err);
+    }
+};
+
+// --- Range: a single bytes= range, clamped to the body ---
+TEST(ParseRangeTest, SatisfiableRanges) {
+    size_t from = 0, to = 0;
+    EXPECT_EQ(FileCache::ParseRange("bytes=0-99", 1000, from, to), 1);
+    EXPECT_EQ(from, 0u);
+    EXPECT_EQ(to, 100u);
+    EXPECT_EQ(FileCache::ParseRange("bytes=500-", 1000, from, to), 1);
+    EXPECT_EQ(from, 500u);
+    EXPECT_EQ(to, 1000u);
+    EXPECT_EQ(FileCache::ParseRange("bytes=990-5000", 1000, from, to), 1);
+    EXPECT_EQ(to, 1000u);
+    EXPECT_EQ(FileCache::ParseRange("bytes=-100", 1000, from, to), 1);
+    EXPECT_EQ(from, 900u);
+    EXPECT_EQ(FileCache::ParseRange("bytes=-5000", 1000, from, to), 1);
+    EXPECT_EQ(from, 0u);
+    EXPECT_EQ(to, 1000u);
+}
+
+TEST(ParseRangeTest, UnsatisfiableAndIgnored) {
+    size_t from = 0, to = 0;
+    EXPECT_EQ(FileCache::ParseRange("bytes=1000-", 1000, from, to), -1);
+    EXPECT_EQ(FileCache::ParseRange("bytes=-0", 1000, from, to), -1);
+    EXPECT_EQ(FileCache::ParseRange("bytes=-10", 0, from, to), -1);
+    // Served whole
+    EXPECT_EQ(FileCache::ParseRange("items=0-9", 1000, from, to), 0);
+    EXPECT_EQ(FileCache::ParseRange("bytes=0-9,20-29", 1000, from, to), 0);
+    EXPECT_EQ(FileCache::ParseRange("bytes=9-0", 1000, from, to), 0);
+    EXPECT_EQ(FileCache::ParseRange("bytes=a-9", 1000, from, to), 0);
+    EXPECT_EQ(FileCache::ParseRange("bytes=+1-9", 1000, from, to), 0);
+    EXPECT_EQ(FileCache::ParseRange("bytes=10", 1000, from, to), 0);
+}
+
+// --- Chunks in any order; bad chunks leave the session as it was ---
+TEST_F(UploadSessionsTest, ChunksOutOfOrderComplete) {
+    UploadSessions u(dir, 3600);
+    auto s = start(u);
+    std::string err;
+    EXPECT_EQ(UploadSessions::Missing(*s), (std::vector<uint64_t>{0, kChunk, 2 * kChunk}));
+    ASSERT_TRUE(put(u, *s, 2 * kChunk, err)) << err;
+    ASSERT_TRUE(put(u, *s, 0, err)) << err;
+    EXPECT_FALSE(s->complete());
+    EXPECT_EQ(s->received(), kChunk + kChunk / 2);
+    ASSERT_TRUE(put(u, *s, kChunk, err)) << err;
+    EXPECT_TRUE(s->complete());
+    EXPECT_EQ(UploadSessions::FileSha256(u.dataPath(s->id)), s->sha256);
+}
+
+TEST_F(UploadSessionsTest, BadChunksRejected) {
+    UploadSessions u(dir, 3600);
+    auto s = start(u);
+    std::string err;
+    std::string sha = UploadSessions::Sha256Hex(data.data(), kChunk);
+    EXPECT_FALSE(u.writeChunk(*s, 1, data.data(), kChunk, sha, err));
+    EXPECT_FALSE(u.writeChunk(*s, 3 * kChunk, data.data(), kChunk, sha, err));
+    EXPECT_FALSE(u.writeChunk(*s, 0, data.data(), kChunk - 1, UploadSessions::Sha256Hex(data.data(), kChunk - 1), err));
+    EXPECT_FALSE(u.writeChunk(*s, 0, data.data(), kChunk, UploadSessions::Sha256Hex(data.data() + 1, kChunk), err));
+    EXPECT_FALSE(u.writeChunk(*s, 0, data.data(), kChunk, "", err));
+    EXPECT_EQ(s->received(), 0u);
+
+    EXPECT_FALSE(u.create("/uploadPubKeyC1", 10, kChunk - 1, "", "", "-", "-", err));
+    EXPECT_FALSE(u.create("/uploadPubKeyC1", 10, UploadSessions::kMaxChunk + 1, "", "", "-", "-", err));
+}
+
+// --- Sizes of 0 or over the limit are refused before anything is allocated ---
+TEST_F(UploadSessionsTest, SizeLimited) {
+    UploadSessions u(dir, 3600, data.size());
+    std::string err;
+    EXPECT_FALSE(u.create("/uploadPubKeyC1", 0, kChunk, "", "", "-", "-", err));
+    EXPECT_NE(err.find("size"), std::string::npos) << err;
+    EXPECT_FALSE(u.create("/uploadPubKeyC1", data.size() + 1, kChunk, "", "", "-", "-", err));
+    EXPECT_FALSE(u.create("/uploadPubKeyC1", UINT64_MAX, kChunk, "", "", "-", "-", err));
+    EXPECT_TRUE(fs::is_empty(dir));
+
+    auto s = start(u);
+    EXPECT_EQ(s->chunks(), 3u);
+
+    // A session over the limit is not resumed after a restart with a lower one
+    UploadSessions lower(dir, 3600, kChunk);
+    EXPECT_FALSE(lower.find(s->id));
+    EXPECT_TRUE(UploadSessions(dir, 3600, data.size()).find(s->id));
+}
+
+// --- A restarted server resumes from the chunks on disk ---
+TEST_F(UploadSessionsTest, ResumesAfterRestart) {
+    std::string id, err;
+    {
+        UploadSessions u(dir, 3600);
+        auto s = start(u);
+        id = s->id;
+        ASSERT_TRUE(put(u, *s, kChunk, err)) << err;
+    }
+    UploadSessions u(dir, 3600);
+    auto s = u.find(id);
+    ASSERT_TRUE(s);
+    EXPECT_EQ(s->target, "/uploadEncWeightsC1?round=3");
+    EXPECT_EQ(s->client_id, "client_1");
+    EXPECT_EQ(UploadSessions::Missing(*s), (std::vector<uint64_t>{0, 2 * kChunk}));
+    ASSERT_TRUE(put(u, *s, 0, err)) << err;
+    ASSERT_TRUE(put(u, *s, 2 * kChunk, err)) << err;
+    EXPECT_TRUE(s->complete());
+    EXPECT_EQ(UploadSessions::FileSha256(u.dataPath(id)), s->sha256);
+}
+
+TEST_F(UploadSessionsTest, UnknownAndUnsafeIds) {
+    UploadSessions u(dir, 3600);
+    EXPECT_FALSE(u.find("0123456789abcdef0123456789abcdef"));
+    EXPECT_FALSE(u.find("../../config/sConfig"));
+    EXPECT_FALSE(u.find(""));
+}
+
+// --- Idle sessions expire, but not one a disk thread is finishing ---
+TEST_F(UploadSessionsTest, ExpireSkipsFinishing) {
+    UploadSessions u(dir, -1);  // everything is idle
+    auto idle = start(u);
+    auto busy = start(u);
+    busy->finishing = true;
+    u.expire();
+    EXPECT_FALSE(u.find(idle->id));
+    EXPECT_TRUE(u.find(busy->id));
+    EXPECT_FALSE(fs::exists(u.dataPath(idle->id)));
+    u.remove(busy->id);
+    EXPECT_EQ(u.active(), 0u);
+}
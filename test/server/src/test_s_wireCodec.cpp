@@ -0,0 +1,107 @@
+#include <gtest/gtest.h>
+#include <sstream>
+#include <string>
+#include "wireCodec.h"
+
+// Content-Encoding codecs (wire::) used by runMserver and ppfl_xfer
+class WireCodecTest : public ::testing::Test {
+protected:
+    wire::Options opt;
+    std::string body;  // Base64-like, several of DecodeTo's 256 KB output chunks
+
+    void SetUp() override {
+        static const char alphabet[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+        uint32_t x = 12345;
+        body.resize(1 << 20);
+        for (auto& ch : body) {
+            x = x * 1103515245 + 12345;
+            ch = alphabet[(x >> 16) % 64];
+        }
+    }
+
+    void roundTrip(const std::string& enc) {
+        std::string packed = wire::Encode(enc, body, opt);
+        EXPECT_LT(packed.size(), body.size()) << enc;
+        std::ostringstream out;
+        EXPECT_EQ(wire::DecodeTo(enc, packed.data(), packed.size(), out), body.size()) << enc;
+        EXPECT_EQ(out.str(), body) << enc;
+        EXPECT_EQ(wire::Decode(enc, wire::Encode(enc, "", opt).data(), wire::Encode(enc, "", opt).size()), "") << enc;
+    }
+
+    void rejectsDamage(const std::string& enc) {
+        std::string packed = wire::Encode(enc, body, opt);
+        EXPECT_THROW(wire::Decode(enc, packed.data(), packed.size() / 2), wire::WireError) << enc << " truncated";
+        std::string garbage(packed.size(), 'x');
+        EXPECT_THROW(wire::Decode(enc, garbage.data(), garbage.size()), wire::WireError) << enc << " corrupt";
+    }
+
+    // 1 MB of zeros packs into a few KB; decoding stops at max_out
+    void boundsOutput(const std::string& enc) {
+        std::string zeros(1 << 20, '\0');
+        std::string bomb = wire::Encode(enc, zeros, opt);
+        EXPECT_LT(bomb.size(), 16u * 1024) << enc;
+        std::ostringstream out;
+        EXPECT_THROW(wire::DecodeTo(enc, bomb.data(), bomb.size(), out, 64 * 1024), wire::WireError) << enc;
+        EXPECT_LE(out.str().size(), 64u * 1024) << enc;
+        EXPECT_EQ(wire::Decode(enc, bomb.data(), bomb.size(), zeros.size()), zeros) << enc;
+        EXPECT_THROW(wire::Decode(enc, bomb.data(), bomb.size(), zeros.size() - 1), wire::WireError) << enc;
+    }
+};
+
+TEST_F(WireCodecTest, IdentityPassesThrough) {
+    EXPECT_EQ(wire::Decode("", body.data(), body.size()), body);
+    EXPECT_EQ(wire::Decode("identity", "abc", 3), "abc");
+    EXPECT_EQ(wire::Decode("identity", "abc", 3, 3), "abc");
+    EXPECT_THROW(wire::Decode("identity", "abc", 3, 2), wire::WireError);
+}
+
+TEST_F(WireCodecTest, GzipRoundTrip) {
+    roundTrip("gzip");
+    opt.gzip_level = 1;
+    roundTrip("gzip");
+}
+
+TEST_F(WireCodecTest, GzipRejectsDamage) {
+    rejectsDamage("gzip");
+}
+
+TEST_F(WireCodecTest, GzipBoundsOutput) {
+    boundsOutput("gzip");
+}
+
+#ifdef PPFL_WITH_ZSTD
+TEST_F(WireCodecTest, ZstdRoundTrip) {
+    roundTrip("zstd");
+    opt.zstd_level = 19;
+    roundTrip("zstd");
+}
+
+TEST_F(WireCodecTest, ZstdRejectsDamage) {
+    rejectsDamage("zstd");
+}
+
+TEST_F(WireCodecTest, ZstdBoundsOutput) {
+    boundsOutput("zstd");
+}
+#endif
+
+TEST_F(WireCodecTest, UnknownEncodingRefused) {
+    EXPECT_FALSE(wire::Supported("br"));
+    EXPECT_THROW(wire::Decode("br", "abc", 3), wire::WireError);
+    EXPECT_THROW(wire::Encode("br", body, opt), wire::WireError);
+}
+
+// --- Accept-Encoding: best shared encoding, q=0 disables one ---
+TEST_F(WireCodecTest, Negotiate) {
+    EXPECT_EQ(wire::Negotiate(""), "");
+    EXPECT_EQ(wire::Negotiate("identity"), "");
+    EXPECT_EQ(wire::Negotiate("gzip, deflate"), "gzip");
+    EXPECT_EQ(wire::Negotiate("gzip;q=0"), "");
+    EXPECT_EQ(wire::Negotiate("gzip;q=0.5"), "gzip");
+#ifdef PPFL_WITH_ZSTD
+    EXPECT_EQ(wire::Negotiate("gzip, zstd"), "zstd");
+    EXPECT_EQ(wire::Negotiate("zstd;q=0, gzip"), "gzip");
+#else
+    EXPECT_EQ(wire::Negotiate("zstd, gzip"), "gzip");
+#endif
+}
@@ -42,5 +42,37 @@ echo "[TEST] Running test_s_aggregateEncryptedWeights (using test/server/config/
 echo "[TEST] Running test_c_decryptModelWeights (using test/client/config/test_c_config.json)..."
 ./test/client/build/test_c_decryptModelWeights --config test/client/config/test_c_config.json
 
+# --- Run test_s_layerAccumulator ---
+echo "[TEST] Running test_s_layerAccumulator (using test/server/config/test_s_config.json)..."
+./test/server/build/test_s_layerAccumulator --config test/server/config/test_s_config.json
+
+# --- Run test_s_uploadSessions ---
+echo "[TEST] Running test_s_uploadSessions..."
+./test/server/build/test_s_uploadSessions
+
+# --- Run test_s_fileCache ---
+echo "[TEST] Running test_s_fileCache..."
+./test/server/build/test_s_fileCache
+
+# --- Run test_s_wireCodec ---
+echo "[TEST] Running test_s_wireCodec..."
+./test/server/build/test_s_wireCodec
+
+# --- Run test_c_taskGraph ---
+echo "[TEST] Running test_c_taskGraph..."
+./test/client/build/test_c_taskGraph
+
+# --- Run test_s_stealingPool ---
+echo "[TEST] Running test_s_stealingPool..."
+./test/server/build/test_s_stealingPool
+
+# --- Run test_s_ciphertextCheck ---
+echo "[TEST] Running test_s_ciphertextCheck (using test/server/config/test_s_config.json)..."
+./test/server/build/test_s_ciphertextCheck --config test/server/config/test_s_config.json
+
+# --- Run test_s_roundAggregator ---
+echo "[TEST] Running test_s_roundAggregator (using test/server/config/test_s_config.json)..."
+./test/server/build/test_s_roundAggregator --config test/server/config/test_s_config.json
+
 echo "All tests completed successfully."
 